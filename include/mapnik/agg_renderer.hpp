@@ -26,6 +26,7 @@
 // mapnik
 #include <mapnik/config.hpp>            // for MAPNIK_DECL
 #include <mapnik/feature_style_processor.hpp>
+#include <mapnik/feature.hpp>             // for feature_batch
 #include <mapnik/util/noncopyable.hpp>       // for noncopyable
 #include <mapnik/rule.hpp>              // for rule, symbolizers
 #include <mapnik/box2d.hpp>     // for box2d
@@ -126,6 +127,18 @@ public:
                  mapnik::feature_impl & feature,
                  proj_transform const& prj_trans);
 
+    // draw features sharing a symbolizer, setting the renderer up once
+    // when its properties are the same for all of them
+    void process_batch(line_symbolizer const& sym,
+                       feature_batch const& features,
+                       proj_transform const& prj_trans);
+    void process_batch(polygon_symbolizer const& sym,
+                       feature_batch const& features,
+                       proj_transform const& prj_trans);
+    void process_batch(markers_symbolizer const& sym,
+                       feature_batch const& features,
+                       proj_transform const& prj_trans);
+
     inline bool process(rule::symbolizers const&,
                         mapnik::feature_impl&,
                         proj_transform const& )
@@ -137,6 +150,12 @@ public:
     void painted(bool painted);
     bool painted();
 
+    // create renderer drawing into its own transparent buffer, used by apply_parallel()
+    std::unique_ptr<agg_renderer> make_layer_processor(Map const& m, bool share_detector) const;
+    // composite output of renderer created by make_layer_processor() into this one,
+    // merging labels it placed into own detector (replacing them if `replace_labels`)
+    void composite_layer_processor(agg_renderer & layer_processor, bool replace_labels);
+
     inline eAttributeCollectionPolicy attribute_collection_policy() const
     {
         return DEFAULT;
@@ -160,7 +179,25 @@ protected:
     void draw_geo_extent(box2d<double> const& extent,mapnik::color const& color);
 
 private:
+    // draw [begin, end) (iterators to feature pointers) reading the
+    // properties of `sym` once, from the first feature
+    template <typename Iterator>
+    void render_lines(line_symbolizer const& sym, Iterator begin, Iterator end,
+                      proj_transform const& prj_trans);
+    template <typename Iterator>
+    void render_polygons(polygon_symbolizer const& sym, Iterator begin, Iterator end,
+                         proj_transform const& prj_trans);
+    // `features` is a feature or a feature_batch, read properties from `first`
+    template <typename Features>
+    void render_markers(markers_symbolizer const& sym, mapnik::feature_impl const& first,
+                        Features & features, proj_transform const& prj_trans);
+
+    // layer renderer sharing settings of `parent`
+    agg_renderer(Map const& m, agg_renderer const& parent, std::shared_ptr<buffer_type> const& pixmap,
+                 std::shared_ptr<detector_type> detector);
+
     buffer_type & pixmap_;
+    std::shared_ptr<buffer_type> owned_pixmap_;
     std::shared_ptr<buffer_type> internal_buffer_;
     mutable buffer_type * current_buffer_;
     mutable bool style_level_compositing_;
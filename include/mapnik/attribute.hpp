@@ -28,6 +28,8 @@
 #include <mapnik/value.hpp>
 #include <mapnik/util/geometry_to_ds_type.hpp>
 // stl
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -36,13 +38,28 @@ namespace mapnik {
 struct attribute
 {
     std::string name_;
+    // index of name_ in the context last evaluated, see feature_impl::get
+    mutable std::atomic<std::uint64_t> binding_;
+
     explicit attribute(std::string const& _name)
-        : name_(_name) {}
+        : name_(_name),
+          binding_(0) {}
+
+    attribute(attribute const& other)
+        : name_(other.name_),
+          binding_(0) {}
+
+    attribute & operator=(attribute const& other)
+    {
+        name_ = other.name_;
+        binding_ = 0;
+        return *this;
+    }
 
     template <typename V ,typename F>
     V const& value(F const& f) const
     {
-        return f.get(name_);
+        return f.get(name_, binding_);
     }
 
     std::string const& name() const { return name_;}
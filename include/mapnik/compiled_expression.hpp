@@ -0,0 +1,145 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_COMPILED_EXPRESSION_HPP
+#define MAPNIK_COMPILED_EXPRESSION_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/expression_evaluator.hpp>
+#include <mapnik/attribute.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/value.hpp>
+
+// stl
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// Expression lowered from the expr_node tree to a linear stack machine
+// program. Constant subexpressions are folded at compile time, `and` and
+// `or` jump over their right operand, comparisons of an attribute with a
+// constant read the feature value in place, and attribute names are bound
+// to context indices on first use. Results are the same as evaluating the
+// tree with mapnik::evaluate. The program doesn't refer to the tree it was
+// compiled from, owners of an expression keep its compiled form next to it
+// (see rule::get_compiled_filter).
+class MAPNIK_DECL compiled_expression
+{
+public:
+    explicit compiled_expression(expr_node const& expr);
+
+    value_type evaluate(feature_impl const& feature, attributes const& vars) const;
+
+    // true when the expression folded to a single constant
+    bool is_constant() const;
+    // the folded value, only meaningful when is_constant()
+    value_type const& constant_value() const;
+    std::size_t size() const { return code_.size(); }
+
+    enum class opcode : std::uint8_t
+    {
+        push_constant,
+        push_attribute,
+        push_global,
+        push_geometry_type,
+        negate,
+        logical_not,
+        to_bool,
+        plus,
+        minus,
+        mult,
+        div,
+        mod,
+        less,
+        less_equal,
+        greater,
+        greater_equal,
+        equal_to,
+        not_equal_to,
+        // attribute `arg` compared with constant `arg2`
+        attribute_less,
+        attribute_less_equal,
+        attribute_greater,
+        attribute_greater_equal,
+        attribute_equal_to,
+        attribute_not_equal_to,
+        // jump to `arg` leaving false (true) on the stack if the top of the
+        // stack is false (true), otherwise pop it and carry on
+        jump_if_false,
+        jump_if_true,
+        regex_match,
+        regex_replace,
+        call_unary,
+        call_binary
+    };
+
+    struct instruction
+    {
+        opcode op;
+        std::uint32_t arg;
+        std::uint32_t arg2;
+    };
+
+private:
+    friend struct expression_compiler;
+    value_type execute(value_type * stack, feature_impl const& feature, attributes const& vars) const;
+
+    std::vector<instruction> code_;
+    std::vector<value_type> constants_;
+    std::vector<attribute> attributes_;
+    std::vector<std::string> globals_;
+    std::vector<regex_match_node> regex_matches_;
+    std::vector<regex_replace_node> regex_replaces_;
+    std::vector<unary_function_impl> unary_functions_;
+    std::vector<binary_function_impl> binary_functions_;
+    std::size_t max_stack_;
+};
+
+using compiled_expression_ptr = std::shared_ptr<compiled_expression const>;
+
+inline compiled_expression_ptr compile_expression(expression_ptr const& expr)
+{
+    return expr ? std::make_shared<compiled_expression const>(*expr) : compiled_expression_ptr();
+}
+
+inline value_type evaluate_value(compiled_expression const& expr, feature_impl const& feature, attributes const& vars)
+{
+    return expr.evaluate(feature, vars);
+}
+
+// Evaluates `expr` by walking the tree, for expressions evaluated too
+// rarely to be worth compiling.
+inline value_type evaluate_value(expression_ptr const& expr, feature_impl const& feature, attributes const& vars)
+{
+    return util::apply_visitor(evaluate<feature_impl, value_type, attributes>(feature, vars), *expr);
+}
+
+}
+
+#endif // MAPNIK_COMPILED_EXPRESSION_HPP
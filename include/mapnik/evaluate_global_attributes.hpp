@@ -308,6 +308,7 @@ struct evaluate_global_attributes : util::noncopyable
             {
                 util::apply_visitor(evaluator<Attributes>(prop, attributes_), prop.second);
             }
+            update_property_table(sym);
         }
         Attributes const& attributes_;
     };
@@ -33,11 +33,15 @@
 //
 #include <mapnik/feature_kv_iterator.hpp>
 #include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/arena.hpp>
 
 // stl
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <ostream>                      // for basic_ostream, operator<<, etc
 #include <sstream>                      // for basic_stringstream
 #include <stdexcept>                    // for out_of_range
@@ -50,6 +54,11 @@ class feature_impl;
 
 using raster_ptr = std::shared_ptr<raster>;
 
+namespace detail {
+// unique non-zero identifier for every context created, shared by all modules
+MAPNIK_DECL std::uint64_t next_context_id();
+}
+
 template <typename T>
 class context : private util::noncopyable
 
@@ -65,26 +74,42 @@ public:
     using const_iterator = typename map_type::const_iterator;
 
     context()
-        : mapping_() {}
+        : mapping_(),
+          lookup_(),
+          id_(detail::next_context_id()) {}
 
     inline size_type push(key_type const& name)
     {
         size_type index = mapping_.size();
         mapping_.emplace(name, index);
+        lookup_.emplace(name, index);
         return index;
     }
 
     inline void add(key_type const& name, size_type index)
     {
         mapping_.emplace(name, index);
+        lookup_.emplace(name, index);
+    }
+
+    // hashed lookup of the data index of `name`
+    inline bool find(key_type const& name, size_type & index) const
+    {
+        auto itr = lookup_.find(name);
+        if (itr == lookup_.end()) return false;
+        index = itr->second;
+        return true;
     }
 
+    inline std::uint64_t id() const { return id_; }
     inline size_type size() const { return mapping_.size(); }
     inline const_iterator begin() const { return mapping_.begin();}
     inline const_iterator end() const { return mapping_.end();}
 
 private:
     map_type mapping_;
+    std::unordered_map<key_type, size_type> lookup_;
+    std::uint64_t id_;
 };
 
 using context_type = context<std::map<std::string,std::size_t> >;
@@ -98,7 +123,8 @@ class MAPNIK_DECL feature_impl : private util::noncopyable
 public:
 
     using value_type = mapnik::value;
-    using cont_type = std::vector<value_type>;
+    // attribute values, allocated from the arena the feature was created in, if any
+    using cont_type = std::vector<value_type, util::arena_allocator<value_type> >;
     using iterator = feature_kv_iterator;
 
     feature_impl(context_ptr const& ctx, mapnik::value_integer _id)
@@ -108,6 +134,13 @@ public:
         geom_(geometry::geometry_empty()),
         raster_() {}
 
+    feature_impl(context_ptr const& ctx, mapnik::value_integer _id, std::shared_ptr<util::arena> const& arena)
+        : id_(_id),
+        ctx_(ctx),
+        data_(ctx_->mapping_.size(), value_type(), util::arena_allocator<value_type>(arena)),
+        geom_(geometry::geometry_empty()),
+        raster_() {}
+
     inline mapnik::value_integer id() const { return id_;}
     inline void set_id(mapnik::value_integer _id) { id_ = _id;}
     template <typename T>
@@ -124,11 +157,10 @@ public:
 
     inline void put(context_type::key_type const& key, value && val)
     {
-        context_type::map_type::const_iterator itr = ctx_->mapping_.find(key);
-        if (itr != ctx_->mapping_.end()
-            && itr->second < data_.size())
+        std::size_t index;
+        if (ctx_->find(key, index) && index < data_.size())
         {
-            data_[itr->second] = std::move(val);
+            data_[index] = std::move(val);
         }
         else
         {
@@ -136,13 +168,32 @@ public:
         }
     }
 
+    // sets value by context index, for datasources resolving their
+    // columns against the context once instead of per feature
+    template <typename T>
+    inline void put_at(std::size_t index, T const& val)
+    {
+        put_at(index, value(val));
+    }
+
+    inline void put_at(std::size_t index, value && val)
+    {
+        if (index < data_.size())
+        {
+            data_[index] = std::move(val);
+        }
+        else
+        {
+            throw std::out_of_range("Attribute index out of range");
+        }
+    }
+
     inline void put_new(context_type::key_type const& key, value && val)
     {
-        context_type::map_type::const_iterator itr = ctx_->mapping_.find(key);
-        if (itr != ctx_->mapping_.end()
-            && itr->second < data_.size())
+        std::size_t index;
+        if (ctx_->find(key, index) && index < data_.size())
         {
-            data_[itr->second] = std::move(val);
+            data_[index] = std::move(val);
         }
         else
         {
@@ -154,18 +205,38 @@ public:
 
     inline bool has_key(context_type::key_type const& key) const
     {
-        return (ctx_->mapping_.count(key) == 1);
+        std::size_t index;
+        return ctx_->find(key, index);
     }
 
     inline value_type const& get(context_type::key_type const& key) const
     {
-        context_type::map_type::const_iterator itr = ctx_->mapping_.find(key);
-        if (itr != ctx_->mapping_.end())
-            return get(itr->second);
+        std::size_t index;
+        if (ctx_->find(key, index))
+            return get(index);
         else
             return default_feature_value;
     }
 
+    // As get(key), `binding` caches the index of `key` in the last context
+    // it was looked up in as (context id << 24 | index), so evaluating the
+    // same expression node over features of one context resolves the name once.
+    inline value_type const& get(context_type::key_type const& key, std::atomic<std::uint64_t> & binding) const
+    {
+        std::uint64_t bound = binding.load(std::memory_order_relaxed);
+        if (bound != 0 && (bound >> 24) == ctx_->id())
+        {
+            return get(static_cast<std::size_t>(bound & 0xffffff));
+        }
+        std::size_t index;
+        if (!ctx_->find(key, index)) return default_feature_value;
+        if (index <= 0xffffff)
+        {
+            binding.store(ctx_->id() << 24 | index, std::memory_order_relaxed);
+        }
+        return get(index);
+    }
+
     inline value_type const& get(std::size_t index) const
     {
         if (index < data_.size())
@@ -272,6 +343,8 @@ inline std::ostream& operator<< (std::ostream & out,feature_impl const& f)
 }
 
 using feature_ptr = std::shared_ptr<feature_impl>;
+// features handed to a renderer at once, see symbolizer_batch
+using feature_batch = std::vector<feature_ptr>;
 
 }
 
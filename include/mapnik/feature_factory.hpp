@@ -26,6 +26,7 @@
 // mapnik
 #include <mapnik/feature.hpp>
 #include <mapnik/value_types.hpp>
+#include <mapnik/util/arena.hpp>
 
 // boost
 //#include <boost/pool/pool_alloc.hpp>
@@ -40,6 +41,23 @@ struct feature_factory
         //return boost::allocate_shared<feature_impl>(boost::fast_pool_allocator<feature_impl>(),fid);
         return std::make_shared<feature_impl>(ctx,fid);
     }
+
+    // Allocates the feature, its shared_ptr control block and its attribute
+    // values in `arena` (usually one per featureset), which is released in
+    // one go once its last feature is gone; geometries still come from the
+    // heap. A fresh arena replaces `arena` after it has handed out
+    // `arena_size` bytes, so long queries recycle memory instead of holding
+    // every feature they ever returned.
+    static std::shared_ptr<feature_impl> create (context_ptr const& ctx, mapnik::value_integer fid,
+                                                 std::shared_ptr<util::arena> & arena)
+    {
+        static const std::size_t arena_size = 256 * 1024;
+        if (!arena || arena->allocated() >= arena_size)
+        {
+            arena = std::make_shared<util::arena>();
+        }
+        return std::allocate_shared<feature_impl>(util::arena_allocator<feature_impl>(arena), ctx, fid, arena);
+    }
 };
 }
 
@@ -32,6 +32,8 @@
 // stl
 #include <set>
 #include <string>
+#include <vector>
+#include <memory>
 
 namespace mapnik
 {
@@ -62,6 +64,16 @@ public:
      */
     void apply(double scale_denom_override=0.0);
 
+    /*!
+     * \brief apply renderer to all map layers, rendering layers which do not
+     * depend on each other concurrently into separate buffers using up to
+     * `jobs` threads (0 - hardware concurrency). Results are composited in map order
+     * as soon as they are ready, so at most `jobs` layer buffers are alive at a time.
+     * Falls back to apply() for processors without layer buffer support.
+     * Sets jobs() to `jobs` first.
+     */
+    void apply_parallel(unsigned jobs, double scale_denom_override=0.0);
+
     /*!
      * \brief apply renderer to a single layer, providing pre-populated set of query attribute names.
      */
@@ -69,6 +81,31 @@ public:
                std::set<std::string>& names,
                double scale_denom_override=0.0);
 
+    /*!
+     * \brief query datasources on worker threads while earlier layers are rendering,
+     * reading up to `num_features` features per query ahead (0 - disabled, the default).
+     * Queries run on the shared prefetch_pool, layers its workers don't get to
+     * in time are queried when they are rendered.
+     * Datasources providing their own asynchronous context (e.g. postgis with
+     * `max_async_connection`) are left alone. Requires MAPNIK_THREADSAFE.
+     */
+    void set_prefetch_size(std::size_t num_features);
+
+    /*!
+     * \brief number of threads (0 - hardware concurrency) the processor may use
+     * for image filters and raster warping, and apply_parallel() for layers (default 1).
+     * Processors rendering layers for apply_parallel() use one.
+     */
+    void set_jobs(unsigned jobs)
+    {
+        jobs_ = jobs;
+    }
+
+    unsigned jobs() const
+    {
+        return jobs_;
+    }
+
     /*!
      * \brief render a layer given a projection and scale.
      */
@@ -83,7 +120,48 @@ public:
                         int buffer_size,
                         std::set<std::string>& names);
 
+protected:
+    /*!
+     * \brief create a processor rendering into its own transparent buffer.
+     * Processors supporting apply_parallel() hide this default, which returns nullptr.
+     */
+    std::unique_ptr<Processor> make_layer_processor(Map const&, bool /*share_detector*/) const
+    {
+        return std::unique_ptr<Processor>();
+    }
+
+    /*!
+     * \brief composite the output of a processor created by make_layer_processor().
+     * With `replace_labels` the labels it placed replace those placed so far.
+     */
+    void composite_layer_processor(Processor &, bool /*replace_labels*/) {}
+
 private:
+    /*!
+     * \brief scale denominator to render at, computed from the map unless overridden.
+     */
+    double scale_denominator(Processor & p,
+                             projection const& proj,
+                             double scale_denom) const;
+
+    /*!
+     * \brief start processing the map and prepare all visible layers.
+     */
+    void start_map(Processor & p,
+                   projection const& proj,
+                   double scale_denom,
+                   std::vector<layer_rendering_material> & mat_list,
+                   feature_style_context_map & ctx_map);
+
+    /*!
+     * \brief prepare all visible layers of the map.
+     */
+    void prepare_layers(std::vector<layer_rendering_material> & mat_list,
+                        feature_style_context_map & ctx_map,
+                        Processor & p,
+                        projection const& proj,
+                        double scale_denom);
+
     /*!
      * \brief renders a featureset with the given styles.
      */
@@ -113,6 +191,8 @@ private:
     void render_material(layer_rendering_material const & mat, Processor & p );
 
     Map const& m_;
+    std::size_t prefetch_size_;
+    unsigned jobs_;
 };
 }
 
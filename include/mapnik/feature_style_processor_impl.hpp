@@ -37,18 +37,30 @@
 #include <mapnik/layer.hpp>
 #include <mapnik/rule.hpp>
 #include <mapnik/rule_cache.hpp>
+#include <mapnik/filter_pushdown.hpp>
 #include <mapnik/attribute_collector.hpp>
 #include <mapnik/expression_evaluator.hpp>
+#include <mapnik/compiled_expression.hpp>
 #include <mapnik/scale_denominator.hpp>
 #include <mapnik/projection.hpp>
 #include <mapnik/proj_transform.hpp>
 #include <mapnik/util/featureset_buffer.hpp>
+#include <mapnik/util/prefetch_featureset.hpp>
 #include <mapnik/util/variant.hpp>
+#include <mapnik/util/parallel.hpp>
 #include <mapnik/symbolizer_dispatch.hpp>
+#include <mapnik/image_compositing.hpp>
 
 // stl
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#include <condition_variable>
+#endif
 
 namespace mapnik
 {
@@ -75,7 +87,9 @@ struct layer_rendering_material
 
 template <typename Processor>
 feature_style_processor<Processor>::feature_style_processor(Map const& m, double scale_factor)
-    : m_(m)
+    : m_(m),
+      prefetch_size_(0),
+      jobs_(1)
 {
     // https://github.com/mapnik/mapnik/issues/1100
     if (scale_factor <= 0)
@@ -85,28 +99,319 @@ feature_style_processor<Processor>::feature_style_processor(Map const& m, double
 }
 
 template <typename Processor>
-void feature_style_processor<Processor>::apply(double scale_denom)
+void feature_style_processor<Processor>::set_prefetch_size(std::size_t num_features)
 {
-    Processor & p = static_cast<Processor&>(*this);
-    p.start_map_processing(m_);
+#ifdef MAPNIK_THREADSAFE
+    prefetch_size_ = num_features;
+#else
+    (void)num_features;
+#endif
+}
 
-    projection proj(m_.srs(),true);
+template <typename Processor>
+double feature_style_processor<Processor>::scale_denominator(Processor & p,
+                                                              projection const& proj,
+                                                              double scale_denom) const
+{
     if (scale_denom <= 0.0)
         scale_denom = mapnik::scale_denominator(m_.scale(),proj.is_geographic());
-    scale_denom *= p.scale_factor(); // FIXME - we might want to comment this out
+    return scale_denom * p.scale_factor(); // FIXME - we might want to comment this out
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::start_map(Processor & p,
+                                                   projection const& proj,
+                                                   double scale_denom,
+                                                   std::vector<layer_rendering_material> & mat_list,
+                                                   feature_style_context_map & ctx_map)
+{
+    p.start_map_processing(m_);
 
     // Asynchronous query supports:
     // This is a two steps process,
     // first we setup all queries at layer level
     // in a second time, we fetch the results and
     // do the actual rendering
+    prepare_layers(mat_list, ctx_map, p, proj, scale_denominator(p, proj, scale_denom));
+}
 
+template <typename Processor>
+void feature_style_processor<Processor>::apply(double scale_denom)
+{
+    Processor & p = static_cast<Processor&>(*this);
+    projection proj(m_.srs(),true);
     std::vector<layer_rendering_material> mat_list;
-
     // Define processing context map used by datasources
     // implementing asynchronous queries
     feature_style_context_map ctx_map;
 
+    start_map(p, proj, scale_denom, mat_list, ctx_map);
+
+    for ( layer_rendering_material const & mat : mat_list )
+    {
+        if (!mat.active_styles_.empty())
+        {
+            render_material(mat, p);
+        }
+    }
+
+    p.end_map_processing(m_);
+}
+
+namespace detail {
+
+struct uses_label_collision_detector
+{
+    template <typename Symbolizer>
+    bool operator() (Symbolizer const&) const
+    {
+        return false;
+    }
+
+    bool operator() (point_symbolizer const&) const { return true; }
+    bool operator() (text_symbolizer const&) const { return true; }
+    bool operator() (shield_symbolizer const&) const { return true; }
+    bool operator() (markers_symbolizer const&) const { return true; }
+    bool operator() (group_symbolizer const&) const { return true; }
+};
+
+// Whether layer places anything into label collision detector
+inline bool layer_uses_detector(layer_rendering_material const& mat)
+{
+    for (rule_cache const& rc : mat.rule_caches_)
+    {
+        for (rule_cache::rule_ptrs const* rules : { &rc.get_if_rules(), &rc.get_else_rules(), &rc.get_also_rules() })
+        {
+            for (rule const* r : *rules)
+            {
+                for (symbolizer const& sym : r->get_symbolizers())
+                {
+                    if (util::apply_visitor(uses_label_collision_detector(), sym)) return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Whether symbolizer composites (itself or its halo) with anything
+// but the default `src-over`
+struct symbolizer_comp_op
+{
+    template <typename Symbolizer>
+    bool operator() (Symbolizer const& sym) const
+    {
+        for (keys key : { keys::comp_op, keys::halo_comp_op })
+        {
+            auto itr = sym.properties.find(key);
+            if (itr == sym.properties.end()) continue;
+            // an expression may evaluate to any mode
+            if (!itr->second.template is<enumeration_wrapper>() ||
+                util::get<enumeration_wrapper>(itr->second) != src_over)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Whether layer output depends on what has been rendered below it,
+// in which case it can't be rendered into a separate transparent buffer
+// and composited with `src-over` later.
+inline bool layer_needs_backdrop(layer_rendering_material const& mat)
+{
+    for (feature_type_style const* style : mat.active_styles_)
+    {
+        if ((style->comp_op() && *style->comp_op() != src_over) ||
+            !style->direct_image_filters().empty())
+        {
+            return true;
+        }
+    }
+    for (rule_cache const& rc : mat.rule_caches_)
+    {
+        for (rule_cache::rule_ptrs const* rules : { &rc.get_if_rules(), &rc.get_else_rules(), &rc.get_also_rules() })
+        {
+            for (rule const* r : *rules)
+            {
+                for (symbolizer const& sym : r->get_symbolizers())
+                {
+                    if (util::apply_visitor(symbolizer_comp_op(), sym)) return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Contiguous range of layers rendered by a single processor
+struct layer_rendering_group
+{
+    std::size_t begin;
+    std::size_t end;
+    bool uses_detector;
+    bool needs_backdrop;
+    bool starts_with_clear;
+};
+
+// Split layers into contiguous groups which can be rendered independently.
+// Layers sharing label collision state (no `clear-label-cache` in between)
+// must end up in the same group, which also swallows any layers in between.
+inline std::vector<layer_rendering_group> make_layer_groups(std::vector<layer_rendering_material> const& mat_list)
+{
+    std::vector<layer_rendering_group> groups;
+    for (std::size_t i = 0; i < mat_list.size(); ++i)
+    {
+        layer_rendering_material const& mat = mat_list[i];
+        bool clear_label_cache = mat.lay_.clear_label_cache();
+        // clearing the label cache changes collision state even without labels
+        bool uses_detector = clear_label_cache || layer_uses_detector(mat);
+        bool needs_backdrop = layer_needs_backdrop(mat);
+        if (uses_detector && !clear_label_cache)
+        {
+            // find last group sharing label collision state
+            auto itr = std::find_if(groups.rbegin(), groups.rend(),
+                                    [](layer_rendering_group const& g) { return g.uses_detector; });
+            if (itr != groups.rend())
+            {
+                std::size_t first = static_cast<std::size_t>(std::distance(itr, groups.rend())) - 1;
+                layer_rendering_group & g = groups[first];
+                for (std::size_t j = first + 1; j < groups.size(); ++j)
+                {
+                    g.needs_backdrop = g.needs_backdrop || groups[j].needs_backdrop;
+                }
+                groups.resize(first + 1);
+                g.end = i + 1;
+                g.needs_backdrop = g.needs_backdrop || needs_backdrop;
+                continue;
+            }
+        }
+        groups.push_back(layer_rendering_group{ i, i + 1, uses_detector, needs_backdrop, clear_label_cache });
+    }
+    return groups;
+}
+
+} // namespace detail
+
+template <typename Processor>
+void feature_style_processor<Processor>::apply_parallel(unsigned jobs, double scale_denom)
+{
+    Processor & p = static_cast<Processor&>(*this);
+    projection proj(m_.srs(),true);
+    std::vector<layer_rendering_material> mat_list;
+    feature_style_context_map ctx_map;
+
+    jobs_ = jobs;
+    start_map(p, proj, scale_denom, mat_list, ctx_map);
+
+    if (jobs == 0) jobs = util::hardware_concurrency();
+#ifdef MAPNIK_THREADSAFE
+    std::vector<detail::layer_rendering_group> groups = detail::make_layer_groups(mat_list);
+    // Only the group touching label collision detector without clearing it first
+    // (there can be at most one) shares it with `p`. All others get their own,
+    // which replaces the labels of `p`'s when the group is composited, as
+    // clearing and placing labels in map order would.
+    auto make_processor = [&](detail::layer_rendering_group const& g)
+    {
+        return p.make_layer_processor(m_, g.uses_detector && !g.starts_with_clear);
+    };
+    std::size_t first = 0;
+    while (first < groups.size() && groups[first].needs_backdrop) ++first;
+    std::unique_ptr<Processor> first_processor;
+    if (jobs > 1 && first + 1 < groups.size())
+    {
+        first_processor = make_processor(groups[first]);
+    }
+    // otherwise nothing to render concurrently, or the processor doesn't
+    // support rendering into separate buffers
+    if (first_processor)
+    {
+        auto render_group = [&](detail::layer_rendering_group const& g, Processor & proc)
+        {
+            for (std::size_t j = g.begin; j < g.end; ++j)
+            {
+                render_material(mat_list[j], proc);
+            }
+        };
+        // Groups are handed out in map order and rendered into their own buffers.
+        // Whoever finishes the next group to composite composites it, and the
+        // finished ones following it, into `p` and frees their buffers; groups
+        // needing a backdrop are rendered onto `p` at that point. A group is only
+        // started once it is less than `jobs` groups ahead of compositing, so at
+        // most `jobs` buffers are alive at any time.
+        std::vector<std::unique_ptr<Processor>> processors(groups.size());
+        if (first < jobs) processors[first] = std::move(first_processor);
+        else first_processor.reset();
+        std::vector<bool> done(groups.size(), false);
+        std::size_t next_composite = 0;
+        bool failed = false;
+        std::mutex mutex;
+        std::condition_variable window;
+
+        util::parallel_for(groups.size(), jobs, [&](std::size_t i)
+        {
+            detail::layer_rendering_group const& g = groups[i];
+            std::unique_lock<std::mutex> lock(mutex);
+            window.wait(lock, [&] { return failed || i < next_composite + jobs; });
+            if (failed) return;
+            try
+            {
+                if (!g.needs_backdrop)
+                {
+                    // created under the lock, `p` may be rendering a group needing a backdrop
+                    if (!processors[i]) processors[i] = make_processor(g);
+                    if (Processor * sub = processors[i].get())
+                    {
+                        lock.unlock();
+                        sub->start_map_processing(m_);
+                        render_group(g, *sub);
+                        lock.lock();
+                    }
+                }
+                done[i] = true;
+                while (next_composite < groups.size() && done[next_composite])
+                {
+                    std::unique_ptr<Processor> & sub = processors[next_composite];
+                    if (sub)
+                    {
+                        p.composite_layer_processor(*sub, groups[next_composite].starts_with_clear);
+                        sub.reset();
+                    }
+                    else
+                    {
+                        render_group(groups[next_composite], p);
+                    }
+                    ++next_composite;
+                }
+            }
+            catch (...)
+            {
+                if (!lock.owns_lock()) lock.lock();
+                failed = true;
+                window.notify_all();
+                throw;
+            }
+            window.notify_all();
+        });
+        p.end_map_processing(m_);
+        return;
+    }
+#endif
+    for ( layer_rendering_material const & mat : mat_list )
+    {
+        render_material(mat, p);
+    }
+    p.end_map_processing(m_);
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::prepare_layers(std::vector<layer_rendering_material> & mat_list,
+                                                        feature_style_context_map & ctx_map,
+                                                        Processor & p,
+                                                        projection const& proj,
+                                                        double scale_denom)
+{
     for ( layer const& lyr : m_.layers() )
     {
         if (lyr.visible(scale_denom))
@@ -132,16 +437,6 @@ void feature_style_processor<Processor>::apply(double scale_denom)
             }
         }
     }
-
-    for ( layer_rendering_material const & mat : mat_list )
-    {
-        if (!mat.active_styles_.empty())
-        {
-            render_material(mat, p);
-        }
-    }
-
-    p.end_map_processing(m_);
 }
 
 template <typename Processor>
@@ -152,9 +447,7 @@ void feature_style_processor<Processor>::apply(mapnik::layer const& lyr,
     Processor & p = static_cast<Processor&>(*this);
     p.start_map_processing(m_);
     projection proj(m_.srs(),true);
-    if (scale_denom <= 0.0)
-        scale_denom = mapnik::scale_denominator(m_.scale(),proj.is_geographic());
-    scale_denom *= p.scale_factor();
+    scale_denom = scale_denominator(p, proj, scale_denom);
 
     if (lyr.visible(scale_denom))
     {
@@ -381,6 +674,7 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
         }
         if (active_rules)
         {
+            rc.build_index();
             rule_caches.push_back(std::move(rc));
             active_styles.push_back(&(*style));
         }
@@ -399,6 +693,8 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
 
     query q(layer_ext,res,scale_denom,extent);
     q.set_variables(p.variables());
+    // lets datasources skip features no active rule draws
+    q.set_filter(combined_filter(rule_caches));
 
     if (p.attribute_collection_policy() == COLLECT_ALL)
     {
@@ -426,14 +722,20 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
 
     bool cache_features = lay.cache_features() && active_styles.size() > 1;
 
+    std::size_t num_queries = (!group_by.empty() || cache_features) ? 1 : active_styles.size();
     std::vector<featureset_ptr> & featureset_ptr_list = mat.featureset_ptr_list_;
-    if (!group_by.empty() || cache_features)
+    if (prefetch_size_ > 0 && !current_ctx)
     {
-        featureset_ptr_list.push_back(ds->features_with_context(q,current_ctx));
+        // start querying now, rendering picks features up when it gets to this layer
+        prefetch_result result = prefetch_features(ds, q, num_queries, prefetch_size_);
+        for (std::size_t i = 0; i < num_queries; ++i)
+        {
+            featureset_ptr_list.push_back(std::make_shared<prefetch_featureset>(result, i));
+        }
     }
     else
     {
-        for(std::size_t i = 0; i < active_styles.size(); ++i)
+        for (std::size_t i = 0; i < num_queries; ++i)
         {
             featureset_ptr_list.push_back(ds->features_with_context(q,current_ctx));
         }
@@ -574,14 +876,14 @@ void feature_style_processor<Processor>::render_style(
     mapnik::attributes vars = p.variables();
     feature_ptr feature;
     bool was_painted = false;
+    symbolizer_batch<Processor> batch(p, prj_trans);
     while ((feature = features->next()))
     {
         bool do_else = true;
         bool do_also = false;
-        for (rule const* r : rc.get_if_rules() )
+        for (rule const* r : rc.get_if_rules(*feature))
         {
-            expression_ptr const& expr = r->get_filter();
-            value_type result = util::apply_visitor(evaluate<feature_impl,value_type,attributes>(*feature,vars),*expr);
+            value_type result = r->get_compiled_filter().evaluate(*feature, vars);
             if (result.to_bool())
             {
                 was_painted = true;
@@ -592,7 +894,7 @@ void feature_style_processor<Processor>::render_style(
                 {
                     for (symbolizer const& sym : symbols)
                     {
-                        util::apply_visitor(symbolizer_dispatch<Processor>(p,*feature,prj_trans),sym);
+                        batch.process(sym, feature);
                     }
                 }
                 if (style->get_filter_mode() == FILTER_FIRST)
@@ -613,7 +915,7 @@ void feature_style_processor<Processor>::render_style(
                 {
                     for (symbolizer const& sym : symbols)
                     {
-                        util::apply_visitor(symbolizer_dispatch<Processor>(p,*feature,prj_trans),sym);
+                        batch.process(sym, feature);
                     }
                 }
             }
@@ -628,12 +930,13 @@ void feature_style_processor<Processor>::render_style(
                 {
                     for (symbolizer const& sym : symbols)
                     {
-                        util::apply_visitor(symbolizer_dispatch<Processor>(p,*feature,prj_trans),sym);
+                        batch.process(sym, feature);
                     }
                 }
             }
         }
     }
+    batch.flush();
     p.painted(p.painted() | was_painted);
     p.end_style_processing(*style);
 }
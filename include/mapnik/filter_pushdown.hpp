@@ -0,0 +1,110 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_FILTER_PUSHDOWN_HPP
+#define MAPNIK_FILTER_PUSHDOWN_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/compiled_expression.hpp>
+#include <mapnik/attribute.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_layer_desc.hpp>
+#include <mapnik/query.hpp>
+
+// stl
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+class rule_cache;
+
+// Filter matching every feature some rule of `rule_caches` may draw: the
+// `or` of the if rules' filters. Null when every feature may be drawn,
+// because of an else rule or a filter which always holds.
+MAPNIK_DECL expression_ptr combined_filter(std::vector<rule_cache> const& rule_caches);
+
+// true when `filter` reads [mapnik::geometry_type]
+MAPNIK_DECL bool filter_uses_geometry(expr_node const& filter);
+
+// Query filter for datasources rejecting records on their attributes before
+// decoding the geometry. Inactive when the query has no filter or the filter
+// needs the geometry.
+class attribute_filter
+{
+public:
+    attribute_filter()
+        : filter_(),
+          vars_() {}
+
+    explicit attribute_filter(query const& q)
+        : filter_(),
+          vars_(q.variables())
+    {
+        expression_ptr const& filter = q.get_filter();
+        if (filter && !filter_uses_geometry(*filter)) filter_ = compile_expression(filter);
+    }
+
+    bool active() const
+    {
+        return filter_ != nullptr;
+    }
+
+    // false when `feature`, holding the queried attributes, can't be drawn
+    bool pass(feature_impl const& feature) const
+    {
+        return !filter_ || filter_->evaluate(feature, vars_).to_bool();
+    }
+
+private:
+    compiled_expression_ptr filter_;
+    attributes vars_;
+};
+
+namespace sql_utils {
+
+enum class sql_dialect : std::uint8_t
+{
+    postgresql,
+    sqlite,
+    ogr
+};
+
+// SQL condition selecting at least the rows of the layer described by `desc`
+// matching `filter`, or an empty string when none can be given. Only
+// comparisons of a column with a constant of the column's type are
+// translated, other parts of the filter are dropped where that only widens
+// the selection.
+MAPNIK_DECL std::string filter_to_sql(expr_node const& filter,
+                                      layer_descriptor const& desc,
+                                      attributes const& vars,
+                                      sql_dialect dialect);
+
+}
+
+}
+
+#endif // MAPNIK_FILTER_PUSHDOWN_HPP
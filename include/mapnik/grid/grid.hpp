@@ -40,6 +40,7 @@
 #include <set>
 #include <cmath>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace mapnik
@@ -53,7 +54,7 @@ public:
     using data_type = mapnik::image<T>;
     using lookup_type = std::string;
     // mapping between pixel id and key
-    using feature_key_type = std::map<value_type, lookup_type>;
+    using feature_key_type = std::unordered_map<value_type, lookup_type>;
     using feature_type = std::map<lookup_type, mapnik::feature_ptr>;
     static const value_type base_mask;
 
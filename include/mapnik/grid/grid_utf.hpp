@@ -0,0 +1,55 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_GRID_UTF_HPP
+#define MAPNIK_GRID_UTF_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_view.hpp>
+
+// stl
+#include <iosfwd>
+#include <string>
+
+namespace mapnik
+{
+
+// Writes `grid` (a mapnik::grid or mapnik::grid_view) to `out` as UTFGrid
+// JSON: {"grid":[...],"keys":[...],"data":{...}}. Every `resolution`th
+// pixel of every `resolution`th row is sampled. Keys are numbered in order
+// of first appearance, starting at codepoint 32 and skipping '"' and '\',
+// so only keys actually visible in the grid are emitted. The empty key
+// stands for pixels without a feature. When `add_features` is set, "data"
+// holds the fields added with hit_grid::add_field for each visible key.
+template <typename T>
+MAPNIK_DECL void grid_encode_utf(T const& grid, std::ostream & out,
+                                 unsigned resolution = 4, bool add_features = true);
+
+template <typename T>
+MAPNIK_DECL std::string grid_encode_utf(T const& grid,
+                                        unsigned resolution = 4, bool add_features = true);
+
+}
+
+#endif // MAPNIK_GRID_UTF_HPP
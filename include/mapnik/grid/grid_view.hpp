@@ -35,6 +35,7 @@
 #include <set>
 #include <cmath>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace mapnik {
@@ -47,7 +48,7 @@ public:
     using value_type = typename T::pixel_type;
     using pixel_type = typename T::pixel_type;
     using lookup_type = std::string;
-    using feature_key_type = std::map<value_type, lookup_type>;
+    using feature_key_type = std::unordered_map<value_type, lookup_type>;
     using feature_type = std::map<std::string, mapnik::feature_ptr>;
 
     hit_grid_view(unsigned x, unsigned y,
@@ -28,6 +28,7 @@
 #include <mapnik/image_filter_types.hpp>
 #include <mapnik/image_util.hpp>
 #include <mapnik/util/hsl.hpp>
+#include <mapnik/util/parallel.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -47,6 +48,8 @@
 
 // stl
 #include <cmath>
+#include <type_traits>
+#include <vector>
 
 // 8-bit YUV
 //Y = ( (  66 * R + 129 * G +  25 * B + 128) >> 8) +  16
@@ -228,182 +231,127 @@ void process_channel (Src const& src, Dst & dst, mapnik::filter::sobel)
 
 
 
+// Convolves rows [y0, y1) of src_view into dst_view. Pixels outside the
+// image repeat their neighbours: columns are clamped, the first row uses
+// the row below it in place of the row above and the last row mirrors
+// the row above it.
 template <typename Src, typename Dst, typename Filter>
-void apply_convolution_3x3(Src const& src_view, Dst & dst_view, Filter const& filter)
+void apply_convolution_3x3(Src const& src_view, Dst & dst_view, Filter const& filter,
+                           std::ptrdiff_t y0, std::ptrdiff_t y1)
 {
     using boost::gil::bits32f;
-    using boost::gil::point2;
 
     // p0 p1 p2
     // p3 p4 p5
     // p6 p7 p8
 
-    typename Src::xy_locator src_loc = src_view.xy_at(0,0);
-    typename Src::xy_locator::cached_location_t loc00 = src_loc.cache_location(-1,-1);
-    typename Src::xy_locator::cached_location_t loc10 = src_loc.cache_location( 0,-1);
-    typename Src::xy_locator::cached_location_t loc20 = src_loc.cache_location( 1,-1);
-    typename Src::xy_locator::cached_location_t loc01 = src_loc.cache_location(-1, 0);
-    typename Src::xy_locator::cached_location_t loc11 = src_loc.cache_location( 0, 0);
-    typename Src::xy_locator::cached_location_t loc21 = src_loc.cache_location( 1, 0);
-    typename Src::xy_locator::cached_location_t loc02 = src_loc.cache_location(-1, 1);
-    typename Src::xy_locator::cached_location_t loc12 = src_loc.cache_location( 0, 1);
-    typename Src::xy_locator::cached_location_t loc22 = src_loc.cache_location( 1, 1);
-
-    typename Src::x_iterator dst_it = dst_view.row_begin(0);
-
-    // top row
-    for (std::ptrdiff_t x = 0 ; x < src_view.width(); ++x)
+    std::ptrdiff_t width = src_view.width();
+    std::ptrdiff_t height = src_view.height();
+    for (std::ptrdiff_t y = y0; y < y1; ++y)
     {
-        (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-        for (std::ptrdiff_t i = 0; i < 3; ++i)
+        std::ptrdiff_t above = (y > 0) ? y - 1 : std::min<std::ptrdiff_t>(1, height - 1);
+        std::ptrdiff_t below = (y < height - 1) ? y + 1 : std::max<std::ptrdiff_t>(0, height - 2);
+        typename Src::x_iterator row0 = src_view.row_begin(above);
+        typename Src::x_iterator row1 = src_view.row_begin(y);
+        typename Src::x_iterator row2 = src_view.row_begin(below);
+        typename Dst::x_iterator dst_it = dst_view.row_begin(y);
+        for (std::ptrdiff_t x = 0; x < width; ++x)
         {
-            bits32f p[9];
-
-            p[4] = src_loc[loc11][i];
-            p[7] = src_loc[loc12][i];
-
-            if (x == 0)
-            {
-                p[3] = p[4];
-                p[6] = p[7];
-            }
-            else
-            {
-                p[3] = src_loc[loc01][i];
-                p[6] = src_loc[loc02][i];
-            }
-
-            if ( x == (src_view.width())-1)
-            {
-                p[5] = p[4];
-                p[8] = p[7];
-            }
-            else
-            {
-                p[5] = src_loc[loc21][i];
-                p[8] = src_loc[loc22][i];
-            }
-
-            p[0] = p[6];
-            p[1] = p[7];
-            p[2] = p[8];
-
-            process_channel(p, (*dst_it)[i], filter);
-        }
-        ++src_loc.x();
-        ++dst_it;
-    }
-    // carrige-return
-    src_loc += point2<std::ptrdiff_t>(-src_view.width(),1);
-
-    // 1... height-1 rows
-    for (std::ptrdiff_t y = 1; y < src_view.height()-1; ++y)
-    {
-        for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
-        {
-            (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
+            std::ptrdiff_t left = (x > 0) ? x - 1 : x;
+            std::ptrdiff_t right = (x < width - 1) ? x + 1 : x;
+            dst_it[x][3] = row1[x][3]; // Dst.a = Src.a
             for (std::ptrdiff_t i = 0; i < 3; ++i)
             {
                 bits32f p[9];
-
-                p[1] = src_loc[loc10][i];
-                p[4] = src_loc[loc11][i];
-                p[7] = src_loc[loc12][i];
-
-                if (x == 0)
-                {
-                    p[0] = p[1];
-                    p[3] = p[4];
-                    p[6] = p[7];
-                }
-                else
-                {
-                    p[0] = src_loc[loc00][i];
-                    p[3] = src_loc[loc01][i];
-                    p[6] = src_loc[loc02][i];
-                }
-
-                if ( x == (src_view.width()) - 1)
-                {
-                    p[2] = p[1];
-                    p[5] = p[4];
-                    p[8] = p[7];
-                }
-                else
-                {
-                    p[2] = src_loc[loc20][i];
-                    p[5] = src_loc[loc21][i];
-                    p[8] = src_loc[loc22][i];
-                }
-                process_channel(p, (*dst_it)[i], filter);
+                p[0] = row0[left][i];
+                p[1] = row0[x][i];
+                p[2] = row0[right][i];
+                p[3] = row1[left][i];
+                p[4] = row1[x][i];
+                p[5] = row1[right][i];
+                p[6] = row2[left][i];
+                p[7] = row2[x][i];
+                p[8] = row2[right][i];
+                process_channel(p, dst_it[x][i], filter);
             }
-            ++dst_it;
-            ++src_loc.x();
         }
-        // carrige-return
-        src_loc += point2<std::ptrdiff_t>(-src_view.width(),1);
     }
+}
 
-    // bottom row
-    //src_loc = src_view.xy_at(0,src_view.height()-1);
-    for (std::ptrdiff_t x = 0 ; x < src_view.width(); ++x)
+// same as agg's multiplier_rgba::premultiply, for filters premultiplying
+// pixels as they process them rather than in a pass of their own
+inline void premultiply_pixel(uint8_t & r, uint8_t & g, uint8_t & b, uint8_t a)
+{
+    if (a < 255)
     {
-        (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-        for (std::ptrdiff_t i = 0; i < 3; ++i)
+        if (a == 0)
         {
-            bits32f p[9];
-
-            p[1] = src_loc[loc10][i];
-            p[4] = src_loc[loc11][i];
-
-            if (x == 0)
-            {
-                p[0] = p[1];
-                p[3] = p[4];
-            }
-            else
-            {
-                p[0] = src_loc[loc00][i];
-                p[3] = src_loc[loc01][i];
-            }
-
-            if ( x == (src_view.width())-1)
-            {
-                p[2] = p[1];
-                p[5] = p[4];
-
-            }
-            else
-            {
-                p[2] = src_loc[loc20][i];
-                p[5] = src_loc[loc21][i];
-            }
-
-            p[6] = p[0];
-            p[7] = p[1];
-            p[8] = p[2];
-            process_channel(p, (*dst_it)[i], filter);
+            r = g = b = 0;
+            return;
         }
-        ++src_loc.x();
-        ++dst_it;
+        r = static_cast<uint8_t>((r * a + 255) >> 8);
+        g = static_cast<uint8_t>((g * a + 255) >> 8);
+        b = static_cast<uint8_t>((b * a + 255) >> 8);
     }
 }
 
+// 3x3 convolutions work on demultiplied pixels. With `premultiply_output`
+// rows are premultiplied as they are written, for a next filter wanting
+// premultiplied input.
 template <typename Src, typename Filter>
-void apply_filter(Src & src, Filter const& filter)
+void apply_filter(Src & src, Filter const& filter, unsigned jobs = 1, bool premultiply_output = false)
 {
+    using namespace boost::gil;
     demultiply_alpha(src);
     double_buffer<Src> tb(src);
-    apply_convolution_3x3(tb.src_view, tb.dst_view, filter);
+    util::parallel_bands(tb.src_view.height(), jobs, 16, [&](std::size_t begin, std::size_t end)
+    {
+        apply_convolution_3x3(tb.src_view, tb.dst_view, filter,
+                              static_cast<std::ptrdiff_t>(begin),
+                              static_cast<std::ptrdiff_t>(end));
+        if (!premultiply_output) return;
+        for (std::size_t y = begin; y < end; ++y)
+        {
+            rgba8_view_t::x_iterator dst_it = tb.dst_view.row_begin(static_cast<long>(y));
+            for (std::ptrdiff_t x = 0; x < tb.dst_view.width(); ++x)
+            {
+                premultiply_pixel(get_color(dst_it[x], red_t()),
+                                  get_color(dst_it[x], green_t()),
+                                  get_color(dst_it[x], blue_t()),
+                                  get_color(dst_it[x], alpha_t()));
+            }
+        }
+    });
+    if (premultiply_output) set_premultiplied_alpha(src, true);
 }
 
 template <typename Src>
-void apply_filter(Src & src, agg_stack_blur const& op)
+void apply_filter(Src & src, agg_stack_blur const& op, unsigned jobs = 1)
 {
-    premultiply_alpha(src);
-    agg::rendering_buffer buf(src.bytes(),src.width(),src.height(), src.row_size());
-    agg::pixfmt_rgba32_pre pixf(buf);
-    agg::stack_blur_rgba32(pixf,op.rx,op.ry);
+    // the blur is separable: rows are blurred independently of each other,
+    // then columns. Premultiplying is done per band of the first pass
+    // rather than as a pass of its own.
+    bool premultiplied = src.get_premultiplied();
+    util::parallel_bands(src.height(), jobs, 16, [&](std::size_t begin, std::size_t end)
+    {
+        agg::rendering_buffer buf(src.bytes() + begin * src.row_size(), src.width(),
+                                  static_cast<unsigned>(end - begin), src.row_size());
+        if (!premultiplied)
+        {
+            agg::pixfmt_rgba32 pixf(buf);
+            pixf.premultiply();
+        }
+        agg::pixfmt_rgba32_pre pixf(buf);
+        agg::stack_blur_rgba32(pixf, op.rx, 0);
+    });
+    set_premultiplied_alpha(src, true);
+    util::parallel_bands(src.width(), jobs, 16, [&](std::size_t begin, std::size_t end)
+    {
+        agg::rendering_buffer buf(src.bytes() + begin * src.pixel_size, static_cast<unsigned>(end - begin),
+                                  src.height(), src.row_size());
+        agg::pixfmt_rgba32_pre pixf(buf);
+        agg::stack_blur_rgba32(pixf, 0, op.ry);
+    });
 }
 
 inline double channel_delta(double source, double match)
@@ -420,7 +368,7 @@ inline uint8_t apply_alpha_shift(double source, double match, double alpha)
 }
 
 template <typename Src>
-void apply_filter(Src & src, color_to_alpha const& op)
+void apply_filter(Src & src, color_to_alpha const& op, unsigned jobs = 1)
 {
     using namespace boost::gil;
     bool premultiplied = src.get_premultiplied();
@@ -428,87 +376,108 @@ void apply_filter(Src & src, color_to_alpha const& op)
     double cr = static_cast<double>(op.color.red())/255.0;
     double cg = static_cast<double>(op.color.green())/255.0;
     double cb = static_cast<double>(op.color.blue())/255.0;
-    for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+    util::parallel_bands(src_view.height(), jobs, 16, [&](std::size_t begin, std::size_t end)
     {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-        for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
+        for (std::size_t y = begin; y < end; ++y)
         {
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            uint8_t & a = get_color(src_it[x], alpha_t());
-            double sr = static_cast<double>(r)/255.0;
-            double sg = static_cast<double>(g)/255.0;
-            double sb = static_cast<double>(b)/255.0;
-            double sa = static_cast<double>(a)/255.0;
-            // demultiply
-            if (sa <= 0.0)
-            {
-                r = g = b = 0;
-                continue;
-            }
-            else if (premultiplied)
-            {
-                sr /= sa;
-                sg /= sa;
-                sb /= sa;
-            }
-            // get that maximum color difference
-            double xa = std::max(channel_delta(sr,cr),std::max(channel_delta(sg,cg),channel_delta(sb,cb)));
-            if (xa > 0)
-            {
-                // apply difference to each channel, returning premultiplied
-                // TODO - experiment with difference in hsl color space
-                r = apply_alpha_shift(sr,cr,xa);
-                g = apply_alpha_shift(sg,cg,xa);
-                b = apply_alpha_shift(sb,cb,xa);
-                // combine new alpha with original
-                xa *= sa;
-                a = static_cast<uint8_t>(std::floor((xa*255.0)+.5));
-                // all color values must be <= alpha
-                if (r>a) r=a;
-                if (g>a) g=a;
-                if (b>a) b=a;
-            }
-            else
+            rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
+            for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
             {
-                r = g = b = a = 0;
+                uint8_t & r = get_color(src_it[x], red_t());
+                uint8_t & g = get_color(src_it[x], green_t());
+                uint8_t & b = get_color(src_it[x], blue_t());
+                uint8_t & a = get_color(src_it[x], alpha_t());
+                double sr = static_cast<double>(r)/255.0;
+                double sg = static_cast<double>(g)/255.0;
+                double sb = static_cast<double>(b)/255.0;
+                double sa = static_cast<double>(a)/255.0;
+                // demultiply
+                if (sa <= 0.0)
+                {
+                    r = g = b = 0;
+                    continue;
+                }
+                else if (premultiplied)
+                {
+                    sr /= sa;
+                    sg /= sa;
+                    sb /= sa;
+                }
+                // get that maximum color difference
+                double xa = std::max(channel_delta(sr,cr),std::max(channel_delta(sg,cg),channel_delta(sb,cb)));
+                if (xa > 0)
+                {
+                    // apply difference to each channel, returning premultiplied
+                    // TODO - experiment with difference in hsl color space
+                    r = apply_alpha_shift(sr,cr,xa);
+                    g = apply_alpha_shift(sg,cg,xa);
+                    b = apply_alpha_shift(sb,cb,xa);
+                    // combine new alpha with original
+                    xa *= sa;
+                    a = static_cast<uint8_t>(std::floor((xa*255.0)+.5));
+                    // all color values must be <= alpha
+                    if (r>a) r=a;
+                    if (g>a) g=a;
+                    if (b>a) b=a;
+                }
+                else
+                {
+                    r = g = b = a = 0;
+                }
             }
         }
-    }
+    });
     // set as premultiplied
     set_premultiplied_alpha(src, true);
 }
 
+// colorize-alpha output depends on source alpha only, so it is computed
+// once per alpha value and looked up for every pixel
 template <typename Src>
-void apply_filter(Src & src, colorize_alpha const& op)
+void colorize_alpha_lookup(Src & src, agg::rgba8 const* lut, unsigned jobs)
 {
     using namespace boost::gil;
-    std::ptrdiff_t size = op.size();
-    if (op.size() == 1)
+    rgba8_view_t src_view = rgba8_view(src);
+    util::parallel_bands(src_view.height(), jobs, 16, [&](std::size_t begin, std::size_t end)
     {
-        // no interpolation if only one stop
-        mapnik::filter::color_stop const& stop = op[0];
-        mapnik::color const& c = stop.color;
-        rgba8_view_t src_view = rgba8_view(src);
-        for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+        for (std::size_t y = begin; y < end; ++y)
         {
             rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
             for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
             {
-                uint8_t & r = get_color(src_it[x], red_t());
-                uint8_t & g = get_color(src_it[x], green_t());
-                uint8_t & b = get_color(src_it[x], blue_t());
                 uint8_t & a = get_color(src_it[x], alpha_t());
-                if ( a > 0)
+                if (a > 0)
                 {
-                    a = (c.alpha() * a + 255) >> 8;
-                    r = (c.red() * a + 255) >> 8;
-                    g = (c.green() * a + 255) >> 8;
-                    b = (c.blue() * a + 255) >> 8;
+                    agg::rgba8 const& c = lut[a];
+                    get_color(src_it[x], red_t()) = c.r;
+                    get_color(src_it[x], green_t()) = c.g;
+                    get_color(src_it[x], blue_t()) = c.b;
+                    a = c.a;
                 }
             }
         }
+    });
+}
+
+template <typename Src>
+void apply_filter(Src & src, colorize_alpha const& op, unsigned jobs = 1)
+{
+    std::ptrdiff_t size = op.size();
+    agg::rgba8 lut[256];
+    if (op.size() == 1)
+    {
+        // no interpolation if only one stop
+        mapnik::filter::color_stop const& stop = op[0];
+        mapnik::color const& c = stop.color;
+        for (unsigned i = 1; i < 256; ++i)
+        {
+            unsigned a = (c.alpha() * i + 255) >> 8;
+            lut[i] = agg::rgba8((c.red() * a + 255) >> 8,
+                                (c.green() * a + 255) >> 8,
+                                (c.blue() * a + 255) >> 8,
+                                a);
+        }
+        colorize_alpha_lookup(src, lut, jobs);
         // set as premultiplied
         set_premultiplied_alpha(src, true);
     }
@@ -534,8 +503,37 @@ void apply_filter(Src & src, colorize_alpha const& op)
         }
         if (grad_lut.build_lut())
         {
-            rgba8_view_t src_view = rgba8_view(src);
-            for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+            for (unsigned i = 1; i < 256; ++i)
+            {
+                agg::rgba8 c = grad_lut[i];
+                unsigned a = (c.a * i + 255) >> 8;
+                lut[i] = agg::rgba8((c.r * a + 255) >> 8,
+                                    (c.g * a + 255) >> 8,
+                                    (c.b * a + 255) >> 8,
+                                    a);
+            }
+            colorize_alpha_lookup(src, lut, jobs);
+        }
+        // set as premultiplied
+        set_premultiplied_alpha(src, true);
+    }
+}
+
+template <typename Src>
+void apply_filter(Src & src, scale_hsla const& transform, unsigned jobs = 1)
+{
+    using namespace boost::gil;
+    bool tinting = !transform.is_identity();
+    bool set_alpha = !transform.is_alpha_identity();
+    // todo - filters be able to report if they
+    // should be run to avoid overhead of temp buffer
+    if (tinting || set_alpha)
+    {
+        bool premultiplied = src.get_premultiplied();
+        rgba8_view_t src_view = rgba8_view(src);
+        util::parallel_bands(src_view.height(), jobs, 16, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t y = begin; y < end; ++y)
             {
                 rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
                 for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
@@ -544,287 +542,224 @@ void apply_filter(Src & src, colorize_alpha const& op)
                     uint8_t & g = get_color(src_it[x], green_t());
                     uint8_t & b = get_color(src_it[x], blue_t());
                     uint8_t & a = get_color(src_it[x], alpha_t());
-                    if ( a > 0)
+                    double r2 = static_cast<double>(r)/255.0;
+                    double g2 = static_cast<double>(g)/255.0;
+                    double b2 = static_cast<double>(b)/255.0;
+                    double a2 = static_cast<double>(a)/255.0;
+                    // demultiply
+                    if (a2 <= 0.0)
                     {
-                        agg::rgba8 c = grad_lut[a];
-                        a = (c.a * a + 255) >> 8;
-                        r = (c.r * a + 255) >> 8;
-                        g = (c.g * a + 255) >> 8;
-                        b = (c.b * a + 255) >> 8;
-        #if 0
-                        // rainbow
-                        r = 0;
-                        g = 0;
-                        b = 0;
-                        if (a < 64)
-                        {
-                            g = a * 4;
-                            b = 255;
-                        }
-                        else if (a >= 64 && a < 128)
+                        r = g = b = 0;
+                        continue;
+                    }
+                    else if (premultiplied)
+                    {
+                        r2 /= a2;
+                        g2 /= a2;
+                        b2 /= a2;
+                    }
+
+                    if (set_alpha)
+                    {
+                        a2 = transform.a0 + (a2 * (transform.a1 - transform.a0));
+                        if (a2 <= 0)
                         {
-                            g = 255;
-                            b = 255 - ((a - 64) * 4);
+                            r = g = b = a = 0;
+                            continue;
                         }
-                        else if (a >= 128 && a < 192)
+                        else if (a2 > 1)
                         {
-                            r = (a - 128) * 4;
-                            g = 255;
+                            a2 = 1;
+                            a = 255;
                         }
-                        else // >= 192
+                        else
                         {
-                            r = 255;
-                            g = 255 - ((a - 192) * 4);
+                            a = static_cast<uint8_t>(std::floor((a2 * 255.0) +.5));
                         }
-                        r = (r * a + 255) >> 8;
-                        g = (g * a + 255) >> 8;
-                        b = (b * a + 255) >> 8;
-        #endif
                     }
+                    if (tinting)
+                    {
+                        double h;
+                        double s;
+                        double l;
+                        rgb2hsl(r2,g2,b2,h,s,l);
+                        double h2 = transform.h0 + (h * (transform.h1 - transform.h0));
+                        double s2 = transform.s0 + (s * (transform.s1 - transform.s0));
+                        double l2 = transform.l0 + (l * (transform.l1 - transform.l0));
+                        if (h2 > 1) { h2 = 1; }
+                        else if (h2 < 0) { h2 = 0; }
+                        if (s2 > 1) { s2 = 1; }
+                        else if (s2 < 0) { s2 = 0; }
+                        if (l2 > 1) { l2 = 1; }
+                        else if (l2 < 0) { l2 = 0; }
+                        hsl2rgb(h2,s2,l2,r2,g2,b2);
+                    }
+                    // premultiply
+                    r2 *= a2;
+                    g2 *= a2;
+                    b2 *= a2;
+                    r = static_cast<uint8_t>(std::floor((r2*255.0)+.5));
+                    g = static_cast<uint8_t>(std::floor((g2*255.0)+.5));
+                    b = static_cast<uint8_t>(std::floor((b2*255.0)+.5));
+                    // all color values must be <= alpha
+                    if (r>a) r=a;
+                    if (g>a) g=a;
+                    if (b>a) b=a;
                 }
             }
-        }
+        });
         // set as premultiplied
         set_premultiplied_alpha(src, true);
     }
 }
 
-template <typename Src>
-void apply_filter(Src & src, scale_hsla const& transform)
+template <typename Src, typename ColorBlindFilter>
+void color_blind_filter(Src & src, ColorBlindFilter const& op, unsigned jobs)
 {
     using namespace boost::gil;
-    bool tinting = !transform.is_identity();
-    bool set_alpha = !transform.is_alpha_identity();
-    // todo - filters be able to report if they
-    // should be run to avoid overhead of temp buffer
-    if (tinting || set_alpha)
+    rgba8_view_t src_view = rgba8_view(src);
+    bool premultiplied = src.get_premultiplied();
+
+    util::parallel_bands(src_view.height(), jobs, 16, [&](std::size_t begin, std::size_t end)
     {
-        bool premultiplied = src.get_premultiplied();
-        rgba8_view_t src_view = rgba8_view(src);
-        for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+        for (std::size_t y = begin; y < end; ++y)
         {
             rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
             for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
             {
+                // formula taken from boost/gil/color_convert.hpp:rgb_to_luminance
                 uint8_t & r = get_color(src_it[x], red_t());
                 uint8_t & g = get_color(src_it[x], green_t());
                 uint8_t & b = get_color(src_it[x], blue_t());
                 uint8_t & a = get_color(src_it[x], alpha_t());
-                double r2 = static_cast<double>(r)/255.0;
-                double g2 = static_cast<double>(g)/255.0;
-                double b2 = static_cast<double>(b)/255.0;
-                double a2 = static_cast<double>(a)/255.0;
+                double dr = static_cast<double>(r)/255.0;
+                double dg = static_cast<double>(g)/255.0;
+                double db = static_cast<double>(b)/255.0;
+                double da = static_cast<double>(a)/255.0;
                 // demultiply
-                if (a2 <= 0.0)
+                if (da <= 0.0)
                 {
                     r = g = b = 0;
                     continue;
                 }
                 else if (premultiplied)
                 {
-                    r2 /= a2;
-                    g2 /= a2;
-                    b2 /= a2;
+                    dr /= da;
+                    dg /= da;
+                    db /= da;
                 }
-
-                if (set_alpha)
+                // Convert source color into XYZ color space
+                double pow_r = std::pow(dr, 2.2);
+                double pow_g = std::pow(dg, 2.2);
+                double pow_b = std::pow(db, 2.2);
+                double X = (0.412424 * pow_r) + (0.357579 * pow_g) + (0.180464 * pow_b);
+                double Y = (0.212656 * pow_r) + (0.715158 * pow_g) + (0.0721856 * pow_b);
+                double Z = (0.0193324 * pow_r) + (0.119193 * pow_g) + (0.950444 * pow_b);
+                // Convert XYZ into xyY Chromacity Coordinates (xy) and Luminance (Y)
+                double chroma_x = X / (X + Y + Z);
+                double chroma_y = Y / (X + Y + Z);
+                // Generate the "Confusion Line" between the source color and the Confusion Point
+                double m_div = chroma_x - op.x;
+                if (std::abs(m_div) < (std::numeric_limits<double>::epsilon())) continue;
+                double m = (chroma_y - op.y) / (chroma_x - op.x); // slope of Confusion Line
+                double yint = chroma_y - chroma_x * m; // y-intercept of confusion line (x-intercept = 0.0)
+                // How far the xy coords deviate from the simulation
+                double m_div2 = m - op.m;
+                if (std::abs(m_div2) < (std::numeric_limits<double>::epsilon())) continue;
+                double deviate_x = (op.yint - yint) / (m - op.m);
+                double deviate_y = (m * deviate_x) + yint;
+                if (std::abs(deviate_y) < (std::numeric_limits<double>::epsilon()))
                 {
-                    a2 = transform.a0 + (a2 * (transform.a1 - transform.a0));
-                    if (a2 <= 0)
-                    {
-                        r = g = b = a = 0;
-                        continue;
-                    }
-                    else if (a2 > 1)
-                    {
-                        a2 = 1;
-                        a = 255;
-                    }
-                    else
-                    {
-                        a = static_cast<uint8_t>(std::floor((a2 * 255.0) +.5));
-                    }
+                    deviate_y = std::numeric_limits<double>::epsilon() * 2.0;
+                }
+                // Compute the simulated color's XYZ coords
+                X = deviate_x * Y / deviate_y;
+                Z = (1.0 - (deviate_x + deviate_y)) * Y / deviate_y;
+                // Neutral grey calculated from luminance (in D65)
+                double neutral_X = 0.312713 * Y / 0.329016;
+                double neutral_Z = 0.358271 * Y / 0.329016;
+                // Difference between simulated color and neutral grey
+                double diff_X = neutral_X - X;
+                double diff_Z = neutral_Z - Z;
+                double diff_r = diff_X * 3.24071 + diff_Z * -0.498571; // XYZ->RGB (sRGB:D65)
+                double diff_g = diff_X * -0.969258 + diff_Z * 0.0415557;
+                double diff_b = diff_X * 0.0556352 + diff_Z * 1.05707;
+                if (std::abs(diff_r) < (std::numeric_limits<double>::epsilon()))
+                {
+                    diff_r = std::numeric_limits<double>::epsilon() * 2.0;
+                }
+                if (std::abs(diff_g) < (std::numeric_limits<double>::epsilon()))
+                {
+                    diff_g = std::numeric_limits<double>::epsilon() * 2.0;
                 }
-                if (tinting)
+                if (std::abs(diff_b) < (std::numeric_limits<double>::epsilon()))
                 {
-                    double h;
-                    double s;
-                    double l;
-                    rgb2hsl(r2,g2,b2,h,s,l);
-                    double h2 = transform.h0 + (h * (transform.h1 - transform.h0));
-                    double s2 = transform.s0 + (s * (transform.s1 - transform.s0));
-                    double l2 = transform.l0 + (l * (transform.l1 - transform.l0));
-                    if (h2 > 1) { h2 = 1; }
-                    else if (h2 < 0) { h2 = 0; }
-                    if (s2 > 1) { s2 = 1; }
-                    else if (s2 < 0) { s2 = 0; }
-                    if (l2 > 1) { l2 = 1; }
-                    else if (l2 < 0) { l2 = 0; }
-                    hsl2rgb(h2,s2,l2,r2,g2,b2);
+                    diff_b = std::numeric_limits<double>::epsilon() * 2.0;
                 }
+                // Convert to RGB color space
+                dr = X * 3.24071 + Y * -1.53726 + Z * -0.498571; // XYZ->RGB (sRGB:D65)
+                dg = X * -0.969258 + Y * 1.87599 + Z * 0.0415557;
+                db = X * 0.0556352 + Y * -0.203996 + Z * 1.05707;
+                // Compensate simulated color towards a neutral fit in RGB space
+                double fit_r = ((dr < 0.0 ? 0.0 : 1.0) - dr) / diff_r;
+                double fit_g = ((dg < 0.0 ? 0.0 : 1.0) - dg) / diff_g;
+                double fit_b = ((db < 0.0 ? 0.0 : 1.0) - db) / diff_b;
+                double adjust = std::max( (fit_r > 1.0 || fit_r < 0.0) ? 0.0 : fit_r,
+                                          (fit_g > 1.0 || fit_g < 0.0) ? 0.0 : fit_g
+                                        );
+                adjust = std::max((fit_b > 1.0 || fit_b < 0.0) ? 0.0 : fit_b, adjust);
+                // Shift proportional to the greatest shift
+                dr = dr + (adjust * diff_r);
+                dg = dg + (adjust * diff_g);
+                db = db + (adjust * diff_b);
+                // Apply gamma correction
+                dr = std::pow(dr, 1.0 / 2.2);
+                dg = std::pow(dg, 1.0 / 2.2);
+                db = std::pow(db, 1.0 / 2.2);
                 // premultiply
-                r2 *= a2;
-                g2 *= a2;
-                b2 *= a2;
-                r = static_cast<uint8_t>(std::floor((r2*255.0)+.5));
-                g = static_cast<uint8_t>(std::floor((g2*255.0)+.5));
-                b = static_cast<uint8_t>(std::floor((b2*255.0)+.5));
-                // all color values must be <= alpha
-                if (r>a) r=a;
-                if (g>a) g=a;
-                if (b>a) b=a;
+                dr *= da;
+                dg *= da;
+                db *= da;
+                // Clamp values
+                if(dr < 0.0)  dr = 0.0;
+                if(dr > 1.0) dr = 1.0;
+                if(dg < 0.0) dg = 0.0;
+                if(dg > 1.0) dg = 1.0;
+                if(db < 0.0) db = 0.0;
+                if(db > 1.0) db = 1.0;
+                r = static_cast<uint8_t>(dr * 255.0);
+                g = static_cast<uint8_t>(dg * 255.0);
+                b = static_cast<uint8_t>(db * 255.0);
             }
         }
-        // set as premultiplied
-        set_premultiplied_alpha(src, true);
-    }
-}
-
-template <typename Src, typename ColorBlindFilter>
-void color_blind_filter(Src & src, ColorBlindFilter const& op)
-{
-    using namespace boost::gil;
-    rgba8_view_t src_view = rgba8_view(src);
-    bool premultiplied = src.get_premultiplied();
-
-    for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
-    {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-        for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
-        {
-            // formula taken from boost/gil/color_convert.hpp:rgb_to_luminance
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            uint8_t & a = get_color(src_it[x], alpha_t());
-            double dr = static_cast<double>(r)/255.0;
-            double dg = static_cast<double>(g)/255.0;
-            double db = static_cast<double>(b)/255.0;
-            double da = static_cast<double>(a)/255.0;
-            // demultiply
-            if (da <= 0.0)
-            {
-                r = g = b = 0;
-                continue;
-            }
-            else if (premultiplied)
-            {
-                dr /= da;
-                dg /= da;
-                db /= da;
-            }
-            // Convert source color into XYZ color space
-            double pow_r = std::pow(dr, 2.2);
-            double pow_g = std::pow(dg, 2.2);
-            double pow_b = std::pow(db, 2.2);
-            double X = (0.412424 * pow_r) + (0.357579 * pow_g) + (0.180464 * pow_b);
-            double Y = (0.212656 * pow_r) + (0.715158 * pow_g) + (0.0721856 * pow_b);
-            double Z = (0.0193324 * pow_r) + (0.119193 * pow_g) + (0.950444 * pow_b);
-            // Convert XYZ into xyY Chromacity Coordinates (xy) and Luminance (Y)
-            double chroma_x = X / (X + Y + Z);
-            double chroma_y = Y / (X + Y + Z);
-            // Generate the "Confusion Line" between the source color and the Confusion Point
-            double m_div = chroma_x - op.x;
-            if (std::abs(m_div) < (std::numeric_limits<double>::epsilon())) continue;
-            double m = (chroma_y - op.y) / (chroma_x - op.x); // slope of Confusion Line
-            double yint = chroma_y - chroma_x * m; // y-intercept of confusion line (x-intercept = 0.0)
-            // How far the xy coords deviate from the simulation
-            double m_div2 = m - op.m;
-            if (std::abs(m_div2) < (std::numeric_limits<double>::epsilon())) continue;
-            double deviate_x = (op.yint - yint) / (m - op.m);
-            double deviate_y = (m * deviate_x) + yint;
-            if (std::abs(deviate_y) < (std::numeric_limits<double>::epsilon()))
-            {
-                deviate_y = std::numeric_limits<double>::epsilon() * 2.0;
-            }
-            // Compute the simulated color's XYZ coords
-            X = deviate_x * Y / deviate_y;
-            Z = (1.0 - (deviate_x + deviate_y)) * Y / deviate_y;
-            // Neutral grey calculated from luminance (in D65)
-            double neutral_X = 0.312713 * Y / 0.329016;
-            double neutral_Z = 0.358271 * Y / 0.329016;
-            // Difference between simulated color and neutral grey
-            double diff_X = neutral_X - X;
-            double diff_Z = neutral_Z - Z;
-            double diff_r = diff_X * 3.24071 + diff_Z * -0.498571; // XYZ->RGB (sRGB:D65)
-            double diff_g = diff_X * -0.969258 + diff_Z * 0.0415557;
-            double diff_b = diff_X * 0.0556352 + diff_Z * 1.05707;
-            if (std::abs(diff_r) < (std::numeric_limits<double>::epsilon()))
-            {
-                diff_r = std::numeric_limits<double>::epsilon() * 2.0;
-            }
-            if (std::abs(diff_g) < (std::numeric_limits<double>::epsilon()))
-            {
-                diff_g = std::numeric_limits<double>::epsilon() * 2.0;
-            }
-            if (std::abs(diff_b) < (std::numeric_limits<double>::epsilon()))
-            {
-                diff_b = std::numeric_limits<double>::epsilon() * 2.0;
-            }
-            // Convert to RGB color space
-            dr = X * 3.24071 + Y * -1.53726 + Z * -0.498571; // XYZ->RGB (sRGB:D65)
-            dg = X * -0.969258 + Y * 1.87599 + Z * 0.0415557;
-            db = X * 0.0556352 + Y * -0.203996 + Z * 1.05707;
-            // Compensate simulated color towards a neutral fit in RGB space
-            double fit_r = ((dr < 0.0 ? 0.0 : 1.0) - dr) / diff_r;
-            double fit_g = ((dg < 0.0 ? 0.0 : 1.0) - dg) / diff_g;
-            double fit_b = ((db < 0.0 ? 0.0 : 1.0) - db) / diff_b;
-            double adjust = std::max( (fit_r > 1.0 || fit_r < 0.0) ? 0.0 : fit_r,
-                                      (fit_g > 1.0 || fit_g < 0.0) ? 0.0 : fit_g
-                                    );
-            adjust = std::max((fit_b > 1.0 || fit_b < 0.0) ? 0.0 : fit_b, adjust);
-            // Shift proportional to the greatest shift
-            dr = dr + (adjust * diff_r);
-            dg = dg + (adjust * diff_g);
-            db = db + (adjust * diff_b);
-            // Apply gamma correction
-            dr = std::pow(dr, 1.0 / 2.2);
-            dg = std::pow(dg, 1.0 / 2.2);
-            db = std::pow(db, 1.0 / 2.2);
-            // premultiply
-            dr *= da;
-            dg *= da;
-            db *= da;
-            // Clamp values
-            if(dr < 0.0)  dr = 0.0;
-            if(dr > 1.0) dr = 1.0;
-            if(dg < 0.0) dg = 0.0;
-            if(dg > 1.0) dg = 1.0;
-            if(db < 0.0) db = 0.0;
-            if(db > 1.0) db = 1.0;
-            r = static_cast<uint8_t>(dr * 255.0);
-            g = static_cast<uint8_t>(dg * 255.0);
-            b = static_cast<uint8_t>(db * 255.0);
-        }
-    }
+    });
     // set as premultiplied
     set_premultiplied_alpha(src, true);
 }
 
 template <typename Src>
-void apply_filter(Src & src, color_blind_protanope const& op)
+void apply_filter(Src & src, color_blind_protanope const& op, unsigned jobs = 1)
 {
-    color_blind_filter(src, op);
+    color_blind_filter(src, op, jobs);
 }
 
 template <typename Src>
-void apply_filter(Src & src, color_blind_deuteranope const& op)
+void apply_filter(Src & src, color_blind_deuteranope const& op, unsigned jobs = 1)
 {
-    color_blind_filter(src, op);
+    color_blind_filter(src, op, jobs);
 }
 
 template <typename Src>
-void apply_filter(Src & src, color_blind_tritanope const& op)
+void apply_filter(Src & src, color_blind_tritanope const& op, unsigned jobs = 1)
 {
-    color_blind_filter(src, op);
+    color_blind_filter(src, op, jobs);
 }
 
 template <typename Src>
-void apply_filter(Src & src, gray const& /*op*/)
+void apply_filter(Src & src, gray const& /*op*/, unsigned /*jobs*/ = 1)
 {
-    premultiply_alpha(src);
     using namespace boost::gil;
-
+    bool premultiplied = src.get_premultiplied();
     rgba8_view_t src_view = rgba8_view(src);
 
     for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
@@ -836,10 +771,12 @@ void apply_filter(Src & src, gray const& /*op*/)
             uint8_t & r = get_color(src_it[x], red_t());
             uint8_t & g = get_color(src_it[x], green_t());
             uint8_t & b = get_color(src_it[x], blue_t());
+            if (!premultiplied) premultiply_pixel(r, g, b, get_color(src_it[x], alpha_t()));
             uint8_t   v = uint8_t((4915 * r + 9667 * g + 1802 * b + 8192) >> 14);
             r = g = b = v;
         }
     }
+    set_premultiplied_alpha(src, true);
 }
 
 template <typename Src, typename Dst>
@@ -871,7 +808,7 @@ void x_gradient_impl(Src const& src_view, Dst const& dst_view)
 }
 
 template <typename Src>
-void apply_filter(Src & src, x_gradient const& /*op*/)
+void apply_filter(Src & src, x_gradient const& /*op*/, unsigned /*jobs*/ = 1)
 {
     premultiply_alpha(src);
     double_buffer<Src> tb(src);
@@ -879,7 +816,7 @@ void apply_filter(Src & src, x_gradient const& /*op*/)
 }
 
 template <typename Src>
-void apply_filter(Src & src, y_gradient const& /*op*/)
+void apply_filter(Src & src, y_gradient const& /*op*/, unsigned /*jobs*/ = 1)
 {
     premultiply_alpha(src);
     double_buffer<Src> tb(src);
@@ -888,11 +825,10 @@ void apply_filter(Src & src, y_gradient const& /*op*/)
 }
 
 template <typename Src>
-void apply_filter(Src & src, invert const& /*op*/)
+void apply_filter(Src & src, invert const& /*op*/, unsigned /*jobs*/ = 1)
 {
-    premultiply_alpha(src);
     using namespace boost::gil;
-
+    bool premultiplied = src.get_premultiplied();
     rgba8_view_t src_view = rgba8_view(src);
 
     for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
@@ -906,28 +842,87 @@ void apply_filter(Src & src, invert const& /*op*/)
             uint8_t & r = get_color(src_it[x], red_t());
             uint8_t & g = get_color(src_it[x], green_t());
             uint8_t & b = get_color(src_it[x], blue_t());
+            if (!premultiplied) premultiply_pixel(r, g, b, a);
             r = a - r;
             g = a - g;
             b = a - b;
         }
     }
+    set_premultiplied_alpha(src, true);
 }
 
+// filters reading premultiplied pixels; they premultiply their input
+// themselves when it isn't
+struct premultiplied_input_visitor
+{
+    template <typename T>
+    bool operator() (T const& /*filter*/) const { return false; }
+    bool operator() (agg_stack_blur const&) const { return true; }
+    bool operator() (gray const&) const { return true; }
+    bool operator() (x_gradient const&) const { return true; }
+    bool operator() (y_gradient const&) const { return true; }
+    bool operator() (invert const&) const { return true; }
+};
+
+template <typename T>
+struct is_convolution : std::false_type {};
+template <> struct is_convolution<blur> : std::true_type {};
+template <> struct is_convolution<emboss> : std::true_type {};
+template <> struct is_convolution<sharpen> : std::true_type {};
+template <> struct is_convolution<edge_detect> : std::true_type {};
+template <> struct is_convolution<sobel> : std::true_type {};
+
 template <typename Src>
 struct filter_visitor
 {
-    filter_visitor(Src & src)
-    : src_(src) {}
+    // with `premultiply_output` a filter leaving demultiplied pixels
+    // premultiplies them as it writes them
+    filter_visitor(Src & src, unsigned jobs = 1, bool premultiply_output = false)
+    : src_(src),
+      jobs_(jobs),
+      premultiply_output_(premultiply_output) {}
 
     template <typename T>
     void operator () (T const& filter) const
     {
-        apply_filter(src_, filter);
+        apply(filter, is_convolution<T>());
     }
 
     Src & src_;
+    unsigned jobs_;
+    bool premultiply_output_;
+
+private:
+    template <typename T>
+    void apply(T const& filter, std::true_type) const
+    {
+        apply_filter(src_, filter, jobs_, premultiply_output_);
+    }
+
+    template <typename T>
+    void apply(T const& filter, std::false_type) const
+    {
+        apply_filter(src_, filter, jobs_);
+    }
 };
 
+// Applies a chain of filters, leaving `src` premultiplied when `premultiply`
+// is set. Alpha is premultiplied within the filters' own passes over the
+// image rather than in passes of its own: by a convolution as it writes its
+// output when the next filter (or the caller) wants premultiplied pixels,
+// or by the next filter as it reads them.
+template <typename Src>
+void apply_filters(Src & src, std::vector<filter_type> const& filters, unsigned jobs = 1, bool premultiply = false)
+{
+    for (std::size_t i = 0; i < filters.size(); ++i)
+    {
+        bool premultiply_output = (i + 1 == filters.size()) ? premultiply :
+            util::apply_visitor(premultiplied_input_visitor(), filters[i + 1]);
+        util::apply_visitor(filter_visitor<Src>(src, jobs, premultiply_output), filters[i]);
+    }
+    if (premultiply) premultiply_alpha(src);
+}
+
 struct filter_radius_visitor
 {
     int & radius_;
@@ -951,11 +946,7 @@ void filter_image(Src & src, std::string const& filter)
     {
         throw std::runtime_error("Failed to parse filter argument in filter_image: '" + filter + "'");
     }
-    filter_visitor<Src> visitor(src);
-    for (filter_type const& filter_tag : filter_vector)
-    {
-        util::apply_visitor(visitor, filter_tag);
-    }
+    apply_filters(src, filter_vector);
 }
 
 template<typename Src>
@@ -967,11 +958,7 @@ Src filter_image(Src const& src, std::string const& filter)
         throw std::runtime_error("Failed to parse filter argument in filter_image: '" + filter + "'");
     }
     Src new_src(src);
-    filter_visitor<Src> visitor(new_src);
-    for (filter_type const& filter_tag : filter_vector)
-    {
-        util::apply_visitor(visitor, filter_tag);
-    }
+    apply_filters(new_src, filter_vector);
     return new_src;
 }
 
@@ -25,6 +25,7 @@
 
 // mapnik
 #include <mapnik/quad_tree.hpp>
+#include <mapnik/packed_rtree.hpp>
 #include <mapnik/util/noncopyable.hpp>
 #include <mapnik/value_types.hpp>
 
@@ -34,6 +35,7 @@
 #pragma GCC diagnostic pop
 
 // stl
+#include <functional>
 #include <vector>
 
 namespace mapnik
@@ -127,7 +129,7 @@ public:
 };
 
 
-//quad tree based label collision detector so labels dont appear within a given distance
+// packed r-tree based label collision detector so labels dont appear within a given distance
 class label_collision_detector4 : util::noncopyable
 {
 public:
@@ -141,26 +143,21 @@ public:
     };
 
 private:
-    using tree_t = quad_tree< label >;
+    using tree_t = packed_rtree< label >;
+    using result_type = std::vector<std::reference_wrapper<label const> >;
     tree_t tree_;
+    box2d<double> extent_;
+    result_type labels_;
 
 public:
-    using query_iterator = tree_t::query_iterator;
+    using query_iterator = result_type::iterator;
 
     explicit label_collision_detector4(box2d<double> const& _extent)
-        : tree_(_extent) {}
+        : tree_(), extent_(_extent), labels_() {}
 
     bool has_placement(box2d<double> const& box)
     {
-        tree_t::query_iterator tree_itr = tree_.query_in_box(box);
-        tree_t::query_iterator tree_end = tree_.query_end();
-
-        for ( ;tree_itr != tree_end; ++tree_itr)
-        {
-            if (tree_itr->get().box.intersects(box)) return false;
-        }
-
-        return true;
+        return !tree_.intersects(box);
     }
 
     bool has_placement(box2d<double> const& box, double margin)
@@ -170,17 +167,7 @@ public:
                                                                box.maxx() + margin, box.maxy() + margin)
                                                : box);
 
-        tree_t::query_iterator tree_itr = tree_.query_in_box(margin_box);
-        tree_t::query_iterator tree_end = tree_.query_end();
-
-        for (;tree_itr != tree_end; ++tree_itr)
-        {
-            if (tree_itr->get().box.intersects(margin_box))
-            {
-                return false;
-            }
-        }
-        return true;
+        return !tree_.intersects(margin_box);
     }
 
     bool has_placement(box2d<double> const& box, double margin, mapnik::value_unicode_string const& text, double repeat_distance)
@@ -198,23 +185,16 @@ public:
                                                                box.maxx() + margin, box.maxy() + margin)
                                                : box);
 
-        tree_t::query_iterator tree_itr = tree_.query_in_box(repeat_box);
-        tree_t::query_iterator tree_end = tree_.query_end();
-
-        for ( ;tree_itr != tree_end; ++tree_itr)
-        {
-            if (tree_itr->get().box.intersects(margin_box) || (text == tree_itr->get().text && tree_itr->get().box.intersects(repeat_box)))
-            {
-                return false;
-            }
-        }
-
-        return true;
+        // labels found within repeat_box intersect it, so only margin and text need checking
+        return tree_.visit(repeat_box, [&](label const& lbl)
+                           {
+                               return !(lbl.box.intersects(margin_box) || text == lbl.text);
+                           });
     }
 
     void insert(box2d<double> const& box)
     {
-        if (tree_.extent().intersects(box))
+        if (extent_.intersects(box))
         {
             tree_.insert(label(box), box);
         }
@@ -222,7 +202,7 @@ public:
 
     void insert(box2d<double> const& box, mapnik::value_unicode_string const& text)
     {
-        if (tree_.extent().intersects(box))
+        if (extent_.intersects(box))
         {
             tree_.insert(label(box, text), box);
         }
@@ -231,15 +211,21 @@ public:
     void clear()
     {
         tree_.clear();
+        labels_.clear();
     }
 
     box2d<double> const& extent() const
     {
-        return tree_.extent();
+        return extent_;
     }
 
-    query_iterator begin() { return tree_.query_in_box(extent()); }
-    query_iterator end() { return tree_.query_end(); }
+    // all labels in insertion order
+    query_iterator begin()
+    {
+        labels_.assign(tree_.begin(), tree_.end());
+        return labels_.begin();
+    }
+    query_iterator end() { return labels_.end(); }
 };
 }
 
@@ -0,0 +1,88 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_METATILE_HPP
+#define MAPNIK_METATILE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/image.hpp>
+
+// stl
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mapnik {
+
+class Map;
+
+struct MAPNIK_DECL metatile_options
+{
+    metatile_options()
+        : columns(1),
+          rows(1),
+          format("png8"),
+          palette(),
+          jobs(0),
+          encode_solid_tiles(true) {}
+
+    // number of sub-tiles across and down, the metatile size must divide evenly
+    unsigned columns;
+    unsigned rows;
+    // image format passed to save_to_string, e.g. "png8:z=1"
+    std::string format;
+    // RGBA bytes of a palette for paletted (png8/png256) formats;
+    // when empty one palette is computed from the whole metatile and
+    // shared by all sub-tiles so they match along their edges
+    std::string palette;
+    // number of threads encoding sub-tiles (0 - hardware concurrency)
+    unsigned jobs;
+    // solid tiles are detected with is_solid() and not encoded per tile;
+    // if set, each distinct solid pixel value is encoded once and shared
+    bool encode_solid_tiles;
+};
+
+struct metatile_tile
+{
+    unsigned column;
+    unsigned row;
+    // all pixels have the same value, which is `pixel`
+    bool solid;
+    std::uint32_t pixel;
+    // encoded image, empty for solid tiles unless encode_solid_tiles is set
+    std::string data;
+};
+
+// Slice rendered metatile into columns x rows tiles and encode them.
+MAPNIK_DECL std::vector<metatile_tile> split_metatile(image_rgba8 const& image,
+                                                      metatile_options const& options);
+
+// Render whole map once (so labels crossing tile edges are placed once)
+// and split the result. Map dimensions make up the metatile size.
+MAPNIK_DECL std::vector<metatile_tile> render_metatile(Map const& map,
+                                                       metatile_options const& options,
+                                                       double scale_factor = 1.0);
+
+}
+
+#endif // MAPNIK_METATILE_HPP
@@ -0,0 +1,251 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_PACKED_RTREE_HPP
+#define MAPNIK_PACKED_RTREE_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace mapnik
+{
+
+// Spatial index stored in flat arrays. Items are bulk loaded into packed
+// R-trees (sort-tile-recursive order, `node_size` entries per node). Items
+// inserted one at a time are kept in an unindexed tail of at most `tail_size`
+// entries, which is then packed into a new level; levels of equal size are
+// merged, so there are only logarithmically many levels to query.
+// Queries don't allocate and clear() keeps all storage for reuse.
+template <typename T, typename Box = box2d<double> >
+class packed_rtree : util::noncopyable
+{
+    static constexpr std::size_t node_size = 16;
+    static constexpr std::size_t tail_size = 64;
+
+    struct leaf
+    {
+        Box box;
+        std::size_t index;
+    };
+
+    struct node
+    {
+        Box box;
+        std::size_t first;
+        std::size_t last;
+        bool is_leaf; // children are in leaves_ rather than level nodes
+    };
+
+    // packed tree indexing items [begin, end)
+    struct level
+    {
+        std::size_t begin;
+        std::size_t end;
+        std::vector<node> nodes; // leaf level first, root last
+    };
+
+public:
+    using value_type = T;
+    using bbox_type = Box;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    packed_rtree()
+        : values_(),
+          boxes_(),
+          leaves_(),
+          levels_(),
+          num_levels_(0),
+          packed_(0) {}
+
+    void insert(value_type value, bbox_type const& box)
+    {
+        values_.push_back(std::move(value));
+        boxes_.push_back(box);
+        if (values_.size() - packed_ >= tail_size)
+        {
+            pack_tail();
+        }
+    }
+
+    // Calls visitor(item) for every item whose box intersects `box` until the
+    // visitor returns false. Returns false if the visitor stopped the query.
+    template <typename Visitor>
+    bool visit(bbox_type const& box, Visitor && visitor) const
+    {
+        for (std::size_t l = 0; l < num_levels_; ++l)
+        {
+            level const& lvl = levels_[l];
+            node const& root = lvl.nodes.back();
+            if (root.box.intersects(box) && !visit_node(lvl, root, box, visitor)) return false;
+        }
+        for (std::size_t i = packed_; i < values_.size(); ++i)
+        {
+            if (boxes_[i].intersects(box) && !visitor(values_[i])) return false;
+        }
+        return true;
+    }
+
+    // True if any item box intersects `box`
+    bool intersects(bbox_type const& box) const
+    {
+        return !visit(box, [](value_type const&) { return false; });
+    }
+
+    // Packs all items into a single tree, e.g. after inserting a batch.
+    void pack()
+    {
+        if (packed_ == values_.size() && num_levels_ <= 1) return;
+        num_levels_ = 0;
+        packed_ = 0;
+        pack_tail();
+    }
+
+    void clear()
+    {
+        values_.clear();
+        boxes_.clear();
+        leaves_.clear();
+        num_levels_ = 0;
+        packed_ = 0;
+    }
+
+    std::size_t size() const { return values_.size(); }
+    bool empty() const { return values_.empty(); }
+
+    // items in insertion order
+    const_iterator begin() const { return values_.begin(); }
+    const_iterator end() const { return values_.end(); }
+
+private:
+    // packs the tail into a new level, merging it with preceding levels
+    // no larger than itself
+    void pack_tail()
+    {
+        std::size_t begin = packed_;
+        std::size_t end = values_.size();
+        if (begin == end) return;
+        while (num_levels_ > 0 &&
+               levels_[num_levels_ - 1].end - levels_[num_levels_ - 1].begin <= end - begin)
+        {
+            begin = levels_[--num_levels_].begin;
+        }
+        if (num_levels_ == levels_.size()) levels_.emplace_back();
+        level & lvl = levels_[num_levels_++];
+        lvl.begin = begin;
+        lvl.end = end;
+        build(lvl);
+        packed_ = end;
+    }
+
+    void build(level & lvl)
+    {
+        leaves_.resize(lvl.end);
+        for (std::size_t i = lvl.begin; i < lvl.end; ++i)
+        {
+            leaves_[i].box = boxes_[i];
+            leaves_[i].index = i;
+        }
+        sort_tile_recursive(leaves_.begin() + lvl.begin, leaves_.begin() + lvl.end);
+        std::vector<node> & nodes = lvl.nodes;
+        nodes.clear();
+        // leaf level
+        for (std::size_t first = lvl.begin; first < lvl.end; first += node_size)
+        {
+            std::size_t last = std::min(lvl.end, first + node_size);
+            node n { leaves_[first].box, first, last, true };
+            for (std::size_t i = first + 1; i < last; ++i) n.box.expand_to_include(leaves_[i].box);
+            nodes.push_back(n);
+        }
+        // upper levels until a single root remains
+        std::size_t level_begin = 0;
+        std::size_t level_end = nodes.size();
+        while (level_end - level_begin > 1)
+        {
+            for (std::size_t first = level_begin; first < level_end; first += node_size)
+            {
+                std::size_t last = std::min(level_end, first + node_size);
+                node n { nodes[first].box, first, last, false };
+                for (std::size_t i = first + 1; i < last; ++i) n.box.expand_to_include(nodes[i].box);
+                nodes.push_back(n);
+            }
+            level_begin = level_end;
+            level_end = nodes.size();
+        }
+    }
+
+    template <typename Visitor>
+    bool visit_node(level const& lvl, node const& n, bbox_type const& box, Visitor & visitor) const
+    {
+        if (n.is_leaf)
+        {
+            for (std::size_t i = n.first; i < n.last; ++i)
+            {
+                if (leaves_[i].box.intersects(box) && !visitor(values_[leaves_[i].index])) return false;
+            }
+        }
+        else
+        {
+            for (std::size_t i = n.first; i < n.last; ++i)
+            {
+                if (lvl.nodes[i].box.intersects(box) && !visit_node(lvl, lvl.nodes[i], box, visitor)) return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename Iterator>
+    static void sort_tile_recursive(Iterator begin, Iterator end)
+    {
+        std::size_t size = static_cast<std::size_t>(end - begin);
+        if (size <= node_size) return;
+        std::size_t num_leaves = (size + node_size - 1) / node_size;
+        std::size_t num_slices = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(num_leaves))));
+        std::size_t slice_size = num_slices * node_size;
+        std::sort(begin, end, [](leaf const& a, leaf const& b)
+                  { return a.box.minx() + a.box.maxx() < b.box.minx() + b.box.maxx(); });
+        for (std::size_t first = 0; first < size; first += slice_size)
+        {
+            std::size_t last = std::min(size, first + slice_size);
+            std::sort(begin + first, begin + last, [](leaf const& a, leaf const& b)
+                      { return a.box.miny() + a.box.maxy() < b.box.miny() + b.box.maxy(); });
+        }
+    }
+
+    std::vector<value_type> values_;
+    std::vector<bbox_type> boxes_;
+    std::vector<leaf> leaves_;
+    std::vector<level> levels_; // largest first, only the first num_levels_ are in use
+    std::size_t num_levels_;
+    std::size_t packed_; // number of items indexed by the levels
+};
+
+}
+
+#endif // MAPNIK_PACKED_RTREE_HPP
@@ -28,6 +28,7 @@
 #include <mapnik/octree.hpp>
 #include <mapnik/hextree.hpp>
 #include <mapnik/image.hpp>
+#include <mapnik/util/parallel.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -42,6 +43,17 @@ extern "C"
 #include <set>
 #pragma GCC diagnostic pop
 
+// stl
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
 #define MAX_OCTREE_LEVELS 4
 
 namespace mapnik {
@@ -54,6 +66,9 @@ struct png_options {
     double gamma;
     bool paletted;
     bool use_hextree;
+    // threads quantising and deflating row bands, 0 = all cores,
+    // 1 = single threaded libpng encoder
+    unsigned jobs;
     png_options() :
         colors(256),
         compression(Z_DEFAULT_COMPRESSION),
@@ -61,7 +76,8 @@ struct png_options {
         trans_mode(-1),
         gamma(-1),
         paletted(true),
-        use_hextree(true) {}
+        use_hextree(true),
+        jobs(1) {}
 };
 
 template <typename T>
@@ -78,12 +94,363 @@ void flush_data (png_structp png_ptr)
     out->flush();
 }
 
+namespace detail {
+
+inline void append_png_uint32(std::string & out, std::uint32_t val)
+{
+    out.push_back(static_cast<char>((val >> 24) & 0xff));
+    out.push_back(static_cast<char>((val >> 16) & 0xff));
+    out.push_back(static_cast<char>((val >> 8) & 0xff));
+    out.push_back(static_cast<char>(val & 0xff));
+}
+
+template <typename T>
+void write_png_chunk(T & file, char const* type, char const* data, std::size_t size)
+{
+    std::string header;
+    append_png_uint32(header, static_cast<std::uint32_t>(size));
+    header.append(type, 4);
+    uLong crc = crc32(0L, reinterpret_cast<Bytef const*>(type), 4);
+    crc = crc32(crc, reinterpret_cast<Bytef const*>(data), static_cast<uInt>(size));
+    std::string trailer;
+    append_png_uint32(trailer, static_cast<std::uint32_t>(crc));
+    file.write(header.data(), header.size());
+    file.write(data, size);
+    file.write(trailer.data(), trailer.size());
+}
+
+template <typename T>
+void write_png_chunk(T & file, char const* type, std::string const& data)
+{
+    write_png_chunk(file, type, data.data(), data.size());
+}
+
+// chunk lengths must stay below 2^31
+constexpr std::size_t png_max_idat_size = std::size_t(1) << 30;
+
+// Writes `data` as consecutive IDAT chunks of at most `max_size` bytes
+template <typename T>
+void write_png_idat(T & file, std::string const& data, std::size_t max_size = png_max_idat_size)
+{
+    std::size_t offset = 0;
+    do
+    {
+        std::size_t size = std::min(data.size() - offset, max_size);
+        write_png_chunk(file, "IDAT", data.data() + offset, size);
+        offset += size;
+    }
+    while (offset < data.size());
+}
+
+// PNG signature and IHDR chunk (no interlacing)
+template <typename T>
+void write_png_header(T & file, unsigned width, unsigned height, int bit_depth, int color_type)
+{
+    static const char signature[8] = { '\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n' };
+    file.write(signature, 8);
+    std::string ihdr;
+    append_png_uint32(ihdr, width);
+    append_png_uint32(ihdr, height);
+    ihdr.push_back(static_cast<char>(bit_depth));
+    ihdr.push_back(static_cast<char>(color_type));
+    ihdr.push_back(0); // compression
+    ihdr.push_back(0); // filter
+    ihdr.push_back(0); // interlace
+    write_png_chunk(file, "IHDR", ihdr);
+}
+
+// PLTE chunk and tRNS chunk truncated to the last non-opaque entry
+template <typename T>
+void write_png_palette(T & file, std::vector<mapnik::rgb> const& palette,
+                       std::vector<unsigned> const& alpha)
+{
+    std::string plte;
+    for (auto const& c : palette)
+    {
+        plte.push_back(static_cast<char>(c.r));
+        plte.push_back(static_cast<char>(c.g));
+        plte.push_back(static_cast<char>(c.b));
+    }
+    write_png_chunk(file, "PLTE", plte);
+    std::size_t alpha_size = 0;
+    for (std::size_t i = 0; i < alpha.size(); ++i)
+    {
+        if (alpha[i] < 255) alpha_size = i + 1;
+    }
+    if (alpha_size > 0)
+    {
+        std::string trns;
+        for (std::size_t i = 0; i < alpha_size; ++i)
+        {
+            trns.push_back(static_cast<char>(alpha[i]));
+        }
+        write_png_chunk(file, "tRNS", trns);
+    }
+}
+
+// Raw deflate output of a band of rows
+struct png_band
+{
+    png_band()
+        : data(),
+          adler(adler32(0L, Z_NULL, 0)),
+          length(0) {}
+    std::string data;
+    uLong adler;
+    std::size_t length;
+};
+
+// Deflates rows [begin, end), each prefixed with filter type 0 and filled
+// by row(y, buffer). Non-final bands end on a byte boundary (Z_SYNC_FLUSH)
+// so fragments can be concatenated into a single stream; the window is
+// primed with the tail of the previous band to keep compression close to
+// the single threaded encoder.
+template <typename RowFunc>
+void deflate_png_band(RowFunc const& row, std::size_t row_bytes,
+                      std::size_t begin, std::size_t end, bool last,
+                      png_options const& opts, png_band & band)
+{
+    std::size_t const stride = row_bytes + 1;
+    std::size_t const window = 32768;
+    std::size_t const chunk_rows = std::max<std::size_t>(1, 65536 / stride);
+    std::vector<std::uint8_t> buffer(std::max(chunk_rows, (window + stride - 1) / stride) * stride);
+    auto fill = [&](std::size_t y0, std::size_t y1)
+    {
+        std::uint8_t * out = buffer.data();
+        for (std::size_t y = y0; y < y1; ++y)
+        {
+            *out++ = 0; // PNG_FILTER_VALUE_NONE
+            row(static_cast<unsigned>(y), out);
+            out += row_bytes;
+        }
+        return static_cast<std::size_t>(out - buffer.data());
+    };
+
+    z_stream strm;
+    std::memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, opts.compression, Z_DEFLATED, -15, 8, opts.strategy) != Z_OK)
+    {
+        throw std::runtime_error("png: failed to initialise deflate");
+    }
+    if (begin > 0)
+    {
+        std::size_t dict_rows = std::min(begin, (window + stride - 1) / stride);
+        std::size_t size = fill(begin - dict_rows, begin);
+        std::size_t dict_size = std::min(size, window);
+        deflateSetDictionary(&strm, buffer.data() + size - dict_size, static_cast<uInt>(dict_size));
+    }
+    auto compress = [&](std::size_t size, int flush)
+    {
+        strm.next_in = buffer.data();
+        strm.avail_in = static_cast<uInt>(size);
+        do
+        {
+            std::size_t offset = band.data.size();
+            band.data.resize(offset + 65536);
+            strm.next_out = reinterpret_cast<Bytef*>(&band.data[offset]);
+            strm.avail_out = 65536;
+            int ret = deflate(&strm, flush);
+            band.data.resize(offset + 65536 - strm.avail_out);
+            if (ret == Z_STREAM_ERROR)
+            {
+                deflateEnd(&strm);
+                throw std::runtime_error("png: deflate failed");
+            }
+        }
+        while (strm.avail_out == 0);
+    };
+    for (std::size_t y = begin; y < end; y += chunk_rows)
+    {
+        std::size_t size = fill(y, std::min(end, y + chunk_rows));
+        band.adler = adler32(band.adler, buffer.data(), static_cast<uInt>(size));
+        band.length += size;
+        compress(size, Z_NO_FLUSH);
+    }
+    compress(0, last ? Z_FINISH : Z_SYNC_FLUSH);
+    deflateEnd(&strm);
+}
+
+// Writes the IDAT chunks and IEND: row bands are deflated concurrently
+// and emitted in order, as IDAT chunks of up to png_max_idat_size bytes per
+// band, wrapped in a zlib header and the combined adler32 checksum.
+template <typename T, typename RowFunc>
+void write_png_image(T & file, unsigned height, std::size_t row_bytes,
+                     RowFunc const& row, png_options const& opts)
+{
+    // bands of at least ~256KB of pixel data so small images stay in one band
+    std::size_t min_band = std::max<std::size_t>(16, (256 * 1024) / (row_bytes + 1));
+    unsigned jobs = opts.jobs == 0 ? util::hardware_concurrency() : opts.jobs;
+    std::size_t num_bands = std::max<std::size_t>(1, std::min<std::size_t>(jobs, height / min_band));
+    std::size_t band_rows = std::max<std::size_t>(1, (height + num_bands - 1) / num_bands);
+    num_bands = std::max<std::size_t>(1, (height + band_rows - 1) / band_rows);
+    std::vector<png_band> bands(num_bands);
+    util::parallel_for(num_bands, jobs, [&](std::size_t i)
+    {
+        std::size_t begin = i * band_rows;
+        std::size_t end = std::min<std::size_t>(height, begin + band_rows);
+        deflate_png_band(row, row_bytes, begin, end, i + 1 == num_bands, opts, bands[i]);
+    });
+
+    // zlib header: 32K window, FLEVEL from the compression level
+    int level = opts.compression;
+    unsigned flevel = (level == Z_DEFAULT_COMPRESSION || level == 6) ? 2 : (level < 2 ? 0 : (level < 6 ? 1 : 3));
+    unsigned cmf = 0x78;
+    unsigned flg = flevel << 6;
+    flg += 31 - ((cmf << 8) + flg) % 31;
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (std::size_t i = 0; i < num_bands; ++i)
+    {
+        std::string & data = bands[i].data;
+        adler = adler32_combine(adler, bands[i].adler, static_cast<z_off_t>(bands[i].length));
+        if (i == 0)
+        {
+            std::string header;
+            header.push_back(static_cast<char>(cmf));
+            header.push_back(static_cast<char>(flg));
+            data.insert(0, header);
+        }
+        if (i + 1 == num_bands)
+        {
+            append_png_uint32(data, static_cast<std::uint32_t>(adler));
+        }
+        write_png_idat(file, data);
+        std::string().swap(data);
+    }
+    write_png_chunk(file, "IEND", std::string());
+}
+
+// Quantises through a small band-local cache: the shared tree (whose own
+// cache is not thread safe) is only consulted under `mutex` on a miss, so
+// bands sharing one palette can be quantised concurrently.
+template <typename Tree>
+class band_quantizer
+{
+    static const unsigned cache_bits = 12;
+public:
+#ifdef MAPNIK_THREADSAFE
+    band_quantizer(Tree const& tree, std::mutex & mutex)
+        : tree_(tree),
+          mutex_(mutex),
+#else
+    explicit band_quantizer(Tree const& tree)
+        : tree_(tree),
+#endif
+          cache_(1 << cache_bits, std::make_pair(0u, -1)) {}
+
+    int operator() (unsigned val)
+    {
+        std::pair<unsigned, int> & entry = cache_[(val * 2654435761u) >> (32 - cache_bits)];
+        if (entry.second < 0 || entry.first != val)
+        {
+#ifdef MAPNIK_THREADSAFE
+            std::lock_guard<std::mutex> lock(mutex_);
+#endif
+            entry.first = val;
+            entry.second = tree_.quantize(val);
+        }
+        return entry.second;
+    }
+
+private:
+    Tree const& tree_;
+#ifdef MAPNIK_THREADSAFE
+    std::mutex & mutex_;
+#endif
+    std::vector<std::pair<unsigned, int> > cache_;
+};
+
+// Fills rows [begin, end) of `out` with 8 or 4 bit palette indexes
+template <typename T, typename Quantizer>
+void quantize_rows(T const& image, image_gray8 & out, unsigned bits,
+                   std::size_t begin, std::size_t end, Quantizer && quantize)
+{
+    unsigned width = image.width();
+    for (std::size_t y = begin; y < end; ++y)
+    {
+        mapnik::image_rgba8::pixel_type const * row = image.get_row(y);
+        mapnik::image_gray8::pixel_type  * row_out = out.get_row(y);
+        if (bits == 8)
+        {
+            for (unsigned x = 0; x < width; ++x)
+            {
+                row_out[x] = quantize(row[x]);
+            }
+        }
+        else
+        {
+            std::uint8_t index = 0;
+            for (unsigned x = 0; x < width; ++x)
+            {
+                index = quantize(row[x]);
+                if (x%2 == 0)
+                {
+                    index = index<<4;
+                }
+                row_out[x>>1] |= index;
+            }
+        }
+    }
+}
+
+// Quantises `image` into `out` in row bands across opts.jobs threads
+template <typename T, typename Tree>
+void quantize_image(T const& image, image_gray8 & out, unsigned bits,
+                    Tree const& tree, png_options const& opts)
+{
+    unsigned jobs = opts.jobs == 0 ? util::hardware_concurrency() : opts.jobs;
+    if (jobs <= 1)
+    {
+        quantize_rows(image, out, bits, 0, image.height(),
+                      [&tree](unsigned val) { return tree.quantize(val); });
+        return;
+    }
+#ifdef MAPNIK_THREADSAFE
+    std::mutex mutex;
+#endif
+    util::parallel_bands(image.height(), jobs, 64, [&](std::size_t begin, std::size_t end)
+    {
+#ifdef MAPNIK_THREADSAFE
+        band_quantizer<Tree> quantize(tree, mutex);
+#else
+        band_quantizer<Tree> quantize(tree);
+#endif
+        quantize_rows(image, out, bits, begin, end, quantize);
+    });
+}
+
+}
+
 template <typename T1, typename T2>
 void save_as_png(T1 & file,
                 T2 const& image,
                 png_options const& opts)
 
 {
+    if (opts.jobs != 1)
+    {
+        bool strip_alpha = (opts.trans_mode == 0);
+        unsigned width = image.width();
+        detail::write_png_header(file, width, image.height(), 8,
+                                 strip_alpha ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA);
+        detail::write_png_image(file, image.height(), std::size_t(width) * (strip_alpha ? 3 : 4),
+                                [&image, width, strip_alpha](unsigned y, std::uint8_t * out)
+        {
+            std::uint8_t const* row = reinterpret_cast<std::uint8_t const*>(image.get_row(y));
+            if (!strip_alpha)
+            {
+                std::memcpy(out, row, std::size_t(width) * 4);
+                return;
+            }
+            for (unsigned x = 0; x < width; ++x)
+            {
+                *out++ = row[4 * x];
+                *out++ = row[4 * x + 1];
+                *out++ = row[4 * x + 2];
+            }
+        }, opts);
+        return;
+    }
+
     png_voidp error_ptr=0;
     png_structp png_ptr=png_create_write_struct(PNG_LIBPNG_VER_STRING,
                                                 error_ptr,0, 0);
@@ -255,6 +622,18 @@ void save_as_png(T & file, std::vector<mapnik::rgb> const& palette,
                  std::vector<unsigned> const&alpha,
                  png_options const& opts)
 {
+    if (opts.jobs != 1)
+    {
+        std::size_t row_bytes = (std::size_t(width) * color_depth + 7) / 8;
+        detail::write_png_header(file, width, height, color_depth, PNG_COLOR_TYPE_PALETTE);
+        detail::write_png_palette(file, palette, alpha);
+        detail::write_png_image(file, height, row_bytes, [&image, row_bytes](unsigned y, std::uint8_t * out)
+        {
+            std::memcpy(out, image.get_row(y), row_bytes);
+        }, opts);
+        return;
+    }
+
     png_voidp error_ptr=0;
     png_structp png_ptr=png_create_write_struct(PNG_LIBPNG_VER_STRING,
                                                 error_ptr,0, 0);
@@ -570,15 +949,7 @@ void save_as_png8(T1 & file,
     {
         // >16 && <=256 colors -> write 8-bit color depth
         image_gray8 reduced_image(width, height);
-        for (unsigned y = 0; y < height; ++y)
-        {
-            mapnik::image_rgba8::pixel_type const * row = image.get_row(y);
-            mapnik::image_gray8::pixel_type  * row_out = reduced_image.get_row(y);
-            for (unsigned x = 0; x < width; ++x)
-            {
-                row_out[x] = tree.quantize(row[x]);
-            }
-        }
+        detail::quantize_image(image, reduced_image, 8, tree, opts);
         save_as_png(file, palette, reduced_image, width, height, 8, alpha_table, opts);
     }
     else if (palette.size() == 1)
@@ -596,22 +967,7 @@ void save_as_png8(T1 & file,
         unsigned image_width  = ((width + 7) >> 1) & ~3U; // 4-bit image, round up to 32-bit boundary
         unsigned image_height = height;
         image_gray8 reduced_image(image_width, image_height);
-        for (unsigned y = 0; y < height; ++y)
-        {
-            mapnik::image_rgba8::pixel_type const * row = image.get_row(y);
-            mapnik::image_gray8::pixel_type  * row_out = reduced_image.get_row(y);
-            std::uint8_t index = 0;
-            for (unsigned x = 0; x < width; ++x)
-            {
-
-                index = tree.quantize(row[x]);
-                if (x%2 == 0)
-                {
-                    index = index<<4;
-                }
-                row_out[x>>1] |= index;
-            }
-        }
+        detail::quantize_image(image, reduced_image, 4, tree, opts);
         save_as_png(file, palette, reduced_image, width, height, 4, alpha_table, opts);
     }
 }
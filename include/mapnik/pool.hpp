@@ -30,81 +30,155 @@
 #include <memory>
 #ifdef MAPNIK_THREADSAFE
 #include <mutex>
+#include <condition_variable>
 #endif
 
 // stl
 #include <algorithm> // std::max
+#include <chrono>
+#include <cstdint>
 #include <deque>
+#include <thread>
 
 namespace mapnik
 {
+
+// Counters describing how a pool has been used since it was created
+struct pool_stats
+{
+    pool_stats()
+        : borrowed(0),
+          exhausted(0),
+          waited(0),
+          created(0),
+          reconnects(0),
+          reaped(0),
+          borrow_time_us(0),
+          max_borrow_time_us(0) {}
+
+    std::size_t borrowed;   // borrowObject calls returning an object
+    std::size_t exhausted;  // borrowObject calls returning nothing
+    std::size_t waited;     // borrowObject calls waiting for an object to be released
+    std::size_t created;    // objects created, including the initial ones
+    std::size_t reconnects; // invalid objects dropped, to be replaced by new ones
+    std::size_t reaped;     // idle objects above the initial size closed
+    std::uint64_t borrow_time_us; // total time spent in borrowObject, waiting included
+    std::uint64_t max_borrow_time_us;
+};
+
+// Pool of objects (e.g. database connections) shared by rendering threads.
+// Objects are borrowed as shared_ptr and go back to the pool when the last
+// copy is released. A thread gets the object it used last when that one is
+// free, and can wait a bounded time for a release when the pool is exhausted.
 template <typename T,template <typename> class Creator>
 class Pool : private util::noncopyable
 {
     using HolderType = std::shared_ptr<T>;
-    using ContType = std::deque<HolderType>;
+    using clock = std::chrono::steady_clock;
+
+    struct entry
+    {
+        HolderType object;
+        std::thread::id owner;
+        clock::time_point last_used;
+    };
+
+    using ContType = std::deque<entry>;
+
+#ifdef MAPNIK_THREADSAFE
+    // outlives the pool while borrowed objects are out
+    struct sync_state
+    {
+        std::mutex mutex;
+        std::condition_variable released;
+    };
+#endif
 
     Creator<T> creator_;
     unsigned initialSize_;
     unsigned maxSize_;
     ContType pool_;
+    std::chrono::milliseconds wait_timeout_;
+    std::chrono::seconds max_idle_;
+    pool_stats stats_;
 #ifdef MAPNIK_THREADSAFE
-    mutable std::mutex mutex_;
+    std::shared_ptr<sync_state> state_;
 #endif
 public:
 
     Pool(const Creator<T>& creator,unsigned initialSize, unsigned maxSize)
         :creator_(creator),
          initialSize_(initialSize),
-         maxSize_(maxSize)
+         maxSize_(maxSize),
+         wait_timeout_(0),
+         max_idle_(0)
+#ifdef MAPNIK_THREADSAFE
+         ,state_(std::make_shared<sync_state>())
+#endif
     {
         for (unsigned i=0; i < initialSize_; ++i)
         {
-            HolderType conn(creator_());
-            if (conn->isOK())
-                pool_.push_back(conn);
+            create();
         }
     }
 
+    // waits up to wait_timeout() for an object when all are borrowed
     HolderType borrowObject()
     {
+        return borrowObject(wait_timeout());
+    }
+
+    HolderType borrowObject(std::chrono::milliseconds timeout)
+    {
+        clock::time_point start = clock::now();
 #ifdef MAPNIK_THREADSAFE
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::unique_lock<std::mutex> lock(state_->mutex);
 #endif
-
-        typename ContType::iterator itr=pool_.begin();
-        while ( itr!=pool_.end())
+        HolderType obj = acquire(start);
+#ifdef MAPNIK_THREADSAFE
+        if (!obj && timeout.count() > 0)
         {
-            if (!itr->unique())
+            ++stats_.waited;
+            clock::time_point deadline = start + timeout;
+            while (!obj && state_->released.wait_until(lock, deadline) == std::cv_status::no_timeout)
             {
-                ++itr;
-            }
-            else if ((*itr)->isOK())
-            {
-                return *itr;
-            }
-            else
-            {
-                itr=pool_.erase(itr);
+                obj = acquire(clock::now());
             }
+            // a release may have raced with the timeout
+            if (!obj) obj = acquire(clock::now());
         }
-        // all connection have been taken, check if we allowed to grow pool
-        if (pool_.size() < maxSize_)
+#else
+        (void)timeout; // single threaded, nothing can be released while waiting
+#endif
+        std::uint64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+        stats_.borrow_time_us += elapsed;
+        stats_.max_borrow_time_us = std::max(stats_.max_borrow_time_us, elapsed);
+        if (!obj)
+        {
+            ++stats_.exhausted;
+            return obj;
+        }
+        ++stats_.borrowed;
+#ifdef MAPNIK_THREADSAFE
+        // the handle keeps `obj` borrowed and wakes up waiting threads on release
+        std::shared_ptr<sync_state> state = state_;
+        return HolderType(obj.get(), [obj, state](T*) mutable
         {
-            HolderType conn(creator_());
-            if (conn->isOK())
             {
-                pool_.push_back(conn);
-                return conn;
+                std::lock_guard<std::mutex> release_lock(state->mutex);
+                obj.reset();
             }
-        }
-        return HolderType();
+            state->released.notify_one();
+        });
+#else
+        return obj;
+#endif
     }
 
     unsigned size() const
     {
 #ifdef MAPNIK_THREADSAFE
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(state_->mutex);
 #endif
         return pool_.size();
     }
@@ -112,7 +186,7 @@ public:
     unsigned max_size() const
     {
 #ifdef MAPNIK_THREADSAFE
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(state_->mutex);
 #endif
         return maxSize_;
     }
@@ -120,7 +194,7 @@ public:
     void set_max_size(unsigned size)
     {
 #ifdef MAPNIK_THREADSAFE
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(state_->mutex);
 #endif
         maxSize_ = std::max(maxSize_,size);
     }
@@ -128,7 +202,7 @@ public:
     unsigned initial_size() const
     {
 #ifdef MAPNIK_THREADSAFE
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(state_->mutex);
 #endif
         return initialSize_;
     }
@@ -136,7 +210,7 @@ public:
     void set_initial_size(unsigned size)
     {
 #ifdef MAPNIK_THREADSAFE
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(state_->mutex);
 #endif
         if (size > initialSize_)
         {
@@ -149,13 +223,111 @@ public:
 
                 for (unsigned i=0; i < grow_size; ++i)
                 {
-                    HolderType conn(creator_());
-                    if (conn->isOK())
-                        pool_.push_back(conn);
+                    create();
                 }
             }
         }
     }
+
+    std::chrono::milliseconds wait_timeout() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(state_->mutex);
+#endif
+        return wait_timeout_;
+    }
+
+    // how long borrowObject() waits for a release when the pool is exhausted (default 0)
+    void set_wait_timeout(std::chrono::milliseconds timeout)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(state_->mutex);
+#endif
+        wait_timeout_ = timeout;
+    }
+
+    // objects above the initial size not borrowed for `idle` are closed (0 keeps them)
+    void set_max_idle(std::chrono::seconds idle)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(state_->mutex);
+#endif
+        max_idle_ = idle;
+    }
+
+    pool_stats stats() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(state_->mutex);
+#endif
+        return stats_;
+    }
+
+private:
+    HolderType create()
+    {
+        HolderType obj(creator_());
+        ++stats_.created;
+        if (!obj->isOK()) return HolderType();
+        entry e;
+        e.object = obj;
+        e.owner = std::this_thread::get_id();
+        e.last_used = clock::now();
+        pool_.push_back(e);
+        return obj;
+    }
+
+    // called with the lock held
+    HolderType acquire(clock::time_point now)
+    {
+        // drop free objects gone bad and, above the initial size, idle ones
+        for (typename ContType::iterator itr = pool_.begin(); itr != pool_.end();)
+        {
+            if (!itr->object.unique())
+            {
+                ++itr;
+            }
+            else if (!itr->object->isOK())
+            {
+                ++stats_.reconnects;
+                itr = pool_.erase(itr);
+            }
+            else if (max_idle_.count() > 0 && pool_.size() > initialSize_ && now - itr->last_used > max_idle_)
+            {
+                ++stats_.reaped;
+                itr = pool_.erase(itr);
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+        // prefer the object this thread used last
+        std::thread::id self = std::this_thread::get_id();
+        typename ContType::iterator found = pool_.end();
+        for (typename ContType::iterator itr = pool_.begin(); itr != pool_.end(); ++itr)
+        {
+            if (!itr->object.unique()) continue;
+            if (found == pool_.end()) found = itr;
+            if (itr->owner == self)
+            {
+                found = itr;
+                break;
+            }
+        }
+        if (found != pool_.end())
+        {
+            found->owner = self;
+            found->last_used = now;
+            return found->object;
+        }
+        // all objects have been taken, check if we are allowed to grow the pool
+        if (pool_.size() < maxSize_)
+        {
+            return create();
+        }
+        return HolderType();
+    }
 };
 
 }
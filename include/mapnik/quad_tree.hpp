@@ -32,6 +32,7 @@
 #include <vector>
 #include <type_traits>
 
+#include <cstdint>
 #include <cstring>
 
 namespace mapnik
@@ -173,16 +174,27 @@ public:
         trim_tree(root_);
     }
 
+    // version 1 is the original "mapnik-index" layout, version 2 pads every
+    // record to 8 bytes so the index can be read in place from mapped memory
     template <typename OutputStream>
-    void write(OutputStream & out)
+    void write(OutputStream & out, unsigned version = 1)
     {
         static_assert(std::is_standard_layout<value_type>::value,
                       "Values stored in quad-tree must be standard layout types to allow serialisation");
         char header[16];
         std::memset(header,0,16);
-        std::strcpy(header,"mapnik-index");
-        out.write(header,16);
-        write_node(out,root_);
+        if (version == 2)
+        {
+            std::strcpy(header,"mapnik-idx-v2");
+            out.write(header,16);
+            write_node_v2(out,root_);
+        }
+        else
+        {
+            std::strcpy(header,"mapnik-index");
+            out.write(header,16);
+            write_node(out,root_);
+        }
     }
 private:
 
@@ -345,6 +357,57 @@ private:
         }
     }
 
+    static std::size_t align8(std::size_t size)
+    {
+        return (size + 7) & ~std::size_t(7);
+    }
+
+    std::uint64_t record_size_v2(node const* n) const
+    {
+        std::uint64_t size = align8(sizeof(bbox_type)) + 16 + align8(n->cont_.size() * sizeof(value_type));
+        for (int i = 0; i < 4; ++i)
+        {
+            if (n->children_[i]) size += record_size_v2(n->children_[i]);
+        }
+        return size;
+    }
+
+    // extent, subtree size (uint64), item count and child count (uint32),
+    // items padded to 8 bytes, then children
+    template <typename OutputStream>
+    void write_node_v2(OutputStream & out, node const* n) const
+    {
+        std::uint64_t subtree_size = 0;
+        std::uint32_t num_subnodes = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            if (n->children_[i])
+            {
+                subtree_size += record_size_v2(n->children_[i]);
+                ++num_subnodes;
+            }
+        }
+        std::uint32_t shape_count = static_cast<std::uint32_t>(n->cont_.size());
+        std::size_t box_size = align8(sizeof(bbox_type));
+        std::size_t items_size = align8(shape_count * sizeof(value_type));
+        std::size_t recsize = box_size + 16 + items_size;
+        std::unique_ptr<char[]> node_record(new char[recsize]);
+        std::memset(node_record.get(), 0, recsize);
+        std::memcpy(node_record.get(), &n->extent_, sizeof(bbox_type));
+        std::memcpy(node_record.get() + box_size, &subtree_size, 8);
+        std::memcpy(node_record.get() + box_size + 8, &shape_count, 4);
+        std::memcpy(node_record.get() + box_size + 12, &num_subnodes, 4);
+        for (std::uint32_t i = 0; i < shape_count; ++i)
+        {
+            std::memcpy(node_record.get() + box_size + 16 + i * sizeof(value_type), &(n->cont_[i]), sizeof(value_type));
+        }
+        out.write(node_record.get(), recsize);
+        for (int i = 0; i < 4; ++i)
+        {
+            if (n->children_[i]) write_node_v2(out, n->children_[i]);
+        }
+    }
+
     const unsigned int max_depth_;
     const double ratio_;
     result_type query_result_;
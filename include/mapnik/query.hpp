@@ -26,6 +26,7 @@
 //mapnik
 #include <mapnik/box2d.hpp>
 #include <mapnik/attribute.hpp>
+#include <mapnik/expression.hpp>
 
 // stl
 #include <set>
@@ -49,7 +50,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(unbuffered_bbox),
           names_(),
-          vars_()
+          vars_(),
+          filter_()
     {}
 
     query(box2d<double> const& bbox,
@@ -61,7 +63,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(bbox),
           names_(),
-          vars_()
+          vars_(),
+          filter_()
     {}
 
     query(box2d<double> const& bbox)
@@ -71,7 +74,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(bbox),
           names_(),
-          vars_()
+          vars_(),
+          filter_()
     {}
 
     query(query const& other)
@@ -81,7 +85,8 @@ public:
           filter_factor_(other.filter_factor_),
           unbuffered_bbox_(other.unbuffered_bbox_),
           names_(other.names_),
-          vars_(other.vars_)
+          vars_(other.vars_),
+          filter_(other.filter_)
     {}
 
     query& operator=(query const& other)
@@ -94,6 +99,7 @@ public:
         unbuffered_bbox_=other.unbuffered_bbox_;
         names_=other.names_;
         vars_=other.vars_;
+        filter_=other.filter_;
         return *this;
     }
 
@@ -157,6 +163,19 @@ public:
         return vars_;
     }
 
+    // Filter all features drawn from the query have to pass, null when any
+    // feature may be drawn. Datasources may use it to skip features early,
+    // features failing it are still filtered out by the renderer.
+    void set_filter(expression_ptr const& filter)
+    {
+        filter_ = filter;
+    }
+
+    expression_ptr const& get_filter() const
+    {
+        return filter_;
+    }
+
 private:
     box2d<double> bbox_;
     resolution_type resolution_;
@@ -165,6 +184,7 @@ private:
     box2d<double> unbuffered_bbox_;
     std::set<std::string> names_;
     attributes vars_;
+    expression_ptr filter_;
 };
 
 }
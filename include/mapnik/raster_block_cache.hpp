@@ -0,0 +1,130 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_RASTER_BLOCK_CACHE_HPP
+#define MAPNIK_RASTER_BLOCK_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/util/shared_lru_cache.hpp>
+
+// stl
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace mapnik
+{
+
+struct image_any;
+
+using raster_block_ptr = std::shared_ptr<image_any const>;
+
+// Identifies a decoded block of a raster source: block (`block_x`, `block_y`)
+// of a grid of `block_size` pixel blocks over `band` of `overview` of `file`,
+// as last modified at `mtime` with `file_size` bytes.
+struct raster_block_key
+{
+    std::string file;
+    std::time_t mtime;
+    std::uintmax_t file_size;
+    int band;
+    int overview;
+    unsigned block_size;
+    int block_x;
+    int block_y;
+
+    bool operator==(raster_block_key const& rhs) const
+    {
+        return band == rhs.band && overview == rhs.overview &&
+            block_size == rhs.block_size &&
+            block_x == rhs.block_x && block_y == rhs.block_y &&
+            mtime == rhs.mtime && file_size == rhs.file_size &&
+            file == rhs.file;
+    }
+};
+
+struct raster_block_key_hash
+{
+    std::size_t operator()(raster_block_key const& key) const
+    {
+        std::size_t seed = std::hash<std::string>()(key.file);
+        for (std::size_t val : { std::size_t(key.mtime), std::size_t(key.file_size), std::size_t(key.band), std::size_t(key.overview), std::size_t(key.block_size),
+                    std::size_t(key.block_x), std::size_t(key.block_y) })
+        {
+            seed ^= val + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+};
+
+// bytes of a decoded block
+struct MAPNIK_DECL raster_block_size
+{
+    std::size_t operator()(raster_block_ptr const& block) const;
+};
+
+// Cache of decoded raster blocks shared by all datasources and threads, so
+// neighbouring tiles needing the same source blocks decode them once.
+// Bounded by the bytes of the decoded blocks; keys carry the modification
+// time and size of files so blocks of files changed on disk are not reused.
+class MAPNIK_DECL raster_block_cache :
+        public util::shared_lru_cache<raster_block_cache, raster_block_key,
+                                      raster_block_ptr, raster_block_key_hash,
+                                      raster_block_size>
+{
+    friend class CreateStatic<raster_block_cache>;
+public:
+    // maximum bytes of cached blocks, 0 disables the cache
+    void set_max_bytes(std::size_t max_bytes)
+    {
+        set_max_entries(max_bytes);
+    }
+
+    std::size_t max_bytes() const
+    {
+        return max_entries();
+    }
+
+    // bytes of cached blocks
+    std::size_t bytes() const
+    {
+        return cost();
+    }
+
+private:
+    using shared_lru_cache::set_max_entries;
+    using shared_lru_cache::max_entries;
+    using shared_lru_cache::cost;
+
+    raster_block_cache();
+    ~raster_block_cache();
+};
+
+extern template class MAPNIK_DECL singleton<raster_block_cache, CreateStatic>;
+
+}
+
+#endif // MAPNIK_RASTER_BLOCK_CACHE_HPP
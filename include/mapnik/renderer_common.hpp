@@ -51,6 +51,9 @@ struct renderer_common : private util::noncopyable
                        detector_ptr detector);
     renderer_common(Map const &m, request const &req, attributes const& vars, unsigned offset_x, unsigned offset_y,
                        unsigned width, unsigned height, double scale_factor);
+    // same view and variables as `other` but with own font library, so it can be used
+    // from another thread, and given placement detector
+    renderer_common(Map const &m, renderer_common const& other, detector_ptr detector);
     ~renderer_common();
 
     unsigned width_;
@@ -134,7 +134,8 @@ struct image_warp_dispatcher
                                box2d<double> const& target_ext, box2d<double> const& source_ext,
                                double offset_x, double offset_y, unsigned mesh_size, scaling_method_e scaling_method,
                                double filter_factor, double opacity, composite_mode_e comp_op,
-                               raster_symbolizer const& sym, feature_impl const& feature, F & composite, boost::optional<double> const& nodata)
+                               raster_symbolizer const& sym, feature_impl const& feature, F & composite, boost::optional<double> const& nodata,
+                               unsigned jobs)
         : prj_trans_(prj_trans),
         start_x_(start_x),
         start_y_(start_y),
@@ -152,14 +153,15 @@ struct image_warp_dispatcher
         sym_(sym),
         feature_(feature),
         composite_(composite),
-        nodata_(nodata) {}
+        nodata_(nodata),
+        jobs_(jobs) {}
 
     void operator() (image_null const&) const {} //no-op
 
     void operator() (image_rgba8 const& data_in) const
     {
         image_rgba8 data_out(width_, height_, true, true);
-        warp_image(data_out, data_in, prj_trans_, target_ext_, source_ext_, offset_x_, offset_y_, mesh_size_, scaling_method_, filter_factor_, nodata_);
+        warp_image(data_out, data_in, prj_trans_, target_ext_, source_ext_, offset_x_, offset_y_, mesh_size_, scaling_method_, filter_factor_, nodata_, jobs_);
         composite_(data_out, comp_op_, opacity_, start_x_, start_y_);
     }
 
@@ -169,7 +171,7 @@ struct image_warp_dispatcher
         using image_type = T;
         image_type data_out(width_, height_);
         if (nodata_) data_out.set(*nodata_);
-        warp_image(data_out, data_in, prj_trans_, target_ext_, source_ext_, offset_x_, offset_y_, mesh_size_, scaling_method_, filter_factor_, nodata_);
+        warp_image(data_out, data_in, prj_trans_, target_ext_, source_ext_, offset_x_, offset_y_, mesh_size_, scaling_method_, filter_factor_, nodata_, jobs_);
         image_rgba8 dst(width_, height_);
         raster_colorizer_ptr colorizer = get<raster_colorizer_ptr>(sym_, keys::colorizer);
         if (colorizer) colorizer->colorize(dst, data_out, nodata_, feature_);
@@ -195,6 +197,7 @@ private:
     feature_impl const& feature_;
     composite_function & composite_;
     boost::optional<double> const& nodata_;
+    unsigned jobs_;
 };
 
 }
@@ -204,7 +207,8 @@ void render_raster_symbolizer(raster_symbolizer const& sym,
                               mapnik::feature_impl& feature,
                               proj_transform const& prj_trans,
                               renderer_common& common,
-                              F composite)
+                              F composite,
+                              unsigned jobs = 1)
 {
     raster_ptr const& source = feature.get_raster();
     if (source)
@@ -242,7 +246,7 @@ void render_raster_symbolizer(raster_symbolizer const& sym,
                 detail::image_warp_dispatcher<F> dispatcher(prj_trans, start_x, start_y, raster_width, raster_height,
                                                                  target_ext, source->ext_, offset_x, offset_y, mesh_size,
                                                                  scaling_method, source->get_filter_factor(),
-                                                                 opacity, comp_op, sym, feature, composite, source->nodata());
+                                                                 opacity, comp_op, sym, feature, composite, source->nodata(), jobs);
                 util::apply_visitor(dispatcher, source->data_);
             }
             else
@@ -23,6 +23,7 @@
 #ifndef MAPNIK_RENDERER_COMMON_RENDER_MARKERS_SYMBOLIZER_HPP
 #define MAPNIK_RENDERER_COMMON_RENDER_MARKERS_SYMBOLIZER_HPP
 
+#include <mapnik/feature.hpp>
 #include <mapnik/marker.hpp>
 #include <mapnik/markers_placement.hpp>
 #include <mapnik/renderer_common.hpp>
@@ -71,6 +72,16 @@ void render_markers_symbolizer(markers_symbolizer const& sym,
                                box2d<double> const& clip_box,
                                markers_renderer_context & renderer_context);
 
+// Draws `features` looking their marker up once. The properties of `sym`
+// have to be the same for all of them (see properties_depend_on_feature).
+MAPNIK_DECL
+void render_markers_symbolizer(markers_symbolizer const& sym,
+                               feature_batch const& features,
+                               proj_transform const& prj_trans,
+                               renderer_common const& common,
+                               box2d<double> const& clip_box,
+                               markers_renderer_context & renderer_context);
+
 } // namespace mapnik
 
 #endif // MAPNIK_RENDERER_COMMON_RENDER_MARKERS_SYMBOLIZER_HPP
@@ -32,9 +32,14 @@
 #include <string>
 #include <vector>
 #include <limits>
+#include <memory>
 
 namespace mapnik
 {
+
+class compiled_expression;
+using compiled_expression_ptr = std::shared_ptr<compiled_expression const>;
+
 class MAPNIK_DECL rule
 {
 public:
@@ -46,6 +51,7 @@ private:
     double max_scale_;
     symbolizers syms_;
     expression_ptr filter_;
+    compiled_expression_ptr compiled_filter_;
     bool else_filter_;
     bool also_filter_;
 
@@ -73,6 +79,8 @@ public:
     symbolizers::iterator end();
     void set_filter(expression_ptr const& filter);
     expression_ptr const& get_filter() const;
+    // filter compiled when it was set, see compiled_expression
+    compiled_expression const& get_compiled_filter() const;
     void set_else(bool else_filter);
     bool has_else_filter() const;
     void set_also(bool also_filter);
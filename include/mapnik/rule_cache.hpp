@@ -25,6 +25,7 @@
 
 // mapnik
 #include <mapnik/rule.hpp>
+#include <mapnik/rule_index.hpp>
 #include <mapnik/util/noncopyable.hpp>
 
 // stl
@@ -41,12 +42,14 @@ public:
     rule_cache()
         : if_rules_(),
           else_rules_(),
-          also_rules_() {}
+          also_rules_(),
+          index_() {}
 
     rule_cache(rule_cache && rhs) // move ctor
         :  if_rules_(std::move(rhs.if_rules_)),
            else_rules_(std::move(rhs.else_rules_)),
-           also_rules_(std::move(rhs.also_rules_))
+           also_rules_(std::move(rhs.also_rules_)),
+           index_(std::move(rhs.index_))
     {}
 
     rule_cache& operator=(rule_cache && rhs) // move assign
@@ -54,6 +57,7 @@ public:
         std::swap(if_rules_, rhs.if_rules_);
         std::swap(else_rules_,rhs.else_rules_);
         std::swap(also_rules_, rhs.also_rules_);
+        std::swap(index_, rhs.index_);
         return *this;
     }
 
@@ -78,6 +82,18 @@ public:
         return if_rules_;
     }
 
+    // subset of get_if_rules() whose filter may match `feature`, in order
+    rule_ptrs const& get_if_rules(feature_impl const& feature) const
+    {
+        return index_.valid() ? index_.candidates(feature) : if_rules_;
+    }
+
+    // to be called once all rules were added
+    void build_index()
+    {
+        index_ = rule_index(if_rules_);
+    }
+
     rule_ptrs const& get_else_rules() const
     {
         return else_rules_;
@@ -92,6 +108,7 @@ private:
     rule_ptrs if_rules_;
     rule_ptrs else_rules_;
     rule_ptrs also_rules_;
+    rule_index index_;
 };
 
 }
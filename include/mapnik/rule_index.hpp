@@ -0,0 +1,90 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_RULE_INDEX_HPP
+#define MAPNIK_RULE_INDEX_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/attribute.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/value_types.hpp>
+
+// stl
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mapnik
+{
+
+class rule;
+
+// Dispatch table from the value of one attribute to the rules whose filter
+// may match it. Filters are analysed for conditions on a single attribute
+// that every matching feature must meet: `[attr] = 'literal'`, disjunctions
+// of those, numeric comparisons and ranges, or any of these in a
+// conjunction. The attribute constrained by most filters is indexed, string
+// values through a hash table and numbers through sorted range bounds.
+// Rules without a condition on it are candidates for every feature.
+// Candidates keep the order of the rules and their filters still have to
+// be evaluated, the index only skips filters that can't match.
+class MAPNIK_DECL rule_index
+{
+public:
+    using rule_ptrs = std::vector<rule const*>;
+
+    rule_index();
+    // no index is built for fewer than `min_indexed` rules with a condition
+    explicit rule_index(rule_ptrs const& rules, std::size_t min_indexed = 4);
+
+    // false when no attribute was worth indexing
+    bool valid() const { return !attribute_name_.empty(); }
+    std::string const& attribute_name() const { return attribute_name_; }
+
+    // rules whose filter may match `feature`, only meaningful when valid()
+    rule_ptrs const& candidates(feature_impl const& feature) const;
+
+private:
+    struct unicode_hash
+    {
+        std::size_t operator() (value_unicode_string const& str) const
+        {
+            return static_cast<std::size_t>(str.hashCode());
+        }
+    };
+
+    std::string attribute_name_;
+    attribute attribute_;
+    // rules without a condition on the attribute
+    rule_ptrs unindexed_;
+    std::unordered_map<value_unicode_string, rule_ptrs, unicode_hash> strings_;
+    // numeric bounds, segment 2 * i + 1 is bounds_[i] and segment 2 * i is
+    // the open interval below it
+    std::vector<double> bounds_;
+    std::vector<rule_ptrs> segments_;
+};
+
+}
+
+#endif // MAPNIK_RULE_INDEX_HPP
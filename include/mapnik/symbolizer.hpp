@@ -31,12 +31,14 @@
 #include <mapnik/enumeration.hpp>
 #include <mapnik/expression.hpp>
 #include <mapnik/expression_evaluator.hpp>
+#include <mapnik/compiled_expression.hpp>
 #include <mapnik/path_expression.hpp>
 #include <mapnik/parse_path.hpp>
 #include <mapnik/color.hpp>
 #include <mapnik/symbolizer_keys.hpp>
 #include <mapnik/attribute.hpp>
 #include <mapnik/symbolizer_base.hpp>
+#include <mapnik/symbolizer_property_table.hpp>
 #include <mapnik/symbolizer_enumerations.hpp>
 #include <mapnik/text/font_feature_settings.hpp>
 #include <mapnik/util/dasharray_parser.hpp>
@@ -280,7 +282,7 @@ struct evaluate_expression_wrapper
     template <typename T1, typename T2, typename T3>
     result_type operator() (T1 const& expr, T2 const& feature, T3 const& vars) const
     {
-        mapnik::value_type result = util::apply_visitor(mapnik::evaluate<T2,mapnik::value_type,T3>(feature,vars), expr);
+        mapnik::value_type result = evaluate_value(expr, feature, vars);
         return detail::expression_result<result_type, std::is_enum<result_type>::value>::convert(result);
     }
 };
@@ -292,7 +294,7 @@ struct evaluate_expression_wrapper<mapnik::color>
     template <typename T1, typename T2, typename T3>
     mapnik::color operator() (T1 const& expr, T2 const& feature, T3 const& vars) const
     {
-        mapnik::value_type val = util::apply_visitor(mapnik::evaluate<T2,mapnik::value_type,T3>(feature,vars), expr);
+        mapnik::value_type val = evaluate_value(expr, feature, vars);
         if (val.is_null()) return mapnik::color(0,0,0,0); // transparent
         return mapnik::color(val.to_string());
     }
@@ -305,7 +307,7 @@ struct evaluate_expression_wrapper<mapnik::enumeration_wrapper>
     template <typename T1, typename T2, typename T3>
     mapnik::enumeration_wrapper operator() (T1 const& expr, T2 const& feature, T3 const& vars) const
     {
-        mapnik::value_type val = util::apply_visitor(mapnik::evaluate<T2,mapnik::value_type,T3>(feature,vars), expr);
+        mapnik::value_type val = evaluate_value(expr, feature, vars);
         return mapnik::enumeration_wrapper(val.to_int());
     }
 };
@@ -316,7 +318,7 @@ struct evaluate_expression_wrapper<mapnik::dash_array>
     template <typename T1, typename T2, typename T3>
     mapnik::dash_array operator() (T1 const& expr, T2 const& feature, T3 const& vars) const
     {
-        mapnik::value_type val = util::apply_visitor(mapnik::evaluate<T2,mapnik::value_type,T3>(feature,vars), expr);
+        mapnik::value_type val = evaluate_value(expr, feature, vars);
         if (val.is_null()) return dash_array();
         dash_array dash;
         std::string str = val.to_string();
@@ -332,7 +334,7 @@ struct evaluate_expression_wrapper<mapnik::font_feature_settings>
     template <typename T1, typename T2, typename T3>
     mapnik::font_feature_settings operator() (T1 const& expr, T2 const& feature, T3 const& vars) const
     {
-        mapnik::value_type val = util::apply_visitor(mapnik::evaluate<T2, mapnik::value_type, T3>(feature, vars), expr);
+        mapnik::value_type val = evaluate_value(expr, feature, vars);
         if (val.is_null()) return mapnik::font_feature_settings();
         return mapnik::font_feature_settings(val.to_string());
     }
@@ -350,7 +352,7 @@ struct extract_value
 
     auto operator() (mapnik::expression_ptr const& expr) const -> result_type
     {
-        return evaluate_expression_wrapper<result_type>()(*expr,feature_,vars_);
+        return evaluate_expression_wrapper<result_type>()(expr,feature_,vars_);
     }
 
     auto operator() (mapnik::path_expression_ptr const& expr) const -> result_type
@@ -416,14 +418,23 @@ inline bool has_key(symbolizer_base const& sym, keys key)
     return (sym.properties.count(key) == 1);
 }
 
+template <typename T>
+T extract_property(property_ref const& prop, mapnik::feature_impl const& feature, attributes const& vars)
+{
+    if (prop.compiled)
+    {
+        return evaluate_expression_wrapper<T>()(*prop.compiled, feature, vars);
+    }
+    return util::apply_visitor(extract_value<T>(feature,vars), *prop.value);
+}
+
 template <typename T, keys key>
 T get(symbolizer_base const& sym, mapnik::feature_impl const& feature, attributes const& vars)
 {
-    using const_iterator = symbolizer_base::cont_type::const_iterator;
-    const_iterator itr = sym.properties.find(key);
-    if (itr != sym.properties.end())
+    property_ref prop = find_property(sym, key);
+    if (prop.value)
     {
-        return util::apply_visitor(extract_value<T>(feature,vars), itr->second);
+        return extract_property<T>(prop, feature, vars);
     }
     return mapnik::symbolizer_default<T,key>::value();
 }
@@ -431,11 +442,10 @@ T get(symbolizer_base const& sym, mapnik::feature_impl const& feature, attribute
 template <typename T>
 T get(symbolizer_base const& sym, keys key, mapnik::feature_impl const& feature, attributes const& vars, T const& default_value)
 {
-    using const_iterator = symbolizer_base::cont_type::const_iterator;
-    const_iterator itr = sym.properties.find(key);
-    if (itr != sym.properties.end())
+    property_ref prop = find_property(sym, key);
+    if (prop.value)
     {
-        return util::apply_visitor(extract_value<T>(feature,vars), itr->second);
+        return extract_property<T>(prop, feature, vars);
     }
     return default_value;
 }
@@ -444,11 +454,10 @@ T get(symbolizer_base const& sym, keys key, mapnik::feature_impl const& feature,
 template <typename T>
 boost::optional<T> get_optional(symbolizer_base const& sym, keys key, mapnik::feature_impl const& feature, attributes const& vars)
 {
-    using const_iterator = symbolizer_base::cont_type::const_iterator;
-    const_iterator itr = sym.properties.find(key);
-    if (itr != sym.properties.end())
+    property_ref prop = find_property(sym, key);
+    if (prop.value)
     {
-        return util::apply_visitor(extract_value<T>(feature,vars), itr->second);
+        return extract_property<T>(prop, feature, vars);
     }
     return boost::optional<T>();
 }
@@ -456,11 +465,10 @@ boost::optional<T> get_optional(symbolizer_base const& sym, keys key, mapnik::fe
 template <typename T>
 T get(symbolizer_base const& sym, keys key)
 {
-    using const_iterator = symbolizer_base::cont_type::const_iterator;
-    const_iterator itr = sym.properties.find(key);
-    if (itr != sym.properties.end())
+    property_ref prop = find_property(sym, key);
+    if (prop.value)
     {
-        return util::apply_visitor(extract_raw_value<T>(), itr->second);
+        return util::apply_visitor(extract_raw_value<T>(), *prop.value);
     }
     return T();
 }
@@ -469,11 +477,10 @@ T get(symbolizer_base const& sym, keys key)
 template <typename T>
 T get(symbolizer_base const& sym, keys key, T const& default_value)
 {
-    using const_iterator = symbolizer_base::cont_type::const_iterator;
-    const_iterator itr = sym.properties.find(key);
-    if (itr != sym.properties.end())
+    property_ref prop = find_property(sym, key);
+    if (prop.value)
     {
-        return util::apply_visitor(extract_raw_value<T>(), itr->second);
+        return util::apply_visitor(extract_raw_value<T>(), *prop.value);
     }
     return default_value;
 }
@@ -481,11 +488,10 @@ T get(symbolizer_base const& sym, keys key, T const& default_value)
 template <typename T>
 boost::optional<T> get_optional(symbolizer_base const& sym, keys key)
 {
-    using const_iterator = symbolizer_base::cont_type::const_iterator;
-    const_iterator itr = sym.properties.find(key);
-    if (itr != sym.properties.end())
+    property_ref prop = find_property(sym, key);
+    if (prop.value)
     {
-        return util::apply_visitor(extract_raw_value<T>(), itr->second);
+        return util::apply_visitor(extract_raw_value<T>(), *prop.value);
     }
     return boost::optional<T>();
 }
@@ -36,10 +36,13 @@
 #include <mapnik/util/variant.hpp>
 
 // stl
+#include <cstdint>
+#include <initializer_list>
 #include <memory>
 #include <vector>
 #include <iosfwd>
 #include <map>
+#include <utility>
 
 namespace agg { struct trans_affine; }
 
@@ -78,6 +81,7 @@ using dash_array = std::vector<std::pair<double,double> >;
 
 class text_placements;
 using text_placements_ptr = std::shared_ptr<text_placements>;
+class property_table;
 
 namespace detail {
 
@@ -117,12 +121,119 @@ struct strict_value : value_base_type
 
 } // namespace detail
 
+// new version number for property_map, unique within the process
+MAPNIK_DECL std::uint64_t next_property_map_version();
+
+// std::map of symbolizer properties taking a new version on every access
+// which can change it, so tables built from it (see
+// symbolizer_property_table.hpp) can tell when they are out of date.
+class property_map : private std::map<keys, detail::strict_value>
+{
+    using base_type = std::map<keys, detail::strict_value>;
+public:
+    using typename base_type::key_type;
+    using typename base_type::mapped_type;
+    using typename base_type::value_type;
+    using typename base_type::size_type;
+    using typename base_type::iterator;
+    using typename base_type::const_iterator;
+
+    using base_type::size;
+    using base_type::empty;
+    using base_type::count;
+    using base_type::cbegin;
+    using base_type::cend;
+
+    property_map()
+        : base_type(),
+          version_(next_property_map_version()) {}
+
+    property_map(std::initializer_list<value_type> init)
+        : base_type(init),
+          version_(next_property_map_version()) {}
+
+    property_map(property_map const& rhs) = default;
+    property_map & operator=(property_map const& rhs) = default;
+
+    // the moved from map changes, it takes a new version
+    property_map(property_map && rhs)
+        : base_type(std::move(rhs)),
+          version_(rhs.version_)
+    {
+        rhs.version_ = next_property_map_version();
+    }
+
+    property_map & operator=(property_map && rhs)
+    {
+        base_type::operator=(std::move(rhs));
+        version_ = rhs.version_;
+        rhs.version_ = next_property_map_version();
+        return *this;
+    }
+
+    const_iterator begin() const { return base_type::begin(); }
+    const_iterator end() const { return base_type::end(); }
+    const_iterator find(key_type key) const { return base_type::find(key); }
+
+    // iterators allowing to change values
+    iterator begin() { touch(); return base_type::begin(); }
+    iterator end() { touch(); return base_type::end(); }
+    iterator find(key_type key) { touch(); return base_type::find(key); }
+
+    mapped_type & operator[](key_type key)
+    {
+        touch();
+        return base_type::operator[](key);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args &&... args)
+    {
+        touch();
+        return base_type::emplace(std::forward<Args>(args)...);
+    }
+
+    std::pair<iterator, bool> insert(value_type const& val)
+    {
+        touch();
+        return base_type::insert(val);
+    }
+
+    size_type erase(key_type key)
+    {
+        touch();
+        return base_type::erase(key);
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        touch();
+        return base_type::erase(pos);
+    }
+
+    void clear()
+    {
+        touch();
+        base_type::clear();
+    }
+
+    // maps with the same version hold the same properties
+    std::uint64_t version() const { return version_; }
+
+private:
+    void touch() { version_ = next_property_map_version(); }
+
+    std::uint64_t version_;
+};
+
 struct MAPNIK_DECL symbolizer_base
 {
     using value_type = detail::strict_value;
     using key_type =  mapnik::keys;
-    using cont_type = std::map<key_type, value_type>;
+    using cont_type = property_map;
     cont_type properties;
+    // `properties` indexed by key, see symbolizer_property_table.hpp
+    std::shared_ptr<property_table const> table;
 };
 
 inline bool is_expression(symbolizer_base::value_type const& val)
@@ -27,12 +27,18 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/proj_transform.hpp>
 #include <mapnik/feature_style_processor.hpp>
+#include <mapnik/symbolizer_base.hpp>
+#include <mapnik/util/noncopyable.hpp>
 #include <mapnik/util/variant.hpp>
 
+// stl
+#include <cstddef>
+
 namespace mapnik
 {
 
 template <typename T0,typename T1> struct has_process;
+template <typename T0,typename T1> struct has_process_batch;
 
 template <bool>
 struct process_impl
@@ -87,6 +93,110 @@ struct symbolizer_dispatch
     proj_transform const& prj_trans_;
 };
 
+template <bool>
+struct process_batch_impl
+{
+    template <typename T0, typename T1, typename T2>
+    static void process(T0 & ren, T1 const& sym, feature_batch const& features, T2 const& tr)
+    {
+        ren.process_batch(sym, features, tr);
+    }
+};
+
+template <>
+struct process_batch_impl<false>
+{
+    template <typename T0, typename T1, typename T2>
+    static void process(T0 & ren, T1 const& sym, feature_batch const& features, T2 const& tr)
+    {
+        for (feature_ptr const& feature : features)
+        {
+            process_impl<has_process<T0,T1>::value>::process(ren, sym, *feature, tr);
+        }
+    }
+};
+
+/** Dispatches symbolizers like symbolizer_dispatch, merging consecutive
+ * features drawn with the same symbolizer into a batch handed to the
+ * renderer's process_batch (when it has one for the symbolizer type).
+ * Batches are flushed before anything else is drawn, so the output is the
+ * same as dispatching feature by feature. Renderers implementing
+ * process_batch are expected not to draw in process(rule::symbolizers).
+ */
+template <typename Processor>
+class symbolizer_batch : private util::noncopyable
+{
+public:
+    static constexpr std::size_t max_size = 256;
+
+    symbolizer_batch(Processor & output, proj_transform const& prj_trans)
+        : output_(output),
+          prj_trans_(prj_trans),
+          sym_(nullptr),
+          features_() {}
+
+    void process(symbolizer const& sym, feature_ptr const& feature)
+    {
+        util::apply_visitor(add_feature(*this, sym, feature), sym);
+    }
+
+    // draws the features batched so far
+    void flush()
+    {
+        if (features_.empty()) return;
+        util::apply_visitor(flush_features(*this), *sym_);
+        features_.clear();
+        sym_ = nullptr;
+    }
+
+private:
+    struct add_feature
+    {
+        add_feature(symbolizer_batch & batch, symbolizer const& sym, feature_ptr const& feature)
+            : batch_(batch),
+              sym_(sym),
+              feature_(feature) {}
+
+        template <typename T>
+        void operator() (T const& sym) const
+        {
+            if (!has_process_batch<Processor,T>::value)
+            {
+                batch_.flush();
+                process_impl<has_process<Processor,T>::value>::process(batch_.output_, sym, *feature_, batch_.prj_trans_);
+                return;
+            }
+            if (batch_.sym_ != &sym_) batch_.flush();
+            batch_.sym_ = &sym_;
+            batch_.features_.push_back(feature_);
+            if (batch_.features_.size() >= max_size) batch_.flush();
+        }
+
+        symbolizer_batch & batch_;
+        symbolizer const& sym_;
+        feature_ptr const& feature_;
+    };
+
+    struct flush_features
+    {
+        explicit flush_features(symbolizer_batch & batch)
+            : batch_(batch) {}
+
+        template <typename T>
+        void operator() (T const& sym) const
+        {
+            process_batch_impl<has_process_batch<Processor,T>::value>::process(batch_.output_, sym, batch_.features_, batch_.prj_trans_);
+        }
+
+        symbolizer_batch & batch_;
+    };
+
+    Processor & output_;
+    proj_transform const& prj_trans_;
+    symbolizer const* sym_;
+    feature_batch features_;
+};
+
 using no_tag = char (&)[1];
 using yes_tag = char (&)[2];
 
@@ -103,6 +213,19 @@ struct has_process
     constexpr static bool value = (sizeof(has_process_helper<processor_impl_type,T1>(0)) == sizeof(yes_tag));
 };
 
+template <typename T0, typename T1, void (T0::*)(T1 const&, feature_batch const&, proj_transform const&) >
+struct process_batch_memfun_helper {};
+
+template <typename T0, typename T1> no_tag  has_process_batch_helper(...);
+template <typename T0, typename T1> yes_tag has_process_batch_helper(process_batch_memfun_helper<T0, T1, &T0::process_batch>* p);
+
+template<typename T0,typename T1>
+struct has_process_batch
+{
+    using processor_impl_type = typename T0::processor_impl_type;
+    constexpr static bool value = (sizeof(has_process_batch_helper<processor_impl_type,T1>(0)) == sizeof(yes_tag));
+};
+
 }
 
 #endif // MAPNIK_SYMBOLIZER_DISPATCH_HPP
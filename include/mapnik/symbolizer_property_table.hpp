@@ -0,0 +1,110 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_SYMBOLIZER_PROPERTY_TABLE_HPP
+#define MAPNIK_SYMBOLIZER_PROPERTY_TABLE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/symbolizer_base.hpp>
+#include <mapnik/symbolizer_keys.hpp>
+#include <mapnik/compiled_expression.hpp>
+
+// stl
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mapnik
+{
+
+// property of a symbolizer, `compiled` is set for expression values
+struct property_ref
+{
+    symbolizer_base::value_type const* value;
+    compiled_expression const* compiled;
+};
+
+// Symbolizer properties copied into an array indexed by key, so renderers
+// reading a dozen properties per feature don't walk the properties map for
+// each of them. Expression values are compiled along.
+class MAPNIK_DECL property_table
+{
+public:
+    explicit property_table(symbolizer_base::cont_type const& properties);
+
+    property_ref find(keys key) const
+    {
+        std::uint8_t index = index_[static_cast<std::size_t>(key)];
+        if (index == unset) return property_ref{nullptr, nullptr};
+        return property_ref{&values_[index], compiled_[index].get()};
+    }
+
+    std::size_t size() const { return values_.size(); }
+    // version of the properties the table was built from
+    std::uint64_t version() const { return version_; }
+    // true when some value holds an expression which may evaluate
+    // differently for each feature
+    bool depends_on_feature() const { return depends_on_feature_; }
+
+private:
+    static constexpr std::uint8_t unset = 0xff;
+    std::array<std::uint8_t, static_cast<std::size_t>(keys::MAX_SYMBOLIZER_KEY)> index_;
+    std::vector<symbolizer_base::value_type> values_;
+    std::vector<compiled_expression_ptr> compiled_;
+    bool depends_on_feature_;
+    std::uint64_t version_;
+};
+
+// Rebuilds the table of `sym` from its properties. Map::insert_style() and
+// load_map() do this once for all symbolizers of a style; a table left behind
+// by put() or by changing `sym.properties` directly is ignored until this is
+// called again.
+MAPNIK_DECL void update_property_table(symbolizer_base & sym);
+
+// true when the table of `sym` holds its current properties
+inline bool property_table_current(symbolizer_base const& sym)
+{
+    return sym.table && sym.table->version() == sym.properties.version();
+}
+
+// property `key` of `sym`, `value` is nullptr when it is not set
+inline property_ref find_property(symbolizer_base const& sym, keys key)
+{
+    // a table out of step with the map (properties changed directly) is ignored
+    if (property_table_current(sym))
+    {
+        return sym.table->find(key);
+    }
+    auto itr = sym.properties.find(key);
+    if (itr == sym.properties.end()) return property_ref{nullptr, nullptr};
+    return property_ref{&itr->second, nullptr};
+}
+
+// true when properties of `sym` may evaluate differently for each feature,
+// renderers set up once for features sharing `sym` otherwise
+MAPNIK_DECL bool properties_depend_on_feature(symbolizer_base const& sym);
+
+}
+
+#endif // MAPNIK_SYMBOLIZER_PROPERTY_TABLE_HPP
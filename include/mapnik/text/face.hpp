@@ -50,7 +50,9 @@ namespace mapnik
 class MAPNIK_DECL font_face : util::noncopyable
 {
 public:
-    font_face(FT_Face face);
+    // `file_name` and `face_index` tell where the face was loaded from, an
+    // empty file name for faces not loaded from a font file
+    font_face(FT_Face face, std::string const& file_name = std::string(), int face_index = 0);
 
     std::string family_name() const
     {
@@ -62,6 +64,16 @@ public:
         return std::string(face_->style_name);
     }
 
+    std::string const& file_name() const
+    {
+        return file_name_;
+    }
+
+    int face_index() const
+    {
+        return face_index_;
+    }
+
     FT_Face get_face() const
     {
         return face_;
@@ -76,6 +88,9 @@ public:
 
 private:
     FT_Face face_;
+    std::string file_name_;
+    int face_index_;
+    FT_F26Dot6 char_size_; // last size set, FT_Set_Char_Size is skipped when unchanged
 };
 using face_ptr = std::shared_ptr<font_face>;
 
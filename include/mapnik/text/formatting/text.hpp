@@ -24,6 +24,7 @@
 
 // mapnik
 #include <mapnik/text/formatting/base.hpp>
+#include <mapnik/compiled_expression.hpp>
 
 // boost
 #include <boost/property_tree/ptree_fwd.hpp>
@@ -35,8 +36,8 @@ class feature_impl;
 namespace formatting {
 class MAPNIK_DECL text_node: public node {
 public:
-    text_node(expression_ptr text): node(), text_(text) {}
-    text_node(std::string text): node(), text_(parse_expression(text)) {}
+    text_node(expression_ptr text): node(), text_(text), compiled_text_(compile_expression(text_)) {}
+    text_node(std::string text): node(), text_(parse_expression(text)), compiled_text_(compile_expression(text_)) {}
     void to_xml(boost::property_tree::ptree &xml) const;
     static node_ptr from_xml(xml_node const& xml, fontset_map const& fontsets);
     virtual void apply(evaluated_format_properties_ptr const& p, feature_impl const& feature, attributes const& vars, text_layout &output) const;
@@ -46,6 +47,7 @@ public:
     expression_ptr get_text() const;
 private:
     expression_ptr text_;
+    compiled_expression_ptr compiled_text_;
 };
 } //ns formatting
 } //ns mapnik
@@ -0,0 +1,161 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_GLYPH_CACHE_HPP
+#define MAPNIK_GLYPH_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/global.hpp>
+#include <mapnik/text/rotation.hpp>
+#include <mapnik/util/shared_lru_cache.hpp>
+
+// stl
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+class font_face;
+class stroker;
+using stroker_ptr = std::shared_ptr<stroker>;
+
+// Rasterised glyph, independent of the FreeType library it was rendered with.
+// `left` and `top` are relative to the integer pixel the glyph origin falls into.
+struct glyph_bitmap
+{
+    int left;
+    int top;
+    unsigned width;
+    unsigned rows;
+    std::vector<unsigned char> buffer; // `rows` rows of `width` bytes
+};
+
+using glyph_bitmap_ptr = std::shared_ptr<glyph_bitmap const>;
+
+struct glyph_cache_key
+{
+    std::string face_file;    // font file and index of the face in it
+    int face_index;
+    std::int32_t size;        // 26.6 fixed point
+    unsigned glyph_index;
+    std::uint8_t subpixel_x;  // origin offset within pixel, in subpixel steps
+    std::uint8_t subpixel_y;
+    std::uint16_t rotation;   // in rotation steps, 0 for upright glyph
+    std::int32_t halo_radius; // 26.6 fixed point, 0 for plain glyph bitmap
+
+    bool operator==(glyph_cache_key const& rhs) const
+    {
+        return size == rhs.size && glyph_index == rhs.glyph_index &&
+            subpixel_x == rhs.subpixel_x && subpixel_y == rhs.subpixel_y &&
+            rotation == rhs.rotation && halo_radius == rhs.halo_radius && face_index == rhs.face_index &&
+            face_file == rhs.face_file;
+    }
+};
+
+struct glyph_cache_key_hash
+{
+    std::size_t operator()(glyph_cache_key const& key) const
+    {
+        std::size_t seed = std::hash<std::string>()(key.face_file);
+        for (std::size_t val : { std::size_t(key.face_index), std::size_t(key.size), std::size_t(key.glyph_index),
+                    std::size_t(key.subpixel_x << 8 | key.subpixel_y), std::size_t(key.rotation),
+                    std::size_t(key.halo_radius) })
+        {
+            seed ^= val + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+};
+
+// Cache of rasterised glyphs shared by all renderers, so repeated labels
+// don't go through FreeType loading and rasterising every time.
+// Glyphs drawn with scaling or skewing aren't cached; glyph origins are
+// snapped to 1/subpixel_steps of a pixel and rotations to 1/rotation_steps
+// of a turn. Glyphs are keyed by the font
+// file of their face, faces not loaded from a file aren't cached.
+class MAPNIK_DECL glyph_cache :
+        public util::shared_lru_cache<glyph_cache, glyph_cache_key,
+                                      glyph_bitmap_ptr, glyph_cache_key_hash>
+{
+    friend class CreateStatic<glyph_cache>;
+public:
+    static constexpr unsigned subpixel_steps = 4;
+    static constexpr unsigned rotation_steps = 1024;
+
+    // Splits a 26.6 fixed point coordinate into whole pixels and the
+    // subpixel step the glyph origin is snapped to.
+    static std::uint8_t split_position(long pos, long & pixel)
+    {
+        long const steps = subpixel_steps;
+        long const step = 64 / steps;
+        long snapped = pos >= 0 ? (pos + step / 2) / step : -((step / 2 - pos) / step);
+        pixel = snapped >= 0 ? snapped / steps : -((steps - 1 - snapped) / steps);
+        return static_cast<std::uint8_t>(snapped - pixel * steps);
+    }
+
+    // Snaps a rotation to the nearest rotation step.
+    static std::uint16_t snap_rotation(rotation const& rot)
+    {
+        if (rot.sin == 0.0 && rot.cos == 1.0) return 0;
+        double steps = std::round(std::atan2(rot.sin, rot.cos) * rotation_steps / (2 * M_PI));
+        long step = static_cast<long>(steps) % static_cast<long>(rotation_steps);
+        return static_cast<std::uint16_t>(step < 0 ? step + rotation_steps : step);
+    }
+
+    // Rotation glyphs snapped to `step` are rendered with.
+    static rotation step_rotation(std::uint16_t step)
+    {
+        if (step == 0) return rotation();
+        return rotation(step * 2 * M_PI / rotation_steps);
+    }
+
+    // Returns bitmap for glyph with origin offset by the given subpixel steps
+    // and rotated by the given rotation step or nullptr if it can't be rendered. With halo_radius > 0 the glyph is
+    // stroked first. `face` must be usable from the calling thread, misses
+    // are rendered with it.
+    glyph_bitmap_ptr get(font_face & face,
+                         double size,
+                         unsigned glyph_index,
+                         std::uint8_t subpixel_x,
+                         std::uint8_t subpixel_y,
+                         std::uint16_t rotation,
+                         double halo_radius,
+                         stroker_ptr const& stroker);
+
+    // set_max_entries(0) disables the cache, renderers then draw glyphs at
+    // their exact positions again
+
+private:
+    glyph_cache();
+    ~glyph_cache();
+};
+
+extern template class MAPNIK_DECL singleton<glyph_cache, CreateStatic>;
+
+}
+
+#endif // MAPNIK_GLYPH_CACHE_HPP
@@ -118,6 +118,7 @@ public:
     void render(glyph_positions const& positions);
 private:
     pixmap_type & pixmap_;
+    bool render_cached(glyph_positions const& positions);
     void render_halo(FT_Bitmap_ *bitmap, unsigned rgba, int x, int y,
                      double halo_radius, double opacity,
                      composite_mode_e comp_op);
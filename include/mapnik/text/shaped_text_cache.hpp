@@ -0,0 +1,80 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_SHAPED_TEXT_CACHE_HPP
+#define MAPNIK_SHAPED_TEXT_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/pixel_position.hpp>
+#include <mapnik/util/shared_lru_cache.hpp>
+
+// stl
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// Result of shaping one glyph. Faces are referenced by their position in
+// the face set of the glyph's format so that shaped lines can be shared
+// between renderers using different font libraries.
+struct shaped_glyph
+{
+    unsigned glyph_index;
+    unsigned char_index;
+    unsigned face_index;
+    double unscaled_ymin;
+    double unscaled_ymax;
+    double unscaled_advance;
+    double unscaled_line_height;
+    double scale_multiplier;
+    pixel_position offset;
+};
+
+struct shaped_line
+{
+    std::vector<shaped_glyph> glyphs;
+    double max_char_height;
+};
+
+using shaped_line_ptr = std::shared_ptr<shaped_line const>;
+
+// Cache of shaped text lines shared by all text layouts, so identical
+// labels skip itemization and shaping. Keys are built by text_layout
+// from the text, line range and the format runs (font files and face
+// indices, size and font features) covering it.
+class MAPNIK_DECL shaped_text_cache :
+        public util::shared_lru_cache<shaped_text_cache, std::string, shaped_line_ptr>
+{
+    friend class CreateStatic<shaped_text_cache>;
+private:
+    shaped_text_cache();
+    ~shaped_text_cache();
+};
+
+extern template class MAPNIK_DECL singleton<shaped_text_cache, CreateStatic>;
+
+}
+
+#endif // MAPNIK_SHAPED_TEXT_CACHE_HPP
@@ -34,6 +34,7 @@
 #include <mapnik/font_engine_freetype.hpp>
 #include <mapnik/text/evaluated_format_properties_ptr.hpp>
 #include <mapnik/text/rotation.hpp>
+#include <mapnik/text/shaped_text_cache.hpp>
 
 //stl
 #include <vector>
@@ -41,6 +42,7 @@
 #include <memory>
 #include <map>
 #include <utility>
+#include <string>
 
 namespace mapnik
 {
@@ -129,6 +131,10 @@ private:
     void break_line(std::pair<unsigned, unsigned> && line_limits);
     void break_line_icu(std::pair<unsigned, unsigned> && line_limits);
     void shape_text(text_line & line);
+    std::string shaping_key(text_line const& line) const;
+    bool apply_shaped_line(text_line & line, shaped_line const& shaped);
+    shaped_line_ptr make_shaped_line(text_line const& line) const;
+    std::size_t find_format_run(unsigned char_index) const;
     void add_line(text_line && line);
     void clear_cluster_widths(unsigned first, unsigned last);
     void init_auto_alignment();
@@ -139,6 +145,14 @@ private:
 
     // processing
     text_itemizer itemizer_;
+    // Text ranges added with each format, used to key the shaped_text_cache
+    struct format_run
+    {
+        unsigned start;
+        unsigned end;
+        evaluated_format_properties_ptr const* format;
+    };
+    std::vector<format_run> format_runs_;
     // Maps char index (UTF-16) to width. If multiple glyphs map to the same char the sum of all widths is used
     // note: this probably isn't the best solution. it would be better to have an object for each cluster, but
     // it needs to be implemented with no overhead.
@@ -0,0 +1,137 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_ARENA_HPP
+#define MAPNIK_UTIL_ARENA_HPP
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mapnik { namespace util {
+
+// Monotonic bump allocator: memory is handed out from large blocks and
+// only returned when the arena is destroyed. Not synchronised, allocate
+// from one thread at a time.
+class arena : private util::noncopyable
+{
+public:
+    explicit arena(std::size_t block_size = 64 * 1024)
+        : block_size_(block_size),
+          blocks_(),
+          ptr_(nullptr),
+          remaining_(0),
+          allocated_(0) {}
+
+    void * allocate(std::size_t size, std::size_t alignment)
+    {
+        std::size_t padding = (alignment - reinterpret_cast<std::uintptr_t>(ptr_) % alignment) % alignment;
+        if (ptr_ == nullptr || padding + size > remaining_)
+        {
+            // oversized requests get a block of their own
+            std::size_t block_size = std::max(block_size_, size + alignment);
+            blocks_.emplace_back(new char[block_size]);
+            ptr_ = blocks_.back().get();
+            remaining_ = block_size;
+            padding = (alignment - reinterpret_cast<std::uintptr_t>(ptr_) % alignment) % alignment;
+        }
+        char * result = ptr_ + padding;
+        ptr_ = result + size;
+        remaining_ -= padding + size;
+        allocated_ += size;
+        return result;
+    }
+
+    // bytes handed out so far
+    std::size_t allocated() const { return allocated_; }
+    std::size_t num_blocks() const { return blocks_.size(); }
+
+private:
+    std::size_t block_size_;
+    std::vector<std::unique_ptr<char[]> > blocks_;
+    char * ptr_;
+    std::size_t remaining_;
+    std::size_t allocated_;
+};
+
+// Standard allocator drawing from a shared arena. Every copy (e.g. the one
+// std::allocate_shared keeps in its control block) holds the arena alive,
+// so the arena is released in one go once the last object built from it
+// is gone. deallocate() is a no-op. Without an arena memory comes from the
+// heap as with std::allocator.
+template <typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    arena_allocator()
+        : arena_() {}
+
+    explicit arena_allocator(std::shared_ptr<arena> const& a)
+        : arena_(a) {}
+
+    template <typename U>
+    arena_allocator(arena_allocator<U> const& other)
+        : arena_(other.get_arena()) {}
+
+    T * allocate(std::size_t n)
+    {
+        if (!arena_) return std::allocator<T>().allocate(n);
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T * p, std::size_t n)
+    {
+        if (!arena_) std::allocator<T>().deallocate(p, n);
+    }
+
+    std::shared_ptr<arena> const& get_arena() const { return arena_; }
+
+    template <typename U>
+    struct rebind { using other = arena_allocator<U>; };
+
+private:
+    std::shared_ptr<arena> arena_;
+};
+
+template <typename T, typename U>
+bool operator==(arena_allocator<T> const& lhs, arena_allocator<U> const& rhs)
+{
+    return lhs.get_arena() == rhs.get_arena();
+}
+
+template <typename T, typename U>
+bool operator!=(arena_allocator<T> const& lhs, arena_allocator<U> const& rhs)
+{
+    return !(lhs == rhs);
+}
+
+}}
+
+#endif // MAPNIK_UTIL_ARENA_HPP
@@ -27,6 +27,8 @@
 #include <mapnik/config.hpp>
 
 // stl
+#include <cstdint>
+#include <ctime>
 #include <string>
 #include <vector>
 
@@ -36,6 +38,8 @@ MAPNIK_DECL bool exists(std::string const& value);
 MAPNIK_DECL bool is_directory(std::string const& value);
 MAPNIK_DECL bool is_regular_file(std::string const& value);
 MAPNIK_DECL bool remove(std::string const& value);
+MAPNIK_DECL std::time_t last_write_time(std::string const& value);
+MAPNIK_DECL std::uintmax_t file_size(std::string const& value);
 MAPNIK_DECL bool is_relative(std::string const& value);
 MAPNIK_DECL std::string make_relative(std::string const& filepath, std::string const& base);
 MAPNIK_DECL std::string make_absolute(std::string const& filepath, std::string const& base);
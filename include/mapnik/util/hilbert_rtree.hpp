@@ -0,0 +1,204 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_HILBERT_RTREE_HPP
+#define MAPNIK_UTIL_HILBERT_RTREE_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mapnik { namespace util {
+
+// Position of (x, y) along a Hilbert curve filling a 2^16 x 2^16 grid
+inline std::uint32_t hilbert_index(std::uint32_t x, std::uint32_t y)
+{
+    std::uint32_t const n = 1u << 16;
+    std::uint64_t d = 0;
+    for (std::uint32_t s = n / 2; s > 0; s /= 2)
+    {
+        std::uint32_t rx = (x & s) > 0;
+        std::uint32_t ry = (y & s) > 0;
+        d += static_cast<std::uint64_t>(s) * s * ((3 * rx) ^ ry);
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return static_cast<std::uint32_t>(d);
+}
+
+// Bulk loader for version 3 index files: a packed R-tree with items
+// sorted along a Hilbert curve, so neighbouring items end up in the same
+// nodes and each item is stored exactly once.
+//
+// Layout (little endian, sections 8 byte aligned):
+//   "mapnik-idx-v3" header (16 bytes)
+//   node size (uint32), value size (uint32), item count (uint64),
+//   level count (uint32), reserved (uint32), extent (4 x double)
+//   first box of each level (uint64 x (levels + 1)), level 0 are items
+//   boxes (4 x float, rounded outwards), root last
+//   values
+template <typename Value>
+class hilbert_rtree_builder
+{
+    static_assert(std::is_standard_layout<Value>::value, "Values stored in index must be standard layout type");
+    using bbox_type = box2d<double>;
+public:
+    explicit hilbert_rtree_builder(std::uint32_t node_size = 16)
+        : node_size_(std::max<std::uint32_t>(node_size, 2)),
+          items_(),
+          extent_() {}
+
+    void insert(Value const& value, bbox_type const& box)
+    {
+        if (!box.valid()) return;
+        if (items_.empty()) extent_ = box;
+        else extent_.expand_to_include(box);
+        items_.emplace_back(box, value);
+    }
+
+    std::size_t size() const { return items_.size(); }
+    bbox_type const& extent() const { return extent_; }
+
+    template <typename OutputStream>
+    void write(OutputStream & out)
+    {
+        sort_items();
+        // boxes of all levels, items first
+        std::vector<bbox_type> boxes;
+        std::vector<std::uint64_t> levels;
+        boxes.reserve(items_.size() + items_.size() / (node_size_ - 1) + 1);
+        levels.push_back(0);
+        for (auto const& item : items_) boxes.push_back(item.first);
+        std::size_t level_begin = 0;
+        std::size_t level_end = boxes.size();
+        levels.push_back(level_end);
+        while (level_end - level_begin > 1)
+        {
+            for (std::size_t first = level_begin; first < level_end; first += node_size_)
+            {
+                std::size_t last = std::min<std::size_t>(level_end, first + node_size_);
+                bbox_type box = boxes[first];
+                for (std::size_t i = first + 1; i < last; ++i) box.expand_to_include(boxes[i]);
+                boxes.push_back(box);
+            }
+            level_begin = level_end;
+            level_end = boxes.size();
+            levels.push_back(level_end);
+        }
+
+        char header[16];
+        std::memset(header, 0, 16);
+        std::strcpy(header, "mapnik-idx-v3");
+        out.write(header, 16);
+        write_value(out, node_size_);
+        write_value(out, static_cast<std::uint32_t>(sizeof(Value)));
+        write_value(out, static_cast<std::uint64_t>(items_.size()));
+        write_value(out, static_cast<std::uint32_t>(levels.size() - 1));
+        write_value(out, std::uint32_t(0));
+        double extent[4] = { extent_.minx(), extent_.miny(), extent_.maxx(), extent_.maxy() };
+        out.write(reinterpret_cast<char const*>(extent), sizeof(extent));
+        for (std::uint64_t level : levels) write_value(out, level);
+        for (auto const& box : boxes)
+        {
+            float coords[4] = { round_down(box.minx()), round_down(box.miny()),
+                                round_up(box.maxx()), round_up(box.maxy()) };
+            out.write(reinterpret_cast<char const*>(coords), sizeof(coords));
+        }
+        pad(out, boxes.size() * 4 * sizeof(float));
+        for (auto const& item : items_)
+        {
+            out.write(reinterpret_cast<char const*>(&item.second), sizeof(Value));
+        }
+        pad(out, items_.size() * sizeof(Value));
+    }
+
+private:
+    void sort_items()
+    {
+        double width = extent_.width() > 0 ? extent_.width() : 1.0;
+        double height = extent_.height() > 0 ? extent_.height() : 1.0;
+        double const max_coord = (1 << 16) - 1;
+        std::vector<std::pair<std::uint32_t, std::size_t> > keys;
+        keys.reserve(items_.size());
+        for (std::size_t i = 0; i < items_.size(); ++i)
+        {
+            auto center = items_[i].first.center();
+            auto x = static_cast<std::uint32_t>(max_coord * (center.x - extent_.minx()) / width);
+            auto y = static_cast<std::uint32_t>(max_coord * (center.y - extent_.miny()) / height);
+            keys.emplace_back(hilbert_index(x, y), i);
+        }
+        std::sort(keys.begin(), keys.end());
+        std::vector<std::pair<bbox_type, Value> > sorted;
+        sorted.reserve(items_.size());
+        for (auto const& key : keys) sorted.push_back(items_[key.second]);
+        items_.swap(sorted);
+    }
+
+    static float round_down(double val)
+    {
+        float f = static_cast<float>(val);
+        return f > val ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+    }
+
+    static float round_up(double val)
+    {
+        float f = static_cast<float>(val);
+        return f < val ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+    }
+
+    template <typename OutputStream, typename T>
+    static void write_value(OutputStream & out, T val)
+    {
+        out.write(reinterpret_cast<char const*>(&val), sizeof(T));
+    }
+
+    template <typename OutputStream>
+    static void pad(OutputStream & out, std::size_t size)
+    {
+        char const zeros[8] = {0};
+        if (size % 8) out.write(zeros, 8 - size % 8);
+    }
+
+    std::uint32_t node_size_;
+    std::vector<std::pair<bbox_type, Value> > items_;
+    bbox_type extent_;
+};
+
+}}
+
+#endif // MAPNIK_UTIL_HILBERT_RTREE_HPP
@@ -0,0 +1,125 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_LRU_CACHE_HPP
+#define MAPNIK_UTIL_LRU_CACHE_HPP
+
+// stl
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace mapnik { namespace util {
+
+// Cost of an lru_cache entry counted against its capacity, one per entry
+struct lru_unit_cost
+{
+    template <typename Value>
+    std::size_t operator()(Value const&) const
+    {
+        return 1;
+    }
+};
+
+// Bounded map evicting least recently used entries once the total `Cost`
+// of the stored entries would exceed `capacity` (by default once `capacity`
+// entries are stored). Not synchronised, callers guard it as needed.
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Cost = lru_unit_cost>
+class lru_cache
+{
+    using entry_list = std::list<std::pair<Key, Value> >;
+    using entry_map = std::unordered_map<Key, typename entry_list::iterator, Hash>;
+public:
+    explicit lru_cache(std::size_t capacity)
+        : capacity_(capacity),
+          cost_(0),
+          entries_(),
+          map_() {}
+
+    // returns nullptr when key is not cached, marks entry as recently used otherwise
+    Value const* find(Key const& key)
+    {
+        auto itr = map_.find(key);
+        if (itr == map_.end()) return nullptr;
+        entries_.splice(entries_.begin(), entries_, itr->second);
+        return &itr->second->second;
+    }
+
+    // entries costing more than the capacity are not stored
+    void insert(Key const& key, Value const& value)
+    {
+        auto itr = map_.find(key);
+        if (itr != map_.end())
+        {
+            cost_ -= Cost()(itr->second->second);
+            entries_.erase(itr->second);
+            map_.erase(itr);
+        }
+        std::size_t cost = Cost()(value);
+        if (capacity_ == 0 || cost > capacity_) return;
+        evict(capacity_ - cost);
+        entries_.emplace_front(key, value);
+        map_.emplace(key, entries_.begin());
+        cost_ += cost;
+    }
+
+    void set_capacity(std::size_t capacity)
+    {
+        capacity_ = capacity;
+        evict(capacity_);
+    }
+
+    std::size_t capacity() const { return capacity_; }
+    std::size_t size() const { return map_.size(); }
+    // total cost of the stored entries
+    std::size_t cost() const { return cost_; }
+
+    void clear()
+    {
+        map_.clear();
+        entries_.clear();
+        cost_ = 0;
+    }
+
+private:
+    // evicts least recently used entries until their total cost is at most `cost`
+    void evict(std::size_t cost)
+    {
+        while (!entries_.empty() && cost_ > cost)
+        {
+            cost_ -= Cost()(entries_.back().second);
+            map_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+    }
+
+    std::size_t capacity_;
+    std::size_t cost_;
+    entry_list entries_;
+    entry_map map_;
+};
+
+}}
+
+#endif // MAPNIK_UTIL_LRU_CACHE_HPP
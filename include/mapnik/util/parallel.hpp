@@ -0,0 +1,124 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_PARALLEL_HPP
+#define MAPNIK_UTIL_PARALLEL_HPP
+
+// stl
+#include <cstddef>
+#include <algorithm>
+#include <exception>
+
+#ifdef MAPNIK_THREADSAFE
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+namespace mapnik { namespace util {
+
+// Number of jobs to use when the caller asks for "as many as possible" (0)
+inline unsigned hardware_concurrency()
+{
+#ifdef MAPNIK_THREADSAFE
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+#else
+    return 1;
+#endif
+}
+
+// Calls func(i) for every i in [0, count) using up to `jobs` threads
+// (the calling thread included). Items are handed out one at a time so
+// uneven work is balanced. The first exception thrown by func is
+// re-thrown in the calling thread once all workers have finished.
+// Without MAPNIK_THREADSAFE, or with jobs <= 1, this is a plain loop.
+template <typename Func>
+void parallel_for(std::size_t count, unsigned jobs, Func && func)
+{
+    if (jobs == 0) jobs = hardware_concurrency();
+#ifdef MAPNIK_THREADSAFE
+    std::size_t num_threads = std::min<std::size_t>(jobs, count);
+    if (num_threads > 1)
+    {
+        std::atomic<std::size_t> next(0);
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto worker = [&]()
+        {
+            for (std::size_t i = next++; i < count; i = next++)
+            {
+                try
+                {
+                    func(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) error = std::current_exception();
+                    next = count; // stop handing out work
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+        for (std::size_t t = 1; t < num_threads; ++t)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread & t : threads)
+        {
+            t.join();
+        }
+        if (error) std::rethrow_exception(error);
+        return;
+    }
+#endif
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        func(i);
+    }
+}
+
+// Splits [0, size) into contiguous bands of at least `min_band` items and
+// calls func(begin, end) for each band using up to `jobs` threads.
+template <typename Func>
+void parallel_bands(std::size_t size, unsigned jobs, std::size_t min_band, Func && func)
+{
+    if (size == 0) return;
+    if (jobs == 0) jobs = hardware_concurrency();
+    if (min_band == 0) min_band = 1;
+    std::size_t num_bands = std::max<std::size_t>(1, std::min<std::size_t>(jobs, size / min_band));
+    std::size_t band = (size + num_bands - 1) / num_bands;
+    parallel_for(num_bands, jobs, [&](std::size_t i)
+    {
+        std::size_t begin = i * band;
+        std::size_t end = std::min(size, begin + band);
+        if (begin < end) func(begin, end);
+    });
+}
+
+}}
+
+#endif // MAPNIK_UTIL_PARALLEL_HPP
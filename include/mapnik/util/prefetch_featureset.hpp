@@ -0,0 +1,184 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_PREFETCH_FEATURESET_HPP
+#define MAPNIK_PREFETCH_FEATURESET_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/featureset.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <vector>
+
+#ifdef MAPNIK_THREADSAFE
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace mapnik {
+
+// Features fetched ahead of rendering: `buffer` holds the first features
+// already read from `features`, which continues where the buffer ends.
+struct prefetched_features
+{
+    featureset_ptr features;
+    std::vector<feature_ptr> buffer;
+};
+
+// Issues `num_queries` identical queries against `ds` and reads up to
+// `num_features` features from each of them. The queries run once, on
+// whichever thread gets to them first: a prefetch_pool worker, or the
+// renderer asking for the features. They are issued one after another
+// from that thread, so datasources keeping per-query state (e.g. ogr)
+// are not raced.
+class MAPNIK_DECL prefetch_task : private util::noncopyable
+{
+public:
+    using result_type = std::vector<std::shared_ptr<prefetched_features> >;
+
+    prefetch_task(datasource_ptr const& ds, query const& q,
+                  std::size_t num_queries, std::size_t num_features);
+
+    // runs the queries unless another thread already started them
+    void run();
+    // runs the queries if nobody started them yet, otherwise waits for
+    // them; re-throws any exception from the datasource
+    result_type const& get();
+
+private:
+    datasource_ptr ds_;
+    query query_;
+    std::size_t num_queries_;
+    std::size_t num_features_;
+    std::atomic<bool> started_;
+    std::promise<result_type> promise_;
+    std::shared_future<result_type> result_;
+};
+
+using prefetch_result = std::shared_ptr<prefetch_task>;
+
+// Process wide pool of threads running prefetch tasks. At most
+// max_threads() workers are started, tasks they don't get to before
+// rendering needs them are run by the renderer. Without MAPNIK_THREADSAFE
+// no workers are started and every task runs on demand.
+class MAPNIK_DECL prefetch_pool :
+        public singleton<prefetch_pool, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<prefetch_pool>;
+public:
+    void submit(prefetch_result const& task);
+
+    // maximum number of worker threads (default: the hardware concurrency),
+    // 0 disables the workers
+    void set_max_threads(std::size_t max_threads);
+    std::size_t max_threads() const;
+    // number of running worker threads
+    std::size_t threads() const;
+
+private:
+    prefetch_pool();
+    ~prefetch_pool();
+#ifdef MAPNIK_THREADSAFE
+    void work();
+    void join_finished();
+    mutable std::mutex pool_mutex_;
+    std::condition_variable cond_;
+    // tasks dropped by the renderer before a worker got to them are skipped
+    std::deque<std::weak_ptr<prefetch_task> > queue_;
+    std::vector<std::thread> workers_;
+    // workers above max_threads() which returned, joined by the next submit()
+    std::vector<std::thread::id> finished_;
+    std::size_t running_;
+    std::size_t idle_;
+    bool stop_;
+#endif
+    std::size_t max_threads_;
+};
+
+extern template class MAPNIK_DECL singleton<prefetch_pool, CreateStatic>;
+
+// Queues `num_queries` identical queries against `ds`, reading ahead up to
+// `num_features` features from each, on the prefetch_pool.
+inline prefetch_result prefetch_features(datasource_ptr const& ds, query const& q,
+                                         std::size_t num_queries, std::size_t num_features)
+{
+    auto task = std::make_shared<prefetch_task>(ds, q, num_queries, num_features);
+    prefetch_pool::instance().submit(task);
+    return task;
+}
+
+// Featureset serving the `index`th query of a prefetch_result, waiting
+// for the worker (or running the queries itself) only when the first
+// feature is requested.
+class prefetch_featureset : public Featureset
+{
+public:
+    prefetch_featureset(prefetch_result const& result, std::size_t index)
+      : result_(result),
+        index_(index),
+        prefetched_(),
+        pos_(0)
+    {}
+
+    virtual ~prefetch_featureset() {}
+
+    feature_ptr next()
+    {
+        if (!prefetched_)
+        {
+            prefetched_ = result_->get().at(index_);
+        }
+        if (pos_ < prefetched_->buffer.size())
+        {
+            feature_ptr feature;
+            feature.swap(prefetched_->buffer[pos_++]);
+            return feature;
+        }
+        if (prefetched_->features)
+        {
+            return prefetched_->features->next();
+        }
+        return feature_ptr();
+    }
+
+private:
+    prefetch_result result_;
+    std::size_t index_;
+    std::shared_ptr<prefetched_features> prefetched_;
+    std::size_t pos_;
+};
+
+}
+
+#endif // MAPNIK_PREFETCH_FEATURESET_HPP
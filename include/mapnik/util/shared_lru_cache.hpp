@@ -0,0 +1,137 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_SHARED_LRU_CACHE_HPP
+#define MAPNIK_UTIL_SHARED_LRU_CACHE_HPP
+
+// mapnik
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/lru_cache.hpp>
+
+// stl
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+namespace mapnik { namespace util {
+
+// Singleton lru_cache shared by all threads, with hit and miss counters.
+// `Derived` is the cache class itself, making its constructor and destructor
+// private and befriending CreateStatic<Derived> as singletons do. `Value`
+// is a pointer type, find() returns a null one when the key is not cached.
+// `Cost` weighs entries against the capacity as in lru_cache.
+template <typename Derived, typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename Cost = lru_unit_cost>
+class shared_lru_cache :
+        public singleton<Derived, CreateStatic>,
+        private util::noncopyable
+{
+public:
+    Value find(Key const& key)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(this->mutex_);
+#endif
+        Value const* cached = cache_.find(key);
+        if (cached)
+        {
+            ++hits_;
+            return *cached;
+        }
+        ++misses_;
+        return Value();
+    }
+
+    void insert(Key const& key, Value const& value)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(this->mutex_);
+#endif
+        cache_.insert(key, value);
+    }
+
+    // maximum number (or total cost) of cached entries, 0 disables the cache
+    void set_max_entries(std::size_t max_entries)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(this->mutex_);
+#endif
+        cache_.set_capacity(max_entries);
+    }
+
+    std::size_t max_entries() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(this->mutex_);
+#endif
+        return cache_.capacity();
+    }
+
+    std::size_t size() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(this->mutex_);
+#endif
+        return cache_.size();
+    }
+
+    // total cost of the cached entries
+    std::size_t cost() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(this->mutex_);
+#endif
+        return cache_.cost();
+    }
+
+    std::size_t hits() const { return hits_; }
+    std::size_t misses() const { return misses_; }
+
+    // drops all entries and resets the counters
+    void clear()
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(this->mutex_);
+#endif
+        cache_.clear();
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+protected:
+    explicit shared_lru_cache(std::size_t max_entries)
+        : cache_(max_entries),
+          hits_(0),
+          misses_(0) {}
+
+    ~shared_lru_cache() {}
+
+private:
+    lru_cache<Key, Value, Hash, Cost> cache_;
+    std::atomic<std::size_t> hits_;
+    std::atomic<std::size_t> misses_;
+};
+
+}}
+
+#endif // MAPNIK_UTIL_SHARED_LRU_CACHE_HPP
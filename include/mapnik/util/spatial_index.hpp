@@ -29,8 +29,12 @@
 #include <mapnik/query.hpp>
 #include <mapnik/geom_util.hpp>
 // stl
+#include <algorithm>
 #include <type_traits>
+#include <cstdint>
 #include <cstring>
+#include <stdexcept>
+#include <vector>
 
 using mapnik::box2d;
 using mapnik::query;
@@ -47,6 +51,27 @@ bool check_spatial_index(InputStream& in)
     return (std::strncmp(header, "mapnik-index",12) == 0);
 }
 
+// Returns index file version from the 16 byte header: 1 for "mapnik-index",
+// 2 for the 8 byte aligned "mapnik-idx-v2" layout, 3 for the packed
+// Hilbert R-tree "mapnik-idx-v3" (see hilbert_rtree.hpp) or 0 if not an index.
+inline unsigned spatial_index_version(char const* header, std::size_t size)
+{
+    if (size < 16) return 0;
+    if (std::strncmp(header, "mapnik-index", 12) == 0) return 1;
+    if (std::strncmp(header, "mapnik-idx-v2", 13) == 0) return 2;
+    if (std::strncmp(header, "mapnik-idx-v3", 13) == 0) return 3;
+    return 0;
+}
+
+template <typename InputStream>
+unsigned spatial_index_version(InputStream& in)
+{
+    char header[16];
+    std::memset(header, 0, 16);
+    in.read(header, 16);
+    return in ? spatial_index_version(header, 16) : 0;
+}
+
 template <typename Value, typename Filter, typename InputStream, typename BBox = box2d<double> >
 class spatial_index
 {
@@ -164,6 +189,234 @@ void spatial_index<Value, Filter, InputStream, BBox>::read_envelope(InputStream&
     in.read(reinterpret_cast<char*>(&envelope), sizeof(envelope));
 }
 
+// Reads index files in place (e.g. from a mapped_region) by pointer
+// arithmetic, without stream state. Supports all index versions;
+// version 2 and 3 records are aligned so items are passed to visitors
+// directly from `data` when it is suitably aligned.
+template <typename Value, typename Filter, typename BBox = box2d<double> >
+class mapped_spatial_index
+{
+    using bbox_type = BBox;
+    static_assert(std::is_standard_layout<Value>::value, "Values stored in quad-tree must be standard layout type");
+public:
+    mapped_spatial_index(char const* data, std::size_t size)
+        : data_(data),
+          size_(size),
+          version_(spatial_index_version(data, size))
+    {
+        if (version_ == 0) throw std::runtime_error("Invalid index file (regenerate with shapeindex)");
+    }
+
+    unsigned version() const { return version_; }
+
+    bbox_type bounding_box() const
+    {
+        if (version_ == 3)
+        {
+            double extent[4];
+            require(v3_extent, sizeof(extent));
+            std::memcpy(extent, data_ + v3_extent, sizeof(extent));
+            return bbox_type(extent[0], extent[1], extent[2], extent[3]);
+        }
+        bbox_type box;
+        std::size_t pos = version_ == 1 ? 16 + 4 : 16;
+        require(pos, sizeof(bbox_type));
+        std::memcpy(&box, data_ + pos, sizeof(bbox_type));
+        return box;
+    }
+
+    // Calls visitor(Value const&) for items of every node passing the
+    // filter, in index order, until the visitor returns false.
+    template <typename Visitor>
+    void visit(Filter const& filter, Visitor && visitor) const
+    {
+        std::size_t end;
+        if (version_ == 1) visit_node_v1(filter, visitor, 16, end);
+        else if (version_ == 2) visit_node_v2(filter, visitor, 16, end);
+        else visit_v3(filter, visitor);
+    }
+
+    void query(Filter const& filter, std::vector<Value> & results) const
+    {
+        visit(filter, [&](Value const& item) { results.push_back(item); return true; });
+    }
+
+    void query_first_n(Filter const& filter, std::vector<Value> & results, std::size_t count) const
+    {
+        if (results.size() >= count) return;
+        visit(filter, [&](Value const& item) { results.push_back(item); return results.size() < count; });
+    }
+
+private:
+    // version 3 header fields following the 16 byte magic
+    static constexpr std::size_t v3_node_size = 16;
+    static constexpr std::size_t v3_value_size = 20;
+    static constexpr std::size_t v3_num_items = 24;
+    static constexpr std::size_t v3_num_levels = 32;
+    static constexpr std::size_t v3_extent = 40;
+    static constexpr std::size_t v3_levels = 72;
+
+    static std::size_t align8(std::size_t size)
+    {
+        return (size + 7) & ~std::size_t(7);
+    }
+
+    void require(std::size_t pos, std::size_t length) const
+    {
+        if (pos > size_ || length > size_ - pos) throw std::runtime_error("Invalid index file (truncated)");
+    }
+
+    std::int32_t read_int32(std::size_t pos) const
+    {
+        unsigned char const* b = reinterpret_cast<unsigned char const*>(data_ + pos);
+        return static_cast<std::int32_t>(b[0] | b[1] << 8 | b[2] << 16 | static_cast<std::uint32_t>(b[3]) << 24);
+    }
+
+    template <typename Visitor>
+    bool visit_item(Visitor & visitor, std::size_t pos) const
+    {
+        char const* ptr = data_ + pos;
+        if (reinterpret_cast<std::uintptr_t>(ptr) % alignof(Value) == 0)
+        {
+            return visitor(*reinterpret_cast<Value const*>(ptr));
+        }
+        Value item;
+        std::memcpy(&item, ptr, sizeof(Value));
+        return visitor(item);
+    }
+
+    // offset (int32), extent, item count (int32), items, child count (int32), children;
+    // offset is the size of all children records
+    template <typename Visitor>
+    bool visit_node_v1(Filter const& filter, Visitor & visitor, std::size_t pos, std::size_t & end) const
+    {
+        std::size_t header_size = 4 + sizeof(bbox_type) + 4;
+        require(pos, header_size);
+        std::int32_t offset = read_int32(pos);
+        std::int32_t num_shapes = read_int32(pos + 4 + sizeof(bbox_type));
+        if (offset < 0 || num_shapes < 0) throw std::runtime_error("Invalid index file (corrupt node)");
+        std::size_t items = pos + header_size;
+        std::size_t children = items + num_shapes * sizeof(Value);
+        end = children + 4 + offset;
+        bbox_type node_ext;
+        std::memcpy(&node_ext, data_ + pos + 4, sizeof(bbox_type));
+        if (!filter.pass(node_ext)) return true;
+        require(items, num_shapes * sizeof(Value) + 4);
+        for (std::int32_t i = 0; i < num_shapes; ++i)
+        {
+            if (!visit_item(visitor, items + i * sizeof(Value))) return false;
+        }
+        std::int32_t num_children = read_int32(children);
+        std::size_t child = children + 4;
+        for (std::int32_t j = 0; j < num_children; ++j)
+        {
+            if (!visit_node_v1(filter, visitor, child, child)) return false;
+        }
+        return true;
+    }
+
+    // extent (padded to 8), subtree size (uint64), item count (uint32),
+    // child count (uint32), items (padded to 8), children
+    template <typename Visitor>
+    bool visit_node_v2(Filter const& filter, Visitor & visitor, std::size_t pos, std::size_t & end) const
+    {
+        std::size_t box_size = align8(sizeof(bbox_type));
+        require(pos, box_size + 16);
+        std::uint64_t subtree_size;
+        std::uint32_t num_shapes;
+        std::uint32_t num_children;
+        std::memcpy(&subtree_size, data_ + pos + box_size, 8);
+        std::memcpy(&num_shapes, data_ + pos + box_size + 8, 4);
+        std::memcpy(&num_children, data_ + pos + box_size + 12, 4);
+        std::size_t items = pos + box_size + 16;
+        std::size_t children = items + align8(num_shapes * sizeof(Value));
+        if (subtree_size > size_) throw std::runtime_error("Invalid index file (corrupt node)");
+        end = children + static_cast<std::size_t>(subtree_size);
+        bbox_type node_ext;
+        std::memcpy(&node_ext, data_ + pos, sizeof(bbox_type));
+        if (!filter.pass(node_ext)) return true;
+        require(items, num_shapes * sizeof(Value));
+        for (std::uint32_t i = 0; i < num_shapes; ++i)
+        {
+            if (!visit_item(visitor, items + i * sizeof(Value))) return false;
+        }
+        std::size_t child = children;
+        for (std::uint32_t j = 0; j < num_children; ++j)
+        {
+            if (!visit_node_v2(filter, visitor, child, child)) return false;
+        }
+        return true;
+    }
+
+    struct packed_tree
+    {
+        std::size_t node_size;
+        std::size_t num_items;
+        std::vector<std::uint64_t> levels; // first box of each level, items at level 0
+        std::size_t boxes;
+        std::size_t values;
+    };
+
+    template <typename Visitor>
+    void visit_v3(Filter const& filter, Visitor & visitor) const
+    {
+        require(0, v3_levels);
+        std::uint32_t node_size;
+        std::uint32_t value_size;
+        std::uint64_t num_items;
+        std::uint32_t num_levels;
+        std::memcpy(&node_size, data_ + v3_node_size, 4);
+        std::memcpy(&value_size, data_ + v3_value_size, 4);
+        std::memcpy(&num_items, data_ + v3_num_items, 8);
+        std::memcpy(&num_levels, data_ + v3_num_levels, 4);
+        if (value_size != sizeof(Value)) throw std::runtime_error("Invalid index file (unexpected item size)");
+        if (num_items == 0 || num_levels == 0) return;
+        if (node_size < 2 || num_items > size_) throw std::runtime_error("Invalid index file (corrupt header)");
+        packed_tree tree;
+        tree.node_size = node_size;
+        tree.num_items = static_cast<std::size_t>(num_items);
+        require(v3_levels, (num_levels + 1) * std::size_t(8));
+        tree.levels.resize(num_levels + 1);
+        std::memcpy(tree.levels.data(), data_ + v3_levels, tree.levels.size() * 8);
+        if (tree.levels.front() != 0 || tree.levels[1] != num_items ||
+            tree.levels.back() - tree.levels[num_levels - 1] != 1 ||
+            !std::is_sorted(tree.levels.begin(), tree.levels.end()))
+        {
+            throw std::runtime_error("Invalid index file (corrupt header)");
+        }
+        tree.boxes = v3_levels + tree.levels.size() * 8;
+        std::size_t boxes_size = static_cast<std::size_t>(tree.levels.back()) * 4 * sizeof(float);
+        tree.values = tree.boxes + align8(boxes_size);
+        require(tree.boxes, boxes_size);
+        require(tree.values, tree.num_items * sizeof(Value));
+        visit_packed_node(filter, visitor, tree, num_levels - 1, 0);
+    }
+
+    // node `index` of `level` covers entries [index * node_size, (index + 1) * node_size)
+    // of the level below; leaf entries are items in Hilbert order
+    template <typename Visitor>
+    bool visit_packed_node(Filter const& filter, Visitor & visitor, packed_tree const& tree,
+                           std::size_t level, std::size_t index) const
+    {
+        float box[4];
+        std::memcpy(box, data_ + tree.boxes + (tree.levels[level] + index) * sizeof(box), sizeof(box));
+        if (!filter.pass(bbox_type(box[0], box[1], box[2], box[3]))) return true;
+        if (level == 0) return visit_item(visitor, tree.values + index * sizeof(Value));
+        std::size_t level_size = static_cast<std::size_t>(tree.levels[level] - tree.levels[level - 1]);
+        std::size_t first = index * tree.node_size;
+        std::size_t last = std::min(level_size, first + tree.node_size);
+        for (std::size_t child = first; child < last; ++child)
+        {
+            if (!visit_packed_node(filter, visitor, tree, level - 1, child)) return false;
+        }
+        return true;
+    }
+
+    char const* data_;
+    std::size_t size_;
+    unsigned version_;
+};
+
 }} // mapnik/util
 
 #endif // MAPNIK_UTIL_SPATIAL_INDEX_HPP
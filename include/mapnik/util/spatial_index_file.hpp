@@ -0,0 +1,93 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_SPATIAL_INDEX_FILE_HPP
+#define MAPNIK_UTIL_SPATIAL_INDEX_FILE_HPP
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+#include <mapnik/mapped_memory_cache.hpp>
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#pragma GCC diagnostic pop
+#endif
+
+// stl
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace mapnik { namespace util {
+
+// Contents of an index file for mapped_spatial_index: memory mapped through
+// mapped_memory_cache when available, otherwise read into memory.
+class spatial_index_file : util::noncopyable
+{
+public:
+    explicit spatial_index_file(std::string const& filename)
+    {
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+        boost::optional<mapped_region_ptr> memory = mapped_memory_cache::instance().find(filename, true);
+        if (!memory) throw std::runtime_error("could not create file mapping for " + filename);
+        region_ = *memory;
+#else
+        std::ifstream in(filename.c_str(), std::ios::binary);
+        if (!in) throw std::runtime_error("could not open index file " + filename);
+        in.seekg(0, std::ios::end);
+        buffer_.resize(static_cast<std::size_t>(in.tellg()));
+        in.seekg(0, std::ios::beg);
+        in.read(buffer_.data(), buffer_.size());
+#endif
+    }
+
+    char const* data() const
+    {
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+        return static_cast<char const*>(region_->get_address());
+#else
+        return buffer_.data();
+#endif
+    }
+
+    std::size_t size() const
+    {
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+        return region_->get_size();
+#else
+        return buffer_.size();
+#endif
+    }
+
+private:
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+    mapped_region_ptr region_;
+#else
+    std::vector<char> buffer_;
+#endif
+};
+
+}}
+
+#endif // MAPNIK_UTIL_SPATIAL_INDEX_FILE_HPP
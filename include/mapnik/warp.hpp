@@ -47,11 +47,15 @@ MAPNIK_DECL void reproject_and_scale_raster(raster & target, raster const& sourc
                                             unsigned mesh_size,
                                             scaling_method_e scaling_method);
 
+// Resamples `source` into `target` through a mesh of source points every
+// `mesh_size` pixels reprojected with `prj_trans`. Bands of target rows are
+// resampled on up to `jobs` threads (0 - hardware concurrency). Meshes are
+// kept in warp_mesh_cache for requests repeating the same grid.
 template <typename T>
 MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const& prj_trans,
                              box2d<double> const& target_ext, box2d<double> const& source_ext,
                              double offset_x, double offset_y, unsigned mesh_size, scaling_method_e scaling_method, double filter_factor,
-                             boost::optional<double> const & nodata_value);
+                             boost::optional<double> const & nodata_value, unsigned jobs = 1);
 }
 
 #endif // MAPNIK_WARP_HPP
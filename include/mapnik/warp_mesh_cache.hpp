@@ -0,0 +1,115 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_WARP_MESH_CACHE_HPP
+#define MAPNIK_WARP_MESH_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/util/shared_lru_cache.hpp>
+
+// stl
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// Reprojection mesh of warp_image(): source raster grid points every
+// `mesh_size` pixels, nx by ny of them, in target pixel coordinates.
+struct warp_mesh
+{
+    std::size_t nx;
+    std::size_t ny;
+    std::vector<double> xs;
+    std::vector<double> ys;
+};
+
+using warp_mesh_ptr = std::shared_ptr<warp_mesh const>;
+
+struct warp_mesh_key
+{
+    box2d<double> source_ext;
+    box2d<double> target_ext;
+    std::size_t source_width;
+    std::size_t source_height;
+    std::size_t target_width;
+    std::size_t target_height;
+    double offset_x;
+    double offset_y;
+    unsigned mesh_size;
+    std::string source_proj;
+    std::string dest_proj;
+
+    bool operator==(warp_mesh_key const& rhs) const
+    {
+        return source_ext == rhs.source_ext && target_ext == rhs.target_ext &&
+            source_width == rhs.source_width && source_height == rhs.source_height &&
+            target_width == rhs.target_width && target_height == rhs.target_height &&
+            offset_x == rhs.offset_x && offset_y == rhs.offset_y &&
+            mesh_size == rhs.mesh_size &&
+            source_proj == rhs.source_proj && dest_proj == rhs.dest_proj;
+    }
+};
+
+struct warp_mesh_key_hash
+{
+    std::size_t operator()(warp_mesh_key const& key) const
+    {
+        std::hash<double> hash_double;
+        std::size_t seed = std::hash<std::string>()(key.source_proj);
+        for (std::size_t val : { std::hash<std::string>()(key.dest_proj),
+                    hash_double(key.source_ext.minx()), hash_double(key.source_ext.miny()),
+                    hash_double(key.source_ext.maxx()), hash_double(key.source_ext.maxy()),
+                    hash_double(key.target_ext.minx()), hash_double(key.target_ext.miny()),
+                    hash_double(key.target_ext.maxx()), hash_double(key.target_ext.maxy()),
+                    key.source_width, key.source_height, key.target_width, key.target_height,
+                    hash_double(key.offset_x), hash_double(key.offset_y), std::size_t(key.mesh_size) })
+        {
+            seed ^= val + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+};
+
+// Cache of reprojection meshes shared by all renderers, so rasters drawn
+// repeatedly onto the same grid (several raster layers or symbolizers of
+// one source, re-rendered tiles) don't reproject the mesh every time.
+class MAPNIK_DECL warp_mesh_cache :
+        public util::shared_lru_cache<warp_mesh_cache, warp_mesh_key,
+                                      warp_mesh_ptr, warp_mesh_key_hash>
+{
+    friend class CreateStatic<warp_mesh_cache>;
+private:
+    warp_mesh_cache();
+    ~warp_mesh_cache();
+};
+
+extern template class MAPNIK_DECL singleton<warp_mesh_cache, CreateStatic>;
+
+}
+
+#endif // MAPNIK_WARP_MESH_CACHE_HPP
@@ -44,6 +44,7 @@
 #include <mapnik/util/fs.hpp>
 #include <mapnik/make_unique.hpp>
 #include <mapnik/util/spatial_index.hpp>
+#include <mapnik/util/spatial_index_file.hpp>
 #include <mapnik/geom_util.hpp>
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
 #pragma GCC diagnostic push
@@ -154,11 +155,9 @@ csv_datasource::csv_datasource(parameters const& params)
         {
             // read bounding box from *.index
             using value_type = std::pair<std::size_t, std::size_t>;
-            std::ifstream index(filename_ + ".index", std::ios::binary);
-            if (!index) throw mapnik::datasource_exception("CSV Plugin: could not open: '" + filename_ + ".index'");
-            extent_ = mapnik::util::spatial_index<value_type,
-                                                  mapnik::filter_in_box,
-                                                  std::ifstream>::bounding_box(index);
+            mapnik::util::spatial_index_file index(filename_ + ".index");
+            extent_ = mapnik::util::mapped_spatial_index<value_type,
+                                                         mapnik::filter_in_box>(index.data(), index.size()).bounding_box();
         }
         //in.close(); no need to call close, rely on dtor
     }
@@ -317,14 +316,11 @@ csv_datasource::get_geometry_type_impl(std::istream & stream) const
     {
         // try reading *.index
         using value_type = std::pair<std::size_t, std::size_t>;
-        std::ifstream index(filename_ + ".index", std::ios::binary);
-        if (!index) throw mapnik::datasource_exception("CSV Plugin: could not open: '" + filename_ + ".index'");
-
+        mapnik::util::spatial_index_file index(filename_ + ".index");
         mapnik::filter_in_box filter(extent_);
         std::vector<value_type> positions;
-        mapnik::util::spatial_index<value_type,
-                                    mapnik::filter_in_box,
-                                    std::ifstream>::query_first_n(filter, index, positions, 5);
+        mapnik::util::mapped_spatial_index<value_type,
+                                           mapnik::filter_in_box>(index.data(), index.size()).query_first_n(filter, positions, 5);
         int multi_type = 0;
         for (auto const& val : positions)
         {
@@ -418,17 +414,20 @@ mapnik::featureset_ptr csv_datasource::features(mapnik::query const& q) const
                       });
             if (inline_string_.empty())
             {
-                return std::make_shared<csv_featureset>(filename_, locator_, separator_, quote_, headers_, ctx_, std::move(index_array));
+                return std::make_shared<csv_featureset>(filename_, locator_, separator_, quote_, headers_, ctx_, std::move(index_array),
+                                                        mapnik::attribute_filter(q));
             }
             else
             {
-                return std::make_shared<csv_inline_featureset>(inline_string_, locator_, separator_, quote_, headers_, ctx_, std::move(index_array));
+                return std::make_shared<csv_inline_featureset>(inline_string_, locator_, separator_, quote_, headers_, ctx_, std::move(index_array),
+                                                               mapnik::attribute_filter(q));
             }
         }
         else if (has_disk_index_)
         {
             mapnik::filter_in_box filter(q.get_bbox());
-            return std::make_shared<csv_index_featureset>(filename_, filter, locator_, separator_, quote_, headers_, ctx_);
+            return std::make_shared<csv_index_featureset>(filename_, filter, locator_, separator_, quote_, headers_, ctx_,
+                                                          mapnik::attribute_filter(q));
         }
     }
     return mapnik::make_empty_featureset();
@@ -32,7 +32,8 @@
 #include <deque>
 
 csv_featureset::csv_featureset(std::string const& filename, locator_type const& locator, char separator, char quote,
-                               std::vector<std::string> const& headers, mapnik::context_ptr const& ctx, array_type && index_array)
+                               std::vector<std::string> const& headers, mapnik::context_ptr const& ctx, array_type && index_array,
+                               mapnik::attribute_filter const& attribute_filter)
     :
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
     //
@@ -49,7 +50,8 @@ csv_featureset::csv_featureset(std::string const& filename, locator_type const&
     index_end_(index_array_.end()),
     ctx_(ctx),
     locator_(locator),
-    tr_("utf8")
+    tr_("utf8"),
+    attribute_filter_(attribute_filter)
 {
 #if defined (MAPNIK_MEMORY_MAPPED_FILE)
     boost::optional<mapnik::mapped_region_ptr> memory =
@@ -72,20 +74,20 @@ csv_featureset::~csv_featureset() {}
 mapnik::feature_ptr csv_featureset::parse_feature(char const* beg, char const* end)
 {
     auto values = csv_utils::parse_line(beg, end, separator_, quote_, headers_.size());
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_ + 1));
+    csv_utils::process_properties(*feature, headers_, values, locator_, tr_);
+    // rows failing the query filter are skipped before their geometry is parsed
+    if (!attribute_filter_.pass(*feature)) return mapnik::feature_ptr();
     auto geom = csv_utils::extract_geometry(values, locator_);
-    if (!geom.is<mapnik::geometry::geometry_empty>())
-    {
-        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, ++feature_id_));
-        feature->set_geometry(std::move(geom));
-        csv_utils::process_properties(*feature, headers_, values, locator_, tr_);
-        return feature;
-    }
-    return mapnik::feature_ptr();
+    if (geom.is<mapnik::geometry::geometry_empty>()) return mapnik::feature_ptr();
+    ++feature_id_;
+    feature->set_geometry(std::move(geom));
+    return feature;
 }
 
 mapnik::feature_ptr csv_featureset::next()
 {
-    if (index_itr_ != index_end_)
+    while (index_itr_ != index_end_)
     {
         csv_datasource::item_type const& item = *index_itr_++;
         std::size_t file_offset = item.second.first;
@@ -101,7 +103,8 @@ mapnik::feature_ptr csv_featureset::next()
         auto const* start = record.data();
         auto const*  end = start + record.size();
 #endif
-        return parse_feature(start, end);
+        auto feature = parse_feature(start, end);
+        if (feature) return feature;
     }
     return mapnik::feature_ptr();
 }
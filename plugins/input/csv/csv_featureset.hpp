@@ -25,6 +25,7 @@
 
 #include <mapnik/feature.hpp>
 #include <mapnik/unicode.hpp>
+#include <mapnik/filter_pushdown.hpp>
 #include "csv_utils.hpp"
 #include "csv_datasource.hpp"
 #include <deque>
@@ -49,7 +50,8 @@ public:
                    char quote,
                    std::vector<std::string> const& headers,
                    mapnik::context_ptr const& ctx,
-                   array_type && index_array);
+                   array_type && index_array,
+                   mapnik::attribute_filter const& attribute_filter = mapnik::attribute_filter());
     ~csv_featureset();
     mapnik::feature_ptr next();
 private:
@@ -71,6 +73,7 @@ private:
     mapnik::value_integer feature_id_ = 0;
     locator_type const& locator_;
     mapnik::transcoder tr_;
+    mapnik::attribute_filter attribute_filter_;
 };
 
 
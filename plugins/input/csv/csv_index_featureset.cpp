@@ -28,6 +28,7 @@
 #include <mapnik/util/utf_conv_win.hpp>
 #include <mapnik/util/trim.hpp>
 #include <mapnik/util/spatial_index.hpp>
+#include <mapnik/util/spatial_index_file.hpp>
 #include <mapnik/geometry.hpp>
 // stl
 #include <string>
@@ -41,13 +42,15 @@ csv_index_featureset::csv_index_featureset(std::string const& filename,
                                            char separator,
                                            char quote,
                                            std::vector<std::string> const& headers,
-                                           mapnik::context_ptr const& ctx)
+                                           mapnik::context_ptr const& ctx,
+                                           mapnik::attribute_filter const& attribute_filter)
     : separator_(separator),
       quote_(quote),
       headers_(headers),
       ctx_(ctx),
       locator_(locator),
-      tr_("utf8")
+      tr_("utf8"),
+      attribute_filter_(attribute_filter)
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
       //
 #elif defined( _WINDOWS)
@@ -72,12 +75,9 @@ csv_index_featureset::csv_index_featureset(std::string const& filename,
     if (!file_) throw mapnik::datasource_exception("CSV Plugin: can't open file " + filename);
 #endif
 
-    std::string indexname = filename + ".index";
-    std::ifstream index(indexname.c_str(), std::ios::binary);
-    if (!index) throw mapnik::datasource_exception("CSV Plugin: can't open index file " + indexname);
-    mapnik::util::spatial_index<value_type,
-                                mapnik::filter_in_box,
-                                std::ifstream>::query(filter, index, positions_);
+    mapnik::util::spatial_index_file index(filename + ".index");
+    mapnik::util::mapped_spatial_index<value_type,
+                                       mapnik::filter_in_box>(index.data(), index.size()).query(filter, positions_);
 
     std::sort(positions_.begin(), positions_.end(),
               [](value_type const& lhs, value_type const& rhs) { return lhs.first < rhs.first;});
@@ -89,15 +89,15 @@ csv_index_featureset::~csv_index_featureset() {}
 mapnik::feature_ptr csv_index_featureset::parse_feature(char const* beg, char const* end)
 {
     auto values = csv_utils::parse_line(beg, end, separator_, quote_, headers_.size());
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_ + 1));
+    csv_utils::process_properties(*feature, headers_, values, locator_, tr_);
+    // rows failing the query filter are skipped before their geometry is parsed
+    if (!attribute_filter_.pass(*feature)) return mapnik::feature_ptr();
     auto geom = csv_utils::extract_geometry(values, locator_);
-    if (!geom.is<mapnik::geometry::geometry_empty>())
-    {
-        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, ++feature_id_));
-        feature->set_geometry(std::move(geom));
-        csv_utils::process_properties(*feature, headers_, values, locator_, tr_);
-        return feature;
-    }
-    return mapnik::feature_ptr();
+    if (geom.is<mapnik::geometry::geometry_empty>()) return mapnik::feature_ptr();
+    ++feature_id_;
+    feature->set_geometry(std::move(geom));
+    return feature;
 }
 
 mapnik::feature_ptr csv_index_featureset::next()
@@ -26,6 +26,7 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/geom_util.hpp>
+#include <mapnik/filter_pushdown.hpp>
 #include "csv_utils.hpp"
 #include "csv_datasource.hpp"
 
@@ -50,7 +51,8 @@ public:
                          char separator,
                          char quote,
                          std::vector<std::string> const& headers,
-                         mapnik::context_ptr const& ctx);
+                         mapnik::context_ptr const& ctx,
+                         mapnik::attribute_filter const& attribute_filter = mapnik::attribute_filter());
     ~csv_index_featureset();
     mapnik::feature_ptr next();
 private:
@@ -62,6 +64,7 @@ private:
     mapnik::value_integer feature_id_ = 0;
     locator_type const& locator_;
     mapnik::transcoder tr_;
+    mapnik::attribute_filter attribute_filter_;
 #if defined (MAPNIK_MEMORY_MAPPED_FILE)
     using file_source_type = boost::interprocess::ibufferstream;
     mapnik::mapped_region_ptr mapped_region_;
@@ -38,7 +38,8 @@ csv_inline_featureset::csv_inline_featureset(std::string const& inline_string,
                                              char quote,
                                              std::vector<std::string> const& headers,
                                              mapnik::context_ptr const& ctx,
-                                             array_type && index_array)
+                                             array_type && index_array,
+                                             mapnik::attribute_filter const& attribute_filter)
     : inline_string_(inline_string),
       separator_(separator),
       quote_(quote),
@@ -48,7 +49,8 @@ csv_inline_featureset::csv_inline_featureset(std::string const& inline_string,
       index_end_(index_array_.end()),
       ctx_(ctx),
       locator_(locator),
-      tr_("utf8") {}
+      tr_("utf8"),
+      attribute_filter_(attribute_filter) {}
 
 csv_inline_featureset::~csv_inline_featureset() {}
 
@@ -57,26 +59,27 @@ mapnik::feature_ptr csv_inline_featureset::parse_feature(std::string const& str)
     auto const* start = str.data();
     auto const* end = start + str.size();
     auto values = csv_utils::parse_line(start, end, separator_, quote_, headers_.size());
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_ + 1));
+    csv_utils::process_properties(*feature, headers_, values, locator_, tr_);
+    // rows failing the query filter are skipped before their geometry is parsed
+    if (!attribute_filter_.pass(*feature)) return mapnik::feature_ptr();
     auto geom = csv_utils::extract_geometry(values, locator_);
-    if (!geom.is<mapnik::geometry::geometry_empty>())
-    {
-        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, ++feature_id_));
-        feature->set_geometry(std::move(geom));
-        csv_utils::process_properties(*feature, headers_, values, locator_, tr_);
-        return feature;
-    }
-    return mapnik::feature_ptr();
+    if (geom.is<mapnik::geometry::geometry_empty>()) return mapnik::feature_ptr();
+    ++feature_id_;
+    feature->set_geometry(std::move(geom));
+    return feature;
 }
 
 mapnik::feature_ptr csv_inline_featureset::next()
 {
-    if (index_itr_ != index_end_)
+    while (index_itr_ != index_end_)
     {
         csv_datasource::item_type const& item = *index_itr_++;
         std::size_t file_offset = item.second.first;
         std::size_t size = item.second.second;
         std::string str = inline_string_.substr(file_offset, size);
-        return parse_feature(str);
+        auto feature = parse_feature(str);
+        if (feature) return feature;
     }
     return mapnik::feature_ptr();
 }
@@ -59,7 +59,8 @@ gdal_datasource::gdal_datasource(parameters const& params)
       dataset_(nullptr, &GDALClose),
       desc_(gdal_datasource::name(), "utf-8"),
       nodata_value_(params.get<double>("nodata")),
-      nodata_tolerance_(*params.get<double>("nodata_tolerance",1e-12))
+      nodata_tolerance_(*params.get<double>("nodata_tolerance",1e-12)),
+      use_overviews_(*params.get<mapnik::boolean_type>("use_overviews", true))
 {
     MAPNIK_LOG_DEBUG(gdal) << "gdal_datasource: Initializing...";
 
@@ -235,7 +236,8 @@ featureset_ptr gdal_datasource::features(query const& q) const
                                               dx_,
                                               dy_,
                                               nodata_value_,
-                                              nodata_tolerance_);
+                                              nodata_tolerance_,
+                                              use_overviews_);
 }
 
 featureset_ptr gdal_datasource::features_at_point(coord2d const& pt, double tol) const
@@ -254,5 +256,6 @@ featureset_ptr gdal_datasource::features_at_point(coord2d const& pt, double tol)
                                               dx_,
                                               dy_,
                                               nodata_value_,
-                                              nodata_tolerance_);
+                                              nodata_tolerance_,
+                                              use_overviews_);
 }
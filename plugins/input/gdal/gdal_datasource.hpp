@@ -68,6 +68,7 @@ private:
     bool shared_dataset_;
     boost::optional<double> nodata_value_;
     double nodata_tolerance_;
+    bool use_overviews_;
 };
 
 #endif // GDAL_DATASOURCE_HPP
@@ -31,6 +31,7 @@
 #include <mapnik/feature_factory.hpp>
 
 // stl
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <sstream>
@@ -79,6 +80,46 @@ void get_overview_meta(GDALRasterBand* band)
 }
 } // anonymous ns
 #endif
+namespace {
+
+// Coarsest overview of `band` still providing at least im_width x im_height
+// pixels over a width x height window of the full resolution band, or -1
+// when only the full resolution band does.
+int select_overview(GDALRasterBand * band, int width, int height, int im_width, int im_height)
+{
+    int overview = -1;
+    double overview_scale = 1.0;
+    for (int i = 0; i < band->GetOverviewCount(); ++i)
+    {
+        GDALRasterBand * candidate = band->GetOverview(i);
+        if (!candidate || candidate->GetXSize() <= 0 || candidate->GetYSize() <= 0) continue;
+        double scale_x = static_cast<double>(band->GetXSize()) / candidate->GetXSize();
+        double scale_y = static_cast<double>(band->GetYSize()) / candidate->GetYSize();
+        if (width / scale_x >= im_width &&
+            height / scale_y >= im_height &&
+            scale_x > overview_scale)
+        {
+            overview = i;
+            overview_scale = scale_x;
+        }
+    }
+    return overview;
+}
+
+// Whether every band of the dataset has `overview` with the given size
+bool overview_available(GDALDataset & dataset, int overview, int xsize, int ysize)
+{
+    for (int i = 1; i <= dataset.GetRasterCount(); ++i)
+    {
+        GDALRasterBand * band = dataset.GetRasterBand(i);
+        GDALRasterBand * ov = band ? band->GetOverview(overview) : nullptr;
+        if (!ov || ov->GetXSize() != xsize || ov->GetYSize() != ysize) return false;
+    }
+    return true;
+}
+
+} // anonymous ns
+
 gdal_featureset::gdal_featureset(GDALDataset& dataset,
                                  int band,
                                  gdal_query q,
@@ -89,7 +130,8 @@ gdal_featureset::gdal_featureset(GDALDataset& dataset,
                                  double dx,
                                  double dy,
                                  boost::optional<double> const& nodata,
-                                 double nodata_tolerance)
+                                 double nodata_tolerance,
+                                 bool use_overviews)
     : dataset_(dataset),
       ctx_(std::make_shared<mapnik::context_type>()),
       band_(band),
@@ -102,6 +144,7 @@ gdal_featureset::gdal_featureset(GDALDataset& dataset,
       nbands_(nbands),
       nodata_value_(nodata),
       nodata_tolerance_(nodata_tolerance),
+      use_overviews_(use_overviews),
       first_(true)
 {
     ctx_->push("nodata");
@@ -225,6 +268,55 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
             im_height = height;
         }
 
+        // when downsampling, read from the coarsest overview still having enough
+        // pixels for the output size (which accounts for filter_factor) instead of
+        // decoding full resolution blocks only to throw most of them away
+        int overview = -1;
+        GDALRasterBand * base_band = dataset_.GetRasterBand(band_ > 0 ? band_ : 1);
+        if (use_overviews_ && base_band && im_width > 0 && im_height > 0 &&
+            im_width < width && im_height < height)
+        {
+            overview = select_overview(base_band, width, height, im_width, im_height);
+            if (overview >= 0)
+            {
+                GDALRasterBand * ov = base_band->GetOverview(overview);
+                int ov_xsize = ov->GetXSize();
+                int ov_ysize = ov->GetYSize();
+                if (band_ <= 0 && !overview_available(dataset_, overview, ov_xsize, ov_ysize))
+                {
+                    overview = -1;
+                }
+                else
+                {
+                    double scale_x = static_cast<double>(raster_width_) / ov_xsize;
+                    double scale_y = static_cast<double>(raster_height_) / ov_ysize;
+                    // window in whole overview pixels covering the requested one
+                    int ov_x_off = static_cast<int>(std::floor(x_off / scale_x));
+                    int ov_y_off = static_cast<int>(std::floor(y_off / scale_y));
+                    int ov_end_x = std::min(ov_xsize, static_cast<int>(std::ceil(end_x / scale_x)));
+                    int ov_end_y = std::min(ov_ysize, static_cast<int>(std::ceil(end_y / scale_y)));
+                    x_off = ov_x_off;
+                    y_off = ov_y_off;
+                    width = ov_end_x - ov_x_off;
+                    height = ov_end_y - ov_y_off;
+                    feature_raster_extent = box2d<double>(ov_x_off * scale_x, ov_y_off * scale_y,
+                                                          ov_end_x * scale_x, ov_end_y * scale_y);
+                    intersect = t.backward(feature_raster_extent);
+                    im_width = std::min(im_width, width);
+                    im_height = std::min(im_height, height);
+                    MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Using overview=" << overview
+                                           << " (" << ov_xsize << "x" << ov_ysize << ")"
+                                           << " StartX=" << x_off << " StartY=" << y_off
+                                           << " Width=" << width << " Height=" << height;
+                }
+            }
+        }
+        // band to read from, taking the selected overview into account
+        auto source = [overview](GDALRasterBand * band)
+        {
+            return overview >= 0 ? band->GetOverview(overview) : band;
+        };
+
         if (im_width > 0 && im_height > 0)
         {
             MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Image Size=(" << im_width << "," << im_height << ")";
@@ -246,9 +338,9 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     mapnik::image_gray8 image(im_width, im_height);
                     image.set(std::numeric_limits<std::uint8_t>::max());
                     raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                    raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                     image.data(), image.width(), image.height(),
-                                                     GDT_Byte, 0, 0);
+                    raster_io_error = source(band)->RasterIO(GF_Read, x_off, y_off, width, height,
+                                                             image.data(), image.width(), image.height(),
+                                                             GDT_Byte, 0, 0);
                     if (raster_io_error == CE_Failure)
                     {
                         throw datasource_exception(CPLGetLastErrorMsg());
@@ -266,9 +358,9 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     mapnik::image_gray32f image(im_width, im_height);
                     image.set(std::numeric_limits<float>::max());
                     raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                    raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                     image.data(), image.width(), image.height(),
-                                                     GDT_Float32, 0, 0);
+                    raster_io_error = source(band)->RasterIO(GF_Read, x_off, y_off, width, height,
+                                                             image.data(), image.width(), image.height(),
+                                                             GDT_Float32, 0, 0);
                     if (raster_io_error == CE_Failure)
                     {
                         throw datasource_exception(CPLGetLastErrorMsg());
@@ -285,9 +377,9 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     mapnik::image_gray16 image(im_width, im_height);
                     image.set(std::numeric_limits<std::uint16_t>::max());
                     raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                    raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                     image.data(), image.width(), image.height(),
-                                                     GDT_UInt16, 0, 0);
+                    raster_io_error = source(band)->RasterIO(GF_Read, x_off, y_off, width, height,
+                                                             image.data(), image.width(), image.height(),
+                                                             GDT_UInt16, 0, 0);
                     if (raster_io_error == CE_Failure)
                     {
                         throw datasource_exception(CPLGetLastErrorMsg());
@@ -305,9 +397,9 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     mapnik::image_gray16s image(im_width, im_height);
                     image.set(std::numeric_limits<std::int16_t>::max());
                     raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                    raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                     image.data(), image.width(), image.height(),
-                                                     GDT_Int16, 0, 0);
+                    raster_io_error = source(band)->RasterIO(GF_Read, x_off, y_off, width, height,
+                                                             image.data(), image.width(), image.height(),
+                                                             GDT_Int16, 0, 0);
                     if (raster_io_error == CE_Failure)
                     {
                         throw datasource_exception(CPLGetLastErrorMsg());
@@ -414,9 +506,9 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                         // TODO - we assume here the nodata value for the red band applies to all bands
                         // more details about this at http://trac.osgeo.org/gdal/ticket/2734
                         float* imageData = (float*)image.bytes();
-                        raster_io_error = red->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                        imageData, image.width(), image.height(),
-                                                        GDT_Float32, 0, 0);
+                        raster_io_error = source(red)->RasterIO(GF_Read, x_off, y_off, width, height,
+                                                                imageData, image.width(), image.height(),
+                                                                GDT_Float32, 0, 0);
                         if (raster_io_error == CE_Failure) {
                             throw datasource_exception(CPLGetLastErrorMsg());
                         }
@@ -435,7 +527,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     }
 
                     /* Use dataset RasterIO in priority in 99.9% of the cases */
-                    if( red->GetBand() == 1 && green->GetBand() == 2 && blue->GetBand() == 3 )
+                    if( overview < 0 && red->GetBand() == 1 && green->GetBand() == 2 && blue->GetBand() == 3 )
                     {
                         int nBandsToRead = 3;
                         if( alpha != nullptr && alpha->GetBand() == 4 && !raster_has_nodata )
@@ -454,18 +546,18 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     }
                     else
                     {
-                        raster_io_error = red->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 0,
-                                                        image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                        raster_io_error = source(red)->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 0,
+                                                                image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                         if (raster_io_error == CE_Failure) {
                             throw datasource_exception(CPLGetLastErrorMsg());
                         }
-                        raster_io_error = green->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 1,
-                                                        image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                        raster_io_error = source(green)->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 1,
+                                                                image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                         if (raster_io_error == CE_Failure) {
                             throw datasource_exception(CPLGetLastErrorMsg());
                         }
-                        raster_io_error = blue->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 2,
-                                                        image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                        raster_io_error = source(blue)->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 2,
+                                                                image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                         if (raster_io_error == CE_Failure) {
                             throw datasource_exception(CPLGetLastErrorMsg());
                         }
@@ -503,9 +595,9 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                         MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: applying nodata value for layer=" << apply_nodata;
                         // first read the data in and create an alpha channel from the nodata values
                         float* imageData = (float*)image.bytes();
-                        raster_io_error = grey->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                         imageData, image.width(), image.height(),
-                                                         GDT_Float32, 0, 0);
+                        raster_io_error = source(grey)->RasterIO(GF_Read, x_off, y_off, width, height,
+                                                                 imageData, image.width(), image.height(),
+                                                                 GDT_Float32, 0, 0);
                         if (raster_io_error == CE_Failure)
                         {
                             throw datasource_exception(CPLGetLastErrorMsg());
@@ -524,22 +616,22 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                         }
                     }
 
-                    raster_io_error = grey->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 0,
-                                                     image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    raster_io_error = source(grey)->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 0,
+                                                             image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                     if (raster_io_error == CE_Failure)
                     {
                         throw datasource_exception(CPLGetLastErrorMsg());
                     }
 
-                    raster_io_error = grey->RasterIO(GF_Read,x_off, y_off, width, height, image.bytes() + 1,
-                                                     image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    raster_io_error = source(grey)->RasterIO(GF_Read,x_off, y_off, width, height, image.bytes() + 1,
+                                                             image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                     if (raster_io_error == CE_Failure)
                     {
                         throw datasource_exception(CPLGetLastErrorMsg());
                     }
 
-                    raster_io_error = grey->RasterIO(GF_Read,x_off, y_off, width, height, image.bytes() + 2,
-                                                     image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    raster_io_error = source(grey)->RasterIO(GF_Read,x_off, y_off, width, height, image.bytes() + 2,
+                                                             image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
 
                     if (raster_io_error == CE_Failure)
                     {
@@ -575,8 +667,8 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: processing alpha band...";
                     if (!raster_has_nodata)
                     {
-                        raster_io_error = alpha->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 3,
-                                                          image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                        raster_io_error = source(alpha)->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 3,
+                                                                  image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                         if (raster_io_error == CE_Failure) {
                             throw datasource_exception(CPLGetLastErrorMsg());
                         }
@@ -593,7 +685,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     GDALRasterBand* mask = 0;
                     if (flags == GMF_PER_DATASET)
                     {
-                        mask = dataset_.GetRasterBand(1)->GetMaskBand();
+                        mask = source(dataset_.GetRasterBand(1))->GetMaskBand();
                     }
                     if (mask)
                     {
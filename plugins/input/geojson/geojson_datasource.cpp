@@ -54,6 +54,7 @@
 #include <mapnik/json/extract_bounding_box_grammar_impl.hpp>
 #include <mapnik/util/fs.hpp>
 #include <mapnik/util/spatial_index.hpp>
+#include <mapnik/util/spatial_index_file.hpp>
 #include <mapnik/geom_util.hpp>
 
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
@@ -220,16 +221,12 @@ void geojson_datasource::initialise_disk_index(std::string const& filename)
 {
     // read extent
     using value_type = std::pair<std::size_t, std::size_t>;
-    std::ifstream index(filename_ + ".index", std::ios::binary);
-    if (!index) throw mapnik::datasource_exception("GeoJSON Plugin: could not open: '" + filename_ + ".index'");
-    extent_ = mapnik::util::spatial_index<value_type,
-                                          mapnik::filter_in_box,
-                                          std::ifstream>::bounding_box(index);
+    mapnik::util::spatial_index_file index(filename_ + ".index");
+    mapnik::util::mapped_spatial_index<value_type, mapnik::filter_in_box> tree(index.data(), index.size());
+    extent_ = tree.bounding_box();
     mapnik::filter_in_box filter(extent_);
     std::vector<value_type> positions;
-    mapnik::util::spatial_index<value_type,
-                                mapnik::filter_in_box,
-                                std::ifstream>::query_first_n(filter, index, positions, num_features_to_query_);
+    tree.query_first_n(filter, positions, num_features_to_query_);
 
     mapnik::util::file file(filename_);
     if (!file) throw mapnik::datasource_exception("GeoJSON Plugin: could not open: '" + filename_ + "'");
@@ -446,13 +443,11 @@ boost::optional<mapnik::datasource_geometry_t> geojson_datasource::get_geometry_
     if (has_disk_index_)
     {
         using value_type = std::pair<std::size_t, std::size_t>;
-        std::ifstream index(filename_ + ".index", std::ios::binary);
-        if (!index) throw mapnik::datasource_exception("GeoJSON Plugin: could not open: '" + filename_ + ".index'");
+        mapnik::util::spatial_index_file index(filename_ + ".index");
         mapnik::filter_in_box filter(extent_);
         std::vector<value_type> positions;
-        mapnik::util::spatial_index<value_type,
-                                    mapnik::filter_in_box,
-                                    std::ifstream>::query_first_n(filter, index, positions, num_features_to_query_);
+        mapnik::util::mapped_spatial_index<value_type,
+                                           mapnik::filter_in_box>(index.data(), index.size()).query_first_n(filter, positions, num_features_to_query_);
 
         mapnik::util::file file(filename_);
 
@@ -27,6 +27,7 @@
 #include <mapnik/json/feature_grammar.hpp>
 #include <mapnik/util/utf_conv_win.hpp>
 #include <mapnik/util/spatial_index.hpp>
+#include <mapnik/util/spatial_index_file.hpp>
 #include <mapnik/geometry_is_empty.hpp>
 // stl
 #include <string>
@@ -59,12 +60,9 @@ geojson_index_featureset::geojson_index_featureset(std::string const& filename,
 #else
     if (!file_) throw std::runtime_error("Can't open " + filename);
 #endif
-    std::string indexname = filename + ".index";
-    std::ifstream index(indexname.c_str(), std::ios::binary);
-    if (!index) throw mapnik::datasource_exception("GeoJSON Plugin: can't open index file " + indexname);
-    mapnik::util::spatial_index<value_type,
-                                mapnik::filter_in_box,
-                                std::ifstream>::query(filter, index, positions_);
+    mapnik::util::spatial_index_file index(filename + ".index");
+    mapnik::util::mapped_spatial_index<value_type,
+                                       mapnik::filter_in_box>(index.data(), index.size()).query(filter, positions_);
 
     std::sort(positions_.begin(), positions_.end(),
               [](value_type const& lhs, value_type const& rhs) { return lhs.first < rhs.first;});
@@ -93,7 +91,7 @@ mapnik::feature_ptr geojson_index_featureset::next()
         static const mapnik::json::feature_grammar<char const*, mapnik::feature_impl> grammar(tr);
         using namespace boost::spirit;
         standard::space_type space;
-        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_++));
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_++, arena_));
         if (!qi::phrase_parse(start, end, (grammar)(boost::phoenix::ref(*feature)), space) || start != end)
         {
             throw std::runtime_error("Failed to parse GeoJSON feature");
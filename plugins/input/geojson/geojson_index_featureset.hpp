@@ -26,6 +26,7 @@
 #include "geojson_datasource.hpp"
 #include <mapnik/feature.hpp>
 #include <mapnik/geom_util.hpp>
+#include <mapnik/util/arena.hpp>
 
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
 #pragma GCC diagnostic push
@@ -57,6 +58,7 @@ private:
 #endif
     mapnik::value_integer feature_id_ = 1;
     mapnik::context_ptr ctx_;
+    std::shared_ptr<mapnik::util::arena> arena_;
     std::vector<value_type> positions_;
     std::vector<value_type>::iterator itr_;
 };
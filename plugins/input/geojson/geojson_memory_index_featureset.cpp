@@ -68,7 +68,7 @@ mapnik::feature_ptr geojson_memory_index_featureset::next()
         static const mapnik::json::feature_grammar<chr_iterator_type,mapnik::feature_impl> grammar(tr);
         using namespace boost::spirit;
         standard::space_type space;
-        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_++));
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_++, arena_));
         if (!qi::phrase_parse(start, end, (grammar)(boost::phoenix::ref(*feature)), space) || start != end)
         {
             throw std::runtime_error("Failed to parse geojson feature");
@@ -24,6 +24,7 @@
 #define GEOJSON_MEMORY_INDEX_FEATURESET_HPP
 
 #include <mapnik/feature.hpp>
+#include <mapnik/util/arena.hpp>
 #include "geojson_datasource.hpp"
 
 #include <deque>
@@ -47,6 +48,7 @@ private:
     array_type::const_iterator index_itr_;
     array_type::const_iterator index_end_;
     mapnik::context_ptr ctx_;
+    std::shared_ptr<mapnik::util::arena> arena_;
 };
 
 #endif // GEOJSON_MEMORY_INDEX_FEATURESET_HPP
@@ -29,6 +29,7 @@
 // mapnik
 #include <mapnik/debug.hpp>
 #include <mapnik/boolean.hpp>
+#include <mapnik/filter_pushdown.hpp>
 #include <mapnik/geom_util.hpp>
 #include <mapnik/timer.hpp>
 #include <mapnik/util/utf_conv_win.hpp>
@@ -75,7 +76,8 @@ ogr_datasource::ogr_datasource(parameters const& params)
       extent_(),
       type_(datasource::Vector),
       desc_(ogr_datasource::name(), *params.get<std::string>("encoding", "utf-8")),
-      indexed_(false)
+      indexed_(false),
+      filter_pushdown_(*params.get<mapnik::boolean_type>("filter_pushdown", true))
 {
     init(params);
 }
@@ -518,6 +520,27 @@ void validate_attribute_names(query const& q, std::vector<attribute_descriptor>
     }
 }
 
+void ogr_datasource::set_attribute_filter(OGRLayer & layer, query const& q) const
+{
+    std::string filter_sql;
+    // the index featureset reads features by position, which an
+    // attribute filter would shift
+    if (filter_pushdown_ && !indexed_ && q.get_filter())
+    {
+        filter_sql = mapnik::sql_utils::filter_to_sql(*q.get_filter(), desc_, q.variables(),
+                                                      mapnik::sql_utils::sql_dialect::ogr);
+    }
+    if (filter_sql.empty())
+    {
+        layer.SetAttributeFilter(nullptr);
+    }
+    else if (layer.SetAttributeFilter(filter_sql.c_str()) != OGRERR_NONE)
+    {
+        MAPNIK_LOG_WARN(ogr) << "ogr_datasource: could not set attribute filter '" << filter_sql << "'";
+        layer.SetAttributeFilter(nullptr);
+    }
+}
+
 featureset_ptr ogr_datasource::features(query const& q) const
 {
 #ifdef MAPNIK_STATS
@@ -540,6 +563,7 @@ featureset_ptr ogr_datasource::features(query const& q) const
         validate_attribute_names(q, desc_ar);
 
         OGRLayer* layer = layer_.layer();
+        set_attribute_filter(*layer, q);
 
         if (indexed_)
         {
@@ -581,6 +605,7 @@ featureset_ptr ogr_datasource::features_at_point(coord2d const& pt, double tol)
         }
 
         OGRLayer* layer = layer_.layer();
+        layer->SetAttributeFilter(nullptr);
 
         if (indexed_)
         {
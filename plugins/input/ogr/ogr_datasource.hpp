@@ -61,6 +61,7 @@ public:
 
 private:
     void init(mapnik::parameters const& params);
+    void set_attribute_filter(OGRLayer & layer, mapnik::query const& q) const;
     mapnik::box2d<double> extent_;
     mapnik::datasource::datasource_t type_;
     std::string dataset_name_;
@@ -70,6 +71,7 @@ private:
     std::string layer_name_;
     mapnik::layer_descriptor desc_;
     bool indexed_;
+    bool filter_pushdown_;
 };
 
 #endif // OGR_DATASOURCE_HPP
@@ -185,6 +185,42 @@ public:
         return result;
     }
 
+    // sends sql for binary results delivered one row per PGresult
+    // (libpq single row mode), see StreamingResultSet
+    bool executeStreamingQuery(std::string const& sql)
+    {
+        executeAsyncQuery(sql, 1);
+        if (PQsetSingleRowMode(conn_) != 1)
+        {
+            std::string err_msg = "Postgis Plugin: ";
+            err_msg += status();
+            err_msg += "failed to enable single row mode for: '";
+            err_msg += sql;
+            err_msg += "'\n";
+            clearAsyncResult(PQgetResult(conn_));
+            throw mapnik::datasource_exception(err_msg);
+        }
+        return true;
+    }
+
+    // asks the server to abandon the running query; pending results still
+    // have to be read (see discardResults)
+    bool cancel()
+    {
+        if (closed_) return false;
+        PGcancel * cancel = PQgetCancel(conn_);
+        if (!cancel) return false;
+        char errbuf[256];
+        int result = PQcancel(cancel, errbuf, sizeof(errbuf));
+        PQfreeCancel(cancel);
+        return result == 1;
+    }
+
+    void discardResults()
+    {
+        if (!closed_) clearAsyncResult(PQgetResult(conn_));
+    }
+
     PGresult* getResult()
     {
         PGresult *result = PQgetResult(conn_);
@@ -34,9 +34,13 @@
 #include <boost/optional.hpp>
 
 // stl
+#include <map>
 #include <string>
 #include <sstream>
 #include <memory>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
 
 using mapnik::Pool;
 using mapnik::singleton;
@@ -115,25 +119,33 @@ public:
 
     bool registerPool(ConnectionCreator<Connection> const& creator,unsigned initialSize,unsigned maxSize)
     {
-        ContType::const_iterator itr = pools_.find(creator.id());
-
-        if (itr != pools_.end())
-        {
-            itr->second->set_initial_size(initialSize);
-            itr->second->set_max_size(maxSize);
-        }
-        else
         {
-            return pools_.insert(
-                std::make_pair(creator.id(),
-                               std::make_shared<PoolType>(creator,initialSize,maxSize))).second;
+#ifdef MAPNIK_THREADSAFE
+            std::lock_guard<std::mutex> lock(mutex_);
+#endif
+            ContType::const_iterator itr = pools_.find(creator.id());
+            if (itr != pools_.end())
+            {
+                itr->second->set_initial_size(initialSize);
+                itr->second->set_max_size(maxSize);
+                return false;
+            }
         }
-        return false;
-
+        // the pool opens its initial connections, don't hold up
+        // getPool() for other datasources meanwhile
+        std::shared_ptr<PoolType> pool = std::make_shared<PoolType>(creator,initialSize,maxSize);
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        // false if another thread registered the same pool meanwhile
+        return pools_.insert(std::make_pair(creator.id(), pool)).second;
     }
 
     std::shared_ptr<PoolType> getPool(std::string const& key)
     {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
         ContType::const_iterator itr=pools_.find(key);
         if (itr!=pools_.end())
         {
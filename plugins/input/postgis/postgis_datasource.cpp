@@ -24,6 +24,7 @@
 #include "postgis_datasource.hpp"
 #include "postgis_featureset.hpp"
 #include "asyncresultset.hpp"
+#include "streamingresultset.hpp"
 
 
 // mapnik
@@ -31,6 +32,7 @@
 #include <mapnik/global.hpp>
 #include <mapnik/boolean.hpp>
 #include <mapnik/sql_utils.hpp>
+#include <mapnik/filter_pushdown.hpp>
 #include <mapnik/util/conversions.hpp>
 #include <mapnik/timer.hpp>
 #include <mapnik/value_types.hpp>
@@ -67,6 +69,7 @@ postgis_datasource::postgis_datasource(parameters const& params)
       geometry_field_(*params.get<std::string>("geometry_field", "")),
       key_field_(*params.get<std::string>("key_field", "")),
       cursor_fetch_size_(*params.get<mapnik::value_integer>("cursor_size", 0)),
+      streaming_(*params.get<mapnik::boolean_type>("streaming", false)),
       row_limit_(*params.get<mapnik::value_integer>("row_limit", 0)),
       type_(datasource::Vector),
       srid_(*params.get<mapnik::value_integer>("srid", 0)),
@@ -104,7 +107,8 @@ postgis_datasource::postgis_datasource(parameters const& params)
       // params below are for testing purposes only and may be removed at any time
       intersect_min_scale_(*params.get<mapnik::value_integer>("intersect_min_scale", 0)),
       intersect_max_scale_(*params.get<mapnik::value_integer>("intersect_max_scale", 0)),
-      key_field_as_attribute_(*params.get<mapnik::boolean_type>("key_field_as_attribute", true))
+      key_field_as_attribute_(*params.get<mapnik::boolean_type>("key_field_as_attribute", true)),
+      filter_pushdown_(*params.get<mapnik::boolean_type>("filter_pushdown", true))
 {
 #ifdef MAPNIK_STATS
     mapnik::progress_timer __stats__(std::clog, "postgis_datasource::init");
@@ -151,6 +155,12 @@ postgis_datasource::postgis_datasource(parameters const& params)
     CnxPool_ptr pool = ConnectionManager::instance().getPool(creator_.id());
     if (pool)
     {
+        // pools are shared by datasources with the same connection string
+        boost::optional<mapnik::value_integer> wait_timeout = params.get<mapnik::value_integer>("pool_wait_timeout");
+        if (wait_timeout) pool->set_wait_timeout(std::chrono::milliseconds(*wait_timeout));
+        boost::optional<mapnik::value_integer> max_idle = params.get<mapnik::value_integer>("pool_max_idle");
+        if (max_idle) pool->set_max_idle(std::chrono::seconds(*max_idle));
+
         shared_ptr<Connection> conn = pool->borrowObject();
         if (!conn) return;
 
@@ -495,7 +505,7 @@ postgis_datasource::~postgis_datasource()
         if (pool)
         {
             try {
-              shared_ptr<Connection> conn = pool->borrowObject();
+              shared_ptr<Connection> conn = pool->borrowObject(std::chrono::milliseconds(0));
               if (conn)
               {
                   conn->close();
@@ -689,6 +699,11 @@ std::shared_ptr<IResultSet> postgis_datasource::get_resultset(std::shared_ptr<Co
             return std::make_shared<CursorResultSet>(conn, cursor_name, cursor_fetch_size_);
 
         }
+        else if (streaming_)
+        {
+            // rows decoded while later ones are still arriving
+            return std::make_shared<StreamingResultSet>(conn, sql);
+        }
         else
         {
             // no cursor
@@ -770,7 +785,8 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
             std::shared_ptr<postgis_processor_context> pgis_ctxt = std::static_pointer_cast<postgis_processor_context>(proc_ctx);
             if ( pgis_ctxt->num_async_requests_ < max_async_connections_ )
             {
-                conn = pool->borrowObject();
+                // never wait: requests without a connection are queued
+                conn = pool->borrowObject(std::chrono::milliseconds(0));
                 pgis_ctxt->num_async_requests_++;
             }
         }
@@ -929,7 +945,22 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
 
         std::string table_with_bbox = populate_tokens(table_, scale_denom, box, px_gw, px_gh, q.variables());
 
-        s << " FROM " << table_with_bbox;
+        std::string filter_sql;
+        if (filter_pushdown_ && q.get_filter())
+        {
+            filter_sql = mapnik::sql_utils::filter_to_sql(*q.get_filter(), desc_, q.variables(),
+                                                          mapnik::sql_utils::sql_dialect::postgresql);
+        }
+
+        if (filter_sql.empty())
+        {
+            s << " FROM " << table_with_bbox;
+        }
+        else
+        {
+            // rows no rule draws are left in the database
+            s << " FROM (SELECT * FROM " << table_with_bbox << ") AS mapnik_filtered WHERE " << filter_sql;
+        }
 
         if (row_limit_ > 0)
         {
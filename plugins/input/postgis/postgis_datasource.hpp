@@ -100,6 +100,7 @@ private:
     const std::string geometry_field_;
     std::string key_field_;
     mapnik::value_integer cursor_fetch_size_;
+    bool streaming_;
     mapnik::value_integer row_limit_;
     std::string geometryColumn_;
     mapnik::datasource::datasource_t type_;
@@ -130,6 +131,7 @@ private:
     int intersect_min_scale_;
     int intersect_max_scale_;
     bool key_field_as_attribute_;
+    bool filter_pushdown_;
 };
 
 #endif // POSTGIS_DATASOURCE_HPP
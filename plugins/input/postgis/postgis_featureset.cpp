@@ -58,10 +58,32 @@ postgis_featureset::postgis_featureset(std::shared_ptr<IResultSet> const& rs,
       feature_id_(1),
       key_field_(key_field),
       key_field_as_attribute_(key_field_as_attribute),
-      twkb_encoding_(twkb_encoding)
+      twkb_encoding_(twkb_encoding),
+      columns_(),
+      columns_resolved_(false)
 {
 }
 
+void postgis_featureset::resolve_columns(unsigned first, unsigned last)
+{
+    // names and types are the same for every row, so look up the context
+    // index of each column once instead of per row
+    columns_.reserve(last - first);
+    for (unsigned pos = first; pos < last; ++pos)
+    {
+        attribute_column column;
+        column.pos = pos;
+        column.oid = rs_->getTypeOID(pos);
+        std::string name = rs_->getFieldName(pos);
+        if (!ctx_->find(name, column.index))
+        {
+            throw mapnik::datasource_exception("Postgis Plugin: unexpected column '" + name + "' in result");
+        }
+        columns_.push_back(column);
+    }
+    columns_resolved_ = true;
+}
+
 feature_ptr postgis_featureset::next()
 {
     while (rs_->next())
@@ -100,7 +122,7 @@ feature_ptr postgis_featureset::next()
                 val = int4net(buf);
             }
 
-            feature = feature_factory::create(ctx_, val);
+            feature = feature_factory::create(ctx_, val, arena_);
             if (key_field_as_attribute_)
             {
                 feature->put<mapnik::value_integer>(name,val);
@@ -110,7 +132,7 @@ feature_ptr postgis_featureset::next()
         else
         {
             // fallback to auto-incrementing id
-            feature = feature_factory::create(ctx_, feature_id_);
+            feature = feature_factory::create(ctx_, feature_id_, arena_);
             ++feature_id_;
         }
 
@@ -135,44 +157,45 @@ feature_ptr postgis_featureset::next()
         }
 
         totalGeomSize_ += size;
-        unsigned num_attrs = ctx_->size() + 1;
-        if (!key_field_as_attribute_)
+        if (!columns_resolved_)
         {
-            num_attrs++;
+            unsigned num_attrs = ctx_->size() + 1;
+            if (!key_field_as_attribute_)
+            {
+                num_attrs++;
+            }
+            resolve_columns(pos, num_attrs);
         }
-        for (; pos < num_attrs; ++pos)
+        for (attribute_column const& column : columns_)
         {
-            std::string name = rs_->getFieldName(pos);
-
             // NOTE: we intentionally do not store null here
             // since it is equivalent to the attribute not existing
-            if (!rs_->isNull(pos))
+            if (!rs_->isNull(column.pos))
             {
-                const char* buf = rs_->getValue(pos);
-                const int oid = rs_->getTypeOID(pos);
-                switch (oid)
+                const char* buf = rs_->getValue(column.pos);
+                switch (column.oid)
                 {
                     case 16: //bool
                     {
-                        feature->put(name, (buf[0] != 0));
+                        feature->put_at(column.index, (buf[0] != 0));
                         break;
                     }
 
                     case 23: //int4
                     {
-                        feature->put<mapnik::value_integer>(name, int4net(buf));
+                        feature->put_at<mapnik::value_integer>(column.index, int4net(buf));
                         break;
                     }
 
                     case 21: //int2
                     {
-                        feature->put<mapnik::value_integer>(name, int2net(buf));
+                        feature->put_at<mapnik::value_integer>(column.index, int2net(buf));
                         break;
                     }
 
                     case 20: //int8/BigInt
                     {
-                        feature->put<mapnik::value_integer>(name, int8net(buf));
+                        feature->put_at<mapnik::value_integer>(column.index, int8net(buf));
                         break;
                     }
 
@@ -180,7 +203,7 @@ feature_ptr postgis_featureset::next()
                     {
                         float val;
                         float4net(val, buf);
-                        feature->put(name, static_cast<double>(val));
+                        feature->put_at(column.index, static_cast<double>(val));
                         break;
                     }
 
@@ -188,7 +211,7 @@ feature_ptr postgis_featureset::next()
                     {
                         double val;
                         float8net(val, buf);
-                        feature->put(name, val);
+                        feature->put_at(column.index, val);
                         break;
                     }
 
@@ -196,14 +219,14 @@ feature_ptr postgis_featureset::next()
                     case 1043: //varchar
                     case 705:  //literal
                     {
-                        feature->put(name, tr_->transcode(buf));
+                        feature->put_at(column.index, tr_->transcode(buf));
                         break;
                     }
 
                     case 1042: //bpchar
                     {
                         std::string str = mapnik::util::trim_copy(buf);
-                        feature->put(name, tr_->transcode(str.c_str()));
+                        feature->put_at(column.index, tr_->transcode(str.c_str()));
                         break;
                     }
 
@@ -213,14 +236,14 @@ feature_ptr postgis_featureset::next()
                         std::string str = numeric2string(buf);
                         if (mapnik::util::string2double(str, val))
                         {
-                            feature->put(name, val);
+                            feature->put_at(column.index, val);
                         }
                         break;
                     }
 
                     default:
                     {
-                        MAPNIK_LOG_WARN(postgis) << "postgis_featureset: Unknown type_oid=" << oid;
+                        MAPNIK_LOG_WARN(postgis) << "postgis_featureset: Unknown type_oid=" << column.oid;
 
                         break;
                     }
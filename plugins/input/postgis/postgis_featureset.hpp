@@ -28,6 +28,10 @@
 #include <mapnik/datasource.hpp>
 #include <mapnik/feature.hpp>
 #include <mapnik/unicode.hpp>
+#include <mapnik/util/arena.hpp>
+
+// stl
+#include <vector>
 
 using mapnik::Featureset;
 using mapnik::box2d;
@@ -50,14 +54,27 @@ public:
     ~postgis_featureset();
 
 private:
+    // attribute column of the result set and its slot in ctx_
+    struct attribute_column
+    {
+        int pos;
+        int oid;
+        std::size_t index;
+    };
+
+    void resolve_columns(unsigned first, unsigned last);
+
     std::shared_ptr<IResultSet> rs_;
     context_ptr ctx_;
+    std::shared_ptr<mapnik::util::arena> arena_;
     const std::unique_ptr<mapnik::transcoder> tr_;
     unsigned totalGeomSize_;
     mapnik::value_integer feature_id_;
     bool key_field_;
     bool key_field_as_attribute_;
     bool twkb_encoding_;
+    std::vector<attribute_column> columns_;
+    bool columns_resolved_;
 };
 
 #endif // POSTGIS_FEATURESET_HPP
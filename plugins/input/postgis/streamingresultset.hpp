@@ -0,0 +1,182 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef POSTGIS_STREAMINGRESULTSET_HPP
+#define POSTGIS_STREAMINGRESULTSET_HPP
+
+#include <mapnik/debug.hpp>
+#include <mapnik/datasource.hpp>
+
+#include "connection.hpp"
+#include "resultset.hpp"
+
+// Binary results read row by row in libpq single row mode: the first
+// feature is available as soon as its row arrives and later rows keep
+// streaming in while earlier ones are decoded and rendered.
+class StreamingResultSet : public IResultSet, private mapnik::util::noncopyable
+{
+public:
+    StreamingResultSet(std::shared_ptr<Connection> const& conn, std::string const& sql)
+        : conn_(conn),
+          res_(0),
+          done_(false),
+          is_closed_(false)
+    {
+        conn_->executeStreamingQuery(sql);
+    }
+
+    virtual ~StreamingResultSet()
+    {
+        close();
+    }
+
+    virtual void close()
+    {
+        if (!is_closed_)
+        {
+            clear_row();
+            if (!done_)
+            {
+                // closed before all rows were read: stop the query and
+                // discard what is still in flight so the connection can be reused
+                MAPNIK_LOG_DEBUG(postgis) << "postgis_streaming_resultset: cancelling query - " << conn_.get();
+                if (conn_->cancel())
+                {
+                    conn_->discardResults();
+                }
+                else
+                {
+                    conn_->close();
+                }
+                done_ = true;
+            }
+            is_closed_ = true;
+            conn_.reset();
+        }
+    }
+
+    virtual int getNumFields() const
+    {
+        return PQnfields(res_);
+    }
+
+    virtual bool next()
+    {
+        if (done_) return false;
+        clear_row();
+        PGresult * result = conn_->getResult();
+        ExecStatusType status = result ? PQresultStatus(result) : PGRES_FATAL_ERROR;
+        if (status == PGRES_SINGLE_TUPLE)
+        {
+            res_ = result;
+            return true;
+        }
+        // PGRES_TUPLES_OK with no rows terminates the result set
+        std::string err_msg;
+        if (status != PGRES_TUPLES_OK)
+        {
+            err_msg = "Postgis Plugin: ";
+            err_msg += conn_->status();
+            err_msg += "in StreamingResultSet::next";
+        }
+        if (result) PQclear(result);
+        conn_->discardResults();
+        done_ = true;
+        if (!err_msg.empty())
+        {
+            throw mapnik::datasource_exception(err_msg);
+        }
+        return false;
+    }
+
+    virtual const char* getFieldName(int index) const
+    {
+        return PQfname(res_, index);
+    }
+
+    virtual int getFieldLength(int index) const
+    {
+        return PQgetlength(res_, 0, index);
+    }
+
+    virtual int getFieldLength(const char* name) const
+    {
+        int col = PQfnumber(res_, name);
+        if (col >= 0)
+        {
+            return PQgetlength(res_, 0, col);
+        }
+        return 0;
+    }
+
+    virtual int getTypeOID(int index) const
+    {
+        return PQftype(res_, index);
+    }
+
+    virtual int getTypeOID(const char* name) const
+    {
+        int col = PQfnumber(res_, name);
+        if (col >= 0)
+        {
+            return PQftype(res_, col);
+        }
+        return 0;
+    }
+
+    virtual bool isNull(int index) const
+    {
+        return static_cast<bool>(PQgetisnull(res_, 0, index));
+    }
+
+    virtual const char* getValue(int index) const
+    {
+        return PQgetvalue(res_, 0, index);
+    }
+
+    virtual const char* getValue(const char* name) const
+    {
+        int col = PQfnumber(res_, name);
+        if (col >= 0)
+        {
+            return getValue(col);
+        }
+        return 0;
+    }
+
+private:
+    void clear_row()
+    {
+        if (res_)
+        {
+            PQclear(res_);
+            res_ = 0;
+        }
+    }
+
+    std::shared_ptr<Connection> conn_;
+    PGresult * res_;
+    bool done_;
+    bool is_closed_;
+};
+
+#endif // POSTGIS_STREAMINGRESULTSET_HPP
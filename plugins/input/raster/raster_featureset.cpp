@@ -28,6 +28,8 @@
 #include <mapnik/image_reader.hpp>
 #include <mapnik/image_util.hpp>
 #include <mapnik/feature_factory.hpp>
+#include <mapnik/raster_block_cache.hpp>
+#include <mapnik/util/fs.hpp>
 #include <mapnik/util/variant.hpp>
 
 #pragma GCC diagnostic push
@@ -36,6 +38,13 @@
 #include <boost/format.hpp>
 #pragma GCC diagnostic pop
 
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
 #include "raster_featureset.hpp"
 
 using mapnik::query;
@@ -45,6 +54,113 @@ using mapnik::image_rgba8;
 using mapnik::raster;
 using mapnik::feature_factory;
 
+namespace {
+
+struct raster_block
+{
+    mapnik::raster_block_ptr data;
+    int x; // origin of the block in image pixels
+    int y;
+};
+
+// Copies the parts of `blocks` overlapping the requested window into a new image
+struct assemble_blocks_visitor
+{
+    assemble_blocks_visitor(std::vector<raster_block> const& blocks,
+                            int x_off, int y_off, int width, int height)
+        : blocks_(blocks),
+          x_off_(x_off),
+          y_off_(y_off),
+          width_(width),
+          height_(height) {}
+
+    mapnik::image_any operator() (mapnik::image_null const&) const
+    {
+        return mapnik::image_any();
+    }
+
+    template <typename T>
+    mapnik::image_any operator() (T const& first) const
+    {
+        T image(width_, height_, true, first.get_premultiplied());
+        image.set_offset(first.get_offset());
+        image.set_scaling(first.get_scaling());
+        for (raster_block const& block : blocks_)
+        {
+            if (!block.data->template is<T>())
+            {
+                throw std::runtime_error("blocks of one raster differ in pixel type");
+            }
+            T const& data = mapnik::util::get<T>(*block.data);
+            int x0 = std::max(x_off_, block.x);
+            int y0 = std::max(y_off_, block.y);
+            int x1 = std::min(x_off_ + width_, block.x + static_cast<int>(data.width()));
+            int y1 = std::min(y_off_ + height_, block.y + static_cast<int>(data.height()));
+            for (int y = y0; y < y1; ++y)
+            {
+                auto const* row = data.get_row(y - block.y);
+                std::copy(row + (x0 - block.x), row + (x1 - block.x),
+                          image.get_row(y - y_off_) + (x0 - x_off_));
+            }
+        }
+        return mapnik::image_any(std::move(image));
+    }
+
+    std::vector<raster_block> const& blocks_;
+    int x_off_;
+    int y_off_;
+    int width_;
+    int height_;
+};
+
+// Reads a window of `file` block by block, taking decoded blocks from the
+// shared raster_block_cache and decoding (and caching) only missing ones.
+mapnik::image_any read_blocks(image_reader & reader, std::string const& file, unsigned block_size,
+                              int x_off, int y_off, int width, int height)
+{
+    mapnik::raster_block_cache & cache = mapnik::raster_block_cache::instance();
+    std::time_t const mtime = mapnik::util::last_write_time(file);
+    std::uintmax_t const file_size = mapnik::util::file_size(file);
+    int const size = static_cast<int>(block_size);
+    int const image_width = static_cast<int>(reader.width());
+    int const image_height = static_cast<int>(reader.height());
+    std::vector<raster_block> blocks;
+    for (int by = y_off / size; by * size < y_off + height; ++by)
+    {
+        for (int bx = x_off / size; bx * size < x_off + width; ++bx)
+        {
+            mapnik::raster_block_key key;
+            key.file = file;
+            key.mtime = mtime;
+            key.file_size = file_size;
+            key.band = 0;
+            key.overview = 0;
+            key.block_size = block_size;
+            key.block_x = bx;
+            key.block_y = by;
+            raster_block block;
+            block.x = bx * size;
+            block.y = by * size;
+            block.data = cache.find(key);
+            if (!block.data)
+            {
+                int block_width = std::min(size, image_width - block.x);
+                int block_height = std::min(size, image_height - block.y);
+                if (block_width <= 0 || block_height <= 0) continue;
+                block.data = std::make_shared<mapnik::image_any const>(
+                    reader.read(block.x, block.y, block_width, block_height));
+                cache.insert(key, block.data);
+            }
+            blocks.push_back(block);
+        }
+    }
+    if (blocks.empty()) return mapnik::image_any();
+    return mapnik::util::apply_visitor(assemble_blocks_visitor(blocks, x_off, y_off, width, height),
+                                       *blocks.front().data);
+}
+
+}
+
 template <typename LookupPolicy>
 raster_featureset<LookupPolicy>::raster_featureset(LookupPolicy const& policy,
                                                    box2d<double> const& extent,
@@ -112,7 +228,9 @@ feature_ptr raster_featureset<LookupPolicy>::next()
                                                             rem.maxx() + x_off + width,
                                                             rem.maxy() + y_off + height);
                         intersect = t.backward(feature_raster_extent);
-                        mapnik::image_any data = reader->read(x_off, y_off, width, height);
+                        mapnik::image_any data = policy_.block_size() > 0
+                            ? read_blocks(*reader, curIter_->file(), policy_.block_size(), x_off, y_off, width, height)
+                            : reader->read(x_off, y_off, width, height);
                         mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(intersect, std::move(data), 1.0);
                         feature->set_raster(raster);
                     }
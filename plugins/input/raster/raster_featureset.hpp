@@ -115,6 +115,12 @@ public:
     {
         return box2d<double>(0, 0, 0, 0);
     }
+
+    // reads of a single file vary with every query, they bypass the block cache
+    inline unsigned block_size() const
+    {
+        return 0;
+    }
 };
 
 class tiled_file_policy
@@ -130,6 +136,7 @@ public:
                       box2d<double> const& bbox,
                       unsigned width,
                       unsigned height)
+        : tile_size_(tile_size)
     {
         double lox = extent.minx();
         double loy = extent.miny();
@@ -190,8 +197,14 @@ public:
         return box2d<double>(0, 0, 0, 0);
     }
 
+    inline unsigned block_size() const
+    {
+        return tile_size_;
+    }
+
 private:
 
+    unsigned tile_size_;
     std::vector<raster_info> infos_;
 };
 
@@ -293,6 +306,12 @@ public:
         return rem;
     }
 
+    // every file is a single tile
+    inline unsigned block_size() const
+    {
+        return tile_size_;
+    }
+
 private:
 
     std::string interpolate(std::string const& pattern, int x, int y) const;
@@ -137,14 +137,12 @@ const field_descriptor& dbf_file::descriptor(int col) const
 }
 
 
-void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, mapnik::feature_impl & f) const throw()
+void dbf_file::add_attribute(int col, std::size_t index, mapnik::transcoder const& tr, mapnik::feature_impl & f) const throw()
 {
     using namespace boost::spirit;
 
     if (col>=0 && col<num_fields_)
     {
-        std::string const& name=fields_[col].name_;
-
         // NOTE: ensure types handled here are matched in shape_datasource.cpp
         switch (fields_[col].type_)
         {
@@ -154,7 +152,7 @@ void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, mapnik::feat
             // FIXME - avoid constructing std::string on stack
             std::string str(record_+fields_[col].offset_,fields_[col].length_);
             mapnik::util::trim(str);
-            f.put(name,tr.transcode(str.c_str()));
+            f.put_at(index, tr.transcode(str.c_str()));
             break;
         }
         case 'L':
@@ -162,12 +160,12 @@ void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, mapnik::feat
             char ch = record_[fields_[col].offset_];
             if ( ch == '1' || ch == 't' || ch == 'T' || ch == 'y' || ch == 'Y')
             {
-                f.put(name,true);
+                f.put_at(index, true);
             }
             else
             {
                 // NOTE: null logical fields use '?'
-                f.put(name,false);
+                f.put_at(index, false);
             }
             break;
         }
@@ -191,7 +189,7 @@ void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, mapnik::feat
                 static qi::double_type double_;
                 if (qi::phrase_parse(itr,end,double_,space,val))
                 {
-                    f.put(name,val);
+                    f.put_at(index, val);
                 }
             }
             else
@@ -203,7 +201,7 @@ void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, mapnik::feat
                 static qi::int_parser<mapnik::value_integer,10,1,-1> numeric_parser;
                 if (qi::phrase_parse(itr, end, numeric_parser, space, val))
                 {
-                    f.put(name,val);
+                    f.put_at(index, val);
                 }
             }
             break;
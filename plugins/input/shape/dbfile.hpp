@@ -77,7 +77,8 @@ public:
     field_descriptor const& descriptor(int col) const;
     void move_to(int index);
     std::string string_value(int col) const;
-    void add_attribute(int col, mapnik::transcoder const& tr, mapnik::feature_impl & f) const throw();
+    // stores field `col` of the current record as attribute `index` of the feature context
+    void add_attribute(int col, std::size_t index, mapnik::transcoder const& tr, mapnik::feature_impl & f) const throw();
 private:
     void read_header();
     int read_short();
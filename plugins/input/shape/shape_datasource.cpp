@@ -246,7 +246,8 @@ featureset_ptr shape_datasource::features(query const& q) const
                                                        q.property_names(),
                                                        desc_.get_encoding(),
                                                        shape_name_,
-                                                       row_limit_));
+                                                       row_limit_,
+                                                       mapnik::attribute_filter(q)));
     }
     else
     {
@@ -254,7 +255,8 @@ featureset_ptr shape_datasource::features(query const& q) const
                                                                   shape_name_,
                                                                   q.property_names(),
                                                                   desc_.get_encoding(),
-                                                                  row_limit_);
+                                                                  row_limit_,
+                                                                  mapnik::attribute_filter(q));
     }
 }
 
@@ -41,8 +41,10 @@ shape_featureset<filterT>::shape_featureset(filterT const& filter,
                                             std::string const& shape_name,
                                             std::set<std::string> const& attribute_names,
                                             std::string const& encoding,
-                                            int row_limit)
+                                            int row_limit,
+                                            mapnik::attribute_filter const& attribute_filter)
     : filter_(filter),
+      attribute_filter_(attribute_filter),
       shape_(shape_name, false),
       query_ext_(),
       feature_bbox_(),
@@ -63,6 +65,37 @@ shape_featureset<filterT>::shape_featureset(filterT const& filter,
     setup_attributes(ctx_, attribute_names, shape_name, shape_, attr_ids_);
 }
 
+template <typename filterT>
+void shape_featureset<filterT>::read_attributes(mapnik::feature_impl & feature)
+{
+    if (attr_ids_.size())
+    {
+        shape_.dbf().move_to(shape_.id_);
+        try
+        {
+            std::size_t index = 0; // attributes were pushed to ctx_ in attr_ids_ order
+            for (auto id : attr_ids_)
+            {
+                shape_.dbf().add_attribute(id, index++, *tr_, feature); //TODO optimize!!!
+            }
+        }
+        catch (...)
+        {
+            MAPNIK_LOG_ERROR(shape) << "Shape Plugin: error processing attributes";
+        }
+    }
+}
+
+// reads the attributes ahead of the geometry when the query filter can
+// reject the record on them
+template <typename filterT>
+bool shape_featureset<filterT>::rejected(mapnik::feature_impl & feature)
+{
+    if (!attribute_filter_.active()) return false;
+    read_attributes(feature);
+    return !attribute_filter_.pass(feature);
+}
+
 template <typename filterT>
 feature_ptr shape_featureset<filterT>::next()
 {
@@ -86,76 +119,69 @@ feature_ptr shape_featureset<filterT>::next()
         // skip null shapes
         if (type == shape_io::shape_null) continue;
 
-        feature_ptr feature(feature_factory::create(ctx_, feature_id));
+        // reject on the bounding box before allocating anything
+        double x = 0, y = 0;
         switch (type)
         {
         case shape_io::shape_point:
         case shape_io::shape_pointm:
         case shape_io::shape_pointz:
+            x = record.read_double();
+            y = record.read_double();
+            if (!filter_.pass(mapnik::box2d<double>(x,y,x,y))) continue;
+            break;
+        case shape_io::shape_multipoint:
+        case shape_io::shape_multipointm:
+        case shape_io::shape_multipointz:
+        case shape_io::shape_polyline:
+        case shape_io::shape_polylinem:
+        case shape_io::shape_polylinez:
+        case shape_io::shape_polygon:
+        case shape_io::shape_polygonm:
+        case shape_io::shape_polygonz:
+            shape_io::read_bbox(record, feature_bbox_);
+            if (!filter_.pass(feature_bbox_)) continue;
+            break;
+        default :
+            MAPNIK_LOG_DEBUG(shape) << "shape_featureset: Unsupported type" << type;
+            return feature_ptr();
+        }
+
+        feature_ptr feature(feature_factory::create(ctx_, feature_id, arena_));
+        if (rejected(*feature)) continue;
+        switch (type)
         {
-            double x = record.read_double();
-            double y = record.read_double();
-            if (!filter_.pass(mapnik::box2d<double>(x,y,x,y)))
-                continue;
+        case shape_io::shape_point:
+        case shape_io::shape_pointm:
+        case shape_io::shape_pointz:
             feature->set_geometry(mapnik::geometry::point<double>(x,y));
             break;
-        }
         case shape_io::shape_multipoint:
         case shape_io::shape_multipointm:
         case shape_io::shape_multipointz:
         {
-            shape_io::read_bbox(record, feature_bbox_);
-            if (!filter_.pass(feature_bbox_)) continue;
             int num_points = record.read_ndr_integer();
             mapnik::geometry::multi_point<double> multi_point;
             for (int i = 0; i < num_points; ++i)
             {
-                double x = record.read_double();
-                double y = record.read_double();
-                multi_point.emplace_back(mapnik::geometry::point<double>(x, y));
+                double px = record.read_double();
+                double py = record.read_double();
+                multi_point.emplace_back(mapnik::geometry::point<double>(px, py));
             }
             feature->set_geometry(std::move(multi_point));
             break;
         }
-
         case shape_io::shape_polyline:
         case shape_io::shape_polylinem:
         case shape_io::shape_polylinez:
-        {
-            shape_io::read_bbox(record, feature_bbox_);
-            if (!filter_.pass(feature_bbox_)) continue;
             feature->set_geometry(shape_io::read_polyline(record));
             break;
-        }
-        case shape_io::shape_polygon:
-        case shape_io::shape_polygonm:
-        case shape_io::shape_polygonz:
-        {
-            shape_io::read_bbox(record, feature_bbox_);
-            if (!filter_.pass(feature_bbox_)) continue;
+        default: // polygons, other types were rejected above
             feature->set_geometry(shape_io::read_polygon(record));
             break;
         }
-        default :
-            MAPNIK_LOG_DEBUG(shape) << "shape_featureset: Unsupported type" << type;
-            return feature_ptr();
-        }
 
-        if (attr_ids_.size())
-        {
-            shape_.dbf().move_to(shape_.id_);
-            try
-            {
-                for (auto id : attr_ids_)
-                {
-                    shape_.dbf().add_attribute(id, *tr_, *feature); //TODO optimize!!!
-                }
-            }
-            catch (...)
-            {
-                MAPNIK_LOG_ERROR(shape) << "Shape Plugin: error processing attributes";
-            }
-        }
+        if (!attribute_filter_.active()) read_attributes(*feature);
         ++count_;
         return feature;
     }
@@ -27,6 +27,8 @@
 #include <mapnik/datasource.hpp>
 #include <mapnik/geom_util.hpp>
 #include <mapnik/feature.hpp>
+#include <mapnik/filter_pushdown.hpp>
+#include <mapnik/util/arena.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/value_types.hpp>
 
@@ -50,12 +52,17 @@ public:
                      std::string const& shape_file,
                      std::set<std::string> const& attribute_names,
                      std::string const& encoding,
-                     int row_limit);
+                     int row_limit,
+                     mapnik::attribute_filter const& attribute_filter = mapnik::attribute_filter());
     virtual ~shape_featureset();
     feature_ptr next();
 
 private:
+    void read_attributes(mapnik::feature_impl & feature);
+    bool rejected(mapnik::feature_impl & feature);
+
     filterT filter_;
+    mapnik::attribute_filter attribute_filter_;
     shape_io shape_;
     box2d<double> query_ext_;
     mutable box2d<double> feature_bbox_;
@@ -65,6 +72,7 @@ private:
     mapnik::value_integer row_limit_;
     mutable int count_;
     context_ptr ctx_;
+    std::shared_ptr<mapnik::util::arena> arena_;
 };
 
 #endif //SHAPE_FEATURESET_HPP
@@ -47,8 +47,10 @@ shape_index_featureset<filterT>::shape_index_featureset(filterT const& filter,
                                                         std::set<std::string> const& attribute_names,
                                                         std::string const& encoding,
                                                         std::string const& shape_name,
-                                                        int row_limit)
+                                                        int row_limit,
+                                                        mapnik::attribute_filter const& attribute_filter)
     : filter_(filter),
+      attribute_filter_(attribute_filter),
       ctx_(std::make_shared<mapnik::context_type>()),
       shape_ptr_(std::move(shape_ptr)),
       tr_(new mapnik::transcoder(encoding)),
@@ -66,9 +68,25 @@ shape_index_featureset<filterT>::shape_index_featureset(filterT const& filter,
     if (index)
     {
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
-        mapnik::util::spatial_index<mapnik::detail::node, filterT,boost::interprocess::ibufferstream>::query(filter, index->file(), offsets_);
+        // read index in place from mapped memory
+        auto buffer = index->file().buffer();
+        mapnik::util::mapped_spatial_index<mapnik::detail::node, filterT>(buffer.first, buffer.second).query(filter, offsets_);
 #else
-        mapnik::util::spatial_index<mapnik::detail::node, filterT, std::ifstream>::query(filter, index->file(), offsets_);
+        if (mapnik::util::spatial_index_version(index->file()) == 1)
+        {
+            index->file().seekg(0, std::ios::beg);
+            mapnik::util::spatial_index<mapnik::detail::node, filterT, std::ifstream>::query(filter, index->file(), offsets_);
+        }
+        else
+        {
+            // aligned index versions are only read in place
+            index->file().clear();
+            index->file().seekg(0, std::ios::end);
+            std::vector<char> buffer(static_cast<std::size_t>(index->file().tellg()));
+            index->file().seekg(0, std::ios::beg);
+            index->file().read(buffer.data(), buffer.size());
+            mapnik::util::mapped_spatial_index<mapnik::detail::node, filterT>(buffer.data(), buffer.size()).query(filter, offsets_);
+        }
 #endif
     }
     std::sort(offsets_.begin(), offsets_.end(), [](mapnik::detail::node const& n0, mapnik::detail::node const& n1)
@@ -77,6 +95,37 @@ shape_index_featureset<filterT>::shape_index_featureset(filterT const& filter,
     itr_ = offsets_.begin();
 }
 
+template <typename filterT>
+void shape_index_featureset<filterT>::read_attributes(mapnik::feature_impl & feature)
+{
+    if (attr_ids_.size())
+    {
+        shape_ptr_->dbf().move_to(shape_ptr_->id_);
+        try
+        {
+            std::size_t index = 0; // attributes were pushed to ctx_ in attr_ids_ order
+            for (auto id : attr_ids_)
+            {
+                shape_ptr_->dbf().add_attribute(id, index++, *tr_, feature);
+            }
+        }
+        catch (...)
+        {
+            MAPNIK_LOG_ERROR(shape) << "Shape Plugin: error processing attributes";
+        }
+    }
+}
+
+// reads the attributes ahead of the geometry when the query filter can
+// reject the record on them
+template <typename filterT>
+bool shape_index_featureset<filterT>::rejected(mapnik::feature_impl & feature)
+{
+    if (!attribute_filter_.active()) return false;
+    read_attributes(feature);
+    return !attribute_filter_.pass(feature);
+}
+
 template <typename filterT>
 feature_ptr shape_index_featureset<filterT>::next()
 {
@@ -99,7 +148,7 @@ feature_ptr shape_index_featureset<filterT>::next()
         shape_file::record_type record(shape_ptr_->reclength_ * 2);
         shape_ptr_->shp().read_record(record);
         int type = record.read_ndr_integer();
-        feature_ptr feature(feature_factory::create(ctx_, feature_id));
+        feature_ptr feature(feature_factory::create(ctx_, feature_id, arena_));
 
         switch (type)
         {
@@ -109,6 +158,7 @@ feature_ptr shape_index_featureset<filterT>::next()
         {
             double x = record.read_double();
             double y = record.read_double();
+            if (rejected(*feature)) continue;
             feature->set_geometry(mapnik::geometry::point<double>(x,y));
             break;
         }
@@ -117,7 +167,7 @@ feature_ptr shape_index_featureset<filterT>::next()
         case shape_io::shape_multipointz:
         {
             shape_io::read_bbox(record, feature_bbox_);
-            if (!filter_.pass(feature_bbox_)) continue;
+            if (!filter_.pass(feature_bbox_) || rejected(*feature)) continue;
             int num_points = record.read_ndr_integer();
             mapnik::geometry::multi_point<double> multi_point;
             for (int i = 0; i < num_points; ++i)
@@ -134,7 +184,7 @@ feature_ptr shape_index_featureset<filterT>::next()
         case shape_io::shape_polylinez:
         {
             shape_io::read_bbox(record, feature_bbox_);
-            if (!filter_.pass(feature_bbox_)) continue;
+            if (!filter_.pass(feature_bbox_) || rejected(*feature)) continue;
             if (parts.size() < 2) feature->set_geometry(shape_io::read_polyline(record));
             else feature->set_geometry(shape_io::read_polyline_parts(record, parts));
             break;
@@ -144,7 +194,7 @@ feature_ptr shape_index_featureset<filterT>::next()
         case shape_io::shape_polygonz:
         {
             shape_io::read_bbox(record, feature_bbox_);
-            if (!filter_.pass(feature_bbox_)) continue;
+            if (!filter_.pass(feature_bbox_) || rejected(*feature)) continue;
             if (parts.size() < 2) feature->set_geometry(shape_io::read_polygon(record));
             else feature->set_geometry(shape_io::read_polygon_parts(record, parts));
             break;
@@ -154,21 +204,7 @@ feature_ptr shape_index_featureset<filterT>::next()
             return feature_ptr();
         }
 
-        if (attr_ids_.size())
-        {
-            shape_ptr_->dbf().move_to(shape_ptr_->id_);
-            try
-            {
-                for (auto id : attr_ids_)
-                {
-                    shape_ptr_->dbf().add_attribute(id, *tr_, *feature);
-                }
-            }
-            catch (...)
-            {
-                MAPNIK_LOG_ERROR(shape) << "Shape Plugin: error processing attributes";
-            }
-        }
+        if (!attribute_filter_.active()) read_attributes(*feature);
         ++count_;
         return feature;
     }
@@ -30,6 +30,8 @@
 // mapnik
 #include <mapnik/geom_util.hpp>
 #include <mapnik/feature.hpp>
+#include <mapnik/filter_pushdown.hpp>
+#include <mapnik/util/arena.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/value_types.hpp>
 
@@ -69,13 +71,19 @@ public:
                            std::set<std::string> const& attribute_names,
                            std::string const& encoding,
                            std::string const& shape_name,
-                           int row_limit);
+                           int row_limit,
+                           mapnik::attribute_filter const& attribute_filter = mapnik::attribute_filter());
     virtual ~shape_index_featureset();
     feature_ptr next();
 
 private:
+    void read_attributes(mapnik::feature_impl & feature);
+    bool rejected(mapnik::feature_impl & feature);
+
     filterT filter_;
+    mapnik::attribute_filter attribute_filter_;
     context_ptr ctx_;
+    std::shared_ptr<mapnik::util::arena> arena_;
     std::unique_ptr<shape_io> shape_ptr_;
     const std::unique_ptr<mapnik::transcoder> tr_;
     std::vector<mapnik::detail::node> offsets_;
@@ -74,7 +74,7 @@ public:
     {
         if (index_ && index_->is_open())
         {
-            bool status = mapnik::util::check_spatial_index(index_->file());
+            bool status = mapnik::util::spatial_index_version(index_->file()) != 0;
             index_->seek(0);// rewind
             return status;
         }
@@ -29,6 +29,7 @@
 #include <mapnik/debug.hpp>
 #include <mapnik/boolean.hpp>
 #include <mapnik/sql_utils.hpp>
+#include <mapnik/filter_pushdown.hpp>
 #include <mapnik/util/geometry_to_ds_type.hpp>
 #include <mapnik/timer.hpp>
 #include <mapnik/wkb.hpp>
@@ -95,6 +96,7 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
     }
 
     use_spatial_index_ = *params.get<mapnik::boolean_type>("use_spatial_index", true);
+    filter_pushdown_ = *params.get<mapnik::boolean_type>("filter_pushdown", true);
 
     // TODO - remove this option once all datasources have an indexing api
     bool auto_index = *params.get<mapnik::boolean_type>("auto_index", true);
@@ -486,6 +488,13 @@ featureset_ptr sqlite_datasource::features(query const& q) const
     {
         mapnik::box2d<double> const& e = q.get_bbox();
 
+        std::string filter_sql;
+        if (filter_pushdown_ && q.get_filter())
+        {
+            filter_sql = mapnik::sql_utils::filter_to_sql(*q.get_filter(), desc_, q.variables(),
+                                                          mapnik::sql_utils::sql_dialect::sqlite);
+        }
+
         std::ostringstream s;
         mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
 
@@ -493,6 +502,9 @@ featureset_ptr sqlite_datasource::features(query const& q) const
         if (!key_field_.empty())
         {
             s << "," << key_field_;
+            // the key is read by position: renamed so that the filtering
+            // subquery below doesn't see it twice when it's also a property
+            if (!filter_sql.empty()) s << " AS mapnik_feature_id";
             ctx->push(key_field_);
         }
         std::set<std::string> const& props = q.property_names();
@@ -538,9 +550,17 @@ featureset_ptr sqlite_datasource::features(query const& q) const
             s << " OFFSET " << row_offset_;
         }
 
-        MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << s.str();
+        std::string sql = s.str();
+        if (!filter_sql.empty())
+        {
+            // rows no rule draws are left in the database, the filter's
+            // columns are among the selected ones
+            sql = "SELECT * FROM (" + sql + ") WHERE " + filter_sql;
+        }
 
-        std::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
+        MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << sql;
+
+        std::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(sql));
 
         return std::make_shared<sqlite_featureset>(rs,
                                                      ctx,
@@ -548,7 +568,7 @@ featureset_ptr sqlite_datasource::features(query const& q) const
                                                      e,
                                                      format_,
                                                      has_spatial_index_,
-                                                     using_subquery_);
+                                                     using_subquery_ || !filter_sql.empty());
     }
 
     return mapnik::make_empty_featureset();
@@ -85,6 +85,7 @@ private:
     bool use_spatial_index_;
     bool has_spatial_index_;
     bool using_subquery_;
+    bool filter_pushdown_;
     mutable std::vector<std::string> init_statements_;
 };
 
@@ -114,6 +114,24 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, std::shared_ptr<T1>
     setup(m);
 }
 
+template <typename T0, typename T1>
+agg_renderer<T0,T1>::agg_renderer(Map const& m, agg_renderer const& parent, std::shared_ptr<T0> const& pixmap,
+                                  std::shared_ptr<T1> detector)
+    : feature_style_processor<agg_renderer>(m, parent.common_.scale_factor_),
+      pixmap_(*pixmap),
+      owned_pixmap_(pixmap),
+      internal_buffer_(),
+      current_buffer_(pixmap.get()),
+      style_level_compositing_(false),
+      ras_ptr(new rasterizer),
+      gamma_method_(GAMMA_POWER),
+      gamma_(1.0),
+      common_(m, parent.common_, detector)
+{
+    // layer buffers start out transparent, background is owned by parent
+    mapnik::set_premultiplied_alpha(pixmap_, true);
+}
+
 template <typename buffer_type>
 struct setup_agg_bg_visitor
 {
@@ -194,6 +212,35 @@ void agg_renderer<T0,T1>::setup(Map const &m)
 template <typename T0, typename T1>
 agg_renderer<T0,T1>::~agg_renderer() {}
 
+template <typename T0, typename T1>
+std::unique_ptr<agg_renderer<T0,T1> > agg_renderer<T0,T1>::make_layer_processor(Map const& m, bool share_detector) const
+{
+    std::shared_ptr<buffer_type> pixmap = std::make_shared<buffer_type>(pixmap_.width(), pixmap_.height());
+    std::shared_ptr<detector_type> detector = share_detector
+        ? common_.detector_
+        : std::make_shared<detector_type>(common_.detector_->extent());
+    return std::unique_ptr<agg_renderer>(new agg_renderer(m, *this, pixmap, detector));
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::composite_layer_processor(agg_renderer & layer_processor, bool replace_labels)
+{
+    if (layer_processor.painted())
+    {
+        composite(pixmap_, layer_processor.pixmap_, src_over, 1.0f, 0, 0);
+        painted(true);
+    }
+    detector_type & detector = *layer_processor.common_.detector_;
+    if (&detector != common_.detector_.get())
+    {
+        if (replace_labels) common_.detector_->clear();
+        for (auto const& lbl : detector)
+        {
+            common_.detector_->insert(lbl.get().box, lbl.get().text);
+        }
+    }
+}
+
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::start_map_processing(Map const& map)
 {
@@ -309,12 +356,7 @@ void agg_renderer<T0,T1>::end_style_processing(feature_type_style const& st)
         if (st.image_filters().size() > 0)
         {
             blend_from = true;
-            mapnik::filter::filter_visitor<buffer_type> visitor(*current_buffer_);
-            for (mapnik::filter::filter_type const& filter_tag : st.image_filters())
-            {
-                util::apply_visitor(visitor, filter_tag);
-            }
-            mapnik::premultiply_alpha(*current_buffer_);
+            mapnik::filter::apply_filters(*current_buffer_, st.image_filters(), this->jobs(), true);
         }
         if (st.comp_op())
         {
@@ -334,12 +376,7 @@ void agg_renderer<T0,T1>::end_style_processing(feature_type_style const& st)
     if (st.direct_image_filters().size() > 0)
     {
         // apply any 'direct' image filters
-        mapnik::filter::filter_visitor<buffer_type> visitor(pixmap_);
-        for (mapnik::filter::filter_type const& filter_tag : st.direct_image_filters())
-        {
-            util::apply_visitor(visitor, filter_tag);
-        }
-        mapnik::premultiply_alpha(pixmap_);
+        mapnik::filter::apply_filters(pixmap_, st.direct_image_filters(), this->jobs(), true);
     }
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: End processing style";
 }
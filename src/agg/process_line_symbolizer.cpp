@@ -52,6 +52,7 @@
 // stl
 #include <string>
 #include <cmath>
+#include <iterator>
 
 namespace mapnik {
 
@@ -90,19 +91,21 @@ void set_join_caps_aa(Symbolizer const& sym, Rasterizer & ras, Feature & feature
 }
 
 template <typename T0, typename T1>
-void agg_renderer<T0,T1>::process(line_symbolizer const& sym,
-                              mapnik::feature_impl & feature,
-                              proj_transform const& prj_trans)
+template <typename Iterator>
+void agg_renderer<T0,T1>::render_lines(line_symbolizer const& sym,
+                                       Iterator begin, Iterator end,
+                                       proj_transform const& prj_trans)
 
 {
-    color const& col = get<color, keys::stroke>(sym, feature, common_.vars_);
+    mapnik::feature_impl & first = **begin;
+    color const& col = get<color, keys::stroke>(sym, first, common_.vars_);
     unsigned r=col.red();
     unsigned g=col.green();
     unsigned b=col.blue();
     unsigned a=col.alpha();
 
-    double gamma = get<value_double, keys::stroke_gamma>(sym, feature, common_.vars_);
-    gamma_method_enum gamma_method = get<gamma_method_enum, keys::stroke_gamma_method>(sym, feature, common_.vars_);
+    double gamma = get<value_double, keys::stroke_gamma>(sym, first, common_.vars_);
+    gamma_method_enum gamma_method = get<gamma_method_enum, keys::stroke_gamma_method>(sym, first, common_.vars_);
     ras_ptr->reset();
 
     if (gamma != gamma_ || gamma_method != gamma_method_)
@@ -121,22 +124,20 @@ void agg_renderer<T0,T1>::process(line_symbolizer const& sym,
     using renderer_base = agg::renderer_base<pixfmt_comp_type>;
 
     pixfmt_comp_type pixf(buf);
-    pixf.comp_op(static_cast<agg::comp_op_e>(get<composite_mode_e, keys::comp_op>(sym, feature, common_.vars_)));
+    pixf.comp_op(static_cast<agg::comp_op_e>(get<composite_mode_e, keys::comp_op>(sym, first, common_.vars_)));
     renderer_base renb(pixf);
 
-    agg::trans_affine tr;
     auto transform = get_optional<transform_type>(sym, keys::geometry_transform);
-    if (transform) evaluate_transform(tr, feature, common_.vars_, *transform, common_.scale_factor_);
 
     box2d<double> clip_box = clipping_extent(common_);
 
-    value_bool clip = get<value_bool, keys::clip>(sym, feature, common_.vars_);
-    value_double width = get<value_double, keys::stroke_width>(sym, feature, common_.vars_);
-    value_double opacity = get<value_double,keys::stroke_opacity>(sym,feature, common_.vars_);
-    value_double offset = get<value_double, keys::offset>(sym, feature, common_.vars_);
-    value_double simplify_tolerance = get<value_double, keys::simplify_tolerance>(sym, feature, common_.vars_);
-    value_double smooth = get<value_double, keys::smooth>(sym, feature, common_.vars_);
-    line_rasterizer_enum rasterizer_e = get<line_rasterizer_enum, keys::line_rasterizer>(sym, feature, common_.vars_);
+    value_bool clip = get<value_bool, keys::clip>(sym, first, common_.vars_);
+    value_double width = get<value_double, keys::stroke_width>(sym, first, common_.vars_);
+    value_double opacity = get<value_double,keys::stroke_opacity>(sym,first, common_.vars_);
+    value_double offset = get<value_double, keys::offset>(sym, first, common_.vars_);
+    value_double simplify_tolerance = get<value_double, keys::simplify_tolerance>(sym, first, common_.vars_);
+    value_double smooth = get<value_double, keys::smooth>(sym, first, common_.vars_);
+    line_rasterizer_enum rasterizer_e = get<line_rasterizer_enum, keys::line_rasterizer>(sym, first, common_.vars_);
     if (clip)
     {
         double padding = static_cast<double>(common_.query_extent_.width()/pixmap_.width());
@@ -166,31 +167,37 @@ void agg_renderer<T0,T1>::process(line_symbolizer const& sym,
         renderer_type ren(renb, profile);
         ren.color(agg::rgba8_pre(r, g, b, int(a * opacity)));
         rasterizer_type ras(ren);
-        set_join_caps_aa(sym, ras, feature, common_.vars_);
+        set_join_caps_aa(sym, ras, first, common_.vars_);
 
         using vertex_converter_type = vertex_converter<clip_line_tag, clip_poly_tag, transform_tag,
                                                        affine_transform_tag,
                                                        simplify_tag, smooth_tag,
                                                        offset_transform_tag>;
-        vertex_converter_type converter(clip_box,sym,common_.t_,prj_trans,tr,feature,common_.vars_,common_.scale_factor_);
-        if (clip)
+        for (Iterator itr = begin; itr != end; ++itr)
         {
-            geometry::geometry_types type = geometry::geometry_type(feature.get_geometry());
-            if (type == geometry::geometry_types::Polygon || type == geometry::geometry_types::MultiPolygon)
-                converter.template set<clip_poly_tag>();
-            else if (type == geometry::geometry_types::LineString || type == geometry::geometry_types::MultiLineString)
-                converter.template set<clip_line_tag>();
+            mapnik::feature_impl & feature = **itr;
+            agg::trans_affine tr;
+            if (transform) evaluate_transform(tr, feature, common_.vars_, *transform, common_.scale_factor_);
+            vertex_converter_type converter(clip_box,sym,common_.t_,prj_trans,tr,feature,common_.vars_,common_.scale_factor_);
+            if (clip)
+            {
+                geometry::geometry_types type = geometry::geometry_type(feature.get_geometry());
+                if (type == geometry::geometry_types::Polygon || type == geometry::geometry_types::MultiPolygon)
+                    converter.template set<clip_poly_tag>();
+                else if (type == geometry::geometry_types::LineString || type == geometry::geometry_types::MultiLineString)
+                    converter.template set<clip_line_tag>();
+            }
+            converter.template set<transform_tag>(); // always transform
+            if (std::fabs(offset) > 0.0) converter.template set<offset_transform_tag>(); // parallel offset
+            converter.template set<affine_transform_tag>(); // optional affine transform
+            if (simplify_tolerance > 0.0) converter.template set<simplify_tag>(); // optional simplify converter
+            if (smooth > 0.0) converter.template set<smooth_tag>(); // optional smooth converter
+
+            using apply_vertex_converter_type = detail::apply_vertex_converter<vertex_converter_type, rasterizer_type>;
+            using vertex_processor_type = geometry::vertex_processor<apply_vertex_converter_type>;
+            apply_vertex_converter_type apply(converter, ras);
+            mapnik::util::apply_visitor(vertex_processor_type(apply),feature.get_geometry());
         }
-        converter.set<transform_tag>(); // always transform
-        if (std::fabs(offset) > 0.0) converter.set<offset_transform_tag>(); // parallel offset
-        converter.set<affine_transform_tag>(); // optional affine transform
-        if (simplify_tolerance > 0.0) converter.set<simplify_tag>(); // optional simplify converter
-        if (smooth > 0.0) converter.set<smooth_tag>(); // optional smooth converter
-
-        using apply_vertex_converter_type = detail::apply_vertex_converter<vertex_converter_type, rasterizer_type>;
-        using vertex_processor_type = geometry::vertex_processor<apply_vertex_converter_type>;
-        apply_vertex_converter_type apply(converter, ras);
-        mapnik::util::apply_visitor(vertex_processor_type(apply),feature.get_geometry());
     }
     else
     {
@@ -199,41 +206,77 @@ void agg_renderer<T0,T1>::process(line_symbolizer const& sym,
                                                        simplify_tag, smooth_tag,
                                                        offset_transform_tag,
                                                        dash_tag, stroke_tag>;
-        vertex_converter_type converter(clip_box, sym,common_.t_,prj_trans,tr,feature,common_.vars_,common_.scale_factor_);
-        if (clip)
-        {
-            geometry::geometry_types type = geometry::geometry_type(feature.get_geometry());
-            if (type == geometry::geometry_types::Polygon || type == geometry::geometry_types::MultiPolygon)
-                converter.template set<clip_poly_tag>();
-            else if (type == geometry::geometry_types::LineString || type == geometry::geometry_types::MultiLineString)
-                converter.template set<clip_line_tag>();
-        }
-        converter.set<transform_tag>(); // always transform
-        if (std::fabs(offset) > 0.0) converter.set<offset_transform_tag>(); // parallel offset
-        converter.set<affine_transform_tag>(); // optional affine transform
-        if (simplify_tolerance > 0.0) converter.set<simplify_tag>(); // optional simplify converter
-        if (smooth > 0.0) converter.set<smooth_tag>(); // optional smooth converter
-        if (has_key(sym, keys::stroke_dasharray))
-            converter.set<dash_tag>();
-        converter.set<stroke_tag>(); //always stroke
-
-        using apply_vertex_converter_type = detail::apply_vertex_converter<vertex_converter_type, rasterizer>;
-        using vertex_processor_type = geometry::vertex_processor<apply_vertex_converter_type>;
-        apply_vertex_converter_type apply(converter, *ras_ptr);
-        mapnik::util::apply_visitor(vertex_processor_type(apply),feature.get_geometry());
-
         using renderer_type = agg::renderer_scanline_aa_solid<renderer_base>;
         renderer_type ren(renb);
         ren.color(agg::rgba8_pre(r, g, b, int(a * opacity)));
         agg::scanline_u8 sl;
-        ras_ptr->filling_rule(agg::fill_non_zero);
-        agg::render_scanlines(*ras_ptr, sl, ren);
+        bool dash = has_key(sym, keys::stroke_dasharray);
+        for (Iterator itr = begin; itr != end; ++itr)
+        {
+            mapnik::feature_impl & feature = **itr;
+            if (itr != begin) ras_ptr->reset();
+            agg::trans_affine tr;
+            if (transform) evaluate_transform(tr, feature, common_.vars_, *transform, common_.scale_factor_);
+            vertex_converter_type converter(clip_box, sym,common_.t_,prj_trans,tr,feature,common_.vars_,common_.scale_factor_);
+            if (clip)
+            {
+                geometry::geometry_types type = geometry::geometry_type(feature.get_geometry());
+                if (type == geometry::geometry_types::Polygon || type == geometry::geometry_types::MultiPolygon)
+                    converter.template set<clip_poly_tag>();
+                else if (type == geometry::geometry_types::LineString || type == geometry::geometry_types::MultiLineString)
+                    converter.template set<clip_line_tag>();
+            }
+            converter.template set<transform_tag>(); // always transform
+            if (std::fabs(offset) > 0.0) converter.template set<offset_transform_tag>(); // parallel offset
+            converter.template set<affine_transform_tag>(); // optional affine transform
+            if (simplify_tolerance > 0.0) converter.template set<simplify_tag>(); // optional simplify converter
+            if (smooth > 0.0) converter.template set<smooth_tag>(); // optional smooth converter
+            if (dash) converter.template set<dash_tag>();
+            converter.template set<stroke_tag>(); //always stroke
+
+            using apply_vertex_converter_type = detail::apply_vertex_converter<vertex_converter_type, rasterizer>;
+            using vertex_processor_type = geometry::vertex_processor<apply_vertex_converter_type>;
+            apply_vertex_converter_type apply(converter, *ras_ptr);
+            mapnik::util::apply_visitor(vertex_processor_type(apply),feature.get_geometry());
+
+            ras_ptr->filling_rule(agg::fill_non_zero);
+            agg::render_scanlines(*ras_ptr, sl, ren);
+        }
     }
 }
 
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::process(line_symbolizer const& sym,
+                              mapnik::feature_impl & feature,
+                              proj_transform const& prj_trans)
+
+{
+    mapnik::feature_impl * features[] = { &feature };
+    render_lines(sym, std::begin(features), std::end(features), prj_trans);
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::process_batch(line_symbolizer const& sym,
+                                        feature_batch const& features,
+                                        proj_transform const& prj_trans)
+{
+    if (features.empty()) return;
+    if (properties_depend_on_feature(sym))
+    {
+        for (feature_ptr const& feature : features)
+        {
+            process(sym, *feature, prj_trans);
+        }
+        return;
+    }
+    render_lines(sym, features.begin(), features.end(), prj_trans);
+}
 
 template void agg_renderer<image_rgba8>::process(line_symbolizer const&,
                                               mapnik::feature_impl &,
                                               proj_transform const&);
+template void agg_renderer<image_rgba8>::process_batch(line_symbolizer const&,
+                                                    feature_batch const&,
+                                                    proj_transform const&);
 
 }
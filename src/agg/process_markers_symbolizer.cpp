@@ -105,9 +105,11 @@ private:
 } // namespace detail
 
 template <typename T0, typename T1>
-void agg_renderer<T0,T1>::process(markers_symbolizer const& sym,
-                              feature_impl & feature,
-                              proj_transform const& prj_trans)
+template <typename Features>
+void agg_renderer<T0,T1>::render_markers(markers_symbolizer const& sym,
+                                         feature_impl const& first,
+                                         Features & features,
+                                         proj_transform const& prj_trans)
 {
     using namespace mapnik::svg;
     using color_type = agg::rgba8;
@@ -125,8 +127,8 @@ void agg_renderer<T0,T1>::process(markers_symbolizer const& sym,
 
     ras_ptr->reset();
 
-    double gamma = get<value_double, keys::gamma>(sym, feature, common_.vars_);
-    gamma_method_enum gamma_method = get<gamma_method_enum, keys::gamma_method>(sym, feature, common_.vars_);
+    double gamma = get<value_double, keys::gamma>(sym, first, common_.vars_);
+    gamma_method_enum gamma_method = get<gamma_method_enum, keys::gamma_method>(sym, first, common_.vars_);
     if (gamma != gamma_ || gamma_method != gamma_method_)
     {
         set_gamma_method(ras_ptr, gamma, gamma_method);
@@ -140,13 +142,41 @@ void agg_renderer<T0,T1>::process(markers_symbolizer const& sym,
     using context_type = detail::agg_markers_renderer_context<svg_renderer_type,
                                                               buf_type,
                                                               rasterizer>;
-    context_type renderer_context(sym, feature, common_.vars_, render_buffer, *ras_ptr);
+    context_type renderer_context(sym, first, common_.vars_, render_buffer, *ras_ptr);
 
     render_markers_symbolizer(
-        sym, feature, prj_trans, common_, clip_box, renderer_context);
+        sym, features, prj_trans, common_, clip_box, renderer_context);
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::process(markers_symbolizer const& sym,
+                              feature_impl & feature,
+                              proj_transform const& prj_trans)
+{
+    render_markers(sym, feature, feature, prj_trans);
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::process_batch(markers_symbolizer const& sym,
+                                        feature_batch const& features,
+                                        proj_transform const& prj_trans)
+{
+    if (features.empty()) return;
+    if (properties_depend_on_feature(sym))
+    {
+        for (feature_ptr const& feature : features)
+        {
+            process(sym, *feature, prj_trans);
+        }
+        return;
+    }
+    render_markers(sym, *features.front(), features, prj_trans);
 }
 
 template void agg_renderer<image_rgba8>::process(markers_symbolizer const&,
                                               mapnik::feature_impl &,
                                               proj_transform const&);
+template void agg_renderer<image_rgba8>::process_batch(markers_symbolizer const&,
+                                                    feature_batch const&,
+                                                    proj_transform const&);
 } // namespace mapnik
@@ -44,18 +44,23 @@
 #include "agg_scanline_u.h"
 #pragma GCC diagnostic pop
 
+// stl
+#include <iterator>
+
 namespace mapnik {
 
 template <typename T0, typename T1>
-void agg_renderer<T0,T1>::process(polygon_symbolizer const& sym,
-                              mapnik::feature_impl & feature,
-                              proj_transform const& prj_trans)
+template <typename Iterator>
+void agg_renderer<T0,T1>::render_polygons(polygon_symbolizer const& sym,
+                                          Iterator begin, Iterator end,
+                                          proj_transform const& prj_trans)
 {
     using vertex_converter_type = vertex_converter<clip_poly_tag,transform_tag,affine_transform_tag,simplify_tag,smooth_tag>;
 
+    mapnik::feature_impl & first = **begin;
     ras_ptr->reset();
-    double gamma = get<value_double>(sym, keys::gamma, feature, common_.vars_, 1.0);
-    gamma_method_enum gamma_method = get<gamma_method_enum>(sym, keys::gamma_method, feature, common_.vars_, GAMMA_POWER);
+    double gamma = get<value_double>(sym, keys::gamma, first, common_.vars_, 1.0);
+    gamma_method_enum gamma_method = get<gamma_method_enum>(sym, keys::gamma_method, first, common_.vars_, GAMMA_POWER);
     if (gamma != gamma_ || gamma_method != gamma_method_)
     {
         set_gamma_method(ras_ptr, gamma, gamma_method);
@@ -66,32 +71,66 @@ void agg_renderer<T0,T1>::process(polygon_symbolizer const& sym,
     box2d<double> clip_box = clipping_extent(common_);
     agg::rendering_buffer buf(current_buffer_->bytes(),current_buffer_->width(),current_buffer_->height(), current_buffer_->row_size());
 
-    render_polygon_symbolizer<vertex_converter_type>(
-        sym, feature, prj_trans, common_, clip_box, *ras_ptr,
-        [&](color const &fill, double opacity) {
-            unsigned r=fill.red();
-            unsigned g=fill.green();
-            unsigned b=fill.blue();
-            unsigned a=fill.alpha();
-            using color_type = agg::rgba8;
-            using order_type = agg::order_rgba;
-            using blender_type = agg::comp_op_adaptor_rgba_pre<color_type, order_type>; // comp blender
-            using pixfmt_comp_type = agg::pixfmt_custom_blend_rgba<blender_type, agg::rendering_buffer>;
-            using renderer_base = agg::renderer_base<pixfmt_comp_type>;
-            using renderer_type = agg::renderer_scanline_aa_solid<renderer_base>;
-            pixfmt_comp_type pixf(buf);
-            pixf.comp_op(static_cast<agg::comp_op_e>(get<composite_mode_e>(sym, keys::comp_op, feature, common_.vars_, src_over)));
-            renderer_base renb(pixf);
-            renderer_type ren(renb);
-            ren.color(agg::rgba8_pre(r, g, b, int(a * opacity)));
-            agg::scanline_u8 sl;
-            ras_ptr->filling_rule(agg::fill_even_odd);
-            agg::render_scanlines(*ras_ptr, sl, ren);
-        });
+    using color_type = agg::rgba8;
+    using order_type = agg::order_rgba;
+    using blender_type = agg::comp_op_adaptor_rgba_pre<color_type, order_type>; // comp blender
+    using pixfmt_comp_type = agg::pixfmt_custom_blend_rgba<blender_type, agg::rendering_buffer>;
+    using renderer_base = agg::renderer_base<pixfmt_comp_type>;
+    using renderer_type = agg::renderer_scanline_aa_solid<renderer_base>;
+    pixfmt_comp_type pixf(buf);
+    pixf.comp_op(static_cast<agg::comp_op_e>(get<composite_mode_e>(sym, keys::comp_op, first, common_.vars_, src_over)));
+    renderer_base renb(pixf);
+    renderer_type ren(renb);
+    agg::scanline_u8 sl;
+
+    for (Iterator itr = begin; itr != end; ++itr)
+    {
+        if (itr != begin) ras_ptr->reset();
+        render_polygon_symbolizer<vertex_converter_type>(
+            sym, **itr, prj_trans, common_, clip_box, *ras_ptr,
+            [&](color const &fill, double opacity) {
+                unsigned r=fill.red();
+                unsigned g=fill.green();
+                unsigned b=fill.blue();
+                unsigned a=fill.alpha();
+                ren.color(agg::rgba8_pre(r, g, b, int(a * opacity)));
+                ras_ptr->filling_rule(agg::fill_even_odd);
+                agg::render_scanlines(*ras_ptr, sl, ren);
+            });
+    }
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::process(polygon_symbolizer const& sym,
+                              mapnik::feature_impl & feature,
+                              proj_transform const& prj_trans)
+{
+    mapnik::feature_impl * features[] = { &feature };
+    render_polygons(sym, std::begin(features), std::end(features), prj_trans);
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::process_batch(polygon_symbolizer const& sym,
+                                        feature_batch const& features,
+                                        proj_transform const& prj_trans)
+{
+    if (features.empty()) return;
+    if (properties_depend_on_feature(sym))
+    {
+        for (feature_ptr const& feature : features)
+        {
+            process(sym, *feature, prj_trans);
+        }
+        return;
+    }
+    render_polygons(sym, features.begin(), features.end(), prj_trans);
 }
 
 template void agg_renderer<image_rgba8>::process(polygon_symbolizer const&,
                                               mapnik::feature_impl &,
                                               proj_transform const&);
+template void agg_renderer<image_rgba8>::process_batch(polygon_symbolizer const&,
+                                                    feature_batch const&,
+                                                    proj_transform const&);
 
 }
@@ -57,7 +57,8 @@ void agg_renderer<T0,T1>::process(raster_symbolizer const& sym,
             int start_x, int start_y) {
             composite(*current_buffer_, target,
                       comp_op, opacity, start_x, start_y);
-        }
+        },
+        this->jobs()
     );
 }
 
@@ -172,7 +172,9 @@ source = Split(
     expression_node.cpp
     expression_string.cpp
     expression.cpp
+    compiled_expression.cpp
     transform_expression.cpp
+    feature.cpp
     feature_kv_iterator.cpp
     feature_style_processor.cpp
     feature_type_style.cpp
@@ -199,10 +201,13 @@ source = Split(
     load_map.cpp
     palette.cpp
     marker_helpers.cpp
+    metatile.cpp
     transform_expression_grammar.cpp
     geometry_envelope.cpp
     plugin.cpp
     rule.cpp
+    rule_index.cpp
+    filter_pushdown.cpp
     save_map.cpp
     wkb.cpp
     twkb.cpp
@@ -215,6 +220,7 @@ source = Split(
     symbolizer.cpp
     symbolizer_keys.cpp
     symbolizer_enumerations.cpp
+    symbolizer_property_table.cpp
     unicode.cpp
     raster_colorizer.cpp
     mapped_memory_cache.cpp
@@ -224,6 +230,8 @@ source = Split(
     svg/svg_points_parser.cpp
     svg/svg_transform_parser.cpp
     warp.cpp
+    raster_block_cache.cpp
+    prefetch_featureset.cpp
     css_color_grammar.cpp
     vertex_cache.cpp
     vertex_adapters.cpp
@@ -233,6 +241,8 @@ source = Split(
     text/itemizer.cpp
     text/scrptrun.cpp
     text/face.cpp
+    text/glyph_cache.cpp
+    text/shaped_text_cache.cpp
     text/glyph_positions.cpp
     text/placement_finder.cpp
     text/properties_util.cpp
@@ -365,6 +375,7 @@ if env['GRID_RENDERER']:
     source += Split(
         """
         grid/grid.cpp
+        grid/grid_utf.cpp
         grid/grid_renderer.cpp
         grid/process_building_symbolizer.cpp
         grid/process_line_pattern_symbolizer.cpp
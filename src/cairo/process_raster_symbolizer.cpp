@@ -47,7 +47,8 @@ void cairo_renderer<T>::process(raster_symbolizer const& sym,
             int start_x, int start_y) {
             context_.set_operator(comp_op);
             context_.add_image(start_x, start_y, target, opacity);
-        }
+        },
+        this->jobs()
     );
 }
 
@@ -0,0 +1,468 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/compiled_expression.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/function_call.hpp>
+#include <mapnik/util/variant.hpp>
+
+// stl
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <utility>
+
+namespace mapnik
+{
+
+using opcode = compiled_expression::opcode;
+
+namespace {
+
+template <typename Tag> struct tag_opcode;
+template <> struct tag_opcode<tags::plus> { static constexpr opcode value = opcode::plus; };
+template <> struct tag_opcode<tags::minus> { static constexpr opcode value = opcode::minus; };
+template <> struct tag_opcode<tags::mult> { static constexpr opcode value = opcode::mult; };
+template <> struct tag_opcode<tags::div> { static constexpr opcode value = opcode::div; };
+template <> struct tag_opcode<tags::mod> { static constexpr opcode value = opcode::mod; };
+template <> struct tag_opcode<tags::less> { static constexpr opcode value = opcode::less; };
+template <> struct tag_opcode<tags::less_equal> { static constexpr opcode value = opcode::less_equal; };
+template <> struct tag_opcode<tags::greater> { static constexpr opcode value = opcode::greater; };
+template <> struct tag_opcode<tags::greater_equal> { static constexpr opcode value = opcode::greater_equal; };
+template <> struct tag_opcode<tags::equal_to> { static constexpr opcode value = opcode::equal_to; };
+template <> struct tag_opcode<tags::not_equal_to> { static constexpr opcode value = opcode::not_equal_to; };
+
+// fused form of a comparison opcode, or the opcode itself
+opcode attribute_opcode(opcode op)
+{
+    switch (op)
+    {
+    case opcode::less: return opcode::attribute_less;
+    case opcode::less_equal: return opcode::attribute_less_equal;
+    case opcode::greater: return opcode::attribute_greater;
+    case opcode::greater_equal: return opcode::attribute_greater_equal;
+    case opcode::equal_to: return opcode::attribute_equal_to;
+    case opcode::not_equal_to: return opcode::attribute_not_equal_to;
+    default: return op;
+    }
+}
+
+inline bool compare(opcode op, value_type const& lhs, value_type const& rhs)
+{
+    switch (op)
+    {
+    case opcode::less: return lhs < rhs;
+    case opcode::less_equal: return lhs <= rhs;
+    case opcode::greater: return lhs > rhs;
+    case opcode::greater_equal: return lhs >= rhs;
+    case opcode::equal_to: return lhs == rhs;
+    default: return lhs != rhs;
+    }
+}
+
+inline value_type arithmetic(opcode op, value_type const& lhs, value_type const& rhs)
+{
+    switch (op)
+    {
+    case opcode::plus: return lhs + rhs;
+    case opcode::minus: return lhs - rhs;
+    case opcode::mult: return lhs * rhs;
+    case opcode::div: return lhs / rhs;
+    default: return lhs % rhs;
+    }
+}
+
+}
+
+// Emits code for one node, returning true when the node folded to a single
+// push_constant at the end of the program.
+struct expression_compiler
+{
+    using instruction = compiled_expression::instruction;
+
+    explicit expression_compiler(compiled_expression & expr)
+        : expr_(expr) {}
+
+    void emit(opcode op, std::uint32_t arg = 0, std::uint32_t arg2 = 0) const
+    {
+        expr_.code_.push_back(instruction{op, arg, arg2});
+    }
+
+    bool push_constant(value_type const& val) const
+    {
+        emit(opcode::push_constant, static_cast<std::uint32_t>(expr_.constants_.size()));
+        expr_.constants_.push_back(val);
+        return true;
+    }
+
+    // removes the trailing constant emitted by a folded node and returns it
+    value_type pop_constant() const
+    {
+        expr_.code_.pop_back();
+        value_type val = std::move(expr_.constants_.back());
+        expr_.constants_.pop_back();
+        return val;
+    }
+
+    bool operator() (value_null val) const { return push_constant(val); }
+    bool operator() (value_bool val) const { return push_constant(val); }
+    bool operator() (value_integer val) const { return push_constant(val); }
+    bool operator() (value_double val) const { return push_constant(val); }
+    bool operator() (value_unicode_string const& val) const { return push_constant(val); }
+
+    bool operator() (attribute const& attr) const
+    {
+        emit(opcode::push_attribute, static_cast<std::uint32_t>(expr_.attributes_.size()));
+        expr_.attributes_.push_back(attr);
+        return false;
+    }
+
+    bool operator() (global_attribute const& attr) const
+    {
+        emit(opcode::push_global, static_cast<std::uint32_t>(expr_.globals_.size()));
+        expr_.globals_.push_back(attr.name);
+        return false;
+    }
+
+    bool operator() (geometry_type_attribute const&) const
+    {
+        emit(opcode::push_geometry_type);
+        return false;
+    }
+
+    bool operator() (unary_node<tags::negate> const& x) const
+    {
+        if (util::apply_visitor(*this, x.expr))
+        {
+            return push_constant(-pop_constant());
+        }
+        emit(opcode::negate);
+        return false;
+    }
+
+    bool operator() (unary_node<tags::logical_not> const& x) const
+    {
+        if (util::apply_visitor(*this, x.expr))
+        {
+            return push_constant(!pop_constant().to_bool());
+        }
+        emit(opcode::logical_not);
+        return false;
+    }
+
+    bool operator() (binary_node<tags::logical_and> const& x) const
+    {
+        return logical(x.left, x.right, false);
+    }
+
+    bool operator() (binary_node<tags::logical_or> const& x) const
+    {
+        return logical(x.left, x.right, true);
+    }
+
+    // `and` when short_circuit is false, `or` when true
+    bool logical(expr_node const& left, expr_node const& right, bool short_circuit) const
+    {
+        if (util::apply_visitor(*this, left))
+        {
+            if (pop_constant().to_bool() == short_circuit)
+            {
+                return push_constant(short_circuit);
+            }
+            return to_bool(right);
+        }
+        std::size_t jump = expr_.code_.size();
+        emit(short_circuit ? opcode::jump_if_true : opcode::jump_if_false);
+        to_bool(right);
+        expr_.code_[jump].arg = static_cast<std::uint32_t>(expr_.code_.size());
+        return false;
+    }
+
+    bool to_bool(expr_node const& node) const
+    {
+        if (util::apply_visitor(*this, node))
+        {
+            return push_constant(pop_constant().to_bool());
+        }
+        emit(opcode::to_bool);
+        return false;
+    }
+
+    template <typename Tag>
+    bool operator() (binary_node<Tag> const& x) const
+    {
+        opcode op = tag_opcode<Tag>::value;
+        bool left = util::apply_visitor(*this, x.left);
+        bool right = util::apply_visitor(*this, x.right);
+        if (left && right)
+        {
+            value_type rhs = pop_constant();
+            value_type lhs = pop_constant();
+            typename make_op<Tag>::type operation;
+            return push_constant(operation(lhs, rhs));
+        }
+        std::size_t size = expr_.code_.size();
+        opcode fused = attribute_opcode(op);
+        if (right && fused != op && x.left.template is<attribute>())
+        {
+            // [attr] <op> constant reads the attribute without copying it
+            std::uint32_t constant = expr_.code_[size - 1].arg;
+            std::uint32_t attr = expr_.code_[size - 2].arg;
+            expr_.code_.resize(size - 2);
+            emit(fused, attr, constant);
+            return false;
+        }
+        emit(op);
+        return false;
+    }
+
+    bool operator() (regex_match_node const& x) const
+    {
+        if (util::apply_visitor(*this, x.expr))
+        {
+            return push_constant(x.apply(pop_constant()));
+        }
+        emit(opcode::regex_match, static_cast<std::uint32_t>(expr_.regex_matches_.size()));
+        expr_.regex_matches_.push_back(x);
+        return false;
+    }
+
+    bool operator() (regex_replace_node const& x) const
+    {
+        if (util::apply_visitor(*this, x.expr))
+        {
+            return push_constant(x.apply(pop_constant()));
+        }
+        emit(opcode::regex_replace, static_cast<std::uint32_t>(expr_.regex_replaces_.size()));
+        expr_.regex_replaces_.push_back(x);
+        return false;
+    }
+
+    bool operator() (unary_function_call const& call) const
+    {
+        if (util::apply_visitor(*this, call.arg))
+        {
+            return push_constant(call.fun(pop_constant()));
+        }
+        emit(opcode::call_unary, static_cast<std::uint32_t>(expr_.unary_functions_.size()));
+        expr_.unary_functions_.push_back(call.fun);
+        return false;
+    }
+
+    bool operator() (binary_function_call const& call) const
+    {
+        bool arg1 = util::apply_visitor(*this, call.arg1);
+        bool arg2 = util::apply_visitor(*this, call.arg2);
+        if (arg1 && arg2)
+        {
+            value_type rhs = pop_constant();
+            value_type lhs = pop_constant();
+            return push_constant(call.fun(lhs, rhs));
+        }
+        emit(opcode::call_binary, static_cast<std::uint32_t>(expr_.binary_functions_.size()));
+        expr_.binary_functions_.push_back(call.fun);
+        return false;
+    }
+
+    compiled_expression & expr_;
+};
+
+compiled_expression::compiled_expression(expr_node const& expr)
+    : code_(),
+      constants_(),
+      attributes_(),
+      globals_(),
+      regex_matches_(),
+      regex_replaces_(),
+      unary_functions_(),
+      binary_functions_(),
+      max_stack_(0)
+{
+    util::apply_visitor(expression_compiler(*this), expr);
+    // upper bound of the stack depth, jumps only ever skip code leaving
+    // the stack as deep as falling through would
+    std::size_t depth = 0;
+    for (instruction const& instr : code_)
+    {
+        switch (instr.op)
+        {
+        case opcode::push_constant:
+        case opcode::push_attribute:
+        case opcode::push_global:
+        case opcode::push_geometry_type:
+        case opcode::attribute_less:
+        case opcode::attribute_less_equal:
+        case opcode::attribute_greater:
+        case opcode::attribute_greater_equal:
+        case opcode::attribute_equal_to:
+        case opcode::attribute_not_equal_to:
+            max_stack_ = std::max(max_stack_, ++depth);
+            break;
+        case opcode::plus:
+        case opcode::minus:
+        case opcode::mult:
+        case opcode::div:
+        case opcode::mod:
+        case opcode::less:
+        case opcode::less_equal:
+        case opcode::greater:
+        case opcode::greater_equal:
+        case opcode::equal_to:
+        case opcode::not_equal_to:
+        case opcode::call_binary:
+        case opcode::jump_if_false:
+        case opcode::jump_if_true:
+            --depth;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool compiled_expression::is_constant() const
+{
+    return code_.size() == 1 && code_.front().op == opcode::push_constant;
+}
+
+value_type const& compiled_expression::constant_value() const
+{
+    return constants_[code_.front().arg];
+}
+
+value_type compiled_expression::evaluate(feature_impl const& feature, attributes const& vars) const
+{
+    if (is_constant()) return constant_value();
+    static constexpr std::size_t small_stack = 8;
+    if (max_stack_ <= small_stack)
+    {
+        std::array<value_type, small_stack> stack;
+        return execute(stack.data(), feature, vars);
+    }
+    std::vector<value_type> stack(max_stack_);
+    return execute(stack.data(), feature, vars);
+}
+
+value_type compiled_expression::execute(value_type * stack, feature_impl const& feature, attributes const& vars) const
+{
+    value_type * top = stack - 1;
+    std::size_t const size = code_.size();
+    for (std::size_t pc = 0; pc < size; ++pc)
+    {
+        instruction const& instr = code_[pc];
+        switch (instr.op)
+        {
+        case opcode::push_constant:
+            *++top = constants_[instr.arg];
+            break;
+        case opcode::push_attribute:
+            *++top = attributes_[instr.arg].value<value_type, feature_impl>(feature);
+            break;
+        case opcode::push_global:
+        {
+            auto itr = vars.find(globals_[instr.arg]);
+            *++top = (itr != vars.end()) ? itr->second : value_type();
+            break;
+        }
+        case opcode::push_geometry_type:
+            *++top = geometry_type_attribute().value<value_type, feature_impl>(feature);
+            break;
+        case opcode::negate:
+            *top = -*top;
+            break;
+        case opcode::logical_not:
+            *top = !top->to_bool();
+            break;
+        case opcode::to_bool:
+            *top = top->to_bool();
+            break;
+        case opcode::plus:
+        case opcode::minus:
+        case opcode::mult:
+        case opcode::div:
+        case opcode::mod:
+            --top;
+            *top = arithmetic(instr.op, *top, *(top + 1));
+            break;
+        case opcode::less:
+        case opcode::less_equal:
+        case opcode::greater:
+        case opcode::greater_equal:
+        case opcode::equal_to:
+        case opcode::not_equal_to:
+            --top;
+            *top = compare(instr.op, *top, *(top + 1));
+            break;
+        case opcode::attribute_less:
+            *++top = attributes_[instr.arg].value<value_type, feature_impl>(feature) < constants_[instr.arg2];
+            break;
+        case opcode::attribute_less_equal:
+            *++top = attributes_[instr.arg].value<value_type, feature_impl>(feature) <= constants_[instr.arg2];
+            break;
+        case opcode::attribute_greater:
+            *++top = attributes_[instr.arg].value<value_type, feature_impl>(feature) > constants_[instr.arg2];
+            break;
+        case opcode::attribute_greater_equal:
+            *++top = attributes_[instr.arg].value<value_type, feature_impl>(feature) >= constants_[instr.arg2];
+            break;
+        case opcode::attribute_equal_to:
+            *++top = attributes_[instr.arg].value<value_type, feature_impl>(feature) == constants_[instr.arg2];
+            break;
+        case opcode::attribute_not_equal_to:
+            *++top = attributes_[instr.arg].value<value_type, feature_impl>(feature) != constants_[instr.arg2];
+            break;
+        case opcode::jump_if_false:
+            if (!top->to_bool())
+            {
+                *top = false;
+                pc = instr.arg - 1;
+            }
+            else --top;
+            break;
+        case opcode::jump_if_true:
+            if (top->to_bool())
+            {
+                *top = true;
+                pc = instr.arg - 1;
+            }
+            else --top;
+            break;
+        case opcode::regex_match:
+            *top = regex_matches_[instr.arg].apply(*top);
+            break;
+        case opcode::regex_replace:
+            *top = regex_replaces_[instr.arg].apply(*top);
+            break;
+        case opcode::call_unary:
+            *top = unary_functions_[instr.arg](*top);
+            break;
+        case opcode::call_binary:
+            --top;
+            *top = binary_functions_[instr.arg](*top, *(top + 1));
+            break;
+        }
+    }
+    return std::move(*top);
+}
+
+}
@@ -22,6 +22,7 @@
 
 // mapnik
 #include <mapnik/expression.hpp>
+#include <mapnik/compiled_expression.hpp>
 #include <mapnik/config_error.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/expression_node_types.hpp>
@@ -37,13 +38,13 @@ expression_ptr parse_expression(std::string const& str)
 {
     static const expression_grammar<std::string::const_iterator> g;
     boost::spirit::standard_wide::space_type space;
-    auto node = std::make_shared<expr_node>();
+    expr_node node;
     std::string::const_iterator itr = str.begin();
     std::string::const_iterator end = str.end();
     bool r = false;
     try
     {
-        r = boost::spirit::qi::phrase_parse(itr, end, g, space, *node);
+        r = boost::spirit::qi::phrase_parse(itr, end, g, space, node);
     }
     catch (boost::spirit::qi::expectation_failure<std::string::const_iterator> const& ex)
     {
@@ -57,7 +58,7 @@ expression_ptr parse_expression(std::string const& str)
     }
     if (r && itr == end)
     {
-        return node;
+        return std::make_shared<expr_node>(std::move(node));
     }
     else
     {
@@ -0,0 +1,368 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/filter_pushdown.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/rule_cache.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/util/variant.hpp>
+
+// boost
+#include <boost/optional.hpp>
+
+// stl
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+
+namespace mapnik
+{
+
+namespace {
+
+struct geometry_finder
+{
+    bool operator() (geometry_type_attribute const&) const
+    {
+        return true;
+    }
+
+    template <typename Tag>
+    bool operator() (unary_node<Tag> const& x) const
+    {
+        return util::apply_visitor(*this, x.expr);
+    }
+
+    template <typename Tag>
+    bool operator() (binary_node<Tag> const& x) const
+    {
+        return util::apply_visitor(*this, x.left) || util::apply_visitor(*this, x.right);
+    }
+
+    bool operator() (regex_match_node const& x) const
+    {
+        return util::apply_visitor(*this, x.expr);
+    }
+
+    bool operator() (regex_replace_node const& x) const
+    {
+        return util::apply_visitor(*this, x.expr);
+    }
+
+    bool operator() (unary_function_call const& x) const
+    {
+        return util::apply_visitor(*this, x.arg);
+    }
+
+    bool operator() (binary_function_call const& x) const
+    {
+        return util::apply_visitor(*this, x.arg1) || util::apply_visitor(*this, x.arg2);
+    }
+
+    template <typename T>
+    bool operator() (T const&) const
+    {
+        return false;
+    }
+};
+
+struct sql_condition
+{
+    std::string sql;
+    // false when `sql` may select rows the filter rejects
+    bool exact;
+};
+
+using optional_condition = boost::optional<sql_condition>;
+
+// Translates filters to two-valued SQL conditions: columns are tested for
+// NULL explicitly since mapnik compares null values as unequal to anything.
+class sql_translator
+{
+public:
+    sql_translator(layer_descriptor const& desc, attributes const& vars, sql_utils::sql_dialect dialect)
+        : desc_(desc),
+          vars_(vars),
+          dialect_(dialect) {}
+
+    // catch-all for nodes without an SQL equivalent
+    template <typename T>
+    optional_condition operator() (T const&) const
+    {
+        return optional_condition();
+    }
+
+    optional_condition operator() (value_bool val) const
+    {
+        return sql_condition{val ? "(1=1)" : "(1=0)", true};
+    }
+
+    optional_condition operator() (binary_node<tags::equal_to> const& x) const
+    {
+        return compare(x.left, x.right, "=");
+    }
+
+    optional_condition operator() (binary_node<tags::not_equal_to> const& x) const
+    {
+        return compare(x.left, x.right, "<>");
+    }
+
+    optional_condition operator() (binary_node<tags::less> const& x) const
+    {
+        return compare(x.left, x.right, "<");
+    }
+
+    optional_condition operator() (binary_node<tags::less_equal> const& x) const
+    {
+        return compare(x.left, x.right, "<=");
+    }
+
+    optional_condition operator() (binary_node<tags::greater> const& x) const
+    {
+        return compare(x.left, x.right, ">");
+    }
+
+    optional_condition operator() (binary_node<tags::greater_equal> const& x) const
+    {
+        return compare(x.left, x.right, ">=");
+    }
+
+    // a side which can't be translated is dropped, widening the selection
+    optional_condition operator() (binary_node<tags::logical_and> const& x) const
+    {
+        optional_condition left = util::apply_visitor(*this, x.left);
+        optional_condition right = util::apply_visitor(*this, x.right);
+        if (!left && !right) return optional_condition();
+        if (!left) return sql_condition{right->sql, false};
+        if (!right) return sql_condition{left->sql, false};
+        return sql_condition{"(" + left->sql + " AND " + right->sql + ")", left->exact && right->exact};
+    }
+
+    optional_condition operator() (binary_node<tags::logical_or> const& x) const
+    {
+        optional_condition left = util::apply_visitor(*this, x.left);
+        if (!left) return optional_condition();
+        optional_condition right = util::apply_visitor(*this, x.right);
+        if (!right) return optional_condition();
+        return sql_condition{"(" + left->sql + " OR " + right->sql + ")", left->exact && right->exact};
+    }
+
+    // negating a wider selection would narrow it, only exact ones are kept
+    optional_condition operator() (unary_node<tags::logical_not> const& x) const
+    {
+        optional_condition cond = util::apply_visitor(*this, x.expr);
+        if (!cond || !cond->exact) return optional_condition();
+        return sql_condition{"(NOT " + cond->sql + ")", true};
+    }
+
+private:
+    optional_condition compare(expr_node const& left, expr_node const& right, std::string op) const
+    {
+        expr_node const* column = &left;
+        expr_node const* literal = &right;
+        if (!column->is<attribute>())
+        {
+            std::swap(column, literal);
+            if (op == "<") op = ">";
+            else if (op == ">") op = "<";
+            else if (op == "<=") op = ">=";
+            else if (op == ">=") op = "<=";
+        }
+        if (!column->is<attribute>()) return optional_condition();
+        std::string const& name = util::get<attribute>(*column).name();
+        attribute_descriptor const* desc = find_column(name);
+        value val;
+        if (desc == nullptr || !literal_value(*literal, val)) return optional_condition();
+
+        bool ordering = op != "=" && op != "<>";
+        int type = desc->get_type();
+        std::string sql_literal;
+        if (val.is<value_integer>() || val.is<value_double>())
+        {
+            if (type != Integer && type != Float && type != Double) return optional_condition();
+            if (val.is<value_integer>())
+            {
+                sql_literal = std::to_string(util::get<value_integer>(val));
+            }
+            else
+            {
+                value_double num = util::get<value_double>(val);
+                if (!std::isfinite(num)) return optional_condition();
+                sql_literal = double_literal(num);
+            }
+            // postgis reads numeric columns as doubles: compare them as
+            // float8 rather than as exact decimals
+            if (dialect_ == sql_utils::sql_dialect::postgresql &&
+                (val.is<value_double>() || type != Integer))
+            {
+                sql_literal = "CAST('" + sql_literal + "' AS double precision)";
+            }
+        }
+        else if (val.is<value_unicode_string>())
+        {
+            // string ordering differs between ICU and SQL collations
+            if (type != String || ordering) return optional_condition();
+            sql_literal = quote_string(val.to_string());
+        }
+        else if (val.is<value_bool>())
+        {
+            if (type != Boolean || ordering) return optional_condition();
+            bool b = util::get<value_bool>(val);
+            if (dialect_ == sql_utils::sql_dialect::postgresql) sql_literal = b ? "TRUE" : "FALSE";
+            else sql_literal = b ? "1" : "0";
+        }
+        else
+        {
+            return optional_condition();
+        }
+
+        std::string quoted = quote_identifier(name);
+        // sqlite columns may hold values of any type, which order
+        // differently than in mapnik
+        bool exact = !(ordering && dialect_ == sql_utils::sql_dialect::sqlite);
+        if (op == "<>" && val.is<value_unicode_string>() && util::get<value_unicode_string>(val).isEmpty())
+        {
+            // null != '' is false in mapnik
+            exact = false;
+        }
+        if (op == "<>")
+        {
+            return sql_condition{"(" + quoted + " IS NULL OR " + quoted + " <> " + sql_literal + ")", exact};
+        }
+        return sql_condition{"(" + quoted + " IS NOT NULL AND " + quoted + " " + op + " " + sql_literal + ")", exact};
+    }
+
+    // constant subexpressions and variables
+    bool literal_value(expr_node const& node, value & val) const
+    {
+        if (node.is<global_attribute>())
+        {
+            auto itr = vars_.find(util::get<global_attribute>(node).name);
+            if (itr == vars_.end()) return false;
+            val = itr->second;
+            return true;
+        }
+        compiled_expression compiled(node);
+        if (!compiled.is_constant()) return false;
+        val = compiled.constant_value();
+        return true;
+    }
+
+    // shortest decimal form reading back as `num`
+    static std::string double_literal(value_double num)
+    {
+        char buf[32];
+        for (int precision = 1; precision <= 17; ++precision)
+        {
+            std::snprintf(buf, sizeof(buf), "%.*g", precision, num);
+            if (std::strtod(buf, nullptr) == num) break;
+        }
+        return buf;
+    }
+
+    attribute_descriptor const* find_column(std::string const& name) const
+    {
+        for (attribute_descriptor const& desc : desc_.get_descriptors())
+        {
+            if (desc.get_name() == name) return &desc;
+        }
+        return nullptr;
+    }
+
+    std::string quote_identifier(std::string const& name) const
+    {
+        std::string result("\"");
+        for (char c : name)
+        {
+            if (c == '"') result += '"';
+            result += c;
+        }
+        return result + "\"";
+    }
+
+    std::string quote_string(std::string const& str) const
+    {
+        bool postgres = dialect_ == sql_utils::sql_dialect::postgresql;
+        std::string result(postgres ? "E'" : "'");
+        for (char c : str)
+        {
+            if (c == '\'' || (postgres && c == '\\')) result += c;
+            result += c;
+        }
+        return result + "'";
+    }
+
+    layer_descriptor const& desc_;
+    attributes const& vars_;
+    sql_utils::sql_dialect dialect_;
+};
+
+}
+
+expression_ptr combined_filter(std::vector<rule_cache> const& rule_caches)
+{
+    std::unique_ptr<expr_node> combined;
+    for (rule_cache const& rc : rule_caches)
+    {
+        if (!rc.get_else_rules().empty()) return expression_ptr();
+        for (rule const* r : rc.get_if_rules())
+        {
+            expression_ptr const& filter = r->get_filter();
+            if (!filter) return expression_ptr();
+            compiled_expression const& compiled = r->get_compiled_filter();
+            if (compiled.is_constant())
+            {
+                if (compiled.constant_value().to_bool()) return expression_ptr();
+                continue;
+            }
+            if (!combined) combined.reset(new expr_node(*filter));
+            else *combined = binary_node<tags::logical_or>(*combined, *filter);
+        }
+    }
+    if (!combined) combined.reset(new expr_node(value_bool(false)));
+    return std::make_shared<expr_node>(std::move(*combined));
+}
+
+bool filter_uses_geometry(expr_node const& filter)
+{
+    return util::apply_visitor(geometry_finder(), filter);
+}
+
+namespace sql_utils {
+
+std::string filter_to_sql(expr_node const& filter,
+                          layer_descriptor const& desc,
+                          attributes const& vars,
+                          sql_dialect dialect)
+{
+    optional_condition cond = util::apply_visitor(sql_translator(desc, vars, dialect), filter);
+    if (!cond || cond->sql == "(1=1)") return std::string();
+    return cond->sql;
+}
+
+}
+
+}
@@ -74,6 +74,24 @@ namespace util {
 #endif
     }
 
+    std::time_t last_write_time(std::string const& filepath)
+    {
+#ifdef _WINDOWS
+        return boost::filesystem::last_write_time(mapnik::utf8_to_utf16(filepath));
+#else
+        return boost::filesystem::last_write_time(filepath);
+#endif
+    }
+
+    std::uintmax_t file_size(std::string const& filepath)
+    {
+#ifdef _WINDOWS
+        return boost::filesystem::file_size(mapnik::utf8_to_utf16(filepath));
+#else
+        return boost::filesystem::file_size(filepath);
+#endif
+    }
+
     bool is_relative(std::string const& filepath)
     {
 
@@ -0,0 +1,295 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#if defined(GRID_RENDERER)
+
+// mapnik
+#include <mapnik/grid/grid_utf.hpp>
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_view.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/util/variant.hpp>
+#include <mapnik/util/conversions.hpp>
+#include <mapnik/unicode.hpp>
+
+// stl
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mapnik
+{
+
+namespace {
+
+void append_utf8(std::string & out, std::uint32_t codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        out += static_cast<char>(codepoint);
+    }
+    else if (codepoint < 0x800)
+    {
+        out += static_cast<char>(0xc0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+    else if (codepoint < 0x10000)
+    {
+        out += static_cast<char>(0xe0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+    else
+    {
+        out += static_cast<char>(0xf0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+}
+
+void append_json_string(std::string & out, std::string const& str)
+{
+    out += '"';
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                out += buf;
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+struct json_value_appender
+{
+    explicit json_value_appender(std::string & out)
+        : out_(out) {}
+
+    void operator() (value_null) const
+    {
+        out_ += "null";
+    }
+
+    void operator() (value_bool val) const
+    {
+        out_ += val ? "true" : "false";
+    }
+
+    void operator() (value_integer val) const
+    {
+        std::string str;
+        util::to_string(str, val);
+        out_ += str;
+    }
+
+    void operator() (value_double val) const
+    {
+        if (!std::isfinite(val))
+        {
+            out_ += "null";
+            return;
+        }
+        std::string str;
+        util::to_string(str, val);
+        out_ += str;
+    }
+
+    void operator() (value_unicode_string const& val) const
+    {
+        std::string str;
+        to_utf8(val, str);
+        append_json_string(out_, str);
+    }
+
+    std::string & out_;
+};
+
+// next codepoint usable for a key, skipping those needing escapes in
+// JSON strings and the UTF-16 surrogate range
+std::uint32_t next_codepoint(std::uint32_t codepoint)
+{
+    ++codepoint;
+    if (codepoint == 34 || codepoint == 92) ++codepoint;
+    if (codepoint >= 0xd800 && codepoint <= 0xdfff) codepoint = 0xe000;
+    if (codepoint > 0x10ffff)
+    {
+        throw std::runtime_error("grid_encode_utf: too many keys to encode");
+    }
+    return codepoint;
+}
+
+}
+
+template <typename T>
+void grid_encode_utf(T const& grid, std::ostream & out, unsigned resolution, bool add_features)
+{
+    if (resolution == 0)
+    {
+        throw std::runtime_error("grid_encode_utf: resolution must be greater than zero");
+    }
+    using value_type = typename T::value_type;
+    auto const& feature_keys = grid.get_feature_keys();
+    // codepoint of each pixel value seen, so that the key table is
+    // consulted once per feature rather than once per pixel
+    std::unordered_map<value_type, std::uint32_t> codepoints;
+    std::unordered_map<std::string, std::uint32_t> keys;
+    std::vector<std::string> key_order;
+    std::uint32_t codepoint = 32;
+    std::string line;
+
+    out << "{\"grid\":[";
+    for (std::size_t y = 0; y < grid.height(); y += resolution)
+    {
+        value_type const* row = grid.get_row(y);
+        bool have_last = false;
+        value_type last_id = 0;
+        std::uint32_t last_codepoint = 0;
+        line.clear();
+        if (y > 0) line += ',';
+        line += '"';
+        for (std::size_t x = 0; x < grid.width(); x += resolution)
+        {
+            value_type feature_id = row[x];
+            if (!have_last || feature_id != last_id)
+            {
+                auto itr = codepoints.find(feature_id);
+                if (itr == codepoints.end())
+                {
+                    // pixels of features without a key are left blank
+                    std::string key;
+                    auto key_itr = feature_keys.find(feature_id);
+                    if (key_itr != feature_keys.end()) key = key_itr->second;
+                    auto pos = keys.find(key);
+                    if (pos == keys.end())
+                    {
+                        pos = keys.emplace(key, codepoint).first;
+                        key_order.push_back(key);
+                        codepoint = next_codepoint(codepoint);
+                    }
+                    itr = codepoints.emplace(feature_id, pos->second).first;
+                }
+                have_last = true;
+                last_id = feature_id;
+                last_codepoint = itr->second;
+            }
+            append_utf8(line, last_codepoint);
+        }
+        line += '"';
+        out.write(line.data(), static_cast<std::streamsize>(line.size()));
+    }
+
+    line = "],\"keys\":[";
+    for (std::size_t i = 0; i < key_order.size(); ++i)
+    {
+        if (i > 0) line += ',';
+        append_json_string(line, key_order[i]);
+    }
+    line += "],\"data\":{";
+    out.write(line.data(), static_cast<std::streamsize>(line.size()));
+
+    if (add_features)
+    {
+        auto const& features = grid.get_grid_features();
+        auto const& fields = grid.get_fields();
+        bool first = true;
+        for (std::string const& key : key_order)
+        {
+            if (key.empty()) continue;
+            auto feat_itr = features.find(key);
+            if (feat_itr == features.end()) continue;
+            feature_ptr const& feature = feat_itr->second;
+            line.clear();
+            json_value_appender append_value(line);
+            bool found = false;
+            for (std::string const& field : fields)
+            {
+                if (field == grid.key_name())
+                {
+                    if (found) line += ',';
+                    append_json_string(line, field);
+                    line += ':';
+                    append_value(feature->id());
+                    found = true;
+                }
+                else if (feature->has_key(field))
+                {
+                    if (found) line += ',';
+                    append_json_string(line, field);
+                    line += ':';
+                    util::apply_visitor(append_value, feature->get(field));
+                    found = true;
+                }
+            }
+            if (!found) continue;
+            std::string entry(first ? "" : ",");
+            append_json_string(entry, key);
+            entry += ":{";
+            out.write(entry.data(), static_cast<std::streamsize>(entry.size()));
+            out.write(line.data(), static_cast<std::streamsize>(line.size()));
+            out << '}';
+            first = false;
+        }
+    }
+    out << "}}";
+}
+
+template <typename T>
+std::string grid_encode_utf(T const& grid, unsigned resolution, bool add_features)
+{
+    std::ostringstream out;
+    grid_encode_utf(grid, out, resolution, add_features);
+    return out.str();
+}
+
+template MAPNIK_DECL void grid_encode_utf<grid>(grid const&, std::ostream &, unsigned, bool);
+template MAPNIK_DECL void grid_encode_utf<grid_view>(grid_view const&, std::ostream &, unsigned, bool);
+template MAPNIK_DECL std::string grid_encode_utf<grid>(grid const&, unsigned, bool);
+template MAPNIK_DECL std::string grid_encode_utf<grid_view>(grid_view const&, unsigned, bool);
+
+}
+
+#endif
@@ -125,6 +125,15 @@ void handle_png_options(std::string const& type,
                 throw image_writer_exception("invalid compression parameter: " + to_string(val) + " (only -1 through 10 are valid)");
             }
         }
+        else if (key == "j")
+        {
+            int jobs = 0;
+            if (!val || !mapnik::util::string2int(*val, jobs) || jobs < 0)
+            {
+                throw image_writer_exception("invalid jobs parameter: " + to_string(val) + " (0 uses all cores)");
+            }
+            opts.jobs = static_cast<unsigned>(jobs);
+        }
         else if (key == "s")
         {
             if (!val) throw image_writer_exception("invalid compression parameter: <uninitialised>");
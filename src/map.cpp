@@ -27,6 +27,7 @@
 #include <mapnik/enumeration.hpp>
 #include <mapnik/layer.hpp>
 #include <mapnik/feature_type_style.hpp>
+#include <mapnik/symbolizer_property_table.hpp>
 #include <mapnik/debug.hpp>
 #include <mapnik/map.hpp>
 #include <mapnik/datasource.hpp>
@@ -221,14 +222,43 @@ Map::const_style_iterator Map::end_styles() const
     return styles_.end();
 }
 
+namespace {
+
+struct update_symbolizer_table
+{
+    template <typename Symbolizer>
+    void operator() (Symbolizer & sym) const
+    {
+        update_property_table(sym);
+    }
+};
+
+// builds property tables of a style once all its symbolizers are set
+void update_property_tables(feature_type_style & style)
+{
+    for (auto & r : style.get_rules_nonconst())
+    {
+        for (auto & sym : r)
+        {
+            util::apply_visitor(update_symbolizer_table(), sym);
+        }
+    }
+}
+
+}
+
 bool Map::insert_style(std::string const& name, feature_type_style const& style)
 {
-    return styles_.emplace(name, style).second;
+    auto result = styles_.emplace(name, style);
+    if (result.second) update_property_tables(result.first->second);
+    return result.second;
 }
 
 bool Map::insert_style(std::string const& name, feature_type_style && style)
 {
-    return styles_.emplace(name, std::move(style)).second;
+    auto result = styles_.emplace(name, std::move(style));
+    if (result.second) update_property_tables(result.first->second);
+    return result.second;
 }
 
 void Map::remove_style(std::string const& name)
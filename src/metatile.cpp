@@ -0,0 +1,186 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/metatile.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/image_view.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/image_options.hpp>
+#include <mapnik/palette.hpp>
+#include <mapnik/hextree.hpp>
+#include <mapnik/util/conversions.hpp>
+#include <mapnik/util/parallel.hpp>
+
+// stl
+#include <map>
+#include <stdexcept>
+
+namespace mapnik {
+
+namespace {
+
+struct palette_options
+{
+    bool paletted = false;
+    int colors = 256;
+    int trans_mode = -1;
+    double gamma = -1;
+};
+
+palette_options parse_palette_options(std::string const& format)
+{
+    palette_options opts;
+    for (auto const& kv : parse_image_options(format))
+    {
+        auto const& key = kv.first;
+        auto const& val = kv.second;
+        if (key == "png8" || key == "png256") opts.paletted = true;
+        else if (key == "c" && val) util::string2int(*val, opts.colors);
+        else if (key == "t" && val) util::string2int(*val, opts.trans_mode);
+        else if (key == "g" && val) util::string2double(*val, opts.gamma);
+    }
+    return opts;
+}
+
+// One palette for the whole metatile, as save_as_png8_hex would compute per tile
+std::string make_palette(image_rgba8 const& image, palette_options const& opts)
+{
+    hextree<rgba> tree(opts.colors);
+    if (opts.trans_mode >= 0) tree.setTransMode(opts.trans_mode);
+    if (opts.gamma > 0) tree.setGamma(opts.gamma);
+    for (std::size_t y = 0; y < image.height(); ++y)
+    {
+        image_rgba8::pixel_type const* row = image.get_row(y);
+        for (std::size_t x = 0; x < image.width(); ++x)
+        {
+            unsigned val = row[x];
+            tree.insert(rgba(U2RED(val), U2GREEN(val), U2BLUE(val), U2ALPHA(val)));
+        }
+    }
+    std::vector<rgba> colors;
+    tree.create_palette(colors);
+    std::string str;
+    str.reserve(colors.size() * 4);
+    for (rgba const& c : colors)
+    {
+        str.push_back(c.r);
+        str.push_back(c.g);
+        str.push_back(c.b);
+        str.push_back(c.a);
+    }
+    return str;
+}
+
+std::string encode(image_view_rgba8 const& view, std::string const& format, std::string const& palette)
+{
+    if (palette.empty())
+    {
+        return save_to_string(view, format);
+    }
+    // rgba_palette caches lookups internally, so every encode gets its own
+    rgba_palette pal(palette, rgba_palette::PALETTE_RGBA);
+    return save_to_string(view, format, pal);
+}
+
+}
+
+std::vector<metatile_tile> split_metatile(image_rgba8 const& image,
+                                          metatile_options const& options)
+{
+    if (options.columns == 0 || options.rows == 0 ||
+        image.width() % options.columns != 0 ||
+        image.height() % options.rows != 0)
+    {
+        throw std::runtime_error("metatile of size " + std::to_string(image.width()) + "x" +
+                                 std::to_string(image.height()) + " can not be split into " +
+                                 std::to_string(options.columns) + "x" + std::to_string(options.rows) + " tiles");
+    }
+    std::size_t tile_width = image.width() / options.columns;
+    std::size_t tile_height = image.height() / options.rows;
+
+    std::string palette = options.palette;
+    if (palette.empty())
+    {
+        palette_options opts = parse_palette_options(options.format);
+        if (opts.paletted && !is_solid(image) && image.width() + image.height() > 3)
+        {
+            palette = make_palette(image, opts);
+        }
+    }
+
+    std::vector<metatile_tile> tiles;
+    tiles.reserve(options.columns * options.rows);
+    for (unsigned row = 0; row < options.rows; ++row)
+    {
+        for (unsigned column = 0; column < options.columns; ++column)
+        {
+            tiles.push_back(metatile_tile{ column, row, false, 0, std::string() });
+        }
+    }
+
+    util::parallel_for(tiles.size(), options.jobs, [&](std::size_t i)
+    {
+        metatile_tile & tile = tiles[i];
+        image_view_rgba8 view(tile.column * tile_width, tile.row * tile_height,
+                              tile_width, tile_height, image);
+        tile.pixel = view.get_row(0)[0];
+        tile.solid = is_solid(view);
+        if (!tile.solid)
+        {
+            tile.data = encode(view, options.format, palette);
+        }
+    });
+
+    if (options.encode_solid_tiles)
+    {
+        // encode each distinct solid tile once
+        std::map<std::uint32_t, std::string> solid_tiles;
+        for (metatile_tile & tile : tiles)
+        {
+            if (!tile.solid) continue;
+            auto itr = solid_tiles.find(tile.pixel);
+            if (itr == solid_tiles.end())
+            {
+                image_view_rgba8 view(tile.column * tile_width, tile.row * tile_height,
+                                      tile_width, tile_height, image);
+                itr = solid_tiles.emplace(tile.pixel, save_to_string(view, options.format)).first;
+            }
+            tile.data = itr->second;
+        }
+    }
+    return tiles;
+}
+
+std::vector<metatile_tile> render_metatile(Map const& map,
+                                           metatile_options const& options,
+                                           double scale_factor)
+{
+    image_rgba8 image(map.width(), map.height());
+    agg_renderer<image_rgba8> ren(map, image, scale_factor);
+    ren.apply();
+    return split_metatile(image, options);
+}
+
+}
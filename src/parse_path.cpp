@@ -67,7 +67,7 @@ namespace path_processor_detail
         void operator() (attribute const& attr) const
         {
             // convert mapnik::value to std::string
-            value const& val = feature_.get(attr.name());
+            value const& val = attr.value<value, feature_impl>(feature_);
             filename_ += val.to_string();
         }
 
@@ -0,0 +1,212 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/util/prefetch_featureset.hpp>
+#include <mapnik/util/parallel.hpp>
+
+// stl
+#include <algorithm>
+#include <exception>
+#include <system_error>
+#include <utility>
+
+namespace mapnik
+{
+
+prefetch_task::prefetch_task(datasource_ptr const& ds, query const& q,
+                             std::size_t num_queries, std::size_t num_features)
+    : ds_(ds),
+      query_(q),
+      num_queries_(num_queries),
+      num_features_(num_features),
+      started_(false),
+      promise_(),
+      result_(promise_.get_future().share()) {}
+
+void prefetch_task::run()
+{
+    if (started_.exchange(true)) return;
+    result_type result;
+    try
+    {
+        result.reserve(num_queries_);
+        for (std::size_t i = 0; i < num_queries_; ++i)
+        {
+            auto prefetched = std::make_shared<prefetched_features>();
+            prefetched->features = ds_->features_with_context(query_, processor_context_ptr());
+            if (prefetched->features)
+            {
+                prefetched->buffer.reserve(num_features_);
+                feature_ptr feature;
+                while (prefetched->buffer.size() < num_features_ &&
+                       (feature = prefetched->features->next()))
+                {
+                    prefetched->buffer.push_back(feature);
+                }
+            }
+            result.push_back(prefetched);
+        }
+    }
+    catch (...)
+    {
+        promise_.set_exception(std::current_exception());
+        return;
+    }
+    promise_.set_value(std::move(result));
+}
+
+prefetch_task::result_type const& prefetch_task::get()
+{
+    run();
+    return result_.get();
+}
+
+template class singleton<prefetch_pool, CreateStatic>;
+
+prefetch_pool::prefetch_pool()
+    :
+#ifdef MAPNIK_THREADSAFE
+      running_(0),
+      idle_(0),
+      stop_(false),
+#endif
+      max_threads_(util::hardware_concurrency()) {}
+
+prefetch_pool::~prefetch_pool()
+{
+#ifdef MAPNIK_THREADSAFE
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    for (auto & worker : workers_)
+    {
+        if (worker.joinable()) worker.join();
+    }
+#endif
+}
+
+void prefetch_pool::submit(prefetch_result const& task)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (stop_ || max_threads_ == 0) return;
+    join_finished();
+    queue_.push_back(task);
+    if (queue_.size() > idle_ && running_ < max_threads_)
+    {
+        try
+        {
+            workers_.emplace_back(&prefetch_pool::work, this);
+            ++running_;
+        }
+        catch (std::system_error const&)
+        {
+            // no thread to spare, the renderer runs the task when it gets to it
+        }
+    }
+    else
+    {
+        cond_.notify_one();
+    }
+#else
+    (void)task;
+#endif
+}
+
+#ifdef MAPNIK_THREADSAFE
+void prefetch_pool::work()
+{
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    while (true)
+    {
+        ++idle_;
+        cond_.wait(lock, [this] { return stop_ || running_ > max_threads_ || !queue_.empty(); });
+        --idle_;
+        if (stop_ || running_ > max_threads_)
+        {
+            --running_;
+            if (!stop_) finished_.push_back(std::this_thread::get_id());
+            return;
+        }
+        std::shared_ptr<prefetch_task> task = queue_.front().lock();
+        queue_.pop_front();
+        if (!task) continue;
+        lock.unlock();
+        task->run();
+        task.reset();
+        lock.lock();
+    }
+}
+
+// called with pool_mutex_ held, finished workers no longer need it to exit
+void prefetch_pool::join_finished()
+{
+    for (std::thread::id id : finished_)
+    {
+        auto itr = std::find_if(workers_.begin(), workers_.end(),
+                                [id](std::thread const& worker) { return worker.get_id() == id; });
+        if (itr != workers_.end())
+        {
+            itr->join();
+            workers_.erase(itr);
+        }
+    }
+    finished_.clear();
+}
+#endif
+
+void prefetch_pool::set_max_threads(std::size_t max_threads)
+{
+#ifdef MAPNIK_THREADSAFE
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        max_threads_ = max_threads;
+    }
+    // workers above the new maximum exit
+    cond_.notify_all();
+#else
+    max_threads_ = max_threads;
+#endif
+}
+
+std::size_t prefetch_pool::max_threads() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+#endif
+    return max_threads_;
+}
+
+std::size_t prefetch_pool::threads() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    return running_;
+#else
+    return 0;
+#endif
+}
+
+}
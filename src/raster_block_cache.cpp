@@ -0,0 +1,42 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/raster_block_cache.hpp>
+#include <mapnik/image_any.hpp>
+
+namespace mapnik
+{
+
+template class singleton<raster_block_cache, CreateStatic>;
+
+std::size_t raster_block_size::operator()(raster_block_ptr const& block) const
+{
+    return block ? block->size() : 0;
+}
+
+raster_block_cache::raster_block_cache()
+    : shared_lru_cache(64 << 20) {}
+
+raster_block_cache::~raster_block_cache() {}
+
+}
@@ -88,6 +88,15 @@ renderer_common::renderer_common(Map const &m, request const &req, attributes co
                                       req.width() + req.buffer_size() ,req.height() + req.buffer_size())))
 {}
 
+renderer_common::renderer_common(Map const &m, renderer_common const& other, detector_ptr detector)
+   : renderer_common(m, other.width_, other.height_, other.scale_factor_,
+                     other.vars_,
+                     view_transform(other.t_),
+                     detector)
+{
+    query_extent_ = other.query_extent_;
+}
+
 renderer_common::~renderer_common()
 {
     // defined in .cpp to make this destructible elsewhere without
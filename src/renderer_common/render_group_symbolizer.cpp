@@ -22,6 +22,7 @@
 
 // mapnik
 #include <mapnik/attribute_collector.hpp>
+#include <mapnik/compiled_expression.hpp>
 #include <mapnik/feature_factory.hpp>
 #include <mapnik/group/group_layout_manager.hpp>
 #include <mapnik/group/group_symbolizer_helper.hpp>
@@ -123,8 +124,7 @@ void render_group_symbolizer(group_symbolizer const& sym,
         // get the layout for this set of properties
         for (auto const& rule : props->get_rules())
         {
-             if (util::apply_visitor(evaluate<feature_impl,value_type,attributes>(*sub_feature,common.vars_),
-                                               *(rule->get_filter())).to_bool())
+             if (evaluate_value(rule->get_filter(), *sub_feature, common.vars_).to_bool())
              {
                 // add matched rule and feature to the list of things to draw
                 matches.emplace_back(rule, sub_feature);
@@ -173,8 +173,7 @@ void render_group_symbolizer(group_symbolizer const& sym,
         // evaluate the repeat key with the matched sub feature if we have one
         if (rpt_key_expr)
         {
-            rpt_key_value = util::apply_visitor(evaluate<feature_impl,value_type,attributes>(*match_feature,common.vars_),
-                                                *rpt_key_expr).to_unicode();
+            rpt_key_value = evaluate_value(rpt_key_expr, *match_feature, common.vars_).to_unicode();
         }
         helper.add_box_element(layout_manager.offset_box_at(i), rpt_key_value);
     }
@@ -262,4 +262,32 @@ void render_markers_symbolizer(markers_symbolizer const& sym,
     }
 }
 
+void render_markers_symbolizer(markers_symbolizer const& sym,
+                               feature_batch const& features,
+                               proj_transform const& prj_trans,
+                               renderer_common const& common,
+                               box2d<double> const& clip_box,
+                               markers_renderer_context & renderer_context)
+{
+    using Detector = label_collision_detector4;
+    using RendererType = renderer_common;
+    using ContextType = markers_renderer_context;
+    using VisitorType = detail::render_marker_symbolizer_visitor<Detector,
+                                                                 RendererType,
+                                                                 ContextType>;
+
+    if (features.empty()) return;
+    std::string filename = get<std::string>(sym, keys::file, *features.front(), common.vars_, "shape://ellipse");
+    if (!filename.empty())
+    {
+        auto mark = mapnik::marker_cache::instance().find(filename, true);
+        for (feature_ptr const& feature : features)
+        {
+            VisitorType visitor(filename, sym, *feature, prj_trans, common, clip_box,
+                                renderer_context);
+            util::apply_visitor(visitor, *mark);
+        }
+    }
+}
+
 } // namespace mapnik
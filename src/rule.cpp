@@ -23,6 +23,7 @@
 // mapnik
 #include <mapnik/rule.hpp>
 #include <mapnik/expression_node.hpp>
+#include <mapnik/compiled_expression.hpp>
 
 // stl
 #include <limits>
@@ -37,6 +38,7 @@ rule::rule()
       max_scale_(std::numeric_limits<double>::infinity()),
       syms_(),
       filter_(std::make_shared<expr_node>(true)),
+      compiled_filter_(compile_expression(filter_)),
       else_filter_(false),
       also_filter_(false) {}
 
@@ -48,6 +50,7 @@ rule::rule(std::string const& name,
       max_scale_(max_scale_denominator),
       syms_(),
       filter_(std::make_shared<mapnik::expr_node>(true)),
+      compiled_filter_(compile_expression(filter_)),
       else_filter_(false),
       also_filter_(false)  {}
 
@@ -57,6 +60,7 @@ rule::rule(rule const& rhs)
       max_scale_(rhs.max_scale_),
       syms_(rhs.syms_),
       filter_(std::make_shared<expr_node>(*rhs.filter_)),
+      compiled_filter_(rhs.compiled_filter_),
       else_filter_(rhs.else_filter_),
       also_filter_(rhs.also_filter_) {}
 
@@ -66,6 +70,7 @@ rule::rule(rule && rhs)
       max_scale_(std::move(rhs.max_scale_)),
       syms_(std::move(rhs.syms_)),
       filter_(std::move(rhs.filter_)),
+      compiled_filter_(std::move(rhs.compiled_filter_)),
       else_filter_(std::move(rhs.else_filter_)),
       also_filter_(std::move(rhs.also_filter_)) {}
 
@@ -77,6 +82,7 @@ rule& rule::operator=(rule rhs)
     swap(this->max_scale_, rhs.max_scale_);
     swap(this->syms_, rhs.syms_);
     swap(this->filter_, rhs.filter_);
+    swap(this->compiled_filter_, rhs.compiled_filter_);
     swap(this->else_filter_, rhs.else_filter_);
     swap(this->also_filter_, rhs.also_filter_);
     return *this;
@@ -165,6 +171,7 @@ rule::symbolizers::iterator rule::end()
 void rule::set_filter(expression_ptr const& filter)
 {
     filter_=filter;
+    compiled_filter_ = compile_expression(filter_);
 }
 
 expression_ptr const& rule::get_filter() const
@@ -172,6 +179,11 @@ expression_ptr const& rule::get_filter() const
     return filter_;
 }
 
+compiled_expression const& rule::get_compiled_filter() const
+{
+    return *compiled_filter_;
+}
+
 void rule::set_else(bool else_filter)
 {
     else_filter_=else_filter;
@@ -0,0 +1,318 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/rule_index.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/util/variant.hpp>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <utility>
+
+namespace mapnik
+{
+
+namespace {
+
+// condition every value of an attribute matching a filter meets: a string
+// out of `strings` or a number inside one of `ranges` (bounds included)
+struct condition
+{
+    std::vector<value_unicode_string> strings;
+    std::vector<std::pair<double, double> > ranges;
+};
+
+using conditions = std::map<std::string, condition>;
+
+bool literal_number(expr_node const& node, double & val)
+{
+    if (node.is<value_integer>())
+    {
+        val = static_cast<double>(util::get<value_integer>(node));
+        return true;
+    }
+    if (node.is<value_double>())
+    {
+        val = util::get<value_double>(node);
+        return !std::isnan(val);
+    }
+    if (node.is<value_bool>())
+    {
+        val = util::get<value_bool>(node) ? 1.0 : 0.0;
+        return true;
+    }
+    if (node.is<unary_node<tags::negate> >())
+    {
+        if (literal_number(util::get<unary_node<tags::negate> >(node).expr, val))
+        {
+            val = -val;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct filter_analyser
+{
+    // catch-all for nodes implying nothing about a single attribute
+    template <typename T>
+    conditions operator() (T const&) const
+    {
+        return conditions();
+    }
+
+    conditions operator() (binary_node<tags::equal_to> const& x) const
+    {
+        conditions result;
+        expr_node const* attr = &x.left;
+        expr_node const* literal = &x.right;
+        if (!attr->is<attribute>()) std::swap(attr, literal);
+        if (!attr->is<attribute>()) return result;
+        double val;
+        if (literal->is<value_unicode_string>())
+        {
+            result[util::get<attribute>(*attr).name()].strings.push_back(util::get<value_unicode_string>(*literal));
+        }
+        else if (literal_number(*literal, val))
+        {
+            result[util::get<attribute>(*attr).name()].ranges.emplace_back(val, val);
+        }
+        return result;
+    }
+
+    conditions operator() (binary_node<tags::less> const& x) const
+    {
+        return compare(x.left, x.right, false);
+    }
+
+    conditions operator() (binary_node<tags::less_equal> const& x) const
+    {
+        return compare(x.left, x.right, false);
+    }
+
+    conditions operator() (binary_node<tags::greater> const& x) const
+    {
+        return compare(x.left, x.right, true);
+    }
+
+    conditions operator() (binary_node<tags::greater_equal> const& x) const
+    {
+        return compare(x.left, x.right, true);
+    }
+
+    // numeric comparisons only hold for numbers, strict ones are widened
+    // to include the bound since integers are compared as doubles here
+    conditions compare(expr_node const& left, expr_node const& right, bool greater) const
+    {
+        conditions result;
+        double val;
+        double const inf = std::numeric_limits<double>::infinity();
+        if (left.is<attribute>() && literal_number(right, val))
+        {
+            result[util::get<attribute>(left).name()].ranges.push_back(greater ? std::make_pair(val, inf) : std::make_pair(-inf, val));
+        }
+        else if (right.is<attribute>() && literal_number(left, val))
+        {
+            result[util::get<attribute>(right).name()].ranges.push_back(greater ? std::make_pair(-inf, val) : std::make_pair(val, inf));
+        }
+        return result;
+    }
+
+    conditions operator() (binary_node<tags::logical_or> const& x) const
+    {
+        conditions left = util::apply_visitor(*this, x.left);
+        conditions right = util::apply_visitor(*this, x.right);
+        conditions result;
+        for (auto & kv : left)
+        {
+            auto itr = right.find(kv.first);
+            if (itr == right.end()) continue;
+            condition & cond = kv.second;
+            cond.strings.insert(cond.strings.end(), itr->second.strings.begin(), itr->second.strings.end());
+            cond.ranges.insert(cond.ranges.end(), itr->second.ranges.begin(), itr->second.ranges.end());
+            result.emplace(kv.first, std::move(cond));
+        }
+        return result;
+    }
+
+    conditions operator() (binary_node<tags::logical_and> const& x) const
+    {
+        conditions result = util::apply_visitor(*this, x.left);
+        conditions right = util::apply_visitor(*this, x.right);
+        for (auto & kv : right)
+        {
+            auto itr = result.find(kv.first);
+            if (itr == result.end())
+            {
+                result.emplace(kv.first, std::move(kv.second));
+                continue;
+            }
+            // either side alone is a valid condition, ranges such as
+            // [attr] >= 1 and [attr] < 5 are narrowed to their intersection
+            condition & cond = itr->second;
+            if (cond.strings.empty() && kv.second.strings.empty() &&
+                cond.ranges.size() == 1 && kv.second.ranges.size() == 1)
+            {
+                cond.ranges.front().first = std::max(cond.ranges.front().first, kv.second.ranges.front().first);
+                cond.ranges.front().second = std::min(cond.ranges.front().second, kv.second.ranges.front().second);
+            }
+        }
+        return result;
+    }
+};
+
+rule_index::rule_ptrs select(rule_index::rule_ptrs const& rules,
+                             std::vector<condition const*> const& conds,
+                             std::function<bool(condition const&)> const& pred)
+{
+    rule_index::rule_ptrs result;
+    for (std::size_t i = 0; i < rules.size(); ++i)
+    {
+        if (conds[i] == nullptr || pred(*conds[i]))
+        {
+            result.push_back(rules[i]);
+        }
+    }
+    return result;
+}
+
+}
+
+rule_index::rule_index()
+    : attribute_name_(),
+      attribute_(""),
+      unindexed_(),
+      strings_(),
+      bounds_(),
+      segments_() {}
+
+rule_index::rule_index(rule_ptrs const& rules, std::size_t min_indexed)
+    : rule_index()
+{
+    std::vector<conditions> analysed;
+    analysed.reserve(rules.size());
+    std::map<std::string, std::size_t> counts;
+    for (rule const* r : rules)
+    {
+        analysed.push_back(util::apply_visitor(filter_analyser(), *r->get_filter()));
+        for (auto const& kv : analysed.back())
+        {
+            ++counts[kv.first];
+        }
+    }
+    auto best = std::max_element(counts.begin(), counts.end(),
+                                 [](std::pair<std::string const, std::size_t> const& lhs,
+                                    std::pair<std::string const, std::size_t> const& rhs)
+                                 { return lhs.second < rhs.second; });
+    if (best == counts.end() || best->second < std::max(min_indexed, std::size_t(1))) return;
+
+    attribute_name_ = best->first;
+    attribute_ = attribute(attribute_name_);
+    std::vector<condition const*> conds;
+    for (conditions const& c : analysed)
+    {
+        auto itr = c.find(attribute_name_);
+        conds.push_back(itr != c.end() ? &itr->second : nullptr);
+    }
+
+    unindexed_ = select(rules, conds, [](condition const&) { return false; });
+    for (condition const* cond : conds)
+    {
+        if (cond == nullptr) continue;
+        for (value_unicode_string const& str : cond->strings)
+        {
+            if (strings_.count(str)) continue;
+            strings_.emplace(str, select(rules, conds, [&str](condition const& c)
+                                         {
+                                             return std::find(c.strings.begin(), c.strings.end(), str) != c.strings.end();
+                                         }));
+        }
+        for (auto const& range : cond->ranges)
+        {
+            if (std::isfinite(range.first)) bounds_.push_back(range.first);
+            if (std::isfinite(range.second)) bounds_.push_back(range.second);
+        }
+    }
+    std::sort(bounds_.begin(), bounds_.end());
+    bounds_.erase(std::unique(bounds_.begin(), bounds_.end()), bounds_.end());
+
+    double const inf = std::numeric_limits<double>::infinity();
+    std::size_t num_bounds = bounds_.size();
+    for (std::size_t seg = 0; seg < 2 * num_bounds + 1; ++seg)
+    {
+        std::size_t i = seg / 2;
+        // a segment is either inside or outside each range, since range
+        // bounds are themselves segment bounds
+        double lo = (seg % 2 == 1) ? bounds_[i] : (i > 0 ? bounds_[i - 1] : -inf);
+        double hi = (seg % 2 == 1) ? bounds_[i] : (i < num_bounds ? bounds_[i] : inf);
+        segments_.push_back(select(rules, conds, [lo, hi](condition const& c)
+                                   {
+                                       for (auto const& range : c.ranges)
+                                       {
+                                           if (range.first <= lo && hi <= range.second) return true;
+                                       }
+                                       return false;
+                                   }));
+    }
+}
+
+rule_index::rule_ptrs const& rule_index::candidates(feature_impl const& feature) const
+{
+    value const& val = attribute_.value<value, feature_impl>(feature);
+    double num;
+    if (val.is<value_unicode_string>())
+    {
+        auto itr = strings_.find(util::get<value_unicode_string>(val));
+        return itr != strings_.end() ? itr->second : unindexed_;
+    }
+    else if (val.is<value_integer>())
+    {
+        num = static_cast<double>(util::get<value_integer>(val));
+    }
+    else if (val.is<value_double>())
+    {
+        num = util::get<value_double>(val);
+    }
+    else if (val.is<value_bool>())
+    {
+        num = util::get<value_bool>(val) ? 1.0 : 0.0;
+    }
+    else
+    {
+        return unindexed_;
+    }
+    std::size_t i = static_cast<std::size_t>(std::lower_bound(bounds_.begin(), bounds_.end(), num) - bounds_.begin());
+    if (i < bounds_.size() && bounds_[i] == num)
+    {
+        return segments_[2 * i + 1];
+    }
+    return segments_[2 * i];
+}
+
+}
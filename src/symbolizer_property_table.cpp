@@ -0,0 +1,97 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/symbolizer_property_table.hpp>
+#include <mapnik/util/variant.hpp>
+
+// stl
+#include <atomic>
+
+namespace mapnik
+{
+
+namespace {
+
+// values holding expressions
+bool feature_dependent(symbolizer_base::value_type const& val)
+{
+    return val.is<expression_ptr>() || val.is<path_expression_ptr>() || val.is<transform_type>() ||
+        val.is<text_placements_ptr>() || val.is<group_symbolizer_properties_ptr>();
+}
+
+}
+
+std::uint64_t next_property_map_version()
+{
+    static std::atomic<std::uint64_t> version(0);
+    return ++version;
+}
+
+constexpr std::uint8_t property_table::unset;
+
+property_table::property_table(symbolizer_base::cont_type const& properties)
+    : index_(),
+      values_(),
+      compiled_(),
+      depends_on_feature_(false),
+      version_(properties.version())
+{
+    index_.fill(unset);
+    values_.reserve(properties.size());
+    compiled_.reserve(properties.size());
+    for (auto const& prop : properties)
+    {
+        index_[static_cast<std::size_t>(prop.first)] = static_cast<std::uint8_t>(values_.size());
+        values_.push_back(prop.second);
+        compiled_expression_ptr compiled;
+        if (prop.second.is<expression_ptr>())
+        {
+            compiled = compile_expression(util::get<expression_ptr>(prop.second));
+        }
+        if (compiled ? !compiled->is_constant() : feature_dependent(prop.second))
+        {
+            depends_on_feature_ = true;
+        }
+        compiled_.push_back(std::move(compiled));
+    }
+}
+
+void update_property_table(symbolizer_base & sym)
+{
+    sym.table = std::make_shared<property_table const>(sym.properties);
+}
+
+bool properties_depend_on_feature(symbolizer_base const& sym)
+{
+    if (property_table_current(sym))
+    {
+        return sym.table->depends_on_feature();
+    }
+    for (auto const& prop : sym.properties)
+    {
+        if (feature_dependent(prop.second)) return true;
+    }
+    return false;
+}
+
+}
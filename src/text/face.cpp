@@ -36,16 +36,28 @@ extern "C"
 namespace mapnik
 {
 
-font_face::font_face(FT_Face face)
-    : face_(face) {}
+font_face::font_face(FT_Face face, std::string const& file_name, int face_index)
+    : face_(face),
+      file_name_(file_name),
+      face_index_(face_index),
+      char_size_(-1) {}
 
 bool font_face::set_character_sizes(double size)
 {
-    return (FT_Set_Char_Size(face_,0,static_cast<FT_F26Dot6>(size * (1<<6)),0,0) == 0);
+    FT_F26Dot6 char_size = static_cast<FT_F26Dot6>(size * (1<<6));
+    if (char_size == char_size_) return true;
+    if (FT_Set_Char_Size(face_,0,char_size,0,0) != 0)
+    {
+        char_size_ = -1;
+        return false;
+    }
+    char_size_ = char_size;
+    return true;
 }
 
 bool font_face::set_unscaled_character_sizes()
 {
+    char_size_ = -1;
     return (FT_Set_Char_Size(face_,0,face_->units_per_EM,0,0) == 0);
 }
 
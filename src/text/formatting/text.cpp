@@ -23,6 +23,7 @@
 #include <mapnik/text/formatting/text.hpp>
 #include <mapnik/expression_string.hpp>
 #include <mapnik/expression_evaluator.hpp>
+#include <mapnik/compiled_expression.hpp>
 #include <mapnik/feature.hpp>
 #include <mapnik/symbolizer.hpp>
 #include <mapnik/text/text_properties.hpp>
@@ -55,7 +56,7 @@ node_ptr text_node::from_xml(xml_node const& xml, fontset_map const&)
 
 void text_node::apply(evaluated_format_properties_ptr const& p, feature_impl const& feature, attributes const& vars, text_layout &output) const
 {
-    mapnik::value_unicode_string text_str = util::apply_visitor(evaluate<feature_impl,value_type,attributes>(feature,vars), *text_).to_unicode();
+    mapnik::value_unicode_string text_str = compiled_text_->evaluate(feature, vars).to_unicode();
     switch (p->text_transform)
     {
     case UPPERCASE:
@@ -93,6 +94,7 @@ void text_node::add_expressions(expression_set &output) const
 void text_node::set_text(expression_ptr text)
 {
     text_ = text;
+    compiled_text_ = compile_expression(text_);
 }
 
 
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/text/glyph_cache.hpp>
+#include <mapnik/text/face.hpp>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+
+extern "C"
+{
+#include FT_GLYPH_H
+}
+
+#pragma GCC diagnostic pop
+
+// stl
+#include <cstring>
+
+namespace mapnik
+{
+
+template class singleton<glyph_cache, CreateStatic>;
+
+namespace {
+
+glyph_bitmap_ptr render_glyph(font_face & face,
+                              double size,
+                              unsigned glyph_index,
+                              std::uint8_t subpixel_x,
+                              std::uint8_t subpixel_y,
+                              std::uint16_t rotation,
+                              double halo_radius,
+                              stroker_ptr const& stroker)
+{
+    if (!face.set_character_sizes(size)) return glyph_bitmap_ptr();
+    FT_Face ft_face = face.get_face();
+    FT_Vector delta;
+    delta.x = subpixel_x * (64 / glyph_cache::subpixel_steps);
+    delta.y = subpixel_y * (64 / glyph_cache::subpixel_steps);
+    if (rotation == 0)
+    {
+        FT_Set_Transform(ft_face, 0, &delta);
+    }
+    else
+    {
+        // same matrix as text_renderer::prepare_glyphs() uses
+        mapnik::rotation rot = glyph_cache::step_rotation(rotation);
+        FT_Matrix matrix;
+        matrix.xx = static_cast<FT_Fixed>( rot.cos * 0x10000L);
+        matrix.xy = static_cast<FT_Fixed>(-rot.sin * 0x10000L);
+        matrix.yx = static_cast<FT_Fixed>( rot.sin * 0x10000L);
+        matrix.yy = static_cast<FT_Fixed>( rot.cos * 0x10000L);
+        FT_Set_Transform(ft_face, &matrix, &delta);
+    }
+    if (FT_Load_Glyph(ft_face, glyph_index, FT_LOAD_NO_HINTING)) return glyph_bitmap_ptr();
+
+    FT_Glyph image;
+    if (FT_Get_Glyph(ft_face->glyph, &image)) return glyph_bitmap_ptr();
+    FT_Error error = 0;
+    if (halo_radius > 0.0)
+    {
+        stroker->init(halo_radius);
+        error = FT_Glyph_Stroke(&image, stroker->get(), 1);
+    }
+    if (!error)
+    {
+        error = FT_Glyph_To_Bitmap(&image, FT_RENDER_MODE_NORMAL, 0, 1);
+    }
+    if (error)
+    {
+        FT_Done_Glyph(image);
+        return glyph_bitmap_ptr();
+    }
+
+    FT_BitmapGlyph bit = reinterpret_cast<FT_BitmapGlyph>(image);
+    auto bitmap = std::make_shared<glyph_bitmap>();
+    bitmap->left = bit->left;
+    bitmap->top = bit->top;
+    bitmap->width = bit->bitmap.width;
+    bitmap->rows = bit->bitmap.rows;
+    bitmap->buffer.resize(bitmap->width * bitmap->rows);
+    for (unsigned row = 0; row < bitmap->rows; ++row)
+    {
+        // pitch may be negative or padded, copy row by row
+        std::memcpy(bitmap->buffer.data() + row * bitmap->width,
+                    bit->bitmap.buffer + static_cast<std::ptrdiff_t>(row) * bit->bitmap.pitch,
+                    bitmap->width);
+    }
+    FT_Done_Glyph(image);
+    return bitmap;
+}
+
+}
+
+glyph_cache::glyph_cache()
+    : shared_lru_cache(10000) {}
+
+glyph_cache::~glyph_cache() {}
+
+glyph_bitmap_ptr glyph_cache::get(font_face & face,
+                                  double size,
+                                  unsigned glyph_index,
+                                  std::uint8_t subpixel_x,
+                                  std::uint8_t subpixel_y,
+                                  std::uint16_t rotation,
+                                  double halo_radius,
+                                  stroker_ptr const& stroker)
+{
+    if (face.file_name().empty())
+    {
+        return render_glyph(face, size, glyph_index, subpixel_x, subpixel_y, rotation, halo_radius, stroker);
+    }
+    glyph_cache_key key;
+    key.face_file = face.file_name();
+    key.face_index = face.face_index();
+    key.size = static_cast<std::int32_t>(size * 64);
+    key.glyph_index = glyph_index;
+    key.subpixel_x = subpixel_x;
+    key.subpixel_y = subpixel_y;
+    key.rotation = rotation;
+    key.halo_radius = static_cast<std::int32_t>(halo_radius * 64);
+    glyph_bitmap_ptr cached = find(key);
+    if (cached) return cached;
+    // rasterise without holding the lock, another thread may race us
+    // to the same glyph which only costs a redundant render
+    glyph_bitmap_ptr bitmap = render_glyph(face, size, glyph_index, subpixel_x, subpixel_y,
+                                           rotation, halo_radius, stroker);
+    if (bitmap) insert(key, bitmap);
+    return bitmap;
+}
+
+}
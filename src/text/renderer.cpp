@@ -26,9 +26,13 @@
 #include <mapnik/text/text_properties.hpp>
 #include <mapnik/font_engine_freetype.hpp>
 #include <mapnik/text/face.hpp>
+#include <mapnik/text/glyph_cache.hpp>
 #include <mapnik/image_util.hpp>
 #include <mapnik/image_any.hpp>
 
+// stl
+#include <cstring>
+
 namespace mapnik
 {
 
@@ -110,6 +114,28 @@ void composite_bitmap(T & pixmap, FT_Bitmap *bitmap, unsigned rgba, int x, int y
     }
 }
 
+namespace {
+
+bool is_translation(agg::trans_affine const& tr)
+{
+    return tr.sx == 1.0 && tr.sy == 1.0 && tr.shx == 0.0 && tr.shy == 0.0;
+}
+
+FT_Bitmap make_ft_bitmap(glyph_bitmap const& bitmap)
+{
+    FT_Bitmap ft_bitmap;
+    std::memset(&ft_bitmap, 0, sizeof(ft_bitmap));
+    ft_bitmap.rows = bitmap.rows;
+    ft_bitmap.width = bitmap.width;
+    ft_bitmap.pitch = static_cast<int>(bitmap.width);
+    ft_bitmap.buffer = const_cast<unsigned char*>(bitmap.buffer.data());
+    ft_bitmap.num_grays = 256;
+    ft_bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+    return ft_bitmap;
+}
+
+}
+
 template <typename T>
 agg_text_renderer<T>::agg_text_renderer (pixmap_type & pixmap,
                                          halo_rasterizer_e rasterizer,
@@ -120,9 +146,92 @@ agg_text_renderer<T>::agg_text_renderer (pixmap_type & pixmap,
     : text_renderer(rasterizer, comp_op, halo_comp_op, scale_factor, stroker), pixmap_(pixmap)
 {}
 
+// Renders unscaled glyphs from the shared glyph_cache, rotated by the
+// nearest rotation step. Returns false when glyphs need the full FreeType
+// transform path or the cache is disabled.
+template <typename T>
+bool agg_text_renderer<T>::render_cached(glyph_positions const& pos)
+{
+    if (!is_translation(transform_) || !is_translation(halo_transform_)) return false;
+
+    glyph_cache & cache = glyph_cache::instance();
+    if (cache.max_entries() == 0) return false;
+    int height = pixmap_.height();
+    pixel_position const& base_point = pos.get_base_point();
+    FT_Pos start_x = static_cast<FT_Pos>(base_point.x * (1 << 6));
+    FT_Pos start_y = static_cast<FT_Pos>((height - base_point.y) * (1 << 6));
+    FT_Pos start_halo_x = start_x + static_cast<FT_Pos>(halo_transform_.tx * 64);
+    FT_Pos start_halo_y = start_y + static_cast<FT_Pos>(halo_transform_.ty * 64);
+    start_x += static_cast<FT_Pos>(transform_.tx * 64);
+    start_y += static_cast<FT_Pos>(transform_.ty * 64);
+    bool full_halo = rasterizer_ == HALO_RASTERIZER_FULL;
+
+    for (auto const& glyph_pos : pos)
+    {
+        glyph_info const& glyph = glyph_pos.glyph;
+        double halo_radius = glyph.format->halo_radius * scale_factor_;
+        // make sure we've got reasonable values.
+        if (halo_radius <= 0.0 || halo_radius > 1024.0) continue;
+        pixel_position glyph_offset = glyph_pos.pos + glyph.offset.rotate(glyph_pos.rot);
+        long x, y;
+        std::uint8_t subpixel_x = glyph_cache::split_position(static_cast<FT_Pos>(glyph_offset.x * 64) + start_halo_x, x);
+        std::uint8_t subpixel_y = glyph_cache::split_position(static_cast<FT_Pos>(glyph_offset.y * 64) + start_halo_y, y);
+        glyph_bitmap_ptr bitmap = cache.get(*glyph.face, glyph.format->text_size * scale_factor_,
+                                            glyph.glyph_index, subpixel_x, subpixel_y,
+                                            glyph_cache::snap_rotation(glyph_pos.rot),
+                                            full_halo ? halo_radius : 0.0, stroker_);
+        if (!bitmap) continue;
+        FT_Bitmap ft_bitmap = make_ft_bitmap(*bitmap);
+        if (full_halo)
+        {
+            composite_bitmap(pixmap_,
+                             &ft_bitmap,
+                             glyph.format->halo_fill.rgba(),
+                             x + bitmap->left,
+                             height - (y + bitmap->top),
+                             glyph.format->halo_opacity,
+                             halo_comp_op_);
+        }
+        else
+        {
+            render_halo(&ft_bitmap,
+                        glyph.format->halo_fill.rgba(),
+                        x + bitmap->left,
+                        height - (y + bitmap->top),
+                        halo_radius,
+                        glyph.format->halo_opacity,
+                        halo_comp_op_);
+        }
+    }
+
+    // render actual text
+    for (auto const& glyph_pos : pos)
+    {
+        glyph_info const& glyph = glyph_pos.glyph;
+        pixel_position glyph_offset = glyph_pos.pos + glyph.offset.rotate(glyph_pos.rot);
+        long x, y;
+        std::uint8_t subpixel_x = glyph_cache::split_position(static_cast<FT_Pos>(glyph_offset.x * 64) + start_x, x);
+        std::uint8_t subpixel_y = glyph_cache::split_position(static_cast<FT_Pos>(glyph_offset.y * 64) + start_y, y);
+        glyph_bitmap_ptr bitmap = cache.get(*glyph.face, glyph.format->text_size * scale_factor_,
+                                            glyph.glyph_index, subpixel_x, subpixel_y,
+                                            glyph_cache::snap_rotation(glyph_pos.rot), 0.0, stroker_);
+        if (!bitmap) continue;
+        FT_Bitmap ft_bitmap = make_ft_bitmap(*bitmap);
+        composite_bitmap(pixmap_,
+                         &ft_bitmap,
+                         glyph.format->fill.rgba(),
+                         x + bitmap->left,
+                         height - (y + bitmap->top),
+                         glyph.format->text_opacity,
+                         comp_op_);
+    }
+    return true;
+}
+
 template <typename T>
 void agg_text_renderer<T>::render(glyph_positions const& pos)
 {
+    if (render_cached(pos)) return;
     prepare_glyphs(pos);
     FT_Error  error;
     FT_Vector start;
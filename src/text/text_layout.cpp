@@ -162,7 +162,9 @@ text_layout::text_layout(face_manager_freetype & font_manager,
 
 void text_layout::add_text(mapnik::value_unicode_string const& str, evaluated_format_properties_ptr const& format)
 {
+    unsigned start = itemizer_.text().length();
     itemizer_.add_text(str, format);
+    format_runs_.push_back(format_run{start, static_cast<unsigned>(itemizer_.text().length()), &format});
 }
 
 void text_layout::add_child(text_layout_ptr const& child_layout)
@@ -433,6 +435,7 @@ void text_layout::clear_cluster_widths(unsigned first, unsigned last)
 void text_layout::clear()
 {
     itemizer_.clear();
+    format_runs_.clear();
     lines_.clear();
     width_map_.clear();
     width_ = 0.0;
@@ -440,9 +443,158 @@ void text_layout::clear()
     child_layout_list_.clear();
 }
 
+namespace {
+
+template <typename T>
+void append_key(std::string & key, T const& val)
+{
+    key.append(reinterpret_cast<char const*>(&val), sizeof(T));
+}
+
+void append_key(std::string & key, std::string const& str)
+{
+    append_key(key, str.size());
+    key.append(str);
+}
+
+}
+
 void text_layout::shape_text(text_line & line)
 {
+    if (line.first_char() == line.last_char())
+    {
+        harfbuzz_shaper::shape_text(line, itemizer_, width_map_, font_manager_, scale_factor_);
+        return;
+    }
+    shaped_text_cache & cache = shaped_text_cache::instance();
+    std::string key = cache.max_entries() > 0 ? shaping_key(line) : std::string();
+    if (key.empty())
+    {
+        harfbuzz_shaper::shape_text(line, itemizer_, width_map_, font_manager_, scale_factor_);
+        return;
+    }
+    shaped_line_ptr cached = cache.find(key);
+    if (cached && apply_shaped_line(line, *cached)) return;
     harfbuzz_shaper::shape_text(line, itemizer_, width_map_, font_manager_, scale_factor_);
+    if (shaped_line_ptr shaped = make_shaped_line(line))
+    {
+        cache.insert(key, shaped);
+    }
+}
+
+// Everything shaping a line depends on: the whole text (script runs are
+// detected over all of it), the line range and the formats covering it,
+// with faces identified by the font file and face index they resolve to.
+// Returns an empty key if a face wasn't loaded from a file.
+std::string text_layout::shaping_key(text_line const& line) const
+{
+    mapnik::value_unicode_string const& text = itemizer_.text();
+    std::string key;
+    append_key(key, text.length());
+    key.append(reinterpret_cast<char const*>(text.getBuffer()), text.length() * sizeof(UChar));
+    append_key(key, line.first_char());
+    append_key(key, line.last_char());
+    append_key(key, scale_factor_);
+    for (auto const& run : format_runs_)
+    {
+        if (run.end <= line.first_char() || run.start >= line.last_char()) continue;
+        evaluated_format_properties const& format = **run.format;
+        append_key(key, run.start);
+        append_key(key, run.end);
+        face_set_ptr face_set = font_manager_.get_face_set(format.face_name, format.fontset);
+        append_key(key, face_set->size());
+        for (face_ptr const& face : *face_set)
+        {
+            if (face->file_name().empty()) return std::string();
+            append_key(key, face->file_name());
+            append_key(key, face->face_index());
+        }
+        append_key(key, format.text_size);
+        append_key(key, format.ff_settings.to_string());
+    }
+    return key;
+}
+
+std::size_t text_layout::find_format_run(unsigned char_index) const
+{
+    for (std::size_t i = 0; i < format_runs_.size(); ++i)
+    {
+        if (format_runs_[i].start <= char_index && char_index < format_runs_[i].end) return i;
+    }
+    return format_runs_.size();
+}
+
+bool text_layout::apply_shaped_line(text_line & line, shaped_line const& shaped)
+{
+    // resolve faces first so the line is untouched if anything is missing
+    std::vector<face_set_ptr> face_sets(format_runs_.size());
+    std::vector<face_ptr> faces;
+    std::vector<std::size_t> runs;
+    faces.reserve(shaped.glyphs.size());
+    runs.reserve(shaped.glyphs.size());
+    for (auto const& glyph : shaped.glyphs)
+    {
+        std::size_t run = find_format_run(glyph.char_index);
+        if (run == format_runs_.size()) return false;
+        face_set_ptr & face_set = face_sets[run];
+        if (!face_set)
+        {
+            evaluated_format_properties const& format = **format_runs_[run].format;
+            face_set = font_manager_.get_face_set(format.face_name, format.fontset);
+        }
+        if (glyph.face_index >= face_set->size()) return false;
+        faces.push_back(*(face_set->begin() + glyph.face_index));
+        runs.push_back(run);
+    }
+
+    line.reserve(shaped.glyphs.size());
+    for (std::size_t i = 0; i < shaped.glyphs.size(); ++i)
+    {
+        shaped_glyph const& glyph = shaped.glyphs[i];
+        glyph_info g(glyph.glyph_index, glyph.char_index, *format_runs_[runs[i]].format);
+        g.face = faces[i];
+        g.unscaled_ymin = glyph.unscaled_ymin;
+        g.unscaled_ymax = glyph.unscaled_ymax;
+        g.unscaled_advance = glyph.unscaled_advance;
+        g.unscaled_line_height = glyph.unscaled_line_height;
+        g.scale_multiplier = glyph.scale_multiplier;
+        g.offset = glyph.offset;
+        width_map_[glyph.char_index] += g.advance();
+        line.add_glyph(std::move(g), scale_factor_);
+    }
+    line.update_max_char_height(shaped.max_char_height);
+    return true;
+}
+
+shaped_line_ptr text_layout::make_shaped_line(text_line const& line) const
+{
+    auto shaped = std::make_shared<shaped_line>();
+    shaped->glyphs.reserve(line.size());
+    shaped->max_char_height = line.max_char_height();
+    std::vector<face_set_ptr> face_sets(format_runs_.size());
+    for (auto const& glyph : line)
+    {
+        std::size_t run = find_format_run(glyph.char_index);
+        if (run == format_runs_.size() || &glyph.format != format_runs_[run].format) return shaped_line_ptr();
+        face_set_ptr & face_set = face_sets[run];
+        if (!face_set)
+        {
+            evaluated_format_properties const& format = **format_runs_[run].format;
+            face_set = font_manager_.get_face_set(format.face_name, format.fontset);
+        }
+        auto itr = std::find(face_set->begin(), face_set->end(), glyph.face);
+        if (itr == face_set->end()) return shaped_line_ptr();
+        shaped->glyphs.push_back(shaped_glyph{glyph.glyph_index,
+                    glyph.char_index,
+                    static_cast<unsigned>(itr - face_set->begin()),
+                    glyph.unscaled_ymin,
+                    glyph.unscaled_ymax,
+                    glyph.unscaled_advance,
+                    glyph.unscaled_line_height,
+                    glyph.scale_multiplier,
+                    glyph.offset});
+    }
+    return shaped;
 }
 
 void text_layout::init_auto_alignment()
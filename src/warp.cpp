@@ -30,6 +30,9 @@
 #include <mapnik/view_transform.hpp>
 #include <mapnik/raster.hpp>
 #include <mapnik/proj_transform.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/warp_mesh_cache.hpp>
+#include <mapnik/util/parallel.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore_agg.hpp>
@@ -48,13 +51,78 @@
 #include "agg_renderer_scanline.h"
 #pragma GCC diagnostic pop
 
+// stl
+#include <algorithm>
+#include <cmath>
+
 namespace mapnik {
 
+template class singleton<warp_mesh_cache, CreateStatic>;
+
+warp_mesh_cache::warp_mesh_cache()
+    : shared_lru_cache(256) {}
+
+warp_mesh_cache::~warp_mesh_cache() {}
+
+namespace {
+
+// Mesh of source grid points projected into target pixel coordinates
+warp_mesh_ptr make_warp_mesh(std::size_t source_width, std::size_t source_height,
+                             proj_transform const& prj_trans,
+                             view_transform const& ts, view_transform const& tt,
+                             unsigned mesh_size)
+{
+    auto mesh = std::make_shared<warp_mesh>();
+    mesh->nx = std::ceil(source_width/double(mesh_size) + 1);
+    mesh->ny = std::ceil(source_height/double(mesh_size) + 1);
+    mesh->xs.resize(mesh->nx * mesh->ny);
+    mesh->ys.resize(mesh->nx * mesh->ny);
+    for (std::size_t j = 0; j < mesh->ny; ++j)
+    {
+        for (std::size_t i = 0; i < mesh->nx; ++i)
+        {
+            double & x = mesh->xs[j * mesh->nx + i];
+            double & y = mesh->ys[j * mesh->nx + i];
+            x = std::min(i * mesh_size, source_width);
+            y = std::min(j * mesh_size, source_height);
+            ts.backward(&x, &y);
+        }
+    }
+    prj_trans.backward(mesh->xs.data(), mesh->ys.data(), nullptr, mesh->nx * mesh->ny);
+    for (std::size_t k = 0; k < mesh->xs.size(); ++k)
+    {
+        tt.forward(&mesh->xs[k], &mesh->ys[k]);
+    }
+    return mesh;
+}
+
+// agg::render_scanlines_bin() restricted to scanlines [y0, y1), producing
+// the same pixels there as rendering the whole polygon
+template <typename Rasterizer, typename Scanline, typename BaseRenderer,
+          typename SpanAllocator, typename SpanGenerator>
+void render_scanlines_bin_rows(Rasterizer & ras, Scanline & sl, BaseRenderer & ren,
+                               SpanAllocator & alloc, SpanGenerator & span_gen,
+                               int y0, int y1)
+{
+    if (ras.rewind_scanlines() && ras.max_y() >= y0 && ras.min_y() < y1)
+    {
+        if (ras.min_y() < y0) ras.navigate_scanline(y0);
+        sl.reset(ras.min_x(), ras.max_x());
+        span_gen.prepare();
+        while (ras.sweep_scanline(sl) && sl.y() < y1)
+        {
+            agg::render_scanline_bin(sl, ren, alloc, span_gen);
+        }
+    }
+}
+
+}
+
 template <typename T>
 MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const& prj_trans,
                  box2d<double> const& target_ext, box2d<double> const& source_ext,
                  double offset_x, double offset_y, unsigned mesh_size, scaling_method_e scaling_method, double filter_factor,
-                 boost::optional<double> const & nodata_value)
+                 boost::optional<double> const & nodata_value, unsigned jobs)
 {
     using image_type = T;
     using pixel_type = typename image_type::pixel_type;
@@ -65,103 +133,123 @@ MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const&
 
     constexpr std::size_t pixel_size = sizeof(pixel_type);
 
+    if (target.width() == 0 || target.height() == 0) return;
+
     view_transform ts(source.width(), source.height(),
                       source_ext);
     view_transform tt(target.width(), target.height(),
                       target_ext, offset_x, offset_y);
 
-    std::size_t mesh_nx = std::ceil(source.width()/double(mesh_size) + 1);
-    std::size_t mesh_ny = std::ceil(source.height()/double(mesh_size) + 1);
-
-    image_gray64f xs(mesh_nx, mesh_ny, false);
-    image_gray64f ys(mesh_nx, mesh_ny, false);
-
-    // Precalculate reprojected mesh
-    for(std::size_t j = 0; j < mesh_ny; ++j)
+    // Precalculate reprojected mesh, or reuse the one of an identical request
+    warp_mesh_key key;
+    key.source_ext = source_ext;
+    key.target_ext = target_ext;
+    key.source_width = source.width();
+    key.source_height = source.height();
+    key.target_width = target.width();
+    key.target_height = target.height();
+    key.offset_x = offset_x;
+    key.offset_y = offset_y;
+    key.mesh_size = mesh_size;
+    key.source_proj = prj_trans.source().params();
+    key.dest_proj = prj_trans.dest().params();
+    warp_mesh_cache & cache = warp_mesh_cache::instance();
+    warp_mesh_ptr mesh = cache.find(key);
+    if (!mesh)
     {
-        for (std::size_t i=0; i<mesh_nx; ++i)
-        {
-            xs(i,j) = std::min(i*mesh_size,source.width());
-            ys(i,j) = std::min(j*mesh_size,source.height());
-            ts.backward(&xs(i,j), &ys(i,j));
-        }
+        mesh = make_warp_mesh(source.width(), source.height(), prj_trans, ts, tt, mesh_size);
+        cache.insert(key, mesh);
     }
-    prj_trans.backward(xs.data(), ys.data(), nullptr, mesh_nx*mesh_ny);
+    std::size_t const mesh_nx = mesh->nx;
+    std::size_t const mesh_ny = mesh->ny;
+    std::vector<double> const& xs = mesh->xs;
+    std::vector<double> const& ys = mesh->ys;
 
-    agg::rasterizer_scanline_aa<> rasterizer;
-    agg::scanline_bin scanline;
     agg::rendering_buffer buf(target.bytes(),
                               target.width(),
                               target.height(),
                               target.width() * pixel_size);
-    pixfmt_pre pixf(buf);
-    renderer_base rb(pixf);
-    rasterizer.clip_box(0, 0, target.width(), target.height());
     agg::rendering_buffer buf_tile(
         const_cast<unsigned char*>(source.bytes()),
         source.width(),
         source.height(),
         source.width() * pixel_size);
 
-    pixfmt_pre pixf_tile(buf_tile);
-
     using img_accessor_type = agg::image_accessor_clone<pixfmt_pre>;
-    img_accessor_type ia(pixf_tile);
+    agg::image_filter_lut filter;
+    if (scaling_method != SCALING_NEAR)
+    {
+        detail::set_scaling_method(filter, scaling_method, filter_factor);
+    }
+    boost::optional<typename detail::agg_scaling_traits<image_type>::span_image_resample_affine::value_type> nodata;
+    if (nodata_value)
+    {
+        nodata = nodata_value;
+    }
 
-    agg::span_allocator<color_type> sa;
-    // Project mesh cells into target interpolating raster inside each one
-    for (std::size_t j = 0; j < mesh_ny - 1; ++j)
+    // Project mesh cells into target interpolating raster inside each one.
+    // Bands of target rows are rendered independently, each going through
+    // all mesh cells in the same order so overlapping cell edges resolve as
+    // they would on a single thread.
+    util::parallel_bands(target.height(), jobs, 32, [&](std::size_t band_begin, std::size_t band_end)
     {
-        for (std::size_t i = 0; i < mesh_nx - 1; ++i)
+        int y0 = static_cast<int>(band_begin);
+        int y1 = static_cast<int>(band_end);
+        agg::rasterizer_scanline_aa<> rasterizer;
+        agg::scanline_bin scanline;
+        pixfmt_pre pixf(buf);
+        renderer_base rb(pixf);
+        rb.clip_box(0, y0, target.width() - 1, y1 - 1);
+        rasterizer.clip_box(0, 0, target.width(), target.height());
+        pixfmt_pre pixf_tile(buf_tile);
+        img_accessor_type ia(pixf_tile);
+        agg::span_allocator<color_type> sa;
+        for (std::size_t j = 0; j < mesh_ny - 1; ++j)
         {
-            double polygon[8] = {xs(i,j), ys(i,j),
-                                 xs(i+1,j), ys(i+1,j),
-                                 xs(i+1,j+1), ys(i+1,j+1),
-                                 xs(i,j+1), ys(i,j+1)};
-            tt.forward(polygon+0, polygon+1);
-            tt.forward(polygon+2, polygon+3);
-            tt.forward(polygon+4, polygon+5);
-            tt.forward(polygon+6, polygon+7);
-
-            rasterizer.reset();
-            rasterizer.move_to_d(std::floor(polygon[0]), std::floor(polygon[1]));
-            rasterizer.line_to_d(std::floor(polygon[2]), std::floor(polygon[3]));
-            rasterizer.line_to_d(std::floor(polygon[4]), std::floor(polygon[5]));
-            rasterizer.line_to_d(std::floor(polygon[6]), std::floor(polygon[7]));
-
-            std::size_t x0 = i * mesh_size;
-            std::size_t y0 = j * mesh_size;
-            std::size_t x1 = (i+1) * mesh_size;
-            std::size_t y1 = (j+1) * mesh_size;
-            x1 = std::min(x1, source.width());
-            y1 = std::min(y1, source.height());
-            agg::trans_affine tr(polygon, x0, y0, x1, y1);
-            if (tr.is_valid())
+            for (std::size_t i = 0; i < mesh_nx - 1; ++i)
             {
-                interpolator_type interpolator(tr);
-                if (scaling_method == SCALING_NEAR)
-                {
-                    using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_filter;
-                    span_gen_type sg(ia, interpolator);
-                    agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
-                }
-                else
+                std::size_t k0 = j * mesh_nx + i;
+                std::size_t k1 = k0 + mesh_nx;
+                double polygon[8] = {xs[k0], ys[k0],
+                                     xs[k0 + 1], ys[k0 + 1],
+                                     xs[k1 + 1], ys[k1 + 1],
+                                     xs[k1], ys[k1]};
+                double cell_miny = std::min(std::min(polygon[1], polygon[3]), std::min(polygon[5], polygon[7]));
+                double cell_maxy = std::max(std::max(polygon[1], polygon[3]), std::max(polygon[5], polygon[7]));
+                if (std::floor(cell_maxy) < y0 || std::floor(cell_miny) >= y1) continue;
+
+                rasterizer.reset();
+                rasterizer.move_to_d(std::floor(polygon[0]), std::floor(polygon[1]));
+                rasterizer.line_to_d(std::floor(polygon[2]), std::floor(polygon[3]));
+                rasterizer.line_to_d(std::floor(polygon[4]), std::floor(polygon[5]));
+                rasterizer.line_to_d(std::floor(polygon[6]), std::floor(polygon[7]));
+
+                std::size_t x0 = i * mesh_size;
+                std::size_t y0_src = j * mesh_size;
+                std::size_t x1 = (i+1) * mesh_size;
+                std::size_t y1_src = (j+1) * mesh_size;
+                x1 = std::min(x1, source.width());
+                y1_src = std::min(y1_src, source.height());
+                agg::trans_affine tr(polygon, x0, y0_src, x1, y1_src);
+                if (tr.is_valid())
                 {
-                    using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_resample_affine;
-                    agg::image_filter_lut filter;
-                    detail::set_scaling_method(filter, scaling_method, filter_factor);
-                    boost::optional<typename span_gen_type::value_type> nodata;
-                    if (nodata_value)
+                    interpolator_type interpolator(tr);
+                    if (scaling_method == SCALING_NEAR)
+                    {
+                        using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_filter;
+                        span_gen_type sg(ia, interpolator);
+                        render_scanlines_bin_rows(rasterizer, scanline, rb, sa, sg, y0, y1);
+                    }
+                    else
                     {
-                        nodata = nodata_value;
+                        using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_resample_affine;
+                        span_gen_type sg(ia, interpolator, filter, nodata);
+                        render_scanlines_bin_rows(rasterizer, scanline, rb, sa, sg, y0, y1);
                     }
-                    span_gen_type sg(ia, interpolator, filter, nodata);
-                    agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
                 }
             }
-
         }
-    }
+    });
 }
 
 namespace detail {
@@ -238,16 +326,16 @@ void reproject_and_scale_raster(raster & target, raster const& source,
 
 
 template MAPNIK_DECL void warp_image (image_rgba8&, image_rgba8 const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &, unsigned);
 
 template MAPNIK_DECL void warp_image (image_gray8&, image_gray8 const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &, unsigned);
 
 template MAPNIK_DECL void warp_image (image_gray16&, image_gray16 const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &, unsigned);
 
 template MAPNIK_DECL void warp_image (image_gray32f&, image_gray32f const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &, unsigned);
 
 
 }// namespace mapnik
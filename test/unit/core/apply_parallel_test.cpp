@@ -0,0 +1,186 @@
+#include "catch.hpp"
+
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/image_compositing.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/label_collision_detector.hpp>
+#include <mapnik/feature_style_processor_impl.hpp>
+
+namespace {
+
+mapnik::datasource_ptr make_polygon_datasource(double offset)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    mapnik::geometry::polygon<double> poly;
+    poly.exterior_ring.add_coord(offset, offset);
+    poly.exterior_ring.add_coord(offset + 100, offset);
+    poly.exterior_ring.add_coord(offset + 100, offset + 100);
+    poly.exterior_ring.add_coord(offset, offset + 100);
+    poly.exterior_ring.add_coord(offset, offset);
+    feature->set_geometry(std::move(poly));
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    ds->push(feature);
+    return ds;
+}
+
+void add_layer(mapnik::Map & m, std::string const& name, double offset,
+               mapnik::color const& fill, double opacity,
+               boost::optional<mapnik::composite_mode_e> comp_op = boost::optional<mapnik::composite_mode_e>())
+{
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::polygon_symbolizer poly_sym;
+    mapnik::put(poly_sym, mapnik::keys::fill, fill);
+    r.append(std::move(poly_sym));
+    style.add_rule(std::move(r));
+    style.set_opacity(opacity);
+    if (comp_op) style.set_comp_op(*comp_op);
+    m.insert_style(name, std::move(style));
+
+    mapnik::layer lyr(name);
+    lyr.set_datasource(make_polygon_datasource(offset));
+    lyr.add_style(name);
+    m.add_layer(lyr);
+}
+
+void add_markers_layer(mapnik::Map & m, std::string const& name,
+                       std::vector<mapnik::geometry::point<double>> const& points,
+                       mapnik::color const& fill, bool clear_label_cache)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::value_integer id = 1;
+    for (auto const& pt : points)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id++));
+        feature->set_geometry(mapnik::geometry::point<double>(pt));
+        ds->push(feature);
+    }
+
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::markers_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::fill, fill);
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    m.insert_style(name, std::move(style));
+
+    mapnik::layer lyr(name);
+    lyr.set_datasource(ds);
+    lyr.add_style(name);
+    lyr.set_clear_label_cache(clear_label_cache);
+    m.add_layer(lyr);
+}
+
+std::vector<mapnik::box2d<double>> label_boxes(mapnik::label_collision_detector4 & detector)
+{
+    std::vector<mapnik::box2d<double>> boxes;
+    for (auto const& lbl : detector)
+    {
+        boxes.push_back(lbl.get().box);
+    }
+    return boxes;
+}
+
+}
+
+TEST_CASE("feature_style_processor") {
+
+SECTION("apply_parallel matches apply") {
+
+    mapnik::Map m(256, 256);
+    m.set_background(mapnik::color(255, 255, 255));
+    add_layer(m, "a", 0, mapnik::color(255, 0, 0), 1.0);
+    add_layer(m, "b", 50, mapnik::color(0, 255, 0), 0.5);
+    add_layer(m, "c", 100, mapnik::color(0, 0, 255, 128), 1.0);
+    add_layer(m, "d", 25, mapnik::color(0, 0, 0), 0.5, mapnik::multiply);
+    add_layer(m, "e", 75, mapnik::color(255, 255, 0), 1.0);
+    m.zoom_to_box(mapnik::box2d<double>(-10, -10, 210, 210));
+
+    mapnik::image_rgba8 serial(m.width(), m.height());
+    {
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(m, serial);
+        ren.apply();
+    }
+    mapnik::image_rgba8 parallel(m.width(), m.height());
+    {
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(m, parallel);
+        CHECK(ren.jobs() == 1);
+        ren.apply_parallel(4);
+        CHECK(ren.jobs() == 4);
+    }
+    CHECK(parallel.painted());
+    // compositing through an intermediate buffer may differ by rounding on edges
+    CHECK(mapnik::compare(serial, parallel, 2) == 0);
+}
+
+SECTION("apply_parallel places labels colliding across layers like apply") {
+
+    for (bool clear_label_cache : { false, true })
+    {
+        mapnik::Map m(256, 256);
+        m.set_background(mapnik::color(255, 255, 255));
+        add_markers_layer(m, "a", { {50, 50}, {150, 150} }, mapnik::color(255, 0, 0), false);
+        add_layer(m, "p1", 0, mapnik::color(200, 200, 200), 0.5);
+        add_markers_layer(m, "b", { {52, 52}, {100, 100} }, mapnik::color(0, 0, 255), clear_label_cache);
+        add_layer(m, "p2", 100, mapnik::color(100, 100, 100), 0.5);
+        add_markers_layer(m, "c", { {150, 152}, {100, 102}, {20, 180} }, mapnik::color(0, 255, 0), false);
+        m.zoom_to_box(mapnik::box2d<double>(0, 0, 200, 200));
+
+        mapnik::box2d<double> extent(0, 0, m.width(), m.height());
+        auto serial_detector = std::make_shared<mapnik::label_collision_detector4>(extent);
+        mapnik::image_rgba8 serial(m.width(), m.height());
+        {
+            mapnik::agg_renderer<mapnik::image_rgba8> ren(m, serial, serial_detector);
+            ren.apply();
+        }
+        auto parallel_detector = std::make_shared<mapnik::label_collision_detector4>(extent);
+        mapnik::image_rgba8 parallel(m.width(), m.height());
+        {
+            mapnik::agg_renderer<mapnik::image_rgba8> ren(m, parallel, parallel_detector);
+            ren.apply_parallel(4);
+        }
+        INFO("clear_label_cache=" << clear_label_cache);
+        CHECK(mapnik::compare(serial, parallel, 2) == 0);
+        // labels end up in the caller's detector either way
+        CHECK(label_boxes(*serial_detector).size() == 4);
+        CHECK(label_boxes(*parallel_detector) == label_boxes(*serial_detector));
+    }
+}
+
+SECTION("only symbolizers compositing with other modes than src-over need a backdrop") {
+
+    mapnik::detail::symbolizer_comp_op needs_backdrop;
+    mapnik::polygon_symbolizer poly_sym;
+    CHECK_FALSE(needs_backdrop(poly_sym));
+    mapnik::put(poly_sym, mapnik::keys::comp_op, mapnik::src_over);
+    CHECK_FALSE(needs_backdrop(poly_sym));
+    mapnik::put(poly_sym, mapnik::keys::comp_op, mapnik::multiply);
+    CHECK(needs_backdrop(poly_sym));
+    mapnik::put(poly_sym, mapnik::keys::comp_op, mapnik::parse_expression("[mode]"));
+    CHECK(needs_backdrop(poly_sym));
+
+    mapnik::text_symbolizer text_sym;
+    mapnik::put(text_sym, mapnik::keys::halo_comp_op, mapnik::src_over);
+    CHECK_FALSE(needs_backdrop(text_sym));
+    mapnik::put(text_sym, mapnik::keys::halo_comp_op, mapnik::multiply);
+    CHECK(needs_backdrop(text_sym));
+}
+
+}
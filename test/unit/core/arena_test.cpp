@@ -0,0 +1,86 @@
+#include "catch.hpp"
+
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/util/arena.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+TEST_CASE("arena") {
+
+SECTION("aligned allocations from blocks") {
+
+    mapnik::util::arena a(256);
+    CHECK(a.num_blocks() == 0);
+    char * c = static_cast<char*>(a.allocate(1, 1));
+    REQUIRE(c != nullptr);
+    void * d = a.allocate(sizeof(double), alignof(double));
+    CHECK(reinterpret_cast<std::uintptr_t>(d) % alignof(double) == 0);
+    CHECK(a.num_blocks() == 1);
+    CHECK(a.allocated() == 1 + sizeof(double));
+    // exhausting the block starts a new one
+    a.allocate(200, 8);
+    a.allocate(200, 8);
+    CHECK(a.num_blocks() == 2);
+    // oversized requests get a block of their own
+    a.allocate(1000, 16);
+    CHECK(a.num_blocks() == 3);
+}
+
+SECTION("allocator is usable with standard containers") {
+
+    auto a = std::make_shared<mapnik::util::arena>(64);
+    std::vector<int, mapnik::util::arena_allocator<int> > v{mapnik::util::arena_allocator<int>(a)};
+    for (int i = 0; i < 1000; ++i) v.push_back(i);
+    CHECK(v.size() == 1000);
+    CHECK(v[999] == 999);
+    CHECK(a->allocated() >= 1000 * sizeof(int));
+}
+
+SECTION("features keep their arena alive") {
+
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    std::shared_ptr<mapnik::util::arena> arena;
+    std::weak_ptr<mapnik::util::arena> first;
+    std::vector<mapnik::feature_ptr> features;
+    for (int i = 0; i < 10; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i, arena));
+        feature->put("name", mapnik::value_integer(i));
+        features.push_back(feature);
+        if (i == 0) first = arena;
+    }
+    REQUIRE(arena);
+    CHECK(arena == first.lock());
+    CHECK(features[9]->get("name") == mapnik::value_integer(9));
+    // attribute values are allocated along with the feature
+    CHECK(arena->allocated() >= 10 * (sizeof(mapnik::feature_impl) + sizeof(mapnik::value)));
+    mapnik::feature_impl::cont_type const& data = features[9]->get_data();
+    CHECK(data.get_allocator().get_arena() == arena);
+    arena.reset();
+    CHECK(!first.expired());
+    features.clear();
+    CHECK(first.expired());
+}
+
+SECTION("a full arena is replaced") {
+
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    std::shared_ptr<mapnik::util::arena> arena;
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1, arena));
+    std::weak_ptr<mapnik::util::arena> first(arena);
+    // features dropped right away do not pin the arena beyond its size limit
+    for (int i = 0; i < 100000 && arena == first.lock(); ++i)
+    {
+        mapnik::feature_factory::create(ctx, i, arena);
+    }
+    CHECK(arena != first.lock());
+    CHECK(!first.expired());
+    feature.reset();
+    CHECK(first.expired());
+}
+
+}
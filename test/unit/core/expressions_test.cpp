@@ -2,11 +2,13 @@
 #include "catch_ext.hpp"
 
 #include <mapnik/expression.hpp>
+#include <mapnik/compiled_expression.hpp>
 #include <mapnik/expression_evaluator.hpp>
 #include <mapnik/expression_string.hpp>
 #include <mapnik/wkt/wkt_factory.hpp>
 #include <mapnik/feature.hpp>
 #include <mapnik/feature_factory.hpp>
+#include <mapnik/rule.hpp>
 #include <mapnik/unicode.hpp>
 
 #include <functional>
@@ -192,3 +194,106 @@ TEST_CASE("expressions")
     // this should evaulate as a combination of an int value and string, but fails
     TRY_CHECK(eval("[int]+m") == eval("'123m'"));
 }
+
+TEST_CASE("expression attribute binding")
+{
+    // same names at different indices in two contexts
+    auto ctx0 = std::make_shared<mapnik::context_type>();
+    ctx0->push("a");
+    ctx0->push("b");
+    auto ctx1 = std::make_shared<mapnik::context_type>();
+    ctx1->push("b");
+    ctx1->push("a");
+    REQUIRE(ctx0->id() != ctx1->id());
+
+    mapnik::feature_ptr f0(mapnik::feature_factory::create(ctx0, 1));
+    f0->put_at(0, mapnik::value_integer(1)); // a
+    f0->put_at(1, mapnik::value_integer(2)); // b
+    mapnik::feature_ptr f1(mapnik::feature_factory::create(ctx1, 2));
+    f1->put("a", mapnik::value_integer(3));
+    f1->put("b", mapnik::value_integer(4));
+    CHECK(f1->get(0) == 4);
+    CHECK_THROWS(f0->put_at(2, mapnik::value_integer(0)));
+
+    // a single expression bound to one context, then the other, then back
+    auto expr = mapnik::parse_expression("[a] * 10 + [b]");
+    for (int i = 0; i < 2; ++i)
+    {
+        CHECK(evaluate(*f0, *expr) == 12);
+        CHECK(evaluate(*f0, *expr) == 12);
+        CHECK(evaluate(*f1, *expr) == 34);
+    }
+
+    // attribute added to the context after a failed lookup
+    auto missing = mapnik::parse_expression("[c]");
+    CHECK(evaluate(*f1, *missing).is_null());
+    f1->put_new("c", mapnik::value_integer(100));
+    CHECK(evaluate(*f1, *missing) == 100);
+
+    // copies do not share bindings with the original
+    mapnik::expr_node copy(*expr);
+    CHECK(evaluate(*f1, copy) == 34);
+    CHECK(evaluate(*f0, *expr) == 12);
+}
+
+TEST_CASE("compiled expressions")
+{
+    using properties_type = std::vector<std::pair<std::string, mapnik::value> > ;
+    mapnik::transcoder tr("utf8");
+    properties_type prop = {{ "foo"   , tr.transcode("bar") },
+                            { "name"  , tr.transcode("Québec")},
+                            { "double", mapnik::value_double(1.23456)},
+                            { "int"   , mapnik::value_integer(123)},
+                            { "zero"  , mapnik::value_integer(0)},
+                            { "null"  , mapnik::value_null()}};
+    auto feature = make_test_feature(1, "POINT(100 200)", prop);
+    mapnik::attributes vars;
+    vars["zoom"] = mapnik::value_integer(12);
+
+    for (std::string const& str : {
+            "[foo] = 'bar'", "[int] > 100 and [double] < 2", "5 < [int]", "[int] != 123",
+            "[int] = 456 or [foo].match('foo') || length([foo]) = 3", "[foo].replace('a','o')",
+            "not [zero] and -[int] < 0", "[zero] or [int]", "[int] and false", "false or [zero]",
+            "[int] * 2 + 1 - [double] / 2", "@zoom >= 10 and [foo] = 'bar' or @zoom < 5", "@missing",
+            "[missing] = 1", "[null] = null", "'' = [null]", "[mapnik::geometry_type] = point",
+            "max([int], 500) + abs(-[double])", "[int] + 'm'"})
+    {
+        auto expr = mapnik::parse_expression(str);
+        mapnik::compiled_expression_ptr compiled = mapnik::compile_expression(expr);
+        REQUIRE(compiled != nullptr);
+        mapnik::value expected = mapnik::util::apply_visitor(
+            mapnik::evaluate<mapnik::feature_impl, mapnik::value_type, mapnik::attributes>(*feature, vars), *expr);
+        for (int i = 0; i < 2; ++i)
+        {
+            mapnik::value result = compiled->evaluate(*feature, vars);
+            INFO(str);
+            CHECK(result.which() == expected.which());
+            CHECK(result.to_string() == expected.to_string());
+        }
+    }
+
+    // constant subexpressions are folded
+    CHECK(mapnik::compile_expression(mapnik::parse_expression("1 + 2 * 3"))->is_constant());
+    CHECK(mapnik::compile_expression(mapnik::parse_expression("false and [int]"))->is_constant());
+    CHECK(mapnik::compile_expression(mapnik::parse_expression("length('abc') = 3"))->constant_value() == true);
+    CHECK(mapnik::compile_expression(mapnik::parse_expression("[int] = 1 + 2"))->size() == 1);
+    CHECK(!mapnik::compile_expression(mapnik::parse_expression("@zoom > 1"))->is_constant());
+    CHECK(mapnik::compile_expression(mapnik::expression_ptr()) == nullptr);
+
+    auto tree = std::make_shared<mapnik::expr_node>(*mapnik::parse_expression("[int] + 1"));
+    CHECK(mapnik::evaluate_value(tree, *feature, vars) == 124);
+
+    // rules compile their filter whenever it is set
+    mapnik::rule r;
+    CHECK(r.get_compiled_filter().is_constant());
+    CHECK(r.get_compiled_filter().constant_value() == true);
+    r.set_filter(mapnik::parse_expression("[int] = 123"));
+    CHECK(r.get_compiled_filter().evaluate(*feature, vars) == true);
+    r.set_filter(tree);
+    CHECK(r.get_compiled_filter().evaluate(*feature, vars) == 124);
+    mapnik::rule copy(r);
+    CHECK(copy.get_compiled_filter().evaluate(*feature, vars) == 124);
+    copy.set_filter(mapnik::parse_expression("[int] * 2"));
+    CHECK(copy.get_compiled_filter().evaluate(*feature, vars) == 246);
+    CHECK(r.get_compiled_filter().evaluate(*feature, vars) == 124);
+}
@@ -0,0 +1,104 @@
+#include "catch.hpp"
+
+#include <mapnik/filter_pushdown.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/rule_cache.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/feature_layer_desc.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string to_sql(std::string const& filter,
+                   mapnik::sql_utils::sql_dialect dialect = mapnik::sql_utils::sql_dialect::postgresql)
+{
+    mapnik::layer_descriptor desc("test", "utf-8");
+    desc.add_descriptor(mapnik::attribute_descriptor("name", mapnik::String));
+    desc.add_descriptor(mapnik::attribute_descriptor("pop", mapnik::Integer));
+    desc.add_descriptor(mapnik::attribute_descriptor("area", mapnik::Double));
+    desc.add_descriptor(mapnik::attribute_descriptor("open", mapnik::Boolean));
+    mapnik::attributes vars;
+    vars["min"] = mapnik::value_integer(10);
+    return mapnik::sql_utils::filter_to_sql(*mapnik::parse_expression(filter), desc, vars, dialect);
+}
+
+}
+
+TEST_CASE("filter pushdown") {
+
+    SECTION("combined filter of active rules") {
+        std::vector<mapnik::rule> rules(3);
+        rules[0].set_filter(mapnik::parse_expression("[pop] > 1000"));
+        rules[1].set_filter(mapnik::parse_expression("[name] = 'a'"));
+        std::vector<mapnik::rule_cache> caches(2);
+        caches[0].add_rule(rules[0]);
+        caches[1].add_rule(rules[1]);
+        mapnik::expression_ptr filter = mapnik::combined_filter(caches);
+        REQUIRE(filter);
+
+        auto ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("pop");
+        ctx->push("name");
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+        feature->put("pop", mapnik::value_integer(10));
+        mapnik::query q(mapnik::box2d<double>(0, 0, 1, 1));
+        q.set_filter(filter);
+        mapnik::attribute_filter attr_filter(q);
+        CHECK(attr_filter.active());
+        CHECK_FALSE(attr_filter.pass(*feature));
+        feature->put("pop", mapnik::value_integer(2000));
+        CHECK(attr_filter.pass(*feature));
+
+        // rules without filter and else rules draw any feature
+        caches[1].add_rule(rules[2]);
+        CHECK_FALSE(mapnik::combined_filter(caches));
+        caches.resize(1);
+        rules[2].set_else(true);
+        caches[0].add_rule(rules[2]);
+        CHECK_FALSE(mapnik::combined_filter(caches));
+        CHECK_FALSE(mapnik::attribute_filter().active());
+        q.set_filter(mapnik::parse_expression("[mapnik::geometry_type] = 1 and [pop] > 1"));
+        CHECK_FALSE(mapnik::attribute_filter(q).active());
+    }
+
+    SECTION("comparisons with constants of the column type") {
+        CHECK(to_sql("[pop] > 1000") == "(\"pop\" IS NOT NULL AND \"pop\" > 1000)");
+        CHECK(to_sql("1000 <= [pop]") == "(\"pop\" IS NOT NULL AND \"pop\" >= 1000)");
+        CHECK(to_sql("[pop] >= @min") == "(\"pop\" IS NOT NULL AND \"pop\" >= 10)");
+        // doubles are written in their shortest form and compared as float8
+        CHECK(to_sql("[area] < -0.5") == "(\"area\" IS NOT NULL AND \"area\" < CAST('-0.5' AS double precision))");
+        CHECK(to_sql("[area] <= 0.3") == "(\"area\" IS NOT NULL AND \"area\" <= CAST('0.3' AS double precision))");
+        CHECK(to_sql("[area] = 2") == "(\"area\" IS NOT NULL AND \"area\" = CAST('2' AS double precision))");
+        CHECK(to_sql("[pop] > 2.5") == "(\"pop\" IS NOT NULL AND \"pop\" > CAST('2.5' AS double precision))");
+        CHECK(to_sql("[area] = 0.1", mapnik::sql_utils::sql_dialect::sqlite) == "(\"area\" IS NOT NULL AND \"area\" = 0.1)");
+        CHECK(to_sql("[name] != \"it's\"") == "(\"name\" IS NULL OR \"name\" <> E'it''s')");
+        CHECK(to_sql("[name] = 'a\\\\b'", mapnik::sql_utils::sql_dialect::sqlite) == "(\"name\" IS NOT NULL AND \"name\" = 'a\\b')");
+        CHECK(to_sql("[open] = true") == "(\"open\" IS NOT NULL AND \"open\" = TRUE)");
+        CHECK(to_sql("[open] = true", mapnik::sql_utils::sql_dialect::ogr) == "(\"open\" IS NOT NULL AND \"open\" = 1)");
+        // types differing from the column, string ordering, unknown columns
+        CHECK(to_sql("[pop] = 'a'").empty());
+        CHECK(to_sql("[name] > 'a'").empty());
+        CHECK(to_sql("[other] = 1").empty());
+        CHECK(to_sql("[pop] = @unset").empty());
+        CHECK(to_sql("[name].match('a.*')").empty());
+    }
+
+    SECTION("logical operators keep the selection wide enough") {
+        CHECK(to_sql("[pop] > 1 and [name].match('a')") == "(\"pop\" IS NOT NULL AND \"pop\" > 1)");
+        CHECK(to_sql("[pop] > 1 or [name].match('a')").empty());
+        CHECK(to_sql("[pop] > 1 or [name] = 'a'") ==
+              "((\"pop\" IS NOT NULL AND \"pop\" > 1) OR (\"name\" IS NOT NULL AND \"name\" = E'a'))");
+        CHECK(to_sql("not ([pop] = 1)") == "(NOT (\"pop\" IS NOT NULL AND \"pop\" = 1))");
+        CHECK(to_sql("not ([pop] = 1 and [name].match('a'))").empty());
+        CHECK(to_sql("not ([pop] > 1)", mapnik::sql_utils::sql_dialect::sqlite).empty());
+        // null != '' is false in mapnik but true in SQL
+        CHECK(to_sql("[name] != ''") == "(\"name\" IS NULL OR \"name\" <> E'')");
+        CHECK(to_sql("not ([name] != '')").empty());
+        CHECK(to_sql("true").empty());
+        CHECK(to_sql("false") == "(1=0)");
+    }
+}
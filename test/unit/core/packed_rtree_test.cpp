@@ -0,0 +1,72 @@
+#include "catch.hpp"
+
+#include <mapnik/packed_rtree.hpp>
+
+#include <algorithm>
+#include <vector>
+
+TEST_CASE("packed_rtree") {
+
+SECTION("visit finds the same items as a linear scan") {
+
+    mapnik::packed_rtree<int> tree;
+    std::vector<mapnik::box2d<double> > boxes;
+    // grid of small boxes, enough to be packed into several tree levels
+    for (int i = 0; i < 3000; ++i)
+    {
+        double x = (i * 37) % 1000;
+        double y = (i * 91) % 1000;
+        mapnik::box2d<double> box(x, y, x + (i % 13), y + (i % 7));
+        boxes.push_back(box);
+        tree.insert(i, box);
+
+        if (i % 50 == 0)
+        {
+            mapnik::box2d<double> query(x - 20, y - 20, x + 5, y + 5);
+            std::size_t count = 0;
+            CHECK(tree.visit(query, [&](int const&) { ++count; return true; }));
+            std::size_t expected = 0;
+            for (auto const& b : boxes)
+            {
+                if (b.intersects(query)) ++expected;
+            }
+            CHECK(count == expected);
+            CHECK(tree.intersects(query));
+        }
+    }
+    CHECK(tree.size() == 3000);
+    CHECK(!tree.intersects(mapnik::box2d<double>(2000, 2000, 2100, 2100)));
+
+    // visitor can stop the query early
+    std::size_t visited = 0;
+    CHECK(!tree.visit(mapnik::box2d<double>(0, 0, 1000, 1000), [&](int const&) { ++visited; return false; }));
+    CHECK(visited == 1);
+
+    tree.clear();
+    CHECK(tree.empty());
+    CHECK(!tree.intersects(mapnik::box2d<double>(0, 0, 1000, 1000)));
+}
+
+SECTION("pack indexes all items in a single tree") {
+
+    mapnik::packed_rtree<int> tree;
+    for (int i = 0; i < 1000; ++i)
+    {
+        tree.insert(i, mapnik::box2d<double>(i, i, i + 1, i + 1));
+    }
+    tree.pack();
+    for (int i = 1000; i < 1010; ++i)
+    {
+        tree.insert(i, mapnik::box2d<double>(i, i, i + 1, i + 1));
+    }
+    std::vector<int> found;
+    CHECK(tree.visit(mapnik::box2d<double>(998.5, 998.5, 1001.5, 1001.5),
+                     [&](int const& i) { found.push_back(i); return true; }));
+    std::sort(found.begin(), found.end());
+    CHECK(found == std::vector<int>({ 998, 999, 1000, 1001 }));
+    std::vector<int> items(tree.begin(), tree.end());
+    CHECK(items.size() == 1010);
+    CHECK(std::is_sorted(items.begin(), items.end()));
+}
+
+}
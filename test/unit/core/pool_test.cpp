@@ -0,0 +1,100 @@
+#include "catch.hpp"
+
+#include <mapnik/pool.hpp>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+
+struct test_object
+{
+    test_object() : ok(true) {}
+    bool isOK() const { return ok; }
+    bool ok;
+};
+
+template <typename T>
+struct test_creator
+{
+    T* operator()() const { return new T(); }
+};
+
+using test_pool = mapnik::Pool<test_object, test_creator>;
+
+}
+
+TEST_CASE("pool") {
+
+SECTION("borrow, release and grow up to max size") {
+
+    test_pool pool(test_creator<test_object>(), 1, 2);
+    CHECK(pool.size() == 1);
+    auto a = pool.borrowObject();
+    auto b = pool.borrowObject();
+    REQUIRE(a);
+    REQUIRE(b);
+    CHECK(a.get() != b.get());
+    CHECK(pool.size() == 2);
+    CHECK(!pool.borrowObject());
+    test_object * first = a.get();
+    a.reset();
+    // released objects are handed out again, the last one used by this thread first
+    auto c = pool.borrowObject();
+    CHECK(c.get() == first);
+
+    mapnik::pool_stats stats = pool.stats();
+    CHECK(stats.borrowed == 3);
+    CHECK(stats.exhausted == 1);
+    CHECK(stats.created == 2);
+}
+
+SECTION("invalid objects are replaced") {
+
+    test_pool pool(test_creator<test_object>(), 1, 1);
+    pool.borrowObject()->ok = false;
+    auto obj = pool.borrowObject();
+    REQUIRE(obj);
+    CHECK(obj->isOK());
+    CHECK(pool.stats().reconnects == 1);
+    CHECK(pool.stats().created == 2);
+}
+
+SECTION("idle objects above the initial size are reaped") {
+
+    test_pool pool(test_creator<test_object>(), 1, 3);
+    {
+        auto a = pool.borrowObject();
+        auto b = pool.borrowObject();
+        auto c = pool.borrowObject();
+    }
+    CHECK(pool.size() == 3);
+    pool.set_max_idle(std::chrono::seconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    auto obj = pool.borrowObject();
+    REQUIRE(obj);
+    CHECK(pool.size() == 1);
+    CHECK(pool.stats().reaped == 2);
+}
+
+#ifdef MAPNIK_THREADSAFE
+SECTION("bounded wait for a release") {
+
+    test_pool pool(test_creator<test_object>(), 1, 1);
+    auto held = pool.borrowObject();
+    REQUIRE(held);
+    // nothing released: times out
+    CHECK(!pool.borrowObject(std::chrono::milliseconds(10)));
+    std::thread releaser([&held]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        held.reset();
+    });
+    auto obj = pool.borrowObject(std::chrono::seconds(10));
+    releaser.join();
+    CHECK(obj);
+    CHECK(pool.stats().waited == 2);
+}
+#endif
+
+}
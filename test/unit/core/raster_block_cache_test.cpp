@@ -0,0 +1,73 @@
+#include "catch.hpp"
+
+#include <mapnik/image_any.hpp>
+#include <mapnik/raster_block_cache.hpp>
+
+#include <memory>
+
+TEST_CASE("raster_block_cache") {
+
+SECTION("blocks are cached per file and block") {
+
+    mapnik::raster_block_cache & cache = mapnik::raster_block_cache::instance();
+    cache.clear();
+    std::size_t max_bytes = cache.max_bytes();
+    // two 4x4 rgba blocks
+    cache.set_max_bytes(2 * 4 * 4 * 4);
+
+    mapnik::raster_block_key key;
+    key.file = "a.tif";
+    key.mtime = 1000;
+    key.file_size = 4096;
+    key.band = 0;
+    key.overview = 0;
+    key.block_size = 256;
+    key.block_x = 1;
+    key.block_y = 2;
+    CHECK(!cache.find(key));
+    CHECK(cache.misses() == 1);
+
+    auto block = std::make_shared<mapnik::image_any const>(mapnik::image_rgba8(4, 4));
+    cache.insert(key, block);
+    CHECK(cache.find(key) == block);
+    CHECK(cache.hits() == 1);
+    CHECK(cache.bytes() == 4 * 4 * 4);
+
+    mapnik::raster_block_key other(key);
+    other.block_x = 2;
+    CHECK(!cache.find(other));
+    // blocks of a file changed on disk are not reused
+    other.block_x = 1;
+    other.mtime = 1001;
+    CHECK(!cache.find(other));
+    other.mtime = 1000;
+    other.file_size = 8192;
+    CHECK(!cache.find(other));
+    other.file_size = 4096;
+    CHECK(cache.find(other) == block);
+    other.file = "b.tif";
+    CHECK(!cache.find(other));
+    cache.insert(other, block);
+    other.overview = 1;
+    cache.insert(other, block);
+    // least recently used block is evicted
+    CHECK(cache.size() == 2);
+    CHECK(!cache.find(key));
+    // a larger block takes the room of both
+    auto large = std::make_shared<mapnik::image_any const>(mapnik::image_rgba8(8, 4));
+    cache.insert(key, large);
+    CHECK(cache.size() == 1);
+    CHECK(cache.bytes() == 8 * 4 * 4);
+    // blocks larger than the cache are not kept
+    key.block_y = 3;
+    cache.insert(key, std::make_shared<mapnik::image_any const>(mapnik::image_rgba8(8, 8)));
+    CHECK(!cache.find(key));
+    CHECK(cache.size() == 1);
+
+    cache.set_max_bytes(max_bytes);
+    cache.clear();
+    CHECK(cache.size() == 0);
+    CHECK(cache.hits() == 0);
+}
+
+}
@@ -0,0 +1,96 @@
+#include "catch.hpp"
+
+#include <mapnik/rule.hpp>
+#include <mapnik/rule_index.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/compiled_expression.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/unicode.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+mapnik::feature_ptr make_feature(std::string const& key, mapnik::value const& val)
+{
+    auto ctx = std::make_shared<mapnik::context_type>();
+    ctx->push(key);
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    feature->put(key, val);
+    return feature;
+}
+
+// rules matching `feature`, by testing every filter
+std::vector<mapnik::rule const*> matching(mapnik::rule_index::rule_ptrs const& rules,
+                                          mapnik::feature_impl const& feature)
+{
+    mapnik::attributes vars;
+    std::vector<mapnik::rule const*> result;
+    for (mapnik::rule const* r : rules)
+    {
+        if (r->get_compiled_filter().evaluate(feature, vars).to_bool()) result.push_back(r);
+    }
+    return result;
+}
+
+}
+
+TEST_CASE("rule index") {
+
+    mapnik::transcoder tr("utf8");
+    std::vector<mapnik::rule> rules;
+    for (std::string const& filter : { "[highway] = 'motorway'",
+                                       "[highway] = 'trunk' or [highway] = 'primary'",
+                                       "[highway] = 'primary' and [tunnel] = 1",
+                                       "[tunnel] = 1",
+                                       "[highway] >= 3 and [highway] < 10",
+                                       "[highway] > 8",
+                                       "5 = [highway]",
+                                       "[highway] = -2",
+                                       "[highway].match('mo.*')" })
+    {
+        rules.emplace_back(filter);
+        rules.back().set_filter(mapnik::parse_expression(filter));
+    }
+    mapnik::rule_index::rule_ptrs ptrs;
+    for (mapnik::rule const& r : rules) ptrs.push_back(&r);
+
+    SECTION("attribute constrained by most filters is indexed") {
+        mapnik::rule_index index(ptrs);
+        REQUIRE(index.valid());
+        CHECK(index.attribute_name() == "highway");
+        CHECK_FALSE(mapnik::rule_index(ptrs, 10).valid());
+        CHECK_FALSE(mapnik::rule_index().valid());
+    }
+
+    SECTION("candidates are the matching rules and the unindexed ones, in order") {
+        mapnik::rule_index index(ptrs);
+        auto features = { make_feature("highway", tr.transcode("motorway")),
+                          make_feature("highway", tr.transcode("primary")),
+                          make_feature("highway", tr.transcode("residential")),
+                          make_feature("highway", mapnik::value_null()),
+                          make_feature("highway", mapnik::value_bool(true)),
+                          make_feature("highway", mapnik::value_integer(-2)) };
+        for (mapnik::feature_ptr const& feature : features)
+        {
+            auto const& candidates = index.candidates(*feature);
+            CHECK(matching(candidates, *feature) == matching(ptrs, *feature));
+            CHECK(candidates.back() == &rules.back());
+        }
+        // boundaries of the numeric ranges
+        for (double val : { -3.0, -2.0, 0.0, 2.9, 3.0, 5.0, 8.0, 8.5, 9.999, 10.0, 11.0 })
+        {
+            for (mapnik::value v : { mapnik::value(val), mapnik::value(static_cast<mapnik::value_integer>(val)) })
+            {
+                auto feature = make_feature("highway", v);
+                CHECK(matching(index.candidates(*feature), *feature) == matching(ptrs, *feature));
+            }
+        }
+        auto feature = make_feature("highway", tr.transcode("trunk"));
+        CHECK(index.candidates(*feature).size() == 3);
+        feature = make_feature("highway", mapnik::value_integer(5));
+        CHECK(index.candidates(*feature).size() == 4);
+    }
+}
@@ -0,0 +1,229 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "catch.hpp"
+
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/expression_evaluator.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/geometry_envelope.hpp>
+#include <mapnik/mapped_memory_cache.hpp>
+#include <mapnik/util/fs.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct drawn_feature
+{
+    mapnik::value_integer id;
+    std::string attributes;
+    mapnik::box2d<double> bbox;
+
+    bool operator==(drawn_feature const& other) const
+    {
+        return id == other.id && attributes == other.attributes && bbox == other.bbox;
+    }
+};
+
+std::ostream & operator<<(std::ostream & os, drawn_feature const& f)
+{
+    return os << f.id << " " << f.attributes << " " << f.bbox;
+}
+
+// the features of `ds` the rules would draw, as render_style selects them:
+// the filter is evaluated on every feature the datasource returns
+std::vector<drawn_feature> drawn_features(mapnik::datasource_ptr ds,
+                                          mapnik::expression_ptr const& filter,
+                                          bool pushdown)
+{
+    mapnik::query q(ds->envelope());
+    for (auto const& desc : ds->get_descriptor().get_descriptors())
+    {
+        q.add_property_name(desc.get_name());
+    }
+    if (pushdown) q.set_filter(filter);
+    auto features = ds->features(q);
+    REQUIRE(features != nullptr);
+    std::vector<drawn_feature> result;
+    while (mapnik::feature_ptr feature = features->next())
+    {
+        if (!mapnik::evaluate_value(filter, *feature, q.variables()).to_bool()) continue;
+        std::string attributes;
+        for (auto const& kv : *feature)
+        {
+            attributes += std::get<0>(kv) + "=" + std::get<1>(kv).to_string() + ";";
+        }
+        result.push_back(drawn_feature{feature->id(), attributes,
+                                       mapnik::geometry::envelope(feature->get_geometry())});
+    }
+    return result;
+}
+
+void require_same_features(mapnik::datasource_ptr ds, mapnik::expression_ptr const& filter)
+{
+    std::vector<drawn_feature> all = drawn_features(ds, filter, false);
+    std::vector<drawn_feature> pushed = drawn_features(ds, filter, true);
+    CHECK(!all.empty());
+    CHECK(pushed == all);
+}
+
+}
+
+TEST_CASE("filter pushdown datasources") {
+
+    SECTION("shape rejects records on their attributes")
+    {
+        std::string shape_plugin("./plugins/input/shape.input");
+        std::string filename("test/data/shp/boundaries.shp");
+        if (mapnik::util::exists(shape_plugin) && mapnik::util::exists(filename))
+        {
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+            mapnik::mapped_memory_cache::instance().clear();
+#endif
+            mapnik::parameters params;
+            params["type"] = "shape";
+            params["file"] = filename;
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+
+            // filter on a value the first record holds
+            mapnik::query q(ds->envelope());
+            auto const& descs = ds->get_descriptor().get_descriptors();
+            REQUIRE(!descs.empty());
+            std::string const& name = descs.front().get_name();
+            q.add_property_name(name);
+            auto features = ds->features(q);
+            REQUIRE(features != nullptr);
+            mapnik::feature_ptr first = features->next();
+            REQUIRE(first != nullptr);
+            mapnik::value val = first->get(name);
+
+            mapnik::expression_ptr equal = std::make_shared<mapnik::expr_node>(
+                mapnik::binary_node<mapnik::tags::equal_to>(mapnik::attribute(name), val));
+            mapnik::expression_ptr not_equal = std::make_shared<mapnik::expr_node>(
+                mapnik::binary_node<mapnik::tags::not_equal_to>(mapnik::attribute(name), val));
+            require_same_features(ds, equal);
+            require_same_features(ds, not_equal);
+        }
+    }
+
+    SECTION("csv rejects rows on their attributes")
+    {
+        std::string csv_plugin("./plugins/input/csv.input");
+        if (mapnik::util::exists(csv_plugin))
+        {
+            std::string csv("x,y,name,pop\n"
+                            "0,0,a,10\n"
+                            "1,1,b,\n"
+                            "2,2,,30\n"
+                            "3,3,a,40\n"
+                            "4,4,c,50\n");
+            mapnik::parameters params;
+            params["type"] = "csv";
+            params["inline"] = csv;
+            auto inline_ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(inline_ds != nullptr);
+
+            std::string filename("/tmp/mapnik-filter-pushdown.csv");
+            {
+                std::ofstream file(filename.c_str());
+                file << csv;
+            }
+            mapnik::parameters file_params;
+            file_params["type"] = "csv";
+            file_params["file"] = filename;
+            auto file_ds = mapnik::datasource_cache::instance().create(file_params);
+            REQUIRE(file_ds != nullptr);
+
+            for (auto const& ds : { inline_ds, file_ds })
+            {
+                require_same_features(ds, mapnik::parse_expression("[name] = 'a'"));
+                require_same_features(ds, mapnik::parse_expression("[pop] >= 30 or [name] = 'b'"));
+                require_same_features(ds, mapnik::parse_expression("[name] != ''"));
+                require_same_features(ds, mapnik::parse_expression("[name] = 'c' and [mapnik::geometry_type] = point"));
+            }
+            std::remove(filename.c_str());
+        }
+    }
+
+    SECTION("sqlite with a filter on the key field")
+    {
+        std::string sqlite_plugin("./plugins/input/sqlite.input");
+        if (mapnik::util::exists(sqlite_plugin))
+        {
+            // points (i,i) as little endian WKB
+            std::string initdb("CREATE TABLE pts (id INTEGER PRIMARY KEY, name TEXT, area REAL, geom BLOB);");
+            char const* coords[] = { "0000000000000000", "000000000000F03F",
+                                     "0000000000000040", "0000000000000840" };
+            char const* names[] = { "'a'", "'b'", "NULL", "'a'" };
+            char const* areas[] = { "0.1", "0.3", "0.5", "NULL" };
+            for (int i = 0; i < 4; ++i)
+            {
+                initdb += std::string("INSERT INTO pts VALUES (") + std::to_string(i + 1) + ","
+                    + names[i] + "," + areas[i] + ",X'0101000000" + coords[i] + coords[i] + "');";
+            }
+
+            for (auto pushdown : { true, false })
+            {
+                mapnik::parameters params;
+                params["type"] = "sqlite";
+                params["file"] = ":memory:";
+                params["initdb"] = initdb;
+                params["table"] = "pts";
+                params["geometry_field"] = "geom";
+                params["key_field"] = "id";
+                params["use_spatial_index"] = mapnik::value_bool(false);
+                params["extent"] = "-1,-1,4,4";
+                params["filter_pushdown"] = mapnik::value_bool(pushdown);
+                auto ds = mapnik::datasource_cache::instance().create(params);
+                REQUIRE(ds != nullptr);
+
+                for (auto const& expr : { "[id] > 1 and [name] = 'a'", "[area] <= 0.3", "[id] = 2 or [name] != ''" })
+                {
+                    INFO(expr);
+                    mapnik::expression_ptr filter = mapnik::parse_expression(expr);
+                    require_same_features(ds, filter);
+                    // the key is put once, under its own name
+                    mapnik::query q(ds->envelope());
+                    q.add_property_name("id");
+                    q.add_property_name("name");
+                    q.add_property_name("area");
+                    q.set_filter(filter);
+                    auto features = ds->features(q);
+                    REQUIRE(features != nullptr);
+                    while (mapnik::feature_ptr feature = features->next())
+                    {
+                        CHECK(feature->get("id") == mapnik::value(feature->id()));
+                        CHECK_FALSE(feature->has_key("id:1"));
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,242 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "catch.hpp"
+
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/raster.hpp>
+#include <mapnik/util/fs.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void put_uint16(std::string & buf, std::uint16_t val)
+{
+    buf += char(val & 0xff);
+    buf += char(val >> 8);
+}
+
+void put_uint32(std::string & buf, std::uint32_t val)
+{
+    put_uint16(buf, val & 0xffff);
+    put_uint16(buf, val >> 16);
+}
+
+void put_double(std::string & buf, double val)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &val, sizeof(bits));
+    put_uint32(buf, bits & 0xffffffff);
+    put_uint32(buf, bits >> 32);
+}
+
+// Writes a little endian, uncompressed, single band 8 bit GeoTIFF with one
+// pixel per map unit and its origin at (0, sizes[0]). The first size is the
+// full resolution image, the following ones are its internal overviews.
+// Every level is filled with its own value so reads tell which one they used.
+void write_geotiff(std::string const& filename, std::vector<std::uint32_t> const& sizes,
+                   std::vector<std::uint8_t> const& values)
+{
+    std::string buf("II*\0", 4);
+    std::size_t next_ifd = buf.size();
+    put_uint32(buf, 0);
+    for (std::size_t level = 0; level < sizes.size(); ++level)
+    {
+        std::uint32_t size = sizes[level];
+        bool georeferenced = level == 0;
+        std::uint16_t num_entries = georeferenced ? 14 : 11;
+        std::uint32_t ifd = buf.size();
+        std::uint32_t pixels = ifd + 2 + num_entries * 12 + 4;
+        std::uint32_t scale = pixels + size * size;
+        std::uint32_t tiepoint = scale + 3 * 8;
+        std::uint32_t geokeys = tiepoint + 6 * 8;
+        for (std::size_t i = 0; i < 4; ++i) buf[next_ifd + i] = char((ifd >> (8 * i)) & 0xff);
+
+        // tag, type (3 - short, 4 - long, 12 - double), count, value or offset
+        auto entry = [&buf](std::uint16_t tag, std::uint16_t type, std::uint32_t count, std::uint32_t value)
+        {
+            put_uint16(buf, tag);
+            put_uint16(buf, type);
+            put_uint32(buf, count);
+            put_uint32(buf, value);
+        };
+        put_uint16(buf, num_entries);
+        entry(254, 4, 1, level == 0 ? 0 : 1); // NewSubfileType: reduced resolution image
+        entry(256, 4, 1, size);               // ImageWidth
+        entry(257, 4, 1, size);               // ImageLength
+        entry(258, 3, 1, 8);                  // BitsPerSample
+        entry(259, 3, 1, 1);                  // Compression: none
+        entry(262, 3, 1, 1);                  // PhotometricInterpretation: min is black
+        entry(273, 4, 1, pixels);             // StripOffsets
+        entry(277, 3, 1, 1);                  // SamplesPerPixel
+        entry(278, 4, 1, size);               // RowsPerStrip
+        entry(279, 4, 1, size * size);        // StripByteCounts
+        entry(284, 3, 1, 1);                  // PlanarConfiguration: contiguous
+        if (georeferenced)
+        {
+            entry(33550, 12, 3, scale);       // ModelPixelScale
+            entry(33922, 12, 6, tiepoint);    // ModelTiepoint
+            entry(34735, 3, 12, geokeys);     // GeoKeyDirectory
+        }
+        next_ifd = buf.size();
+        put_uint32(buf, 0);
+
+        buf.append(size * size, char(values[level]));
+        if (georeferenced)
+        {
+            for (double val : { 1.0, 1.0, 0.0 }) put_double(buf, val);
+            for (double val : { 0.0, 0.0, 0.0, 0.0, double(size), 0.0 }) put_double(buf, val);
+            // version 1.1.0, 2 keys: GTModelType geographic, GTRasterType pixel is area
+            for (std::uint16_t val : { 1, 1, 0, 2, 1024, 0, 1, 2, 1025, 0, 1, 1 }) put_uint16(buf, val);
+        }
+    }
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    file.write(buf.data(), buf.size());
+}
+
+mapnik::raster_ptr read_raster(mapnik::datasource_ptr const& ds, mapnik::box2d<double> const& bbox,
+                               double resolution, double filter_factor = 1.0)
+{
+    mapnik::query q(bbox, mapnik::query::resolution_type(resolution, resolution));
+    q.set_filter_factor(filter_factor);
+    auto features = ds->features(q);
+    REQUIRE(features != nullptr);
+    mapnik::feature_ptr feature = features->next();
+    REQUIRE(feature != nullptr);
+    REQUIRE(feature->get_raster() != nullptr);
+    return feature->get_raster();
+}
+
+// value all pixels of the raster hold, -1 when they differ
+int raster_value(mapnik::raster const& raster)
+{
+    REQUIRE(raster.data_.is<mapnik::image_gray8>());
+    mapnik::image_gray8 const& image = mapnik::util::get<mapnik::image_gray8>(raster.data_);
+    REQUIRE(image.size() > 0);
+    int value = image(0, 0);
+    for (std::size_t y = 0; y < image.height(); ++y)
+    {
+        for (std::size_t x = 0; x < image.width(); ++x)
+        {
+            if (image(x, y) != value) return -1;
+        }
+    }
+    return value;
+}
+
+void check_raster(mapnik::raster const& raster, std::size_t size, mapnik::box2d<double> const& extent)
+{
+    CHECK(raster.data_.width() == size);
+    CHECK(raster.data_.height() == size);
+    CHECK(raster.ext_ == extent);
+}
+
+}
+
+TEST_CASE("gdal") {
+
+    std::string gdal_plugin("./plugins/input/gdal.input");
+    if (mapnik::util::exists(gdal_plugin))
+    {
+        std::string filename("/tmp/mapnik-gdal-overviews.tif");
+        write_geotiff(filename, { 64, 32, 16 }, { 10, 100, 200 });
+        mapnik::box2d<double> full_extent(0, 0, 64, 64);
+
+        mapnik::parameters params;
+        params["type"] = "gdal";
+        params["file"] = filename;
+        params["band"] = mapnik::value_integer(1);
+
+        SECTION("reads the coarsest overview providing the query resolution")
+        {
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+            CHECK(ds->envelope() == full_extent);
+
+            // full resolution
+            mapnik::raster_ptr raster = read_raster(ds, full_extent, 1.0);
+            check_raster(*raster, 64, full_extent);
+            CHECK(raster_value(*raster) == 10);
+            // a quarter of it: the 16x16 overview
+            raster = read_raster(ds, full_extent, 0.25);
+            check_raster(*raster, 16, full_extent);
+            CHECK(raster_value(*raster) == 200);
+            // between the overviews: the finer 32x32 one
+            raster = read_raster(ds, full_extent, 0.4);
+            check_raster(*raster, 26, full_extent);
+            CHECK(raster_value(*raster) == 100);
+            raster = read_raster(ds, full_extent, 0.5);
+            check_raster(*raster, 32, full_extent);
+            CHECK(raster_value(*raster) == 100);
+        }
+
+        SECTION("filter_factor asks for finer overviews")
+        {
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+            mapnik::raster_ptr raster = read_raster(ds, full_extent, 0.25, 2.0);
+            check_raster(*raster, 32, full_extent);
+            CHECK(raster_value(*raster) == 100);
+            CHECK(raster->get_filter_factor() == 2.0);
+            raster = read_raster(ds, full_extent, 0.5, 2.0);
+            check_raster(*raster, 64, full_extent);
+            CHECK(raster_value(*raster) == 10);
+        }
+
+        SECTION("the window snaps to whole overview pixels")
+        {
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+            // pixels 3..61 with the margin, 1.5..30.5 on the 32x32 overview
+            mapnik::raster_ptr raster = read_raster(ds, mapnik::box2d<double>(5, 5, 59, 59), 0.5);
+            check_raster(*raster, 29, mapnik::box2d<double>(2, 2, 62, 62));
+            CHECK(raster_value(*raster) == 100);
+        }
+
+        SECTION("use_overviews=false reads the full resolution window")
+        {
+            params["use_overviews"] = mapnik::value_bool(false);
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+            // GDAL may still downsample from an overview, the window is the
+            // full resolution one
+            mapnik::raster_ptr raster = read_raster(ds, mapnik::box2d<double>(5, 5, 59, 59), 0.5);
+            check_raster(*raster, 29, mapnik::box2d<double>(3, 3, 61, 61));
+            raster = read_raster(ds, full_extent, 0.25);
+            check_raster(*raster, 16, full_extent);
+            raster = read_raster(ds, full_extent, 1.0);
+            check_raster(*raster, 64, full_extent);
+            CHECK(raster_value(*raster) == 10);
+        }
+        std::remove(filename.c_str());
+    }
+}
@@ -255,6 +255,31 @@ TEST_CASE("postgis") {
             require_geometry(featureset->next(), 3, mapnik::geometry::geometry_types::GeometryCollection);
         }
 
+        SECTION("Postgis streamingresultset")
+        {
+            mapnik::parameters params(base_params);
+            params["table"] = "(SELECT * FROM test) as data";
+            params["streaming"] = "true";
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+            auto featureset = all_features(ds);
+            CHECK(count_features(featureset) == 8);
+
+            featureset = all_features(ds);
+            mapnik::feature_ptr feature;
+            while (bool(feature = featureset->next())) {
+                CHECK(feature->size() == 10);
+            }
+
+            // abandon a query half way, the connection must be reusable
+            featureset = all_features(ds);
+            require_geometry(featureset->next(), 1, mapnik::geometry::geometry_types::Point);
+            require_geometry(featureset->next(), 1, mapnik::geometry::geometry_types::Point);
+            featureset.reset();
+            featureset = all_features(ds);
+            CHECK(count_features(featureset) == 8);
+        }
+
         SECTION("Postgis bbox query")
         {
             mapnik::parameters params(base_params);
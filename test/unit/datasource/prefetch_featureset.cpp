@@ -0,0 +1,168 @@
+#include "catch.hpp"
+
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/util/prefetch_featureset.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/image.hpp>
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+struct failing_datasource : mapnik::memory_datasource
+{
+    failing_datasource(mapnik::parameters const& params)
+        : mapnik::memory_datasource(params) {}
+
+    mapnik::featureset_ptr features(mapnik::query const&) const
+    {
+        throw std::runtime_error("failing_datasource");
+    }
+};
+
+void add_layer(mapnik::Map & m, std::string const& name, mapnik::datasource_ptr const& ds, int num_styles)
+{
+    mapnik::layer lyr(name);
+    lyr.set_datasource(ds);
+    for (int s = 0; s < num_styles; ++s)
+    {
+        std::string style_name = name + "-" + std::to_string(s);
+        mapnik::feature_type_style style;
+        mapnik::rule r;
+        mapnik::polygon_symbolizer poly_sym;
+        mapnik::put(poly_sym, mapnik::keys::fill, mapnik::color(40 * s, 255 - 20 * s, 100, 128));
+        r.append(std::move(poly_sym));
+        style.add_rule(std::move(r));
+        m.insert_style(style_name, std::move(style));
+        lyr.add_style(style_name);
+    }
+    lyr.set_cache_features(false);
+    m.add_layer(lyr);
+}
+
+mapnik::Map make_map(int num_layers)
+{
+    mapnik::Map m(256, 256);
+    m.set_background(mapnik::color(255, 255, 255));
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    for (int l = 0; l < num_layers; ++l)
+    {
+        mapnik::parameters params;
+        params["type"] = "memory";
+        auto ds = std::make_shared<mapnik::memory_datasource>(params);
+        for (int i = 0; i < 5; ++i)
+        {
+            double x = l * 10 + i * 20;
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i + 1));
+            mapnik::geometry::polygon<double> poly;
+            poly.exterior_ring.add_coord(x, x);
+            poly.exterior_ring.add_coord(x + 30, x);
+            poly.exterior_ring.add_coord(x + 30, x + 15);
+            poly.exterior_ring.add_coord(x, x);
+            feature->set_geometry(std::move(poly));
+            ds->push(feature);
+        }
+        add_layer(m, "layer" + std::to_string(l), ds, 1 + l % 3);
+    }
+    m.zoom_to_box(mapnik::box2d<double>(-10, -10, 250, 250));
+    return m;
+}
+
+}
+
+TEST_CASE("prefetch_featureset") {
+
+SECTION("returns all features of every query") {
+
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    for (int i = 0; i < 10; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i + 1));
+        feature->set_geometry(mapnik::geometry::point<double>(i, i));
+        ds->push(feature);
+    }
+
+    mapnik::query q(ds->envelope());
+    // fewer features prefetched than available, and more than available
+    for (std::size_t num_features : { std::size_t(3), std::size_t(100) })
+    {
+        mapnik::prefetch_result result = mapnik::prefetch_features(ds, q, 2, num_features);
+        for (std::size_t i = 0; i < 2; ++i)
+        {
+            mapnik::prefetch_featureset fs(result, i);
+            mapnik::value_integer expected_id = 1;
+            while (mapnik::feature_ptr feature = fs.next())
+            {
+                CHECK(feature->id() == expected_id++);
+            }
+            CHECK(expected_id == 11);
+            CHECK(!fs.next());
+        }
+    }
+}
+
+SECTION("prefetching layers renders like querying them") {
+
+    mapnik::prefetch_pool & pool = mapnik::prefetch_pool::instance();
+    std::size_t max_threads = pool.max_threads();
+    pool.set_max_threads(2);
+
+    mapnik::Map m = make_map(16);
+    mapnik::image_rgba8 queried(m.width(), m.height());
+    {
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(m, queried);
+        ren.apply();
+    }
+    CHECK(queried.painted());
+    // fewer features prefetched than a layer has, and all of them
+    for (std::size_t prefetch_size : { std::size_t(2), std::size_t(100) })
+    {
+        mapnik::image_rgba8 prefetched(m.width(), m.height());
+        {
+            mapnik::agg_renderer<mapnik::image_rgba8> ren(m, prefetched);
+            ren.set_prefetch_size(prefetch_size);
+            ren.apply();
+        }
+        CHECK(pool.threads() <= 2);
+        CHECK(prefetched == queried);
+    }
+
+    // layers the workers don't get to are queried by the renderer
+    pool.set_max_threads(0);
+    {
+        mapnik::image_rgba8 prefetched(m.width(), m.height());
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(m, prefetched);
+        ren.set_prefetch_size(2);
+        ren.apply();
+        CHECK(prefetched == queried);
+    }
+    pool.set_max_threads(max_threads);
+
+    // datasource errors reach the renderer
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto failing = std::make_shared<failing_datasource>(params);
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(std::make_shared<mapnik::context_type>(), 1));
+    feature->set_geometry(mapnik::geometry::point<double>(100, 100));
+    failing->push(feature);
+    add_layer(m, "failing", failing, 1);
+    mapnik::image_rgba8 image(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, image);
+    ren.set_prefetch_size(2);
+    CHECK_THROWS(ren.apply());
+}
+
+}
@@ -0,0 +1,146 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "catch.hpp"
+
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/raster.hpp>
+#include <mapnik/raster_block_cache.hpp>
+#include <mapnik/util/fs.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Reads every raster the datasource returns for `bbox` and counts the pixels
+// differing from the window of `source` the raster's extent covers. The
+// datasource maps one map unit to one pixel of `source`.
+std::size_t count_mismatches(mapnik::datasource_ptr const& ds, mapnik::box2d<double> const& bbox,
+                             mapnik::image_rgba8 const& source, std::vector<mapnik::image_rgba8> & rasters)
+{
+    mapnik::query q(bbox);
+    auto features = ds->features(q);
+    REQUIRE(features != nullptr);
+    std::size_t mismatches = 0;
+    while (mapnik::feature_ptr feature = features->next())
+    {
+        mapnik::raster_ptr raster = feature->get_raster();
+        if (!raster) continue; // nothing visible of this tile
+        REQUIRE(raster->data_.is<mapnik::image_rgba8>());
+        mapnik::image_rgba8 const& data = mapnik::util::get<mapnik::image_rgba8>(raster->data_);
+        int x_off = static_cast<int>(raster->ext_.minx());
+        int y_off = static_cast<int>(source.height() - raster->ext_.maxy());
+        CHECK(raster->ext_.width() == data.width());
+        CHECK(raster->ext_.height() == data.height());
+        REQUIRE(x_off >= 0);
+        REQUIRE(y_off >= 0);
+        REQUIRE(x_off + data.width() <= std::size_t(source.width()));
+        REQUIRE(y_off + data.height() <= std::size_t(source.height()));
+        for (std::size_t y = 0; y < data.height(); ++y)
+        {
+            for (std::size_t x = 0; x < data.width(); ++x)
+            {
+                if (data(x, y) != source(x_off + x, y_off + y)) ++mismatches;
+            }
+        }
+        rasters.push_back(data);
+    }
+    return mismatches;
+}
+
+}
+
+TEST_CASE("raster") {
+
+#if defined(HAVE_TIFF)
+    std::string raster_plugin("./plugins/input/raster.input");
+    if (mapnik::util::exists(raster_plugin))
+    {
+        SECTION("tiled reads through the block cache match the image")
+        {
+            // not a multiple of the tile size, the last row and column of
+            // blocks are partial
+            mapnik::image_rgba8 source(100, 70);
+            for (std::size_t y = 0; y < source.height(); ++y)
+            {
+                for (std::size_t x = 0; x < source.width(); ++x)
+                {
+                    std::uint32_t blue = (x * 7 + y * 13) & 0xff;
+                    source(x, y) = std::uint32_t(x) | std::uint32_t(y) << 8 | blue << 16 | 0xffu << 24;
+                }
+            }
+            std::string filename("/tmp/mapnik-raster-blocks.tif");
+            mapnik::save_to_file(source, filename, "tiff");
+
+            mapnik::parameters params;
+            params["type"] = "raster";
+            params["file"] = filename;
+            params["format"] = "tiff";
+            params["extent"] = "0,0,100,70";
+            params["tile_size"] = mapnik::value_integer(16);
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+
+            mapnik::raster_block_cache & cache = mapnik::raster_block_cache::instance();
+            std::size_t max_bytes = cache.max_bytes();
+            cache.set_max_bytes(1 << 20);
+            cache.clear();
+
+            // the whole image, and a window starting and ending within blocks
+            // that reaches the partial blocks on the right
+            for (auto const& bbox : { mapnik::box2d<double>(0, 0, 100, 70),
+                                      mapnik::box2d<double>(13.5, 2.25, 100, 61.5) })
+            {
+                INFO(bbox);
+                std::vector<mapnik::image_rgba8> uncached;
+                cache.set_max_bytes(0);
+                CHECK(count_mismatches(ds, bbox, source, uncached) == 0);
+                CHECK(cache.size() == 0);
+                CHECK(uncached.size() > 1);
+
+                cache.set_max_bytes(1 << 20);
+                std::vector<mapnik::image_rgba8> decoded;
+                CHECK(count_mismatches(ds, bbox, source, decoded) == 0);
+                CHECK(cache.size() > 0);
+                std::size_t hits = cache.hits();
+                std::vector<mapnik::image_rgba8> cached;
+                CHECK(count_mismatches(ds, bbox, source, cached) == 0);
+                CHECK(cache.hits() > hits);
+
+                CHECK(decoded == uncached);
+                CHECK(cached == uncached);
+            }
+            cache.clear();
+            cache.set_max_bytes(max_bytes);
+            std::remove(filename.c_str());
+        }
+    }
+#endif
+}
@@ -26,8 +26,15 @@
 #include <mapnik/datasource_cache.hpp>
 #include <mapnik/mapped_memory_cache.hpp>
 #include <mapnik/util/fs.hpp>
+#include <mapnik/util/geometry_to_wkt.hpp>
+#include <mapnik/util/hilbert_rtree.hpp>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <vector>
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
 #include <boost/algorithm/string.hpp>
@@ -66,7 +73,48 @@ std::size_t count_shapefile_features(std::string const& filename)
     return feature_count;
 }
 
-int create_shapefile_index(std::string const& filename, bool index_parts, bool silent = true)
+struct shape_feature
+{
+    std::string wkt;
+    std::string attributes;
+    mapnik::box2d<double> envelope;
+};
+
+// features of a shapefile in the order the datasource returns them
+std::vector<shape_feature> read_shapefile_features(std::string const& filename, mapnik::box2d<double> & extent)
+{
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+    mapnik::mapped_memory_cache::instance().clear();
+#endif
+    mapnik::parameters params;
+    params["type"] = "shape";
+    params["file"] = filename;
+    auto ds = mapnik::datasource_cache::instance().create(params);
+    REQUIRE(ds != nullptr);
+    extent = ds->envelope();
+    mapnik::query query(extent);
+    for (auto const& field : ds->get_descriptor().get_descriptors())
+    {
+        query.add_property_name(field.get_name());
+    }
+    auto features = ds->features(query);
+    REQUIRE(features != nullptr);
+    std::vector<shape_feature> result;
+    while (auto feature = features->next())
+    {
+        shape_feature f;
+        mapnik::util::to_wkt(f.wkt, feature->get_geometry());
+        for (auto const& kv : *feature)
+        {
+            f.attributes += std::get<0>(kv) + "=" + std::get<1>(kv).to_string() + ";";
+        }
+        f.envelope = feature->envelope();
+        result.push_back(f);
+    }
+    return result;
+}
+
+int create_shapefile_index(std::string const& filename, bool index_parts, bool reorder = false, bool silent = true)
 {
     std::string cmd;
     if (std::getenv("DYLD_LIBRARY_PATH") != nullptr)
@@ -76,6 +124,7 @@ int create_shapefile_index(std::string const& filename, bool index_parts, bool s
 
     cmd += "shapeindex ";
     if (index_parts) cmd+= "--index-parts ";
+    if (reorder) cmd+= "--reorder ";
     cmd += filename;
     if (silent)
     {
@@ -180,5 +229,64 @@ TEST_CASE("shapeindex")
                 }
             }
         }
+
+        SECTION("Reorder")
+        {
+            std::string path = "test/data/shp/boundaries.shp";
+            std::string reordered_base = path.substr(0, path.rfind(".")) + "_hilbert";
+            mapnik::box2d<double> extent;
+            std::vector<shape_feature> features = read_shapefile_features(path, extent);
+            REQUIRE(create_shapefile_index(path, false, true) == 0);
+            REQUIRE(mapnik::util::exists(reordered_base + ".shp"));
+            REQUIRE(mapnik::util::exists(reordered_base + ".index"));
+            // same features, served through the index of the reordered copy
+            CHECK(count_shapefile_features(reordered_base + ".shp") == features.size());
+
+            // records of the copy in file order
+            mapnik::util::remove(reordered_base + ".index");
+            mapnik::box2d<double> reordered_extent;
+            std::vector<shape_feature> reordered = read_shapefile_features(reordered_base + ".shp", reordered_extent);
+            REQUIRE(reordered.size() == features.size());
+            CHECK(reordered_extent == extent);
+
+            // each geometry keeps its dbf attributes
+            std::multimap<std::string, std::string> attributes;
+            for (auto const& f : features)
+            {
+                attributes.emplace(f.wkt, f.attributes);
+            }
+            for (auto const& f : reordered)
+            {
+                CAPTURE(f.wkt);
+                auto range = attributes.equal_range(f.wkt);
+                auto itr = range.first;
+                while (itr != range.second && itr->second != f.attributes) ++itr;
+                REQUIRE(itr != range.second);
+                attributes.erase(itr);
+            }
+
+            // records follow the Hilbert curve through the centres of their boxes
+            double const max_coord = (1 << 16) - 1;
+            std::uint32_t previous = 0;
+            for (auto const& f : reordered)
+            {
+                std::uint32_t hilbert = std::numeric_limits<std::uint32_t>::max();
+                if (f.envelope.valid() && extent.contains(f.envelope.center()))
+                {
+                    hilbert = mapnik::util::hilbert_index(
+                        static_cast<std::uint32_t>(max_coord * (f.envelope.center().x - extent.minx()) / extent.width()),
+                        static_cast<std::uint32_t>(max_coord * (f.envelope.center().y - extent.miny()) / extent.height()));
+                }
+                CHECK(hilbert >= previous);
+                previous = hilbert;
+            }
+            for (auto const& ext : {".shp", ".shx", ".dbf", ".prj", ".cpg", ".index"})
+            {
+                if (mapnik::util::exists(reordered_base + ext))
+                {
+                    mapnik::util::remove(reordered_base + ext);
+                }
+            }
+        }
     }
 }
@@ -24,6 +24,9 @@
 
 #include <mapnik/quad_tree.hpp>
 #include <mapnik/util/spatial_index.hpp>
+#include <mapnik/util/hilbert_rtree.hpp>
+
+#include <algorithm>
 
 TEST_CASE("spatial_index")
 {
@@ -84,4 +87,136 @@ TEST_CASE("spatial_index")
         REQUIRE(results[3] == 2);
         REQUIRE(results.size() == 4);
     }
+
+    SECTION("mapnik::util::mapped_spatial_index<T>")
+    {
+        using value_type = std::int32_t;
+        using mapnik::filter_in_box;
+        using index_type = mapnik::util::mapped_spatial_index<value_type, filter_in_box>;
+        mapnik::box2d<double> extent(0,0,100,100);
+        mapnik::quad_tree<value_type> tree(extent);
+        tree.insert(1, mapnik::box2d<double>(10,10,20,20));
+        tree.insert(2, mapnik::box2d<double>(30,30,40,40));
+        tree.insert(3, mapnik::box2d<double>(30,10,40,20));
+        tree.insert(4, mapnik::box2d<double>(1,1,2,2));
+        tree.trim();
+
+        for (unsigned version : {1u, 2u})
+        {
+            std::ostringstream out(std::ios::binary);
+            tree.write(out, version);
+            std::string const buffer = out.str();
+            index_type index(buffer.data(), buffer.size());
+            REQUIRE(index.version() == version);
+            REQUIRE(index.bounding_box() == tree.extent());
+
+            // same order as the stream based reader
+            std::vector<value_type> results;
+            filter_in_box filter(extent);
+            index.query(filter, results);
+            REQUIRE(results.size() == 4);
+            REQUIRE(results[0] == 1);
+            REQUIRE(results[1] == 4);
+            REQUIRE(results[2] == 3);
+            REQUIRE(results[3] == 2);
+
+            results.clear();
+            index.query_first_n(filter, results, 2);
+            REQUIRE(results.size() == 2);
+            REQUIRE(results[0] == 1);
+            REQUIRE(results[1] == 4);
+
+            // only the node containing item 2 and its parents pass this filter
+            results.clear();
+            index.query(filter_in_box(mapnik::box2d<double>(35,35,36,36)), results);
+            REQUIRE(std::find(results.begin(), results.end(), 2) != results.end());
+            REQUIRE(std::find(results.begin(), results.end(), 4) == results.end());
+        }
+
+        std::string const garbage(64, 'x');
+        REQUIRE_THROWS(index_type(garbage.data(), garbage.size()));
+    }
+
+    SECTION("mapnik::util::hilbert_rtree_builder<T>")
+    {
+        using value_type = std::int32_t;
+        using mapnik::filter_in_box;
+        using index_type = mapnik::util::mapped_spatial_index<value_type, filter_in_box>;
+
+        // the corner 8x8 block is visited first, stepping between adjacent cells
+        std::vector<std::pair<std::uint32_t, std::uint32_t> > cells(64);
+        for (std::uint32_t x = 0; x < 8; ++x)
+        {
+            for (std::uint32_t y = 0; y < 8; ++y)
+            {
+                std::uint32_t d = mapnik::util::hilbert_index(x, y);
+                REQUIRE(d < 64);
+                cells[d] = std::make_pair(x, y);
+            }
+        }
+        for (std::size_t i = 1; i < cells.size(); ++i)
+        {
+            int dx = std::abs(int(cells[i].first) - int(cells[i - 1].first));
+            int dy = std::abs(int(cells[i].second) - int(cells[i - 1].second));
+            REQUIRE(dx + dy == 1);
+        }
+
+        mapnik::util::hilbert_rtree_builder<value_type> builder(4);
+        for (int x = 0; x < 10; ++x)
+        {
+            for (int y = 0; y < 10; ++y)
+            {
+                builder.insert(x * 10 + y, mapnik::box2d<double>(x * 10 + 0.1, y * 10 + 0.1, x * 10 + 0.9, y * 10 + 0.9));
+            }
+        }
+        builder.insert(-1, mapnik::box2d<double>()); // invalid boxes are skipped
+        REQUIRE(builder.size() == 100);
+
+        std::ostringstream out(std::ios::binary);
+        builder.write(out);
+        std::string const buffer = out.str();
+        REQUIRE(buffer.size() % 8 == 0);
+        index_type index(buffer.data(), buffer.size());
+        REQUIRE(index.version() == 3);
+        REQUIRE(index.bounding_box() == mapnik::box2d<double>(0.1, 0.1, 90.9, 90.9));
+
+        std::vector<value_type> results;
+        index.query(filter_in_box(index.bounding_box()), results);
+        REQUIRE(results.size() == 100);
+        std::sort(results.begin(), results.end());
+        for (int i = 0; i < 100; ++i) REQUIRE(results[i] == i);
+
+        // boxes are rounded outwards, so the query never misses items
+        results.clear();
+        index.query(filter_in_box(mapnik::box2d<double>(30.9, 40.9, 31, 41)), results);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0] == 34);
+
+        results.clear();
+        index.query(filter_in_box(mapnik::box2d<double>(25, 25, 45, 45)), results);
+        std::sort(results.begin(), results.end());
+        REQUIRE(results == std::vector<value_type>({33, 34, 43, 44}));
+
+        results.clear();
+        index.query_first_n(filter_in_box(index.bounding_box()), results, 7);
+        REQUIRE(results.size() == 7);
+
+        // single item tree: the root is the item
+        mapnik::util::hilbert_rtree_builder<value_type> single;
+        single.insert(42, mapnik::box2d<double>(1, 1, 2, 2));
+        std::ostringstream single_out(std::ios::binary);
+        single.write(single_out);
+        std::string const single_buffer = single_out.str();
+        index_type single_index(single_buffer.data(), single_buffer.size());
+        results.clear();
+        single_index.query(filter_in_box(mapnik::box2d<double>(0, 0, 10, 10)), results);
+        REQUIRE(results == std::vector<value_type>({42}));
+        results.clear();
+        single_index.query(filter_in_box(mapnik::box2d<double>(5, 5, 10, 10)), results);
+        REQUIRE(results.empty());
+
+        // truncated files are rejected
+        index_type truncated(buffer.data(), buffer.size() / 2);
+        REQUIRE_THROWS(truncated.query(filter_in_box(index.bounding_box()), results));
+    }
 }
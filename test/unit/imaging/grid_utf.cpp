@@ -0,0 +1,74 @@
+#include "catch.hpp"
+
+#if defined(GRID_RENDERER)
+
+// mapnik
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_utf.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/unicode.hpp>
+
+// stl
+#include <sstream>
+#include <string>
+
+TEST_CASE("grid utf") {
+
+SECTION("encodes visible keys and their fields") {
+
+    mapnik::grid g(4, 4, "__id__");
+    g.add_field("__id__");
+    g.add_field("name");
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    mapnik::feature_ptr f1(mapnik::feature_factory::create(ctx, 1));
+    f1->put("name", mapnik::value_unicode_string("a \"quoted\" name"));
+    mapnik::feature_ptr f2(mapnik::feature_factory::create(ctx, 2));
+    f2->put("name", mapnik::value_unicode_string("b"));
+    g.add_feature(*f1);
+    g.add_feature(*f2);
+    g.setPixel(1, 0, 1);
+    g.setPixel(2, 2, 1);
+    g.setPixel(3, 3, 2);
+
+    CHECK(mapnik::grid_encode_utf(g, 1) ==
+          "{\"grid\":[\" !  \",\"    \",\"  ! \",\"   #\"],"
+          "\"keys\":[\"\",\"1\",\"2\"],"
+          "\"data\":{\"1\":{\"__id__\":1,\"name\":\"a \\\"quoted\\\" name\"},"
+          "\"2\":{\"__id__\":2,\"name\":\"b\"}}}");
+
+    // feature 2 is not sampled at resolution 2 and is left out entirely
+    std::ostringstream out;
+    mapnik::grid_encode_utf(g, out, 2, false);
+    CHECK(out.str() == "{\"grid\":[\"  \",\" !\"],\"keys\":[\"\",\"1\"],\"data\":{}}");
+
+    // views encode their own window
+    mapnik::grid_view view = g.get_view(2, 2, 2, 2);
+    CHECK(mapnik::grid_encode_utf(view, 1, false) ==
+          "{\"grid\":[\" !\",\"!#\"],\"keys\":[\"1\",\"\",\"2\"],\"data\":{}}");
+}
+
+SECTION("skips codepoints needing escapes") {
+
+    mapnik::grid g(100, 1, "__id__");
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    for (int i = 1; i < 100; ++i)
+    {
+        mapnik::feature_ptr f(mapnik::feature_factory::create(ctx, i));
+        g.add_feature(*f);
+        g.setPixel(i, 0, i);
+    }
+    std::string json = mapnik::grid_encode_utf(g, 1, false);
+    std::string row = json.substr(json.find('"', 9) + 1);
+    row = row.substr(0, row.find('"'));
+    CHECK(row.find('\\') == std::string::npos);
+    // 100 keys from 32, skipping '"' and '\': 94 of them fit in ascii,
+    // the last 6 take two bytes each in utf-8
+    CHECK(row.size() == 94 + 6 * 2);
+    CHECK(json.find("\"keys\":[\"\",\"1\",\"2\",") != std::string::npos);
+}
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/image.hpp>
+#include <mapnik/image_compositing.hpp>
+#include <mapnik/image_util.hpp>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore_agg.hpp>
+#include "agg_color_rgba.h"
+#include "agg_pixfmt_rgba.h"
+#pragma GCC diagnostic pop
+
+// stl
+#include <cstdint>
+#include <random>
+
+namespace {
+
+using color = agg::rgba8;
+using order = agg::order_rgba;
+
+mapnik::image_rgba8 random_image(std::size_t width, std::size_t height, std::mt19937 & rng)
+{
+    mapnik::image_rgba8 im(width, height, true, true);
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            std::uint32_t a = rng() % 256;
+            if (x % 5 == 0) a = 0;
+            if (x % 7 == 0) a = 255;
+            std::uint32_t r = (rng() % 256) * a / 255;
+            std::uint32_t g = (rng() % 256) * a / 255;
+            std::uint32_t b = (rng() % 256) * a / 255;
+            im(x, y) = r | (g << 8) | (b << 16) | (a << 24);
+        }
+    }
+    return im;
+}
+
+// per pixel reference using AGG's blenders directly
+template <typename Blender>
+void reference_composite(mapnik::image_rgba8 & dst, mapnik::image_rgba8 const& src,
+                         unsigned cover, int dx, int dy)
+{
+    for (int y = 0; y < static_cast<int>(dst.height()); ++y)
+    {
+        for (int x = 0; x < static_cast<int>(dst.width()); ++x)
+        {
+            int sx = x - dx;
+            int sy = y - dy;
+            if (sx < 0 || sy < 0 || sx >= static_cast<int>(src.width()) || sy >= static_cast<int>(src.height())) continue;
+            std::uint8_t * p = reinterpret_cast<std::uint8_t*>(&dst(x, y));
+            std::uint8_t const* s = reinterpret_cast<std::uint8_t const*>(&src(sx, sy));
+            Blender::blend_pix(p, s[order::R], s[order::G], s[order::B], s[order::A], cover);
+        }
+    }
+}
+
+template <typename Blender>
+void check_mode(mapnik::composite_mode_e mode, std::mt19937 & rng)
+{
+    mapnik::image_rgba8 src = random_image(37, 19, rng);
+    mapnik::image_rgba8 dst = random_image(41, 23, rng);
+    for (float opacity : { 1.0f, 0.5f, 0.0f })
+    {
+        for (int offset : { 0, 3, -5 })
+        {
+            mapnik::image_rgba8 expected(dst);
+            reference_composite<Blender>(expected, src, static_cast<unsigned>(255 * opacity), offset, -offset);
+            mapnik::image_rgba8 result(dst);
+            mapnik::composite(result, src, mode, opacity, offset, -offset);
+            CHECK(mapnik::compare(expected, result) == 0);
+        }
+    }
+}
+
+}
+
+TEST_CASE("image compositing") {
+
+SECTION("row kernels match agg blenders") {
+
+    std::mt19937 rng(42);
+    check_mode<agg::comp_op_rgba_src_over<color, order> >(mapnik::src_over, rng);
+    check_mode<agg::comp_op_rgba_dst_in<color, order> >(mapnik::dst_in, rng);
+    check_mode<agg::comp_op_rgba_dst_out<color, order> >(mapnik::dst_out, rng);
+    check_mode<agg::comp_op_rgba_multiply<color, order> >(mapnik::multiply, rng);
+    check_mode<agg::comp_op_rgba_screen<color, order> >(mapnik::screen, rng);
+    // modes without a row kernel still go through agg
+    check_mode<agg::comp_op_rgba_darken<color, order> >(mapnik::darken, rng);
+}
+
+}
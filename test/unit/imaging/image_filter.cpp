@@ -11,6 +11,8 @@
 // stl
 #include <sstream>
 #include <array>
+#include <cstdint>
+#include <vector>
 
 TEST_CASE("image filter") {
 
@@ -521,4 +523,73 @@ SECTION("test color-blind-tritanope") {
 
 } // END SECTION
 
+SECTION("filters give the same result with multiple jobs") {
+
+    mapnik::image_rgba8 im(67,41);
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            std::uint32_t a = (x * 7 + y * 3) % 256;
+            std::uint32_t r = (x * 13) % 256;
+            std::uint32_t g = (y * 29) % 256;
+            std::uint32_t b = (x * y) % 256;
+            im(x,y) = r | (g << 8) | (b << 16) | (a << 24);
+        }
+    }
+    std::vector<mapnik::filter::filter_type> filters;
+    REQUIRE(mapnik::filter::parse_image_filters("agg-stack-blur(3,5) sharpen emboss "
+                                                "colorize-alpha(blue,red 0.5,green) "
+                                                "color-to-alpha(blue) scale-hsla(0,0.5,0,1,0,1,0,1) "
+                                                "color-blind-protanope", filters));
+    for (auto const& filter : filters)
+    {
+        mapnik::image_rgba8 serial(im);
+        mapnik::image_rgba8 parallel(im);
+        mapnik::util::apply_visitor(mapnik::filter::filter_visitor<mapnik::image_rgba8>(serial, 1), filter);
+        mapnik::util::apply_visitor(mapnik::filter::filter_visitor<mapnik::image_rgba8>(parallel, 4), filter);
+        CHECK(parallel.get_premultiplied() == serial.get_premultiplied());
+        CHECK(mapnik::compare(parallel, serial) == 0);
+    }
+
+} // END SECTION
+
+SECTION("filter chains premultiply within the filters") {
+
+    mapnik::image_rgba8 im(53,37);
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            std::uint32_t a = (x * 11 + y * 5) % 256;
+            std::uint32_t r = (x * 17) % 256;
+            std::uint32_t g = (y * 23) % 256;
+            std::uint32_t b = (x * y) % 256;
+            im(x,y) = r | (g << 8) | (b << 16) | (a << 24);
+        }
+    }
+    std::vector<mapnik::filter::filter_type> filters;
+    REQUIRE(mapnik::filter::parse_image_filters("blur gray sharpen invert emboss "
+                                                "agg-stack-blur(2,3) edge-detect x-gradient "
+                                                "sobel scale-hsla(0,1,0,1,0,1,0,0.5) sobel", filters));
+    for (bool premultiply : { true, false })
+    {
+        // each filter premultiplying or demultiplying the whole image
+        mapnik::image_rgba8 expected(im);
+        for (auto const& filter : filters)
+        {
+            mapnik::util::apply_visitor(mapnik::filter::filter_visitor<mapnik::image_rgba8>(expected), filter);
+        }
+        if (premultiply) mapnik::premultiply_alpha(expected);
+        for (unsigned jobs : { 1, 4 })
+        {
+            mapnik::image_rgba8 fused(im);
+            mapnik::filter::apply_filters(fused, filters, jobs, premultiply);
+            CHECK(fused.get_premultiplied() == expected.get_premultiplied());
+            CHECK(mapnik::compare(fused, expected) == 0);
+        }
+    }
+
+} // END SECTION
+
 } // END TEST CASE
@@ -7,6 +7,9 @@
 #include <mapnik/image_util.hpp>
 #include <mapnik/image_util_jpeg.hpp>
 #include <mapnik/util/fs.hpp>
+#if defined(HAVE_PNG)
+#include <mapnik/png_io.hpp>
+#endif
 #if defined(HAVE_CAIRO)
 #include <mapnik/cairo/cairo_context.hpp>
 #include <mapnik/cairo/cairo_image_util.hpp>
@@ -233,4 +236,53 @@ SECTION("Quantising small (less than 3 pixel images preserve original colours")
 #endif
 } // END SECTION
 
+SECTION("Parallel png encoding decodes to the same pixels")
+{
+#if defined(HAVE_PNG)
+    mapnik::image_rgba8 im(300, 700);
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            im(x, y) = mapnik::color(x % 256, y % 256, (x * y) % 256, (x + y) % 2 ? 255 : 128).rgba();
+        }
+    }
+    for (std::string const& format : { "png32", "png24", "png8", "png8:c=16", "png8:m=o" })
+    {
+        std::string serial = mapnik::save_to_string(im, format);
+        std::string parallel = mapnik::save_to_string(im, format + ":j=4");
+        std::unique_ptr<mapnik::image_reader> reader1(mapnik::get_image_reader(serial.data(), serial.size()));
+        std::unique_ptr<mapnik::image_reader> reader2(mapnik::get_image_reader(parallel.data(), parallel.size()));
+        REQUIRE(reader2->width() == im.width());
+        REQUIRE(reader2->height() == im.height());
+        auto im1 = mapnik::util::get<mapnik::image_rgba8>(reader1->read(0, 0, im.width(), im.height()));
+        auto im2 = mapnik::util::get<mapnik::image_rgba8>(reader2->read(0, 0, im.width(), im.height()));
+        CHECK(mapnik::compare(im1, im2) == 0);
+    }
+    REQUIRE_THROWS(mapnik::save_to_string(im, "png8:j=-1"));
+#endif
+} // END SECTION
+
+SECTION("IDAT data is split into bounded chunks")
+{
+#if defined(HAVE_PNG)
+    std::string data("0123456789");
+    std::ostringstream ss(std::ios::binary);
+    mapnik::detail::write_png_idat(ss, data, 4);
+    std::string out = ss.str();
+    // length, type, data and crc of each chunk
+    REQUIRE(out.size() == 3 * 12 + data.size());
+    std::size_t offset = 0;
+    std::string joined;
+    for (std::size_t length : { 4, 4, 2 })
+    {
+        CHECK(out.substr(offset, 4) == std::string("\0\0\0", 3) + static_cast<char>(length));
+        CHECK(out.substr(offset + 4, 4) == "IDAT");
+        joined += out.substr(offset + 8, length);
+        offset += 12 + length;
+    }
+    CHECK(joined == data);
+#endif
+} // END SECTION
+
 } // END TEST_CASE
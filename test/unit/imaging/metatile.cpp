@@ -0,0 +1,54 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/image.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/color.hpp>
+#include <mapnik/metatile.hpp>
+
+TEST_CASE("metatile") {
+
+SECTION("split and encode") {
+
+    mapnik::image_rgba8 im(64, 32);
+    mapnik::fill(im, mapnik::color("white"));
+    // only the right tile has any detail
+    for (unsigned x = 32; x < 64; ++x)
+    {
+        mapnik::set_pixel(im, x, x - 32, mapnik::color("blue"));
+    }
+
+    for (std::string const& format : { std::string("png"), std::string("png8"), std::string("png8:c=16") })
+    {
+        mapnik::metatile_options opts;
+        opts.columns = 2;
+        opts.rows = 1;
+        opts.format = format;
+        opts.jobs = 2;
+        std::vector<mapnik::metatile_tile> tiles = mapnik::split_metatile(im, opts);
+        REQUIRE(tiles.size() == 2);
+        CHECK(tiles[0].column == 0);
+        CHECK(tiles[1].column == 1);
+        CHECK(tiles[0].solid);
+        CHECK(tiles[0].pixel == mapnik::get_pixel<std::uint32_t>(im, 0, 0));
+        CHECK_FALSE(tiles[1].solid);
+        CHECK(tiles[0].data == mapnik::save_to_string(mapnik::image_view_rgba8(0, 0, 32, 32, im), format));
+        CHECK(!tiles[1].data.empty());
+
+        opts.encode_solid_tiles = false;
+        tiles = mapnik::split_metatile(im, opts);
+        CHECK(tiles[0].data.empty());
+        CHECK(!tiles[1].data.empty());
+    }
+}
+
+SECTION("uneven split") {
+
+    mapnik::image_rgba8 im(30, 30);
+    mapnik::metatile_options opts;
+    opts.columns = 4;
+    opts.rows = 4;
+    REQUIRE_THROWS(mapnik::split_metatile(im, opts));
+}
+
+}
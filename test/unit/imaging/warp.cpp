@@ -0,0 +1,47 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/image.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/warp.hpp>
+#include <mapnik/warp_mesh_cache.hpp>
+
+TEST_CASE("warp") {
+
+SECTION("multiple jobs and cached meshes give the same image") {
+
+    mapnik::projection proj_4326("+init=epsg:4326");
+    mapnik::projection proj_3857("+init=epsg:3857");
+    mapnik::proj_transform prj_trans(proj_3857, proj_4326);
+
+    mapnik::image_rgba8 source(90, 60, true, true);
+    for (unsigned y = 0; y < source.height(); ++y)
+    {
+        for (unsigned x = 0; x < source.width(); ++x)
+        {
+            source(x, y) = 0xff000000 | ((x * 3) << 16) | ((y * 4) << 8) | ((x * y) & 0xff);
+        }
+    }
+    mapnik::box2d<double> source_ext(-30, 20, 60, 80);
+    mapnik::box2d<double> target_ext(-4000000, 2000000, 7000000, 14000000);
+
+    mapnik::warp_mesh_cache & cache = mapnik::warp_mesh_cache::instance();
+    cache.clear();
+    mapnik::image_rgba8 serial(256, 256, true, true);
+    mapnik::warp_image(serial, source, prj_trans, target_ext, source_ext, 0, 0, 16,
+                       mapnik::SCALING_BILINEAR, 1.0, boost::optional<double>(), 1);
+    CHECK(cache.misses() == 1);
+    CHECK(cache.hits() == 0);
+    mapnik::image_rgba8 parallel(256, 256, true, true);
+    mapnik::warp_image(parallel, source, prj_trans, target_ext, source_ext, 0, 0, 16,
+                       mapnik::SCALING_BILINEAR, 1.0, boost::optional<double>(), 4);
+    CHECK(cache.hits() == 1);
+    CHECK(cache.size() == 1);
+    CHECK(mapnik::compare(serial, parallel) == 0);
+    CHECK(mapnik::is_solid(serial) == false);
+    cache.clear();
+}
+
+}
@@ -0,0 +1,210 @@
+#include "catch.hpp"
+
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/symbolizer_dispatch.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/map.hpp>
+
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// records draws as "<symbolizer><feature ids>", batches as "<symbolizer>[<ids>]"
+struct recorder
+{
+    using processor_impl_type = recorder;
+
+    void process(mapnik::line_symbolizer const&, mapnik::feature_impl & feature, mapnik::proj_transform const&)
+    {
+        draws.push_back("L" + std::to_string(feature.id()));
+    }
+
+    void process(mapnik::text_symbolizer const&, mapnik::feature_impl & feature, mapnik::proj_transform const&)
+    {
+        draws.push_back("T" + std::to_string(feature.id()));
+    }
+
+    void process_batch(mapnik::line_symbolizer const&, mapnik::feature_batch const& features, mapnik::proj_transform const&)
+    {
+        std::string ids;
+        for (mapnik::feature_ptr const& feature : features) ids += std::to_string(feature->id());
+        draws.push_back("L[" + ids + "]");
+    }
+
+    std::vector<std::string> draws;
+};
+
+mapnik::geometry::line_string<double> make_line(std::initializer_list<std::pair<double, double> > coords)
+{
+    mapnik::geometry::line_string<double> line;
+    for (auto const& c : coords) line.add_coord(c.first, c.second);
+    return line;
+}
+
+mapnik::geometry::polygon<double> make_box(double x0, double y0, double x1, double y1)
+{
+    mapnik::geometry::polygon<double> poly;
+    poly.exterior_ring = make_line({ {x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}, {x0, y0} });
+    return poly;
+}
+
+// overlapping lines, polygons and points, so draws blend into each other
+mapnik::feature_batch make_features()
+{
+    auto ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("width");
+    mapnik::feature_batch features;
+    auto add = [&](mapnik::geometry::geometry<double> && geom)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, features.size() + 1));
+        feature->put("width", mapnik::value_double(1.0 + features.size()));
+        feature->set_geometry(std::move(geom));
+        features.push_back(feature);
+    };
+    add(make_line({ {5, 5}, {95, 90}, {50, 95} }));
+    add(make_line({ {5, 90}, {90, 10}, {95, 60} }));
+    mapnik::geometry::multi_line_string<double> multi;
+    multi.push_back(make_line({ {10, 50}, {90, 50} }));
+    multi.push_back(make_line({ {50, 5}, {50.5, 95} }));
+    add(std::move(multi));
+    add(make_box(20, 20, 60, 70));
+    add(make_box(40, 30, 85, 80));
+    add(mapnik::geometry::point<double>(30, 30));
+    add(mapnik::geometry::point<double>(32, 31));
+    add(mapnik::geometry::point<double>(70, 60));
+    return features;
+}
+
+// draws `features` through process_batch and one by one through process
+// on two images, which must come out identical
+template <typename Symbolizer>
+void require_same_pixels(Symbolizer const& sym, mapnik::feature_batch const& features)
+{
+    mapnik::Map m(256, 256);
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 100, 100));
+    mapnik::projection prj(m.srs(), true);
+    mapnik::proj_transform prj_trans(prj, prj);
+    mapnik::layer lyr("batch");
+
+    mapnik::image_rgba8 batched(m.width(), m.height());
+    {
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(m, batched);
+        ren.start_layer_processing(lyr, m.get_current_extent());
+        ren.process_batch(sym, features, prj_trans);
+    }
+    mapnik::image_rgba8 single(m.width(), m.height());
+    {
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(m, single);
+        ren.start_layer_processing(lyr, m.get_current_extent());
+        for (mapnik::feature_ptr const& feature : features)
+        {
+            ren.process(sym, *feature, prj_trans);
+        }
+    }
+    CHECK_FALSE(single == mapnik::image_rgba8(m.width(), m.height()));
+    CHECK(batched == single);
+}
+
+}
+
+TEST_CASE("symbolizer batch") {
+
+    mapnik::projection merc("+init=epsg:3857", true);
+    mapnik::proj_transform prj_trans(merc, merc);
+    auto ctx = std::make_shared<mapnik::context_type>();
+    std::vector<mapnik::feature_ptr> features;
+    for (mapnik::value_integer id = 1; id <= 4; ++id)
+    {
+        features.push_back(mapnik::feature_factory::create(ctx, id));
+    }
+    mapnik::symbolizer line1 = mapnik::line_symbolizer();
+    mapnik::symbolizer line2 = mapnik::line_symbolizer();
+    mapnik::symbolizer text = mapnik::text_symbolizer();
+
+    SECTION("consecutive draws with one symbolizer are merged") {
+        recorder r;
+        mapnik::symbolizer_batch<recorder> batch(r, prj_trans);
+        for (auto const& feature : features) batch.process(line1, feature);
+        CHECK(r.draws.empty());
+        batch.flush();
+        CHECK(r.draws == std::vector<std::string>({ "L[1234]" }));
+    }
+
+    SECTION("draw order is kept") {
+        recorder r;
+        mapnik::symbolizer_batch<recorder> batch(r, prj_trans);
+        batch.process(line1, features[0]);
+        batch.process(line1, features[1]);
+        batch.process(line2, features[1]);
+        batch.process(text, features[1]);
+        batch.process(line1, features[2]);
+        batch.process(line1, features[3]);
+        batch.flush();
+        batch.flush();
+        CHECK(r.draws == std::vector<std::string>({ "L[12]", "L[2]", "T2", "L[34]" }));
+    }
+}
+
+TEST_CASE("agg batches render like single features") {
+
+    mapnik::feature_batch features = make_features();
+
+    SECTION("lines") {
+        mapnik::line_symbolizer sym;
+        mapnik::put(sym, mapnik::keys::stroke, mapnik::color(200, 20, 60, 180));
+        mapnik::put(sym, mapnik::keys::stroke_width, 4.0);
+        mapnik::put(sym, mapnik::keys::stroke_opacity, 0.8);
+        require_same_pixels(sym, features);
+
+        // agg::rasterizer_outline_aa
+        mapnik::put(sym, mapnik::keys::stroke_width, 1.5);
+        mapnik::put(sym, mapnik::keys::line_rasterizer, mapnik::RASTERIZER_FAST);
+        require_same_pixels(sym, features);
+
+        mapnik::line_symbolizer dashed;
+        mapnik::put(dashed, mapnik::keys::stroke, mapnik::color(20, 60, 200, 200));
+        mapnik::put(dashed, mapnik::keys::stroke_width, 3.0);
+        mapnik::put(dashed, mapnik::keys::stroke_dasharray, mapnik::dash_array({ {6.0, 3.0}, {2.0, 3.0} }));
+        mapnik::put(dashed, mapnik::keys::stroke_linecap, mapnik::ROUND_CAP);
+        mapnik::put(dashed, mapnik::keys::offset, 2.0);
+        require_same_pixels(dashed, features);
+
+        // width from the feature, drawn one by one
+        mapnik::line_symbolizer per_feature;
+        mapnik::put(per_feature, mapnik::keys::stroke_width, mapnik::parse_expression("[width]"));
+        require_same_pixels(per_feature, features);
+    }
+
+    SECTION("polygons") {
+        mapnik::polygon_symbolizer sym;
+        mapnik::put(sym, mapnik::keys::fill, mapnik::color(20, 160, 60, 128));
+        mapnik::put(sym, mapnik::keys::fill_opacity, 0.7);
+        mapnik::put(sym, mapnik::keys::gamma, 0.5);
+        require_same_pixels(sym, features);
+        mapnik::put(sym, mapnik::keys::comp_op, mapnik::multiply);
+        require_same_pixels(sym, features);
+    }
+
+    SECTION("markers") {
+        mapnik::markers_symbolizer sym;
+        mapnik::put(sym, mapnik::keys::fill, mapnik::color(60, 60, 200, 160));
+        mapnik::put(sym, mapnik::keys::width, 12.0);
+        mapnik::put(sym, mapnik::keys::height, 12.0);
+        mapnik::put(sym, mapnik::keys::allow_overlap, true);
+        require_same_pixels(sym, features);
+        // placements collide with earlier ones
+        mapnik::put(sym, mapnik::keys::allow_overlap, false);
+        mapnik::put(sym, mapnik::keys::spacing, 15.0);
+        require_same_pixels(sym, features);
+    }
+}
@@ -3,6 +3,13 @@
 
 #include <iostream>
 #include <mapnik/symbolizer.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/map.hpp>
 
 using namespace mapnik;
 
@@ -26,4 +33,92 @@ SECTION("enums") {
     }
 
 }
+
+SECTION("property table") {
+
+    line_symbolizer sym;
+    REQUIRE(!sym.table);
+    put(sym, keys::stroke_width, 2.0);
+    put(sym, keys::stroke_opacity, parse_expression("[opacity] / 2"));
+    // built by hand, compiled by the table
+    put(sym, keys::offset, std::make_shared<expr_node>(attribute("offset")));
+    put(sym, keys::stroke_linecap, ROUND_CAP);
+    // built once all properties are set, not on every put
+    REQUIRE(!sym.table);
+    CHECK(find_property(sym, keys::stroke_width).value != nullptr);
+    update_property_table(sym);
+    REQUIRE(sym.table);
+    CHECK(sym.table->size() == 4);
+    CHECK(find_property(sym, keys::stroke_opacity).compiled != nullptr);
+    CHECK(find_property(sym, keys::offset).compiled != nullptr);
+    CHECK(find_property(sym, keys::stroke_width).compiled == nullptr);
+    CHECK(find_property(sym, keys::stroke).value == nullptr);
+    CHECK(properties_depend_on_feature(sym));
+    line_symbolizer constant;
+    put(constant, keys::stroke_width, 2.0);
+    put(constant, keys::stroke_opacity, parse_expression("1 / 2"));
+    update_property_table(constant);
+    CHECK_FALSE(properties_depend_on_feature(constant));
+
+    auto ctx = std::make_shared<context_type>();
+    ctx->push("opacity");
+    ctx->push("offset");
+    feature_ptr feature(feature_factory::create(ctx, 1));
+    feature->put("opacity", value_double(0.5));
+    feature->put("offset", value_integer(3));
+    attributes vars;
+    CHECK((get<value_double, keys::stroke_width>(sym, *feature, vars)) == 2.0);
+    CHECK((get<value_double, keys::stroke_opacity>(sym, *feature, vars)) == 0.25);
+    CHECK((get<value_double, keys::offset>(sym, *feature, vars)) == 3.0);
+    CHECK((get<line_cap_enum, keys::stroke_linecap>(sym, *feature, vars)) == ROUND_CAP);
+    CHECK((get<value_double, keys::gamma>(sym, *feature, vars)) == 1.0);
+    CHECK(get<value_double>(sym, keys::stroke_width) == 2.0);
+
+    // copies share the table, changes leave it out of date
+    line_symbolizer copy(sym);
+    CHECK(copy.table == sym.table);
+    put(copy, keys::stroke_width, 4.0);
+    CHECK_FALSE(property_table_current(copy));
+    CHECK((get<value_double, keys::stroke_width>(copy, *feature, vars)) == 4.0);
+    CHECK((get<value_double, keys::stroke_width>(sym, *feature, vars)) == 2.0);
+
+    // properties inserted directly aren't hidden by the table
+    copy.properties.emplace(keys::stroke_miterlimit, 8.0);
+    CHECK((get<value_double, keys::stroke_miterlimit>(copy, *feature, vars)) == 8.0);
+    // nor are values overwritten or replaced without changing the size
+    copy.properties[keys::stroke_width] = 6.0;
+    CHECK((get<value_double, keys::stroke_width>(copy, *feature, vars)) == 6.0);
+    copy.properties.erase(keys::stroke_width);
+    copy.properties.emplace(keys::stroke_width, 7.0);
+    CHECK((get<value_double, keys::stroke_width>(copy, *feature, vars)) == 7.0);
+    CHECK_FALSE(property_table_current(copy));
+    update_property_table(copy);
+    CHECK(property_table_current(copy));
+    CHECK((get<value_double, keys::stroke_width>(copy, *feature, vars)) == 7.0);
+    CHECK(property_table_current(sym));
+    CHECK((get<value_double, keys::stroke_width>(sym, *feature, vars)) == 2.0);
+    // and the batching check sees expressions set directly
+    CHECK_FALSE(properties_depend_on_feature(constant));
+    constant.properties[keys::stroke_width] = parse_expression("[width]");
+    CHECK(properties_depend_on_feature(constant));
+}
+
+SECTION("property tables are built when a style is inserted") {
+
+    line_symbolizer sym;
+    put(sym, keys::stroke_width, 2.0);
+    put(sym, keys::stroke_opacity, parse_expression("[opacity] / 2"));
+    rule r;
+    r.append(std::move(sym));
+    feature_type_style style;
+    style.add_rule(std::move(r));
+    Map m(256, 256);
+    REQUIRE(m.insert_style("style", std::move(style)));
+    boost::optional<feature_type_style const&> inserted = m.find_style("style");
+    REQUIRE(inserted);
+    symbolizer const& inserted_sym = inserted->get_rules().front().get_symbolizers().front();
+    line_symbolizer const& line = util::get<line_symbolizer>(inserted_sym);
+    CHECK(property_table_current(line));
+    CHECK(line.table->size() == 2);
+}
 }
@@ -0,0 +1,167 @@
+#include "catch.hpp"
+
+#include <mapnik/text/glyph_cache.hpp>
+#include <mapnik/text/face.hpp>
+#include <mapnik/text/font_library.hpp>
+#include <mapnik/text/glyph_info.hpp>
+#include <mapnik/text/glyph_positions.hpp>
+#include <mapnik/text/renderer.hpp>
+#include <mapnik/text/text_properties.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/util/fs.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+mapnik::image_rgba8 render_text(mapnik::glyph_positions const& positions, mapnik::stroker_ptr const& stroker)
+{
+    mapnik::image_rgba8 image(96, 48);
+    mapnik::agg_text_renderer<mapnik::image_rgba8> renderer(image, mapnik::HALO_RASTERIZER_FULL,
+                                                            mapnik::src_over, mapnik::src_over,
+                                                            1.0, stroker);
+    renderer.render(positions);
+    return image;
+}
+
+}
+
+TEST_CASE("glyph_cache") {
+
+    std::string font_file("fonts/dejavu-fonts-ttf-2.37/ttf/DejaVuSans.ttf");
+    if (mapnik::util::exists(font_file))
+    {
+        mapnik::glyph_cache & cache = mapnik::glyph_cache::instance();
+        std::size_t max_entries = cache.max_entries();
+        mapnik::font_library library;
+        mapnik::freetype_engine::font_file_mapping_type mapping;
+        mapping.emplace("DejaVu Sans Book", std::make_pair(0, font_file));
+        mapnik::freetype_engine::font_memory_cache_type memory_cache;
+        mapnik::face_manager manager(library, mapping, memory_cache);
+        mapnik::face_ptr face = manager.get_face("DejaVu Sans Book");
+        REQUIRE(face);
+        CHECK(face->file_name() == font_file);
+        unsigned glyph_index = FT_Get_Char_Index(face->get_face(), 'a');
+        REQUIRE(glyph_index != 0);
+
+        SECTION("glyphs are keyed by font file")
+        {
+            // the same face from another file
+            std::string copy_file("/tmp/mapnik-glyph-cache-DejaVuSans.ttf");
+            {
+                std::ifstream in(font_file.c_str(), std::ios::binary);
+                std::ofstream out(copy_file.c_str(), std::ios::binary);
+                out << in.rdbuf();
+            }
+            mapnik::freetype_engine::font_file_mapping_type copy_mapping;
+            copy_mapping.emplace("DejaVu Sans Book", std::make_pair(0, copy_file));
+            mapnik::face_manager copy_manager(library, copy_mapping, memory_cache);
+            mapnik::face_ptr copy_face = copy_manager.get_face("DejaVu Sans Book");
+            REQUIRE(copy_face);
+            CHECK(copy_face->family_name() == face->family_name());
+            CHECK(copy_face->style_name() == face->style_name());
+
+            cache.clear();
+            mapnik::glyph_bitmap_ptr bitmap = cache.get(*face, 12.0, glyph_index, 1, 2, 0, 0.0, manager.get_stroker());
+            REQUIRE(bitmap);
+            CHECK(cache.get(*face, 12.0, glyph_index, 1, 2, 0, 0.0, manager.get_stroker()) == bitmap);
+            CHECK(cache.hits() == 1);
+            mapnik::glyph_bitmap_ptr copy_bitmap = cache.get(*copy_face, 12.0, glyph_index, 1, 2, 0, 0.0,
+                                                             copy_manager.get_stroker());
+            REQUIRE(copy_bitmap);
+            CHECK(copy_bitmap != bitmap);
+            CHECK(cache.misses() == 2);
+            CHECK(copy_bitmap->buffer == bitmap->buffer);
+
+            // faces not loaded from a file bypass the cache
+            FT_Face ft_face;
+            REQUIRE(FT_New_Face(library.get(), font_file.c_str(), 0, &ft_face) == 0);
+            mapnik::font_face anonymous(ft_face);
+            CHECK(cache.get(anonymous, 12.0, glyph_index, 1, 2, 0, 0.0, manager.get_stroker()));
+            CHECK(cache.size() == 2);
+            cache.clear();
+            std::remove(copy_file.c_str());
+        }
+
+        SECTION("cached glyphs render like uncached ones")
+        {
+            mapnik::evaluated_format_properties_ptr format(new mapnik::detail::evaluated_format_properties());
+            format->text_size = 14.0;
+            format->text_opacity = 1.0;
+            format->halo_opacity = 1.0;
+            format->halo_radius = 0.0;
+            format->fill = mapnik::color(0, 0, 0);
+
+            std::string text("Mapnik");
+            std::vector<mapnik::glyph_info> glyphs;
+            glyphs.reserve(text.size());
+            for (unsigned i = 0; i < text.size(); ++i)
+            {
+                glyphs.emplace_back(FT_Get_Char_Index(face->get_face(), text[i]), i, format);
+                glyphs.back().face = face;
+            }
+            // origins on the subpixel grid, where snapping doesn't move them
+            mapnik::glyph_positions positions;
+            positions.set_base_point(mapnik::pixel_position(4.25, 30.5));
+            double x = 0.0;
+            for (auto const& glyph : glyphs)
+            {
+                positions.emplace_back(glyph, mapnik::pixel_position(x, 0.75), mapnik::rotation());
+                x += 11.25;
+            }
+
+            cache.clear();
+            cache.set_max_entries(max_entries > 0 ? max_entries : 10000);
+            mapnik::image_rgba8 cached = render_text(positions, manager.get_stroker());
+            CHECK(cache.size() > 0);
+            cache.set_max_entries(0);
+            mapnik::image_rgba8 uncached = render_text(positions, manager.get_stroker());
+            CHECK(cache.size() == 0);
+            cache.set_max_entries(max_entries);
+
+            CHECK_FALSE(uncached == mapnik::image_rgba8(96, 48));
+            CHECK(cached == uncached);
+
+            // rotated by a whole rotation step, as along a line
+            mapnik::rotation rot = mapnik::glyph_cache::step_rotation(mapnik::glyph_cache::rotation_steps / 16);
+            CHECK(mapnik::glyph_cache::snap_rotation(rot) == mapnik::glyph_cache::rotation_steps / 16);
+            mapnik::glyph_positions rotated;
+            rotated.set_base_point(mapnik::pixel_position(4.25, 40.5));
+            for (auto const& glyph_pos : positions)
+            {
+                rotated.emplace_back(glyph_pos.glyph, glyph_pos.pos, rot);
+            }
+            cache.set_max_entries(max_entries > 0 ? max_entries : 10000);
+            mapnik::image_rgba8 rotated_cached = render_text(rotated, manager.get_stroker());
+            CHECK(cache.size() > 0);
+            cache.set_max_entries(0);
+            mapnik::image_rgba8 rotated_uncached = render_text(rotated, manager.get_stroker());
+            cache.set_max_entries(max_entries);
+
+            CHECK_FALSE(rotated_uncached == uncached);
+            CHECK(rotated_cached == rotated_uncached);
+        }
+
+        SECTION("rotations are snapped to rotation steps")
+        {
+            unsigned steps = mapnik::glyph_cache::rotation_steps;
+            CHECK(mapnik::glyph_cache::snap_rotation(mapnik::rotation()) == 0);
+            CHECK(mapnik::glyph_cache::snap_rotation(mapnik::rotation(-2 * M_PI / steps)) == steps - 1);
+            CHECK(mapnik::glyph_cache::snap_rotation(mapnik::rotation(M_PI)) == steps / 2);
+            CHECK(mapnik::glyph_cache::snap_rotation(mapnik::rotation(0.4 * 2 * M_PI / steps)) == 0);
+            mapnik::glyph_bitmap_ptr upright = cache.get(*face, 12.0, glyph_index, 0, 0, 0, 0.0, manager.get_stroker());
+            mapnik::glyph_bitmap_ptr turned = cache.get(*face, 12.0, glyph_index, 0, 0, steps / 4, 0.0, manager.get_stroker());
+            REQUIRE(upright);
+            REQUIRE(turned);
+            CHECK(turned != upright);
+            CHECK(turned->width == upright->rows);
+            CHECK(turned->rows == upright->width);
+            cache.clear();
+        }
+        cache.set_max_entries(max_entries);
+    }
+}
@@ -0,0 +1,135 @@
+#include "catch.hpp"
+
+#include <mapnik/text/shaped_text_cache.hpp>
+#include <mapnik/text/text_layout.hpp>
+#include <mapnik/text/text_properties.hpp>
+#include <mapnik/text/font_library.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/util/fs.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct laid_out_glyph
+{
+    unsigned glyph_index;
+    unsigned char_index;
+    std::string face_file;
+    double advance;
+    double line_width;
+
+    bool operator==(laid_out_glyph const& rhs) const
+    {
+        return glyph_index == rhs.glyph_index && char_index == rhs.char_index &&
+            face_file == rhs.face_file && advance == rhs.advance && line_width == rhs.line_width;
+    }
+};
+
+std::vector<laid_out_glyph> layout_text(mapnik::face_manager_freetype & font_manager,
+                                        std::string const& text)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    mapnik::text_symbolizer_properties properties;
+    mapnik::text_layout layout(font_manager, *feature, mapnik::attributes(), 1.0,
+                               properties, properties.layout_defaults, mapnik::formatting::node_ptr());
+    mapnik::evaluated_format_properties_ptr format(new mapnik::detail::evaluated_format_properties());
+    format->face_name = "DejaVu Sans Book";
+    format->text_size = 12.0;
+    layout.add_text(mapnik::value_unicode_string(text.c_str()), format);
+    layout.layout();
+    std::vector<laid_out_glyph> glyphs;
+    for (auto const& line : layout)
+    {
+        for (auto const& glyph : line)
+        {
+            glyphs.push_back(laid_out_glyph{glyph.glyph_index, glyph.char_index,
+                        glyph.face->file_name(), glyph.advance(), line.width()});
+        }
+    }
+    return glyphs;
+}
+
+}
+
+TEST_CASE("shaped_text_cache") {
+
+SECTION("stores shaped lines by key") {
+
+    mapnik::shaped_text_cache & cache = mapnik::shaped_text_cache::instance();
+    std::size_t max_entries = cache.max_entries();
+    cache.clear();
+    CHECK(!cache.find("key"));
+    CHECK(cache.misses() == 1);
+
+    auto line = std::make_shared<mapnik::shaped_line>();
+    line->max_char_height = 10.0;
+    cache.insert("key", line);
+    mapnik::shaped_line_ptr cached = cache.find("key");
+    REQUIRE(cached);
+    CHECK(cached->max_char_height == 10.0);
+    CHECK(cache.hits() == 1);
+
+    cache.set_max_entries(0);
+    CHECK(cache.size() == 0);
+    cache.insert("key", line);
+    CHECK(!cache.find("key"));
+    cache.set_max_entries(max_entries);
+    cache.clear();
+}
+
+SECTION("text laid out from cached shaping matches uncached layout") {
+
+    std::string font_file("fonts/dejavu-fonts-ttf-2.37/ttf/DejaVuSans.ttf");
+    if (mapnik::util::exists(font_file))
+    {
+        mapnik::shaped_text_cache & cache = mapnik::shaped_text_cache::instance();
+        std::size_t max_entries = cache.max_entries();
+        mapnik::font_library library;
+        mapnik::freetype_engine::font_file_mapping_type mapping;
+        mapping.emplace("DejaVu Sans Book", std::make_pair(0, font_file));
+        mapnik::freetype_engine::font_memory_cache_type memory_cache;
+        mapnik::face_manager_freetype manager(library, mapping, memory_cache);
+        std::string text("Mapnik AV");
+
+        cache.set_max_entries(0);
+        std::vector<laid_out_glyph> uncached = layout_text(manager, text);
+        REQUIRE(!uncached.empty());
+
+        cache.set_max_entries(max_entries > 0 ? max_entries : 10000);
+        cache.clear();
+        CHECK(layout_text(manager, text) == uncached);
+        CHECK(cache.misses() == 1);
+        CHECK(layout_text(manager, text) == uncached);
+        CHECK(cache.hits() == 1);
+
+        // the same face name resolving to another font file is shaped again
+        std::string copy_file("/tmp/mapnik-shaped-text-cache-DejaVuSans.ttf");
+        {
+            std::ifstream in(font_file.c_str(), std::ios::binary);
+            std::ofstream out(copy_file.c_str(), std::ios::binary);
+            out << in.rdbuf();
+        }
+        mapnik::freetype_engine::font_file_mapping_type copy_mapping;
+        copy_mapping.emplace("DejaVu Sans Book", std::make_pair(0, copy_file));
+        mapnik::face_manager_freetype copy_manager(library, copy_mapping, memory_cache);
+        std::vector<laid_out_glyph> copy = layout_text(copy_manager, text);
+        CHECK(cache.hits() == 1);
+        CHECK(cache.misses() == 2);
+        REQUIRE(copy.size() == uncached.size());
+        CHECK(copy.front().face_file == copy_file);
+
+        cache.set_max_entries(max_entries);
+        cache.clear();
+        std::remove(copy_file.c_str());
+    }
+}
+
+}
@@ -0,0 +1,80 @@
+#include "catch.hpp"
+
+#include <mapnik/util/lru_cache.hpp>
+
+#include <string>
+
+namespace {
+
+struct string_length
+{
+    std::size_t operator()(std::string const& value) const
+    {
+        return value.size();
+    }
+};
+
+}
+
+TEST_CASE("lru_cache") {
+
+SECTION("evicts least recently used entry") {
+
+    mapnik::util::lru_cache<std::string, int> cache(2);
+    cache.insert("a", 1);
+    cache.insert("b", 2);
+    REQUIRE(cache.find("a") != nullptr);
+    CHECK(*cache.find("a") == 1);
+    cache.insert("c", 3); // "b" is least recently used
+    CHECK(cache.size() == 2);
+    CHECK(cache.find("b") == nullptr);
+    REQUIRE(cache.find("c") != nullptr);
+    CHECK(*cache.find("c") == 3);
+    cache.insert("a", 4);
+    CHECK(*cache.find("a") == 4);
+    CHECK(cache.size() == 2);
+}
+
+SECTION("capacity") {
+
+    mapnik::util::lru_cache<int, int> cache(4);
+    for (int i = 0; i < 4; ++i) cache.insert(i, i);
+    cache.set_capacity(1);
+    CHECK(cache.size() == 1);
+    CHECK(cache.find(3) != nullptr);
+    cache.set_capacity(0);
+    cache.insert(5, 5);
+    CHECK(cache.size() == 0);
+    cache.set_capacity(2);
+    cache.insert(5, 5);
+    cache.clear();
+    CHECK(cache.size() == 0);
+    CHECK(cache.find(5) == nullptr);
+}
+
+SECTION("cost") {
+
+    mapnik::util::lru_cache<int, std::string, std::hash<int>, string_length> cache(6);
+    cache.insert(1, "ab");
+    cache.insert(2, "cd");
+    cache.insert(3, "ef");
+    CHECK(cache.cost() == 6);
+    cache.insert(4, "ghij"); // evicts 1 and 2
+    CHECK(cache.size() == 2);
+    CHECK(cache.cost() == 6);
+    CHECK(cache.find(1) == nullptr);
+    CHECK(cache.find(2) == nullptr);
+    cache.insert(3, "e"); // replacing an entry updates its cost
+    CHECK(cache.cost() == 5);
+    cache.insert(5, "klmnopq"); // costs more than the capacity
+    CHECK(cache.find(5) == nullptr);
+    CHECK(cache.size() == 2);
+    cache.set_capacity(4); // evicts 4, 3 was used more recently
+    CHECK(cache.size() == 1);
+    CHECK(cache.find(3) != nullptr);
+    CHECK(cache.find(4) == nullptr);
+    cache.clear();
+    CHECK(cache.cost() == 0);
+}
+
+}
@@ -27,6 +27,7 @@
 
 #include <mapnik/util/fs.hpp>
 #include <mapnik/quad_tree.hpp>
+#include <mapnik/util/hilbert_rtree.hpp>
 
 #include "process_csv_file.hpp"
 #include "process_geojson_file.hpp"
@@ -64,6 +65,7 @@ int main (int argc, char** argv)
     bool validate_features = false;
     unsigned int depth = DEFAULT_DEPTH;
     double ratio = DEFAULT_RATIO;
+    unsigned index_version = 1;
     std::vector<std::string> files;
     char separator = 0;
     char quote = 0;
@@ -77,6 +79,7 @@ int main (int argc, char** argv)
             ("verbose,v","verbose output")
             ("depth,d", po::value<unsigned int>(), "max tree depth\n(default 8)")
             ("ratio,r",po::value<double>(),"split ratio (default 0.55)")
+            ("index-version", po::value<unsigned>(), "index file version: 1, 2 for aligned records read in place or 3 for a packed Hilbert R-tree (default 1)")
             ("separator,s", po::value<char>(), "CSV columns separator")
             ("quote,q", po::value<char>(), "CSV columns quote")
             ("manual-headers,H", po::value<std::string>(), "CSV manual headers string")
@@ -116,6 +119,15 @@ int main (int argc, char** argv)
         {
             ratio = vm["ratio"].as<double>();
         }
+        if (vm.count("index-version"))
+        {
+            index_version = vm["index-version"].as<unsigned>();
+            if (index_version < 1 || index_version > 3)
+            {
+                std::clog << "Error: unsupported index version " << index_version << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
         if (vm.count("separator"))
         {
             separator = vm["separator"].as<char>();
@@ -204,10 +216,13 @@ int main (int argc, char** argv)
             std::clog << extent << std::endl;
             mapnik::box2d<double> extent_d(extent.minx(), extent.miny(), extent.maxx(), extent.maxy());
             mapnik::quad_tree<std::pair<std::size_t, std::size_t>> tree(extent_d, depth, ratio);
+            mapnik::util::hilbert_rtree_builder<std::pair<std::size_t, std::size_t>> packed_tree;
             for (auto const& item : boxes)
             {
                 auto ext_f = std::get<0>(item);
-                tree.insert(std::get<1>(item), mapnik::box2d<double>(ext_f.minx(), ext_f.miny(), ext_f.maxx(), ext_f.maxy()));
+                mapnik::box2d<double> item_ext(ext_f.minx(), ext_f.miny(), ext_f.maxx(), ext_f.maxy());
+                if (index_version == 3) packed_tree.insert(std::get<1>(item), item_ext);
+                else tree.insert(std::get<1>(item), item_ext);
             }
 
             std::fstream file((filename + ".index").c_str(),
@@ -219,11 +234,19 @@ int main (int argc, char** argv)
             }
             else
             {
-                tree.trim();
-                std::clog <<  "number nodes=" << tree.count() << std::endl;
-                std::clog <<  "number element=" << tree.count_items() << std::endl;
                 file.exceptions(std::ios::failbit | std::ios::badbit);
-                tree.write(file);
+                if (index_version == 3)
+                {
+                    std::clog <<  "number element=" << packed_tree.size() << std::endl;
+                    packed_tree.write(file);
+                }
+                else
+                {
+                    tree.trim();
+                    std::clog <<  "number nodes=" << tree.count() << std::endl;
+                    std::clog <<  "number element=" << tree.count_items() << std::endl;
+                    tree.write(file, index_version);
+                }
                 file.flush();
                 file.close();
             }
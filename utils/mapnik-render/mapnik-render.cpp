@@ -4,6 +4,7 @@
 #include <mapnik/version.hpp>
 #include <mapnik/debug.hpp>
 #include <mapnik/image_util.hpp>
+#include <mapnik/metatile.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/datasource_cache.hpp>
 #include <mapnik/font_engine_freetype.hpp>
@@ -15,6 +16,7 @@
 #pragma GCC diagnostic pop
 
 #include <string>
+#include <fstream>
 
 int main (int argc,char** argv)
 {
@@ -27,6 +29,9 @@ int main (int argc,char** argv)
     std::string img_file;
     double scale_factor = 1;
     bool params_as_variables = false;
+    unsigned metatile = 0;
+    unsigned tile_size = 256;
+    unsigned jobs = 0;
     mapnik::logger logger;
     logger.set_severity(mapnik::logger::error);
 
@@ -42,6 +47,9 @@ int main (int argc,char** argv)
             ("img",po::value<std::string>(),"image to render")
             ("scale-factor",po::value<double>(),"scale factor for rendering")
             ("variables","make map parameters available as render-time variables")
+            ("metatile",po::value<unsigned>(),"render a NxN metatile once and write its tiles as <img>-<column>-<row>.<ext>")
+            ("tile-size",po::value<unsigned>(),"size of metatile tiles in pixels (default 256)")
+            ("jobs",po::value<unsigned>(),"number of threads encoding metatile tiles (default: all cores)")
             ;
 
         po::positional_options_description p;
@@ -103,10 +111,29 @@ int main (int argc,char** argv)
             params_as_variables = true;
         }
 
+        if (vm.count("metatile"))
+        {
+            metatile = vm["metatile"].as<unsigned>();
+        }
+
+        if (vm.count("tile-size"))
+        {
+            tile_size = vm["tile-size"].as<unsigned>();
+        }
+
+        if (vm.count("jobs"))
+        {
+            jobs = vm["jobs"].as<unsigned>();
+        }
+
         mapnik::datasource_cache::instance().register_datasources("./plugins/input/");
         mapnik::freetype_engine::register_fonts("./fonts",true);
         mapnik::Map map(600,400);
         mapnik::load_map(map,xml_file,true);
+        if (metatile > 0)
+        {
+            map.resize(metatile * tile_size, metatile * tile_size);
+        }
         map.zoom_all();
         mapnik::image_rgba8 im(map.width(),map.height());
         mapnik::request req(map.width(),map.height(),map.get_current_extent());
@@ -137,7 +164,38 @@ int main (int argc,char** argv)
         }
         mapnik::agg_renderer<mapnik::image_rgba8> ren(map,req,vars,im,scale_factor,0,0);
         ren.apply();
-        mapnik::save_to_file(im,img_file);
+        if (metatile > 0)
+        {
+            mapnik::metatile_options opts;
+            opts.columns = metatile;
+            opts.rows = metatile;
+            opts.format = mapnik::guess_type(img_file);
+            opts.jobs = jobs;
+            std::string::size_type dot = img_file.find_last_of('.');
+            std::string stem = img_file.substr(0, dot);
+            std::string ext = dot == std::string::npos ? std::string() : img_file.substr(dot);
+            std::size_t solid = 0;
+            for (mapnik::metatile_tile const& tile : mapnik::split_metatile(im, opts))
+            {
+                std::string tile_file = stem + "-" + std::to_string(tile.column) + "-" + std::to_string(tile.row) + ext;
+                std::ofstream file(tile_file.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+                if (!file)
+                {
+                    throw mapnik::image_writer_exception("could not write file to " + tile_file);
+                }
+                file << tile.data;
+                if (tile.solid) ++solid;
+            }
+            if (verbose)
+            {
+                std::clog << "metatile: " << metatile * metatile << " tiles, " << solid << " solid\n";
+            }
+            img_file = stem + "-0-0" + ext;
+        }
+        else
+        {
+            mapnik::save_to_file(im,img_file);
+        }
         if (auto_open)
         {
             std::ostringstream s;
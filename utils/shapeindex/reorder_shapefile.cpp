@@ -0,0 +1,243 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "reorder_shapefile.hpp"
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/util/fs.hpp>
+#include <mapnik/util/hilbert_rtree.hpp>
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace mapnik { namespace detail {
+
+namespace {
+
+// shapefile main header and shx records use big endian integers counted in 16 bit words
+std::int32_t read_xdr_integer(char const* b)
+{
+    return static_cast<std::int32_t>((static_cast<std::uint32_t>(b[0] & 0xff) << 24) | (b[1] & 0xff) << 16 | (b[2] & 0xff) << 8 | (b[3] & 0xff));
+}
+
+void write_xdr_integer(char * b, std::int32_t val)
+{
+    b[0] = static_cast<char>((val >> 24) & 0xff);
+    b[1] = static_cast<char>((val >> 16) & 0xff);
+    b[2] = static_cast<char>((val >> 8) & 0xff);
+    b[3] = static_cast<char>(val & 0xff);
+}
+
+std::int32_t read_ndr_integer(char const* b)
+{
+    return static_cast<std::int32_t>((b[0] & 0xff) | (b[1] & 0xff) << 8 | (b[2] & 0xff) << 16 | static_cast<std::uint32_t>(b[3] & 0xff) << 24);
+}
+
+double read_double(char const* b)
+{
+    double val;
+    std::memcpy(&val, b, 8);
+    return val;
+}
+
+struct shape_record
+{
+    std::int32_t offset; // in 16 bit words
+    std::int32_t content_length; // in 16 bit words
+    std::uint32_t hilbert;
+    std::size_t number;
+};
+
+bool copy_file(std::string const& from, std::string const& to)
+{
+    std::ifstream in(from.c_str(), std::ios::binary);
+    std::ofstream out(to.c_str(), std::ios::trunc | std::ios::binary);
+    if (!in || !out) return false;
+    out << in.rdbuf();
+    return static_cast<bool>(out);
+}
+
+bool reorder_dbf(std::string const& dbfname, std::string const& output, std::vector<shape_record> const& records)
+{
+    std::ifstream in(dbfname.c_str(), std::ios::binary);
+    if (!in) return false;
+    char header[32];
+    if (!in.read(header, 32)) return false;
+    std::uint32_t num_records = static_cast<std::uint32_t>(read_ndr_integer(header + 4));
+    std::size_t header_length = (header[8] & 0xff) | (header[9] & 0xff) << 8;
+    std::size_t record_length = (header[10] & 0xff) | (header[11] & 0xff) << 8;
+    if (num_records != records.size() || header_length < 32 || record_length == 0)
+    {
+        std::clog << "Error : " << dbfname << " record count does not match shapefile" << std::endl;
+        return false;
+    }
+    std::vector<char> buffer(std::max(header_length, record_length));
+    in.seekg(0, std::ios::beg);
+    if (!in.read(buffer.data(), header_length)) return false;
+    std::ofstream out(output.c_str(), std::ios::trunc | std::ios::binary);
+    if (!out) return false;
+    out.write(buffer.data(), header_length);
+    for (auto const& record : records)
+    {
+        in.seekg(header_length + record.number * record_length, std::ios::beg);
+        if (!in.read(buffer.data(), record_length)) return false;
+        out.write(buffer.data(), record_length);
+    }
+    out.put(0x1a); // end of file marker
+    return static_cast<bool>(out);
+}
+
+}
+
+bool reorder_shapefile(std::string const& shapename, std::string const& output_name)
+{
+    std::string const shpname = shapename + ".shp";
+    std::string const shxname = shapename + ".shx";
+    std::ifstream shp(shpname.c_str(), std::ios::binary);
+    std::ifstream shx(shxname.c_str(), std::ios::binary);
+    if (!shp || !shx)
+    {
+        std::clog << "Error : cannot open " << shapename << std::endl;
+        return false;
+    }
+    char header[100];
+    if (!shx.read(header, 100) || read_xdr_integer(header) != 9994)
+    {
+        std::clog << "Error : " << shxname << " is not a shapefile index" << std::endl;
+        return false;
+    }
+    std::int32_t file_length = read_xdr_integer(header + 24);
+    box2d<double> extent(read_double(header + 36), read_double(header + 44),
+                         read_double(header + 52), read_double(header + 60));
+    double width = extent.width() > 0 ? extent.width() : 1.0;
+    double height = extent.height() > 0 ? extent.height() : 1.0;
+    double const max_coord = (1 << 16) - 1;
+
+    std::vector<shape_record> records;
+    records.reserve(file_length > 50 ? (file_length - 50) / 4 : 0);
+    char entry[8];
+    char content[36];
+    while (shx.read(entry, 8))
+    {
+        shape_record record;
+        record.offset = read_xdr_integer(entry);
+        record.content_length = read_xdr_integer(entry + 4);
+        record.number = records.size();
+        record.hilbert = std::numeric_limits<std::uint32_t>::max();
+        std::size_t content_size = std::min<std::size_t>(sizeof(content), record.content_length * 2);
+        shp.seekg(record.offset * 2 + 8, std::ios::beg);
+        if (record.content_length < 2 || !shp.read(content, content_size))
+        {
+            std::clog << "Error : cannot read record " << record.number + 1 << " of " << shpname << std::endl;
+            return false;
+        }
+        std::int32_t shape_type = read_ndr_integer(content);
+        double x = 0;
+        double y = 0;
+        bool empty = true;
+        if (shape_type == 1 || shape_type == 11 || shape_type == 21) // points
+        {
+            if (content_size >= 20)
+            {
+                x = read_double(content + 4);
+                y = read_double(content + 12);
+                empty = false;
+            }
+        }
+        else if (shape_type != 0 && content_size >= 36)
+        {
+            x = (read_double(content + 4) + read_double(content + 20)) / 2;
+            y = (read_double(content + 12) + read_double(content + 28)) / 2;
+            empty = false;
+        }
+        if (!empty && extent.contains(x, y))
+        {
+            record.hilbert = util::hilbert_index(
+                static_cast<std::uint32_t>(max_coord * (x - extent.minx()) / width),
+                static_cast<std::uint32_t>(max_coord * (y - extent.miny()) / height));
+        }
+        records.push_back(record);
+    }
+    std::stable_sort(records.begin(), records.end(), [](shape_record const& r0, shape_record const& r1)
+                     { return r0.hilbert < r1.hilbert; });
+
+    std::ofstream shp_out((output_name + ".shp").c_str(), std::ios::trunc | std::ios::binary);
+    std::ofstream shx_out((output_name + ".shx").c_str(), std::ios::trunc | std::ios::binary);
+    if (!shp_out || !shx_out)
+    {
+        std::clog << "Error : cannot open " << output_name << " for writing" << std::endl;
+        return false;
+    }
+    // headers are identical apart from the file length
+    std::int32_t shp_length = 50;
+    for (auto const& record : records) shp_length += 4 + record.content_length;
+    write_xdr_integer(header + 24, shp_length);
+    shp_out.write(header, 100);
+    write_xdr_integer(header + 24, 50 + 4 * static_cast<std::int32_t>(records.size()));
+    shx_out.write(header, 100);
+
+    std::vector<char> buffer;
+    std::int32_t offset = 50;
+    for (std::size_t i = 0; i < records.size(); ++i)
+    {
+        auto const& record = records[i];
+        buffer.resize(8 + record.content_length * 2);
+        shp.seekg(record.offset * 2, std::ios::beg);
+        if (!shp.read(buffer.data(), buffer.size()))
+        {
+            std::clog << "Error : cannot read record " << record.number + 1 << " of " << shpname << std::endl;
+            return false;
+        }
+        write_xdr_integer(buffer.data(), static_cast<std::int32_t>(i + 1)); // record number
+        shp_out.write(buffer.data(), buffer.size());
+        write_xdr_integer(entry, offset);
+        write_xdr_integer(entry + 4, record.content_length);
+        shx_out.write(entry, 8);
+        offset += 4 + record.content_length;
+    }
+    if (!shp_out || !shx_out)
+    {
+        std::clog << "Error : failed writing " << output_name << std::endl;
+        return false;
+    }
+
+    if (mapnik::util::exists(shapename + ".dbf") &&
+        !reorder_dbf(shapename + ".dbf", output_name + ".dbf", records))
+    {
+        std::clog << "Error : failed writing " << output_name << ".dbf" << std::endl;
+        return false;
+    }
+    for (char const* ext : { ".prj", ".cpg" })
+    {
+        if (mapnik::util::exists(shapename + ext)) copy_file(shapename + ext, output_name + ext);
+    }
+    return true;
+}
+
+}}
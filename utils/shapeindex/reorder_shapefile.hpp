@@ -0,0 +1,38 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTILS_REORDER_SHAPEFILE_HPP
+#define MAPNIK_UTILS_REORDER_SHAPEFILE_HPP
+
+#include <string>
+
+namespace mapnik { namespace detail {
+
+// Writes a copy of shapefile `shapename` (.shp/.shx and, if present,
+// .dbf/.prj/.cpg) to `output_name` with records sorted by the Hilbert
+// value of their bounding box centres, so spatially close features are
+// close in the file. Empty (null) shapes are moved to the end.
+bool reorder_shapefile(std::string const& shapename, std::string const& output_name);
+
+}}
+
+#endif // MAPNIK_UTILS_REORDER_SHAPEFILE_HPP
@@ -26,10 +26,12 @@
 #include <string>
 #include <mapnik/util/fs.hpp>
 #include <mapnik/quad_tree.hpp>
+#include <mapnik/util/hilbert_rtree.hpp>
 #include <mapnik/geometry_envelope.hpp>
 #include "shapefile.hpp"
 #include "shape_io.hpp"
 #include "shape_index_featureset.hpp"
+#include "reorder_shapefile.hpp"
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
 #include <boost/algorithm/string.hpp>
@@ -46,8 +48,10 @@ int main (int argc,char** argv)
 
     bool verbose=false;
     bool index_parts = false;
+    bool reorder = false;
     unsigned int depth = DEFAULT_DEPTH;
     double ratio = DEFAULT_RATIO;
+    unsigned index_version = 1;
     std::vector<std::string> shape_files;
 
     try
@@ -57,9 +61,11 @@ int main (int argc,char** argv)
             ("help,h", "produce usage message")
             ("version,V","print version string")
             ("index-parts","index individual shape parts (default: no)")
+            ("reorder","write a copy of each shape file with records in Hilbert curve order\n(<name>_hilbert.shp, .shx, .dbf) and index the copy (default: no)")
             ("verbose,v","verbose output")
             ("depth,d", po::value<unsigned int>(), "max tree depth\n(default 8)")
             ("ratio,r",po::value<double>(),"split ratio (default 0.55)")
+            ("index-version", po::value<unsigned>(), "index file version: 1, 2 for aligned records read in place or 3 for a packed Hilbert R-tree (default 1)")
             ("shape_files",po::value<std::vector<std::string> >(),"shape files to index: file1 file2 ...fileN")
             ;
 
@@ -88,6 +94,10 @@ int main (int argc,char** argv)
         {
             index_parts = true;
         }
+        if (vm.count("reorder"))
+        {
+            reorder = true;
+        }
         if (vm.count("depth"))
         {
             depth = vm["depth"].as<unsigned int>();
@@ -96,6 +106,15 @@ int main (int argc,char** argv)
         {
             ratio = vm["ratio"].as<double>();
         }
+        if (vm.count("index-version"))
+        {
+            index_version = vm["index-version"].as<unsigned>();
+            if (index_version < 1 || index_version > 3)
+            {
+                std::clog << "Error: unsupported index version " << index_version << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
 
         if (vm.count("shape_files"))
         {
@@ -133,6 +152,18 @@ int main (int argc,char** argv)
             std::clog << "Error : shapefile index file (*.shx) " << shxname << " does not exist" << std::endl;
             continue;
         }
+        if (reorder)
+        {
+            std::string reordered_name(shapename + "_hilbert");
+            std::clog << "reordering into " << reordered_name << ".shp" << std::endl;
+            if (!mapnik::detail::reorder_shapefile(shapename, reordered_name))
+            {
+                continue;
+            }
+            shapename = reordered_name;
+            shapename_full = shapename + ".shp";
+            shxname = shapename + ".shx";
+        }
         shape_file shp (shapename_full);
 
         if (! shp.is_open())
@@ -172,6 +203,12 @@ int main (int argc,char** argv)
         int pos = 50;
         shx.seek(pos * 2);
         mapnik::quad_tree<mapnik::detail::node> tree(extent, depth, ratio);
+        mapnik::util::hilbert_rtree_builder<mapnik::detail::node> packed_tree;
+        auto insert_item = [&](mapnik::detail::node const& item, box2d<double> const& item_ext)
+        {
+            if (index_version == 3) packed_tree.insert(item, item_ext);
+            else tree.insert(item, item_ext);
+        };
         int count = 0;
 
         if (shape_type != shape_io::shape_null)
@@ -234,7 +271,7 @@ int main (int argc,char** argv)
                             {
                                 std::clog << "record number " << record_number << " box=" << item_ext << std::endl;
                             }
-                            tree.insert(mapnik::detail::node(offset * 2, start, end),item_ext);
+                            insert_item(mapnik::detail::node(offset * 2, start, end),item_ext);
                             ++count;
                         }
                     }
@@ -251,7 +288,7 @@ int main (int argc,char** argv)
                     {
                         std::clog << "record number " << record_number << " box=" << item_ext << std::endl;
                     }
-                    tree.insert(mapnik::detail::node(offset * 2,-1,0),item_ext);
+                    insert_item(mapnik::detail::node(offset * 2,-1,0),item_ext);
                     ++count;
                 }
             }
@@ -268,10 +305,17 @@ int main (int argc,char** argv)
             }
             else
             {
-                tree.trim();
-                std::clog << " number nodes=" << tree.count() << std::endl;
                 file.exceptions(std::ios::failbit | std::ios::badbit);
-                tree.write(file);
+                if (index_version == 3)
+                {
+                    packed_tree.write(file);
+                }
+                else
+                {
+                    tree.trim();
+                    std::clog << " number nodes=" << tree.count() << std::endl;
+                    tree.write(file, index_version);
+                }
                 file.flush();
                 file.close();
             }